@@ -0,0 +1,108 @@
+#ifndef FOXY_BENCH_BENCH_HPP_
+#define FOXY_BENCH_BENCH_HPP_
+
+#include "foxy/metrics.hpp"
+
+#include <ctime>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <functional>
+
+namespace bench {
+
+struct options {
+  // how many requests, tunnelled bodies or parses each scenario performs
+  //
+  std::size_t iterations = 10000;
+
+  // the size of the response bodies served by the loopback origin
+  //
+  std::size_t body_size = 1024;
+
+  // the number and size of the bodies relayed through the proxy tunnel
+  //
+  std::size_t tunnel_iterations = 200;
+  std::size_t tunnel_body_size  = 1024 * 1024;
+};
+
+struct result {
+  std::string                             name;
+  std::uint64_t                           iterations = 0;
+  std::uint64_t                           bytes      = 0;
+  std::chrono::nanoseconds                elapsed    = {};
+  std::optional<foxy::histogram_snapshot> latency;
+  std::optional<std::uint64_t>            syscalls;
+  std::optional<std::chrono::nanoseconds> cpu_time;
+};
+
+using scenario = std::function<result(options const&)>;
+
+struct registered_scenario {
+  std::string name;
+  scenario    run;
+};
+
+auto scenarios() -> std::vector<registered_scenario>&;
+
+// registrar adds a scenario to the suite from a namespace-scope object in
+// whichever file defines it
+//
+struct registrar {
+  registrar(std::string name, scenario run) {
+    scenarios().push_back({std::move(name), std::move(run)});
+  }
+};
+
+// timer measures the wall clock time of a whole scenario
+//
+struct timer {
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+
+  auto elapsed() const -> std::chrono::nanoseconds {
+    return std::chrono::steady_clock::now() - start;
+  }
+};
+
+// cpu_timer measures the processor time used by every thread in the process,
+// user and system alike, over a whole scenario
+//
+struct cpu_timer {
+  std::clock_t start = std::clock();
+
+  auto elapsed() const -> std::chrono::nanoseconds {
+    auto const seconds =
+      static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(seconds));
+  }
+};
+
+// syscall_counter counts the system calls made by the thread which created
+// it, along with any threads that thread starts afterwards, using the
+// `raw_syscalls:sys_enter` tracepoint
+//
+// this needs Linux, a mounted tracefs and enough privilege to open perf
+// events; whenever any of that is missing, `count` is empty
+//
+struct syscall_counter {
+
+private:
+  int fd_;
+
+public:
+  syscall_counter();
+  syscall_counter(syscall_counter const&) = delete;
+  ~syscall_counter();
+
+  auto count() const -> std::optional<std::uint64_t>;
+};
+
+} // bench
+
+#endif // FOXY_BENCH_BENCH_HPP_
@@ -0,0 +1,164 @@
+#include "bench.hpp"
+
+#include "foxy/coroutine.hpp"
+#include "foxy/client_session.hpp"
+
+#include "foxy/test/origin.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <tuple>
+#include <chrono>
+#include <string>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using boost::system::error_code;
+
+namespace {
+
+// how the request loops below find out whether an operation failed: with the
+// error code redirected into a variable the loop checks afterwards, or handed
+// back alongside the result with `foxy::as_tuple`
+//
+enum class error_style { redirect, tuple };
+
+struct loop_stats {
+  foxy::histogram latency;
+  std::uint64_t   requests = 0;
+  std::uint64_t   bytes    = 0;
+};
+
+auto request_loop(
+  asio::io_context& io,
+  std::string const port,
+  error_style const style,
+  std::size_t const iterations,
+  loop_stats&       stats) -> foxy::awaitable<void> {
+
+  auto token       = co_await foxy::this_coro::token();
+  auto ec          = error_code();
+  auto error_token = foxy::redirect_error(token, ec);
+
+  auto session = foxy::client_session(io);
+
+  co_await session.async_connect("127.0.0.1", port, error_token);
+  if (ec) { co_return; }
+
+  for (auto i = std::size_t{0}; i < iterations; ++i) {
+    auto const start = std::chrono::steady_clock::now();
+
+    auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+    http::response_parser<http::string_body> parser;
+
+    if (style == error_style::redirect) {
+      co_await session.async_request(request, parser, error_token);
+    } else {
+      std::tie(ec) = co_await session.async_request(
+        request, parser, foxy::as_tuple(token));
+    }
+    if (ec) { break; }
+
+    stats.latency.record_since(start);
+    stats.bytes += parser.get().body().size();
+    ++stats.requests;
+  }
+
+  session.shutdown(ec);
+}
+
+// request_scenario runs sequential keep-alive requests against the loopback
+// origin, where the coroutine machinery is a fair share of each request
+//
+auto request_scenario(error_style const style) -> bench::scenario {
+  return [=](bench::options const& opts) {
+    asio::io_context io;
+
+    auto origin_opts      = foxy::test::origin_options();
+    origin_opts.body_size = opts.body_size;
+
+    auto origin = foxy::test::origin(io, origin_opts, nullptr);
+    origin.run();
+
+    auto stats = loop_stats();
+    auto timer = bench::timer();
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await request_loop(
+          io, origin.port(), style, opts.iterations, stats);
+
+        origin.stop();
+      },
+      foxy::detached);
+
+    io.run();
+
+    auto r       = bench::result();
+    r.iterations = stats.requests;
+    r.bytes      = stats.bytes;
+    r.elapsed    = timer.elapsed();
+    r.latency    = stats.latency.snapshot();
+    return r;
+  };
+}
+
+// wait_scenario isolates the cost of suspending and resuming on an operation
+// by awaiting a timer which has already expired, over and over
+//
+auto wait_scenario(error_style const style) -> bench::scenario {
+  return [=](bench::options const& opts) {
+    asio::io_context io;
+
+    auto const waits = opts.iterations * 100;
+
+    auto timer = bench::timer();
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        auto token = co_await foxy::this_coro::token();
+        auto ec    = error_code();
+
+        auto t = asio::steady_timer(io);
+
+        for (auto i = std::size_t{0}; i < waits; ++i) {
+          t.expires_at(asio::steady_timer::time_point::min());
+
+          if (style == error_style::redirect) {
+            co_await t.async_wait(foxy::redirect_error(token, ec));
+          } else {
+            std::tie(ec) = co_await t.async_wait(foxy::as_tuple(token));
+          }
+        }
+      },
+      foxy::detached);
+
+    io.run();
+
+    auto r       = bench::result();
+    r.iterations = waits;
+    r.elapsed    = timer.elapsed();
+    return r;
+  };
+}
+
+auto const keep_alive_redirect_error = bench::registrar(
+  "coroutine/keep_alive/redirect_error",
+  request_scenario(error_style::redirect));
+
+auto const keep_alive_as_tuple = bench::registrar(
+  "coroutine/keep_alive/as_tuple", request_scenario(error_style::tuple));
+
+auto const wait_redirect_error = bench::registrar(
+  "coroutine/wait/redirect_error", wait_scenario(error_style::redirect));
+
+auto const wait_as_tuple = bench::registrar(
+  "coroutine/wait/as_tuple", wait_scenario(error_style::tuple));
+
+} // anonymous
@@ -0,0 +1,111 @@
+#include "bench.hpp"
+
+#include "foxy/detail/timer_wheel.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace asio = boost::asio;
+
+using boost::system::error_code;
+using foxy::detail::timer_wheel;
+
+namespace {
+
+// as many keep-alive sessions as a busy proxy might have sitting idle, each
+// with a deadline that every read and write it makes pushes back
+//
+constexpr auto idle_sessions = std::size_t{500000};
+constexpr auto idle_timeout  = std::chrono::seconds(30);
+
+// the event loop gets a turn this often, which is when a `steady_timer` has
+// the waits its re-arming cancelled completed
+//
+constexpr auto rearms_per_turn = std::size_t{1000};
+
+// steady_timer re-arms a `steady_timer` apiece the way a session would, by
+// moving its expiry, which cancels the outstanding wait, and waiting again
+//
+auto steady_timer(bench::options const& opts) -> bench::result {
+  asio::io_context io;
+
+  auto timers = std::vector<std::unique_ptr<asio::steady_timer>>();
+  timers.reserve(idle_sessions);
+
+  auto const on_wait = [](error_code) {};
+
+  for (auto i = std::size_t{0}; i < idle_sessions; ++i) {
+    timers.push_back(std::make_unique<asio::steady_timer>(io));
+    timers.back()->expires_after(idle_timeout);
+    timers.back()->async_wait(on_wait);
+  }
+
+  auto const rearms = opts.iterations * 100;
+
+  auto timer = bench::timer();
+
+  for (auto i = std::size_t{0}; i < rearms; ++i) {
+    auto& t = *timers[i % idle_sessions];
+    t.expires_after(idle_timeout);
+    t.async_wait(on_wait);
+
+    if (i % rearms_per_turn == 0) { io.poll(); }
+  }
+  io.poll();
+
+  auto r       = bench::result();
+  r.iterations = rearms;
+  r.elapsed    = timer.elapsed();
+
+  timers.clear();
+  io.poll();
+
+  return r;
+}
+
+// timer_wheel re-arms the same deadlines kept by the wheel instead
+//
+auto wheel(bench::options const& opts) -> bench::result {
+  asio::io_context io;
+
+  auto timers = std::vector<std::unique_ptr<timer_wheel::timer>>();
+  timers.reserve(idle_sessions);
+
+  for (auto i = std::size_t{0}; i < idle_sessions; ++i) {
+    timers.push_back(std::make_unique<timer_wheel::timer>(io, [] {}));
+    timers.back()->expires_after(idle_timeout);
+  }
+
+  auto const rearms = opts.iterations * 100;
+
+  auto timer = bench::timer();
+
+  for (auto i = std::size_t{0}; i < rearms; ++i) {
+    timers[i % idle_sessions]->expires_after(idle_timeout);
+
+    if (i % rearms_per_turn == 0) { io.poll(); }
+  }
+  io.poll();
+
+  auto r       = bench::result();
+  r.iterations = rearms;
+  r.elapsed    = timer.elapsed();
+
+  timers.clear();
+
+  return r;
+}
+
+auto const steady_timer_rearm = bench::registrar(
+  "deadlines/steady_timer_rearm", steady_timer);
+
+auto const timer_wheel_rearm = bench::registrar(
+  "deadlines/timer_wheel_rearm", wheel);
+
+} // anonymous
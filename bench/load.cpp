@@ -0,0 +1,414 @@
+#include "foxy/coroutine.hpp"
+#include "foxy/metrics.hpp"
+#include "foxy/client_session.hpp"
+
+#include "foxy/test/origin.hpp"
+#include "foxy/test/certificate_authority.hpp"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+// foxy_load drives `foxy::client_session` against an HTTP or HTTPS server and
+// reports throughput along with latency percentiles
+//
+// in closed-loop mode, each of `--connections` clients sends its next request
+// as soon as the previous response has been read
+// in open-loop mode, `--rate` requests per second are scheduled up front and
+// spread evenly across the connections; latency is measured from when each
+// request was due to be sent rather than from when it actually was, which
+// corrects for coordinated omission once the server falls behind
+//
+// connections are spread across `--threads` threads, each running an
+// `io_context` of its own
+// without `--host`, requests go to an in-process loopback origin
+//
+// usage: foxy_load [--host=<host>] [--port=<port>] [--target=<path>] [--tls]
+//                  [--ca=<pem file>] [--insecure] [--connections=<n>]
+//                  [--threads=<n>] [--rate=<requests per second>]
+//                  [--duration=<seconds>] [--body-size=<bytes>]
+//
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+namespace ssl  = asio::ssl;
+
+using boost::system::error_code;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// how long a closed-loop connection waits before trying to connect again
+// after failing to
+//
+auto const connect_backoff = std::chrono::milliseconds(100);
+
+struct load_options {
+  std::string host;
+  std::string port;
+  std::string target = "/";
+  std::string ca_file;
+  bool        tls      = false;
+  bool        insecure = false;
+
+  std::size_t connections = 64;
+  std::size_t threads     = 1;
+
+  // when zero, the load is closed-loop
+  //
+  double rate = 0;
+
+  std::chrono::seconds duration = std::chrono::seconds(10);
+
+  // the size of the bodies served by the loopback origin
+  //
+  std::size_t body_size = 1024;
+};
+
+struct load_stats {
+  // time from when a request was due to be sent until its response was read
+  // in closed-loop mode, this is the same as `service_time`
+  //
+  foxy::histogram latency;
+
+  // time from when a request was actually sent until its response was read
+  //
+  foxy::histogram service_time;
+
+  std::atomic<std::uint64_t> requests{0};
+  std::atomic<std::uint64_t> non_2xx{0};
+  std::atomic<std::uint64_t> bytes{0};
+  std::atomic<std::uint64_t> errors{0};
+  std::atomic<std::uint64_t> connect_errors{0};
+};
+
+// schedule is shared by every connection
+//
+// in open-loop mode, connection `index` sends its `i`th request at
+// `start + index * rate_interval + i * connection_interval` so that the
+// connections take turns and the aggregate rate is the one asked for
+//
+struct schedule {
+  bool                     open_loop           = false;
+  clock_type::time_point   start               = {};
+  clock_type::time_point   end                 = {};
+  std::chrono::nanoseconds rate_interval       = {};
+  std::chrono::nanoseconds connection_interval = {};
+
+  auto due(std::size_t const index, std::uint64_t const i) const
+  -> clock_type::time_point {
+    return start +
+      rate_interval * static_cast<std::int64_t>(index) +
+      connection_interval * static_cast<std::int64_t>(i);
+  }
+};
+
+auto run_connection(
+  asio::io_context&   io,
+  load_options const& opts,
+  ssl::context*       ctx,
+  schedule const&     sched,
+  std::size_t const   index,
+  load_stats&         stats) -> foxy::awaitable<void> {
+
+  auto token       = co_await foxy::this_coro::token();
+  auto ec          = error_code();
+  auto error_token = foxy::redirect_error(token, ec);
+
+  auto timer   = asio::steady_timer(io);
+  auto session = std::optional<foxy::client_session>();
+
+  for (auto i = std::uint64_t{0}; true; ++i) {
+    auto due = clock_type::now();
+
+    if (sched.open_loop) {
+      due = sched.due(index, i);
+      if (due >= sched.end) { break; }
+
+      if (due > clock_type::now()) {
+        timer.expires_at(due);
+        co_await timer.async_wait(error_token);
+        ec = {};
+      }
+    } else if (due >= sched.end) {
+      break;
+    }
+
+    auto const sent = clock_type::now();
+
+    if (!session) {
+      if (ctx) {
+        session.emplace(io, *ctx);
+      } else {
+        session.emplace(io);
+      }
+
+      co_await session->async_connect(opts.host, opts.port, error_token);
+      if (ec) {
+        ++stats.connect_errors;
+        session.reset();
+        ec = {};
+
+        // an open loop waits on its schedule anyway, but a closed one would
+        // go straight back to a server that isn't taking connections
+        //
+        if (!sched.open_loop) {
+          timer.expires_at(
+            std::min(clock_type::now() + connect_backoff, sched.end));
+
+          co_await timer.async_wait(error_token);
+          ec = {};
+        }
+        continue;
+      }
+    }
+
+    auto request =
+      http::request<http::empty_body>(http::verb::get, opts.target, 11);
+
+    request.set(http::field::host, opts.host);
+    request.keep_alive(true);
+
+    http::response_parser<http::string_body> parser;
+    parser.body_limit(std::numeric_limits<std::uint64_t>::max());
+
+    co_await session->async_request(request, parser, error_token);
+    if (ec) {
+      ++stats.errors;
+      session.reset();
+      ec = {};
+      continue;
+    }
+
+    auto const now = clock_type::now();
+
+    stats.latency.record(now - due);
+    stats.service_time.record(now - sent);
+
+    ++stats.requests;
+    stats.bytes += parser.get().body().size();
+
+    if (http::to_status_class(parser.get().result()) !=
+        http::status_class::successful) {
+      ++stats.non_2xx;
+    }
+
+    if (!parser.keep_alive()) {
+      if (!ctx) { session->shutdown(ec); }
+      session.reset();
+      ec = {};
+    }
+  }
+
+  if (!session) { co_return; }
+
+  if (ctx) {
+    co_await session->async_ssl_shutdown(error_token);
+  } else {
+    session->shutdown(ec);
+  }
+}
+
+auto starts_with(std::string_view const s, std::string_view const prefix)
+-> bool {
+  return s.substr(0, prefix.size()) == prefix;
+}
+
+auto print_histogram(
+  std::string_view const          name,
+  foxy::histogram_snapshot const& h) -> void {
+
+  auto const ms = [](std::uint64_t const ns) { return ns / 1e6; };
+
+  std::cout
+    << name << " (ms):"
+    << " p50="   << ms(h.value_at(0.5))
+    << " p90="   << ms(h.value_at(0.9))
+    << " p99="   << ms(h.value_at(0.99))
+    << " p99.9=" << ms(h.value_at(0.999))
+    << " max="   << ms(h.max)
+    << "\n";
+}
+
+} // anonymous
+
+int main(int argc, char** argv) {
+  auto opts = load_options();
+
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = std::string_view(argv[i]);
+
+    auto value = [&](std::string_view const flag) {
+      return std::string(arg.substr(flag.size()));
+    };
+
+    if (starts_with(arg, "--host=")) {
+      opts.host = value("--host=");
+    } else if (starts_with(arg, "--port=")) {
+      opts.port = value("--port=");
+    } else if (starts_with(arg, "--target=")) {
+      opts.target = value("--target=");
+    } else if (arg == "--tls") {
+      opts.tls = true;
+    } else if (starts_with(arg, "--ca=")) {
+      opts.ca_file = value("--ca=");
+    } else if (arg == "--insecure") {
+      opts.insecure = true;
+    } else if (starts_with(arg, "--connections=")) {
+      opts.connections = std::stoul(value("--connections="));
+    } else if (starts_with(arg, "--threads=")) {
+      opts.threads = std::stoul(value("--threads="));
+    } else if (starts_with(arg, "--rate=")) {
+      opts.rate = std::stod(value("--rate="));
+    } else if (starts_with(arg, "--duration=")) {
+      opts.duration = std::chrono::seconds(std::stoul(value("--duration=")));
+    } else if (starts_with(arg, "--body-size=")) {
+      opts.body_size = std::stoul(value("--body-size="));
+    } else {
+      std::cerr << "unrecognized argument: " << arg << "\n";
+      return 1;
+    }
+  }
+
+  if (opts.connections == 0 || opts.threads == 0 || opts.rate < 0) {
+    std::cerr << "--connections and --threads must be positive and --rate "
+                 "must not be negative\n";
+    return 1;
+  }
+
+  auto const ca = foxy::test::certificate_authority();
+
+  auto client_ctx = std::optional<ssl::context>();
+  auto server_ctx = std::optional<ssl::context>();
+
+  if (opts.tls) {
+    client_ctx.emplace(ssl::context::tls_client);
+
+    if (opts.host.empty()) {
+      server_ctx.emplace(ca.server_context());
+      ca.trust(*client_ctx);
+    } else if (!opts.insecure) {
+      if (opts.ca_file.empty()) {
+        client_ctx->set_default_verify_paths();
+      } else {
+        client_ctx->load_verify_file(opts.ca_file);
+      }
+      client_ctx->set_verify_mode(ssl::verify_peer);
+    }
+  }
+
+  // the loopback origin gets an `io_context` and a thread of its own so that
+  // it never competes with the clients for a turn on theirs
+  //
+  auto origin_io     = asio::io_context();
+  auto origin        = std::optional<foxy::test::origin>();
+  auto origin_thread = std::thread();
+
+  if (opts.host.empty()) {
+    auto origin_opts      = foxy::test::origin_options();
+    origin_opts.body_size = opts.body_size;
+
+    origin.emplace(
+      origin_io, origin_opts, server_ctx ? &*server_ctx : nullptr);
+    origin->run();
+
+    opts.host = opts.tls ? "localhost" : "127.0.0.1";
+    opts.port = origin->port();
+
+    origin_thread = std::thread([&]() { origin_io.run(); });
+  } else if (opts.port.empty()) {
+    opts.port = opts.tls ? "443" : "80";
+  }
+
+  auto stats = load_stats();
+
+  auto sched      = schedule();
+  sched.open_loop = opts.rate > 0;
+  sched.start     = clock_type::now();
+  sched.end       = sched.start + opts.duration;
+
+  if (sched.open_loop) {
+    auto const interval = std::chrono::duration<double>(1 / opts.rate);
+
+    sched.rate_interval =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(interval);
+
+    sched.connection_interval =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        interval * static_cast<double>(opts.connections));
+  }
+
+  auto ios = std::vector<std::unique_ptr<asio::io_context>>();
+  for (auto i = std::size_t{0}; i < opts.threads; ++i) {
+    ios.push_back(std::make_unique<asio::io_context>(1));
+  }
+
+  for (auto i = std::size_t{0}; i < opts.connections; ++i) {
+    auto& io = *ios[i % ios.size()];
+
+    foxy::co_spawn(
+      io,
+      [&, i]() {
+        return run_connection(
+          io, opts, client_ctx ? &*client_ctx : nullptr, sched, i, stats);
+      },
+      foxy::detached);
+  }
+
+  auto threads = std::vector<std::thread>();
+  for (auto& io : ios) {
+    threads.emplace_back([&io]() { io->run(); });
+  }
+
+  for (auto& t : threads) { t.join(); }
+
+  auto const elapsed =
+    std::chrono::duration<double>(clock_type::now() - sched.start).count();
+
+  if (origin) {
+    asio::post(origin_io, [&]() { origin->stop(); });
+    origin_thread.join();
+  }
+
+  auto const requests = stats.requests.load();
+
+  std::cout
+    << (sched.open_loop ? "open" : "closed") << " loop, "
+    << opts.connections << " connections, "
+    << opts.threads << " threads, "
+    << elapsed << "s\n"
+    << "requests: " << requests
+    << " (" << requests / elapsed << "/s)"
+    << " bytes: " << stats.bytes.load()
+    << " (" << stats.bytes.load() / elapsed << "/s)\n"
+    << "non-2xx: " << stats.non_2xx.load()
+    << " errors: " << stats.errors.load()
+    << " connect errors: " << stats.connect_errors.load() << "\n";
+
+  if (sched.open_loop) {
+    std::cout << "target rate: " << opts.rate << "/s\n";
+    print_histogram("corrected latency", stats.latency.snapshot());
+    print_histogram("service time", stats.service_time.snapshot());
+  } else {
+    print_histogram("latency", stats.latency.snapshot());
+  }
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+#include "bench.hpp"
+
+#include <ctime>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+// foxy_bench runs every registered scenario over loopback and writes the
+// results as a single JSON document so that runs can be diffed across
+// releases
+//
+// usage: foxy_bench [--filter=<substring>] [--iterations=<n>]
+//                   [--body-size=<bytes>] [--tunnel-iterations=<n>]
+//                   [--tunnel-body-size=<bytes>] [--out=<path>]
+//
+
+auto bench::scenarios() -> std::vector<registered_scenario>& {
+  static std::vector<registered_scenario> all;
+  return all;
+}
+
+namespace {
+
+auto starts_with(std::string_view const s, std::string_view const prefix)
+-> bool {
+  return s.substr(0, prefix.size()) == prefix;
+}
+
+auto write_result(std::ostream& out, bench::result const& r) -> void {
+  auto const seconds = std::chrono::duration<double>(r.elapsed).count();
+
+  out << "    {\n";
+  out << "      \"name\": \"" << r.name << "\",\n";
+  out << "      \"iterations\": " << r.iterations << ",\n";
+  out << "      \"seconds\": " << seconds << ",\n";
+  out << "      \"ops_per_second\": "
+      << (seconds > 0 ? r.iterations / seconds : 0) << ",\n";
+  out << "      \"bytes_per_second\": "
+      << (seconds > 0 ? r.bytes / seconds : 0);
+
+  if (r.syscalls && r.iterations > 0) {
+    out << ",\n";
+    out << "      \"syscalls_per_op\": "
+        << static_cast<double>(*r.syscalls) / r.iterations;
+  }
+
+  if (r.cpu_time && r.bytes > 0) {
+    auto const cpu_seconds =
+      std::chrono::duration<double>(*r.cpu_time).count();
+
+    out << ",\n";
+    out << "      \"cpu_seconds_per_gb\": "
+        << cpu_seconds / (static_cast<double>(r.bytes) / 1e9);
+  }
+
+  if (r.latency) {
+    auto const& h = *r.latency;
+
+    out << ",\n";
+    out << "      \"latency_ns\": {\n";
+    out << "        \"p50\": "  << h.value_at(0.5)   << ",\n";
+    out << "        \"p90\": "  << h.value_at(0.9)   << ",\n";
+    out << "        \"p99\": "  << h.value_at(0.99)  << ",\n";
+    out << "        \"p999\": " << h.value_at(0.999) << ",\n";
+    out << "        \"max\": "  << h.max             << "\n";
+    out << "      }";
+  }
+
+  out << "\n    }";
+}
+
+} // anonymous
+
+int main(int argc, char** argv) {
+  auto opts   = bench::options();
+  auto filter = std::string();
+  auto path   = std::string();
+
+  for (auto i = 1; i < argc; ++i) {
+    auto const arg = std::string_view(argv[i]);
+
+    auto value = [&](std::string_view const flag) {
+      return std::string(arg.substr(flag.size()));
+    };
+
+    if (starts_with(arg, "--filter=")) {
+      filter = value("--filter=");
+    } else if (starts_with(arg, "--iterations=")) {
+      opts.iterations = std::stoul(value("--iterations="));
+    } else if (starts_with(arg, "--body-size=")) {
+      opts.body_size = std::stoul(value("--body-size="));
+    } else if (starts_with(arg, "--tunnel-iterations=")) {
+      opts.tunnel_iterations = std::stoul(value("--tunnel-iterations="));
+    } else if (starts_with(arg, "--tunnel-body-size=")) {
+      opts.tunnel_body_size = std::stoul(value("--tunnel-body-size="));
+    } else if (starts_with(arg, "--out=")) {
+      path = value("--out=");
+    } else {
+      std::cerr << "unrecognized argument: " << arg << "\n";
+      return 1;
+    }
+  }
+
+  auto results = std::vector<bench::result>();
+  for (auto const& s : bench::scenarios()) {
+    if (!filter.empty() && s.name.find(filter) == std::string::npos) {
+      continue;
+    }
+
+    std::cerr << "running " << s.name << "...\n";
+
+    auto r = s.run(opts);
+    r.name = s.name;
+    results.push_back(std::move(r));
+  }
+
+  auto file = std::ofstream();
+  if (!path.empty()) {
+    file.open(path);
+    if (!file) {
+      std::cerr << "unable to open " << path << "\n";
+      return 1;
+    }
+  }
+
+  auto& out = path.empty() ? std::cout : static_cast<std::ostream&>(file);
+
+  out << "{\n";
+  out << "  \"timestamp\": " << std::time(nullptr) << ",\n";
+  out << "  \"iterations\": " << opts.iterations << ",\n";
+  out << "  \"body_size\": " << opts.body_size << ",\n";
+  out << "  \"tunnel_iterations\": " << opts.tunnel_iterations << ",\n";
+  out << "  \"tunnel_body_size\": " << opts.tunnel_body_size << ",\n";
+  out << "  \"results\": [\n";
+
+  for (auto i = std::size_t{0}; i < results.size(); ++i) {
+    write_result(out, results[i]);
+    out << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+
+  out << "  ]\n";
+  out << "}\n";
+
+  return 0;
+}
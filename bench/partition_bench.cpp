@@ -0,0 +1,54 @@
+#include "bench.hpp"
+
+#include "foxy/metrics.hpp"
+#include "foxy/partition.hpp"
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+
+namespace http = boost::beast::http;
+
+namespace {
+
+// partition measures `partition_connection_options` on a header set typical
+// of a request passing through a proxy
+// building the input fields is part of every iteration as the function
+// consumes them
+//
+auto partition(bench::options const& opts) -> bench::result {
+  auto latency = foxy::histogram();
+  auto timer   = bench::timer();
+
+  auto const iterations = opts.iterations * 10;
+
+  for (auto i = std::size_t{0}; i < iterations; ++i) {
+    auto const start = std::chrono::steady_clock::now();
+
+    auto fields = http::fields();
+    fields.insert(http::field::host, "www.example.com");
+    fields.insert(http::field::user_agent, "foxy_bench");
+    fields.insert(http::field::accept, "*/*");
+    fields.insert(http::field::connection, "keep-alive, upgrade, x-hop");
+    fields.insert(http::field::keep_alive, "timeout=5, max=1000");
+    fields.insert(http::field::upgrade, "h2c");
+    fields.insert("x-hop", "hop-by-hop value");
+
+    auto proxy_fields = http::fields();
+
+    foxy::partition_connection_options(fields, proxy_fields);
+
+    latency.record_since(start);
+  }
+
+  auto r       = bench::result();
+  r.iterations = iterations;
+  r.elapsed    = timer.elapsed();
+  r.latency    = latency.snapshot();
+  return r;
+}
+
+auto const partition_options = bench::registrar(
+  "partition/connection_options", partition);
+
+} // anonymous
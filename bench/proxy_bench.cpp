@@ -0,0 +1,116 @@
+#include "bench.hpp"
+
+#include "foxy/coroutine.hpp"
+#include "foxy/forward_proxy.hpp"
+#include "foxy/client_session.hpp"
+
+#include "foxy/test/origin.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <string>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+namespace ip   = asio::ip;
+
+using ip::tcp;
+using boost::system::error_code;
+
+namespace {
+
+// tunnel_throughput opens a single CONNECT tunnel through `forward_proxy` to
+// the loopback origin and then downloads large bodies through it back to
+// back, which mostly measures how quickly the proxy relays body data
+//
+auto tunnel_throughput(bench::options const& opts) -> bench::result {
+  asio::io_context io;
+
+  auto origin_opts      = foxy::test::origin_options();
+  origin_opts.body_size = opts.tunnel_body_size;
+
+  auto origin = foxy::test::origin(io, origin_opts);
+
+  origin.run();
+
+  auto proxy = foxy::forward_proxy(
+    io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true);
+
+  proxy.run();
+
+  auto latency  = foxy::histogram();
+  auto requests = std::uint64_t{0};
+  auto bytes    = std::uint64_t{0};
+  auto timer    = bench::timer();
+
+  foxy::co_spawn(
+    io,
+    [&]() -> foxy::awaitable<void> {
+      auto token       = co_await foxy::this_coro::token();
+      auto ec          = error_code();
+      auto error_token = foxy::redirect_error(token, ec);
+
+      auto session = foxy::client_session(io);
+
+      co_await session.async_connect(
+        "127.0.0.1",
+        std::to_string(proxy.local_endpoint().port()),
+        error_token);
+
+      if (!ec) {
+        auto connect = http::request<http::empty_body>(
+          http::verb::connect, "127.0.0.1:" + origin.port(), 11);
+
+        // the 200 which opens the tunnel has no body, but nothing else tells
+        // the parser that
+        //
+        http::response_parser<http::empty_body> parser;
+        parser.skip(true);
+
+        co_await session.async_request(connect, parser, error_token);
+      }
+
+      for (auto i = std::size_t{0}; !ec && i < opts.tunnel_iterations; ++i) {
+        auto const start = std::chrono::steady_clock::now();
+
+        auto request =
+          http::request<http::empty_body>(http::verb::get, "/", 11);
+
+        http::response_parser<http::string_body> parser;
+        parser.body_limit(opts.tunnel_body_size);
+
+        co_await session.async_request(request, parser, error_token);
+        if (ec) { break; }
+
+        latency.record_since(start);
+        bytes += parser.get().body().size();
+        ++requests;
+      }
+
+      session.shutdown(ec);
+      origin.stop();
+
+      proxy.async_drain(
+        std::chrono::steady_clock::now() + std::chrono::seconds(5),
+        [](error_code, std::size_t) {});
+    },
+    foxy::detached);
+
+  io.run();
+
+  auto r       = bench::result();
+  r.iterations = requests;
+  r.bytes      = bytes;
+  r.elapsed    = timer.elapsed();
+  r.latency    = latency.snapshot();
+  return r;
+}
+
+auto const tunnel = bench::registrar(
+  "forward_proxy/tunnel_throughput", tunnel_throughput);
+
+} // anonymous
@@ -0,0 +1,173 @@
+#include "bench.hpp"
+
+#include "foxy/coroutine.hpp"
+#include "foxy/metrics.hpp"
+#include "foxy/io_uring.hpp"
+#include "foxy/client_session.hpp"
+
+#include "foxy/test/origin.hpp"
+#include "foxy/test/certificate_authority.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ssl/context.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <optional>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+namespace ssl  = asio::ssl;
+
+using boost::system::error_code;
+
+namespace {
+
+struct client_stats {
+  foxy::histogram latency;
+  std::uint64_t   requests = 0;
+  std::uint64_t   bytes    = 0;
+};
+
+// run_client issues `iterations` sequential GET requests, either all over one
+// persistent connection or each over a connection of its own, so that the
+// difference between the two is the cost of connection setup
+//
+auto run_client(
+  asio::io_context& io,
+  std::string const port,
+  ssl::context*     ctx,
+  bool const        keep_alive,
+  std::size_t const iterations,
+  client_stats&     stats) -> foxy::awaitable<void> {
+
+  auto token       = co_await foxy::this_coro::token();
+  auto ec          = error_code();
+  auto error_token = foxy::redirect_error(token, ec);
+
+  auto session = std::optional<foxy::client_session>();
+
+  for (auto i = std::size_t{0}; i < iterations; ++i) {
+    auto const start = std::chrono::steady_clock::now();
+
+    if (!session) {
+      if (ctx) {
+        session.emplace(io, *ctx);
+      } else {
+        session.emplace(io);
+      }
+
+      co_await session->async_connect("127.0.0.1", port, error_token);
+      if (ec) { break; }
+    }
+
+    auto request = http::request<http::empty_body>(http::verb::get, "/", 11);
+    request.keep_alive(keep_alive);
+
+    http::response_parser<http::string_body> parser;
+
+    co_await session->async_request(request, parser, error_token);
+    if (ec) { break; }
+
+    stats.latency.record_since(start);
+    stats.bytes += parser.get().body().size();
+    ++stats.requests;
+
+    if (!keep_alive) {
+      if (ctx) {
+        co_await session->async_ssl_shutdown(error_token);
+      } else {
+        session->shutdown(ec);
+      }
+
+      ec = {};
+      session.reset();
+    }
+  }
+
+  if (session && !ctx) {
+    session->shutdown(ec);
+  }
+}
+
+// with `uring` set, the client and the origin both do their I/O through
+// io_uring, so comparing against the same scenario without it shows what
+// batching submissions saves in system calls per request
+//
+auto request_scenario(bool const tls, bool const keep_alive, bool const uring)
+-> bench::scenario {
+  return [=](bench::options const& opts) {
+    asio::io_context io;
+
+    if (uring && !foxy::use_io_uring(io)) {
+      std::cerr << "io_uring is unavailable, running on the reactor\n";
+    }
+
+    auto const ca = foxy::test::certificate_authority();
+
+    auto server_ctx = std::optional<ssl::context>();
+    auto client_ctx = std::optional<ssl::context>();
+
+    if (tls) {
+      server_ctx.emplace(ca.server_context());
+      client_ctx.emplace(ca.client_context());
+    }
+
+    auto origin_opts      = foxy::test::origin_options();
+    origin_opts.body_size = opts.body_size;
+
+    auto origin = foxy::test::origin(
+      io, origin_opts, server_ctx ? &*server_ctx : nullptr);
+
+    origin.run();
+
+    auto stats    = client_stats();
+    auto syscalls = bench::syscall_counter();
+    auto timer    = bench::timer();
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await run_client(
+          io, origin.port(), client_ctx ? &*client_ctx : nullptr,
+          keep_alive, opts.iterations, stats);
+
+        origin.stop();
+      },
+      foxy::detached);
+
+    io.run();
+
+    auto r       = bench::result();
+    r.iterations = stats.requests;
+    r.bytes      = stats.bytes;
+    r.elapsed    = timer.elapsed();
+    r.latency    = stats.latency.snapshot();
+    r.syscalls   = syscalls.count();
+    return r;
+  };
+}
+
+auto const http_keep_alive = bench::registrar(
+  "session/http/keep_alive", request_scenario(false, true, false));
+
+auto const http_new_connection = bench::registrar(
+  "session/http/new_connection", request_scenario(false, false, false));
+
+auto const https_keep_alive = bench::registrar(
+  "session/https/keep_alive", request_scenario(true, true, false));
+
+auto const https_new_connection = bench::registrar(
+  "session/https/new_connection", request_scenario(true, false, false));
+
+auto const uring_keep_alive = bench::registrar(
+  "session/http/keep_alive/io_uring", request_scenario(false, true, true));
+
+auto const uring_new_connection = bench::registrar(
+  "session/http/new_connection/io_uring",
+  request_scenario(false, false, true));
+
+} // anonymous
@@ -0,0 +1,84 @@
+#include "bench.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#endif
+
+namespace {
+
+#if defined(__linux__)
+
+auto sys_enter_tracepoint_id() -> long {
+  char const* const paths[] = {
+    "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+    "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"
+  };
+
+  for (auto const* path : paths) {
+    auto file = std::ifstream(path);
+    auto id   = -1l;
+    if (file >> id) { return id; }
+  }
+
+  return -1;
+}
+
+auto open_counter() -> int {
+  auto const id = sys_enter_tracepoint_id();
+  if (id < 0) { return -1; }
+
+  auto attr = perf_event_attr();
+  std::memset(&attr, 0, sizeof(attr));
+
+  attr.type     = PERF_TYPE_TRACEPOINT;
+  attr.size     = sizeof(attr);
+  attr.config   = static_cast<std::uint64_t>(id);
+  attr.disabled = 1;
+  attr.inherit  = 1;
+
+  auto const fd = static_cast<int>(
+    ::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+
+  if (fd >= 0) {
+    ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  return fd;
+}
+
+#else
+
+auto open_counter() -> int {
+  return -1;
+}
+
+#endif
+
+} // anonymous
+
+bench::syscall_counter::syscall_counter()
+: fd_(open_counter())
+{
+}
+
+bench::syscall_counter::~syscall_counter() {
+#if defined(__linux__)
+  if (fd_ >= 0) { ::close(fd_); }
+#endif
+}
+
+auto bench::syscall_counter::count() const -> std::optional<std::uint64_t> {
+#if defined(__linux__)
+  auto value = std::uint64_t{0};
+  if (fd_ >= 0 && ::read(fd_, &value, sizeof(value)) == sizeof(value)) {
+    return value;
+  }
+#endif
+  return std::nullopt;
+}
@@ -0,0 +1,112 @@
+#include "bench.hpp"
+
+#include "foxy/multi_stream.hpp"
+
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <functional>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+
+using ip::tcp;
+using boost::system::error_code;
+
+namespace {
+
+// bulk_send writes `tunnel_iterations` bodies of `tunnel_body_size` bytes
+// over a single loopback connection while the other end reads and discards
+// them, which is the shape of a large download or a busy tunnel
+//
+// the interesting number is `cpu_seconds_per_gb`; over loopback the kernel
+// copies zero-copy sends on delivery anyway, so the difference between the
+// two scenarios shows the cost of pinning pages and reaping notifications
+// rather than the savings a real NIC would see
+//
+auto bulk_send(bool const zerocopy) -> bench::scenario {
+  return [=](bench::options const& opts) {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto sender   = foxy::multi_stream(io);
+    auto receiver = foxy::multi_stream(io);
+
+    sender.stream().connect(acceptor.local_endpoint());
+    acceptor.accept(receiver.stream());
+
+    if (zerocopy) {
+      auto ec = error_code();
+      sender.enable_zerocopy(foxy::detail::default_zerocopy_threshold, ec);
+      if (ec) {
+        std::cerr << "SO_ZEROCOPY is unavailable: " << ec.message() << "\n";
+      }
+    }
+
+    auto const body    = std::string(opts.tunnel_body_size, 'x');
+    auto       scratch = std::vector<char>(256 * 1024);
+
+    auto sent     = std::uint64_t{0};
+    auto received = std::uint64_t{0};
+
+    auto latency = foxy::histogram();
+    auto cpu     = bench::cpu_timer();
+    auto timer   = bench::timer();
+
+    std::function<void(std::size_t)> send_next = [&](std::size_t const i) {
+      if (i == opts.tunnel_iterations) {
+        auto ec = error_code();
+        sender.stream().shutdown(tcp::socket::shutdown_send, ec);
+        return;
+      }
+
+      auto const start = std::chrono::steady_clock::now();
+
+      asio::async_write(
+        sender, asio::buffer(body),
+        [&, i, start](error_code const ec, std::size_t const n) {
+          if (ec) { return; }
+
+          latency.record_since(start);
+          sent += n;
+          send_next(i + 1);
+        });
+    };
+
+    std::function<void(error_code, std::size_t)> on_read =
+      [&](error_code const ec, std::size_t const n) {
+        received += n;
+        if (ec) { return; }
+
+        receiver.async_read_some(asio::buffer(scratch), on_read);
+      };
+
+    send_next(0);
+    receiver.async_read_some(asio::buffer(scratch), on_read);
+
+    io.run();
+
+    auto r       = bench::result();
+    r.iterations = opts.tunnel_iterations;
+    r.bytes      = received;
+    r.elapsed    = timer.elapsed();
+    r.cpu_time   = cpu.elapsed();
+    r.latency    = latency.snapshot();
+    return r;
+  };
+}
+
+auto const copy = bench::registrar("stream/bulk_send/copy", bulk_send(false));
+
+auto const zerocopy =
+  bench::registrar("stream/bulk_send/zerocopy", bulk_send(true));
+
+} // anonymous
@@ -0,0 +1,110 @@
+#ifndef FOXY_ADMISSION_CONTROL_HPP_
+#define FOXY_ADMISSION_CONTROL_HPP_
+
+#include <boost/asio/io_context.hpp>
+
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "foxy/coroutine.hpp"
+#include "foxy/cancellation.hpp"
+#include "foxy/detail/mpmc_queue.hpp"
+
+namespace foxy {
+
+// admission_control bounds the number of concurrently served connections as
+// well as the number of outbound connection attempts in flight
+//
+// connections arriving while the server is at capacity are parked in a
+// bounded wait queue and are admitted, in order, as slots free up
+// connections which find the wait queue full, or which wait longer than
+// `max_pending_time`, are rejected so that the server can fail fast instead of
+// letting latency collapse for everyone
+//
+// all bookkeeping is done with atomics so a single instance may be shared by
+// every thread running the server's `io_context`
+//
+struct admission_control {
+
+public:
+  struct options {
+    std::size_t               max_connections         = 10000;
+    std::size_t               max_pending_connections = 1024;
+    std::chrono::milliseconds max_pending_time        = std::chrono::seconds(1);
+    std::size_t               max_upstream_connects   = 1024;
+  };
+
+  struct stats_type {
+    std::size_t   active_connections       = 0;
+    std::size_t   pending_connections      = 0;
+    std::size_t   active_upstream_connects = 0;
+    std::uint64_t admitted                 = 0;
+    std::uint64_t queued                   = 0;
+    std::uint64_t rejected                 = 0;
+    std::uint64_t timed_out                = 0;
+    std::uint64_t upstream_rejected        = 0;
+  };
+
+private:
+  struct waiter;
+
+  options const opts_;
+
+  std::atomic<std::size_t> active_;
+  std::atomic<std::size_t> pending_;
+  std::atomic<std::size_t> upstream_;
+
+  std::atomic<std::uint64_t> admitted_;
+  std::atomic<std::uint64_t> queued_;
+  std::atomic<std::uint64_t> rejected_;
+  std::atomic<std::uint64_t> timed_out_;
+  std::atomic<std::uint64_t> upstream_rejected_;
+
+  detail::mpmc_queue<std::shared_ptr<waiter>> waiters_;
+
+  auto try_acquire_slot() -> bool;
+  auto enqueue(std::shared_ptr<waiter> const& w) -> bool;
+  auto wake_waiters() -> void;
+
+public:
+  admission_control()                         = delete;
+  admission_control(admission_control const&) = delete;
+  admission_control(admission_control&&)      = delete;
+
+  explicit
+  admission_control(options const& opts);
+
+  // `async_admit` resolves to true once the caller holds a connection slot,
+  // either immediately or after waiting in the queue
+  // it resolves to false if the caller was turned away and should respond with
+  // a 503
+  //
+  // emitting the signal behind `slot` turns the caller away at once if it's
+  // still waiting in the queue
+  //
+  // every successful admission must be paired with a call to `leave`
+  //
+  auto async_admit(
+    boost::asio::io_context& io,
+    cancellation_slot        slot = cancellation_slot()) -> awaitable<bool>;
+
+  auto leave() -> void;
+
+  // `try_acquire_upstream` never waits; callers which fail to acquire an
+  // upstream slot should reject the request
+  //
+  // every successful acquisition must be paired with a call to
+  // `release_upstream`
+  //
+  auto try_acquire_upstream() -> bool;
+  auto release_upstream() -> void;
+
+  auto stats() const -> stats_type;
+};
+
+} // foxy
+
+#endif // FOXY_ADMISSION_CONTROL_HPP_
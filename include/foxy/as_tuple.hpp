@@ -0,0 +1,184 @@
+#ifndef FOXY_AS_TUPLE_HPP_
+#define FOXY_AS_TUPLE_HPP_
+
+#include "foxy/cancellation.hpp"
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+
+#include <tuple>
+#include <memory>
+#include <utility>
+#include <type_traits>
+
+namespace foxy {
+
+// as_tuple adapts a completion token so that everything an operation completes
+// with is handed over as one tuple, error code included, which lets a
+// coroutine write
+//
+//   auto [ec, endpoint] =
+//     co_await session.async_connect(host, service, foxy::as_tuple(token));
+//
+// instead of redirecting the error code into a variable declared up front
+// with `redirect_error`
+//
+template <typename CompletionToken>
+struct as_tuple_t {
+  CompletionToken token_;
+
+  template <typename T>
+  explicit
+  as_tuple_t(T&& token)
+  : token_(std::forward<T>(token))
+  {
+  }
+};
+
+template <typename CompletionToken>
+auto as_tuple(CompletionToken&& token)
+-> as_tuple_t<std::decay_t<CompletionToken>> {
+  return as_tuple_t<std::decay_t<CompletionToken>>(
+    std::forward<CompletionToken>(token));
+}
+
+// as_tuple_handler is what an operation given an `as_tuple_t` completes
+// through, packing up its arguments for the handler it wraps
+//
+template <typename Handler>
+struct as_tuple_handler {
+
+private:
+  Handler handler_;
+
+public:
+  template <typename CompletionToken>
+  explicit
+  as_tuple_handler(as_tuple_t<CompletionToken>&& token)
+  : handler_(std::move(token.token_))
+  {
+  }
+
+  template <typename CompletionToken>
+  explicit
+  as_tuple_handler(as_tuple_t<CompletionToken> const& token)
+  : handler_(token.token_)
+  {
+  }
+
+  as_tuple_handler(as_tuple_handler const&) = default;
+  as_tuple_handler(as_tuple_handler&&)      = default;
+
+  auto get() noexcept -> Handler& { return handler_; }
+  auto get() const noexcept -> Handler const& { return handler_; }
+
+  template <typename... Args>
+  auto operator()(Args&&... args) -> void {
+    handler_(std::make_tuple(std::forward<Args>(args)...));
+  }
+
+  template <typename Function>
+  friend
+  auto asio_handler_invoke(Function&& f, as_tuple_handler* h) -> void {
+    using boost::asio::asio_handler_invoke;
+    asio_handler_invoke(f, std::addressof(h->handler_));
+  }
+
+  friend
+  auto asio_handler_allocate(std::size_t const size, as_tuple_handler* h)
+  -> void* {
+    using boost::asio::asio_handler_allocate;
+    return asio_handler_allocate(size, std::addressof(h->handler_));
+  }
+
+  friend
+  auto asio_handler_deallocate(
+    void*             p,
+    std::size_t const size,
+    as_tuple_handler* h) -> void {
+
+    using boost::asio::asio_handler_deallocate;
+    asio_handler_deallocate(p, size, std::addressof(h->handler_));
+  }
+
+  friend
+  auto asio_handler_is_continuation(as_tuple_handler* h) -> bool {
+    using boost::asio::asio_handler_is_continuation;
+    return asio_handler_is_continuation(std::addressof(h->handler_));
+  }
+};
+
+// a slot bound underneath `as_tuple` still reaches the operation
+//
+template <typename Handler>
+struct associated_cancellation_slot<as_tuple_handler<Handler>> {
+  static auto get(as_tuple_handler<Handler> const& h) noexcept
+  -> cancellation_slot {
+    return get_associated_cancellation_slot(h.get());
+  }
+};
+
+} // foxy
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<foxy::as_tuple_handler<Handler>, Executor> {
+  using type = typename associated_executor<Handler, Executor>::type;
+
+  static auto get(
+    foxy::as_tuple_handler<Handler> const& h,
+    Executor const&                        ex = Executor()) noexcept
+  -> type {
+    return associated_executor<Handler, Executor>::get(h.get(), ex);
+  }
+};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<foxy::as_tuple_handler<Handler>, Allocator> {
+  using type = typename associated_allocator<Handler, Allocator>::type;
+
+  static auto get(
+    foxy::as_tuple_handler<Handler> const& h,
+    Allocator const&                       a = Allocator()) noexcept
+  -> type {
+    return associated_allocator<Handler, Allocator>::get(h.get(), a);
+  }
+};
+
+// the wrapped token sees an operation which completes with a single tuple, so
+// awaiting it resumes the coroutine with that tuple as the result
+//
+template <typename CompletionToken, typename R, typename... Args>
+struct async_result<foxy::as_tuple_t<CompletionToken>, R(Args...)> {
+
+private:
+  using signature = void(std::tuple<std::decay_t<Args>...>);
+
+  async_result<CompletionToken, signature> target_;
+
+public:
+  using completion_handler_type = foxy::as_tuple_handler<
+    typename async_result<CompletionToken, signature>::completion_handler_type>;
+
+  using return_type =
+    typename async_result<CompletionToken, signature>::return_type;
+
+  explicit
+  async_result(completion_handler_type& handler)
+  : target_(handler.get())
+  {
+  }
+
+  auto get() -> return_type { return target_.get(); }
+};
+
+} // asio
+} // boost
+
+#endif // FOXY_AS_TUPLE_HPP_
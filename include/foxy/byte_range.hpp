@@ -0,0 +1,56 @@
+#ifndef FOXY_BYTE_RANGE_HPP_
+#define FOXY_BYTE_RANGE_HPP_
+
+#include <string>
+#include <cstdint>
+#include <string_view>
+
+namespace foxy {
+
+struct byte_range {
+  std::uint64_t offset = 0;
+  std::uint64_t length = 0;
+};
+
+enum class range_status {
+  // there was no usable range so the whole resource should be sent with a
+  // 200, which is also what we do for multiple ranges and malformed headers
+  //
+  ignored,
+
+  // the range should be sent with a 206 and a `Content-Range` header
+  //
+  satisfiable,
+
+  // the range lies beyond the end of the resource and should be answered
+  // with a 416
+  //
+  unsatisfiable
+};
+
+// `parse_range` interprets the value of a `Range` header for a resource which
+// is `size` bytes large, storing the requested bytes in `range` when they can
+// be served
+//
+// only single `bytes` ranges are honored: `first-last`, `first-` and
+// `-suffix_length`
+//
+auto parse_range(
+  std::string_view const value,
+  std::uint64_t const    size,
+  byte_range&            range) -> range_status;
+
+// `content_range` formats the value of a `Content-Range` header for `range`
+// out of a resource of `size` bytes
+//
+auto content_range(byte_range const range, std::uint64_t const size)
+-> std::string;
+
+// `unsatisfied_range` formats the value of the `Content-Range` header sent
+// with a 416
+//
+auto unsatisfied_range(std::uint64_t const size) -> std::string;
+
+} // foxy
+
+#endif // FOXY_BYTE_RANGE_HPP_
@@ -0,0 +1,256 @@
+#ifndef FOXY_CANCELLATION_HPP_
+#define FOXY_CANCELLATION_HPP_
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+
+#include <mutex>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+namespace foxy {
+
+struct cancellation_slot;
+
+// cancellation_signal lets an asynchronous operation be cancelled on its own,
+// without closing whatever it's running on from the outside, by binding its
+// completion token to the signal's slot with `bind_cancellation_slot` and
+// calling `emit`
+//
+// the operation hooks itself up to the slot while it runs and unhooks itself
+// before it completes, so `emit` does nothing unless there's something to
+// cancel; a signal serves one operation at a time and has to outlive it
+//
+// foxy's operations treat cancellation as terminal: the operation completes
+// with `operation_aborted` as soon as it can, taking its connection down with
+// it, and whatever it was holding onto is freed
+//
+// `emit` may be called from any thread
+//
+struct cancellation_signal {
+
+private:
+  friend cancellation_slot;
+
+  std::mutex            mtx_;
+  std::function<void()> handler_;
+
+public:
+  cancellation_signal()                           = default;
+  cancellation_signal(cancellation_signal const&) = delete;
+  cancellation_signal(cancellation_signal&&)      = delete;
+
+  auto emit() -> void;
+  auto slot() noexcept -> cancellation_slot;
+};
+
+// cancellation_slot is where an operation hooks itself up to a signal, a slot
+// which isn't connected to one being what operations which can't be cancelled
+// are given
+//
+struct cancellation_slot {
+
+private:
+  cancellation_signal* signal_;
+
+public:
+  cancellation_slot() noexcept;
+
+  explicit
+  cancellation_slot(cancellation_signal& signal) noexcept;
+
+  auto is_connected() const noexcept -> bool;
+
+  // `assign` installs what the signal calls on `emit`, replacing whatever was
+  // installed before, and `clear` removes it; neither may be called from
+  // within the handler itself
+  //
+  template <typename CancellationHandler>
+  auto assign(CancellationHandler&& handler) -> void {
+    if (!signal_) { return; }
+
+    auto lock = std::lock_guard<std::mutex>(signal_->mtx_);
+    signal_->handler_ = std::forward<CancellationHandler>(handler);
+  }
+
+  auto clear() -> void;
+};
+
+// cancellation_slot_binder attaches a cancellation slot to a completion token
+// or handler, leaving its executor and allocator as they were
+//
+template <typename T>
+struct cancellation_slot_binder {
+
+private:
+  template <typename U>
+  friend struct cancellation_slot_binder;
+
+  cancellation_slot slot_;
+  T                 target_;
+
+public:
+  using target_type = T;
+
+  template <typename U>
+  cancellation_slot_binder(cancellation_slot const slot, U&& target)
+  : slot_(slot)
+  , target_(std::forward<U>(target))
+  {
+  }
+
+  // completion handlers are made out of the token they're bound to, which
+  // carries the slot over to them
+  //
+  template <typename U>
+  cancellation_slot_binder(cancellation_slot_binder<U>&& other)
+  : slot_(other.slot_)
+  , target_(std::move(other.target_))
+  {
+  }
+
+  cancellation_slot_binder(cancellation_slot_binder const&) = default;
+  cancellation_slot_binder(cancellation_slot_binder&&)      = default;
+
+  auto get() noexcept -> target_type& { return target_; }
+  auto get() const noexcept -> target_type const& { return target_; }
+
+  auto get_cancellation_slot() const noexcept -> cancellation_slot {
+    return slot_;
+  }
+
+  template <typename... Args>
+  auto operator()(Args&&... args) -> decltype(auto) {
+    return target_(std::forward<Args>(args)...);
+  }
+
+  template <typename Function>
+  friend
+  auto asio_handler_invoke(
+    Function&&                f,
+    cancellation_slot_binder* binder) -> void {
+
+    using boost::asio::asio_handler_invoke;
+    asio_handler_invoke(f, std::addressof(binder->target_));
+  }
+
+  friend
+  auto asio_handler_allocate(
+    std::size_t const         size,
+    cancellation_slot_binder* binder) -> void* {
+
+    using boost::asio::asio_handler_allocate;
+    return asio_handler_allocate(size, std::addressof(binder->target_));
+  }
+
+  friend
+  auto asio_handler_deallocate(
+    void*                     p,
+    std::size_t const         size,
+    cancellation_slot_binder* binder) -> void {
+
+    using boost::asio::asio_handler_deallocate;
+    asio_handler_deallocate(p, size, std::addressof(binder->target_));
+  }
+
+  friend
+  auto asio_handler_is_continuation(cancellation_slot_binder* binder) -> bool {
+    using boost::asio::asio_handler_is_continuation;
+    return asio_handler_is_continuation(std::addressof(binder->target_));
+  }
+};
+
+template <typename T>
+auto bind_cancellation_slot(cancellation_slot const slot, T&& target)
+-> cancellation_slot_binder<std::decay_t<T>> {
+  return cancellation_slot_binder<std::decay_t<T>>(
+    slot, std::forward<T>(target));
+}
+
+// associated_cancellation_slot is the slot a completion handler was bound to,
+// if any, and an unconnected one otherwise
+//
+template <typename T>
+struct associated_cancellation_slot {
+  static auto get(T const&) noexcept -> cancellation_slot {
+    return cancellation_slot();
+  }
+};
+
+template <typename T>
+struct associated_cancellation_slot<cancellation_slot_binder<T>> {
+  static auto get(cancellation_slot_binder<T> const& binder) noexcept
+  -> cancellation_slot {
+    return binder.get_cancellation_slot();
+  }
+};
+
+template <typename T>
+auto get_associated_cancellation_slot(T const& t) noexcept
+-> cancellation_slot {
+  return associated_cancellation_slot<T>::get(t);
+}
+
+} // foxy
+
+namespace boost {
+namespace asio {
+
+template <typename T, typename Executor>
+struct associated_executor<foxy::cancellation_slot_binder<T>, Executor> {
+  using type = typename associated_executor<T, Executor>::type;
+
+  static auto get(
+    foxy::cancellation_slot_binder<T> const& binder,
+    Executor const&                          ex = Executor()) noexcept
+  -> type {
+    return associated_executor<T, Executor>::get(binder.get(), ex);
+  }
+};
+
+template <typename T, typename Allocator>
+struct associated_allocator<foxy::cancellation_slot_binder<T>, Allocator> {
+  using type = typename associated_allocator<T, Allocator>::type;
+
+  static auto get(
+    foxy::cancellation_slot_binder<T> const& binder,
+    Allocator const&                         a = Allocator()) noexcept
+  -> type {
+    return associated_allocator<T, Allocator>::get(binder.get(), a);
+  }
+};
+
+// binding a slot to a completion token leaves the operation's result as the
+// token alone would have it
+//
+template <typename T, typename Signature>
+struct async_result<foxy::cancellation_slot_binder<T>, Signature> {
+
+private:
+  async_result<T, Signature> target_;
+
+public:
+  using completion_handler_type = foxy::cancellation_slot_binder<
+    typename async_result<T, Signature>::completion_handler_type>;
+
+  using return_type = typename async_result<T, Signature>::return_type;
+
+  explicit
+  async_result(completion_handler_type& handler)
+  : target_(handler.get())
+  {
+  }
+
+  auto get() -> return_type { return target_.get(); }
+};
+
+} // asio
+} // boost
+
+#endif // FOXY_CANCELLATION_HPP_
@@ -0,0 +1,137 @@
+#ifndef FOXY_CIRCUIT_BREAKER_HPP_
+#define FOXY_CIRCUIT_BREAKER_HPP_
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+namespace foxy {
+
+// circuit_breaker tracks the health of every upstream host the proxy connects
+// to and decides, before each connection attempt, whether it should be made at
+// all
+//
+// each host is limited to `max_connects_per_host` connection attempts in
+// flight
+// once at least `min_requests` attempts have completed within a
+// `failure_window` and `failure_ratio` of them failed, the breaker for that
+// host opens and all attempts fail fast for `open_duration`
+// afterwards the breaker is half-open and lets `half_open_probes` attempts
+// through; the first success closes it again while a failure re-opens it
+//
+// host state lives in a sharded hash map so that concurrent lookups for
+// different hosts rarely contend on the same lock
+//
+struct circuit_breaker {
+
+public:
+  using clock_type = std::chrono::steady_clock;
+  using time_point = clock_type::time_point;
+
+  struct options {
+    std::size_t               max_connects_per_host = 64;
+    std::size_t               min_requests          = 5;
+    double                    failure_ratio         = 0.5;
+    std::chrono::milliseconds failure_window        = std::chrono::seconds(10);
+    std::chrono::milliseconds open_duration         = std::chrono::seconds(5);
+    std::size_t               half_open_probes      = 1;
+    std::size_t               max_hosts_per_shard   = 4096;
+  };
+
+  enum class state { closed, open, half_open };
+
+  enum class verdict {
+    // the connection attempt may proceed and must be followed up with a call
+    // to either `release` or `abandon`
+    //
+    allow,
+
+    // too many connection attempts to the host are already in flight
+    //
+    busy,
+
+    // the host has been failing and the breaker is open
+    //
+    open
+  };
+
+  struct stats_type {
+    std::uint64_t allowed       = 0;
+    std::uint64_t rejected_busy = 0;
+    std::uint64_t rejected_open = 0;
+    std::uint64_t trips         = 0;
+  };
+
+private:
+  static constexpr std::size_t num_shards = 16;
+
+  struct host_state {
+    state       current      = state::closed;
+    std::size_t in_flight    = 0;
+    std::size_t successes    = 0;
+    std::size_t failures     = 0;
+    time_point  window_start = {};
+    time_point  open_until   = {};
+  };
+
+  struct alignas(64) shard {
+    std::mutex                                  mtx;
+    std::unordered_map<std::string, host_state> hosts;
+  };
+
+  options const            opts_;
+  std::unique_ptr<shard[]> shards_;
+
+  std::atomic<std::uint64_t> allowed_;
+  std::atomic<std::uint64_t> rejected_busy_;
+  std::atomic<std::uint64_t> rejected_open_;
+  std::atomic<std::uint64_t> trips_;
+
+  auto shard_for(std::string_view const host) -> shard&;
+  auto prune(shard& s) -> void;
+  auto trip(host_state& h, time_point const now) -> void;
+
+public:
+  circuit_breaker()                       = delete;
+  circuit_breaker(circuit_breaker const&) = delete;
+  circuit_breaker(circuit_breaker&&)      = delete;
+
+  explicit
+  circuit_breaker(options const& opts);
+
+  // `try_acquire` is to be called before connecting to `host`
+  //
+  auto try_acquire(
+    std::string_view const host,
+    time_point const       now = clock_type::now()) -> verdict;
+
+  // `release` reports the outcome of an attempt previously allowed by
+  // `try_acquire`
+  //
+  auto release(
+    std::string_view const host,
+    bool const             success,
+    time_point const       now = clock_type::now()) -> void;
+
+  // `abandon` gives back an attempt previously allowed by `try_acquire` which
+  // was called off before it had an outcome, say because the proxy's draining
+  //
+  auto abandon(std::string_view const host) -> void;
+
+  // `state_of` reports the breaker state for `host` as of the last call to
+  // either `try_acquire` or `release`
+  //
+  auto state_of(std::string_view const host) -> state;
+
+  auto stats() const -> stats_type;
+};
+
+} // foxy
+
+#endif // FOXY_CIRCUIT_BREAKER_HPP_
@@ -26,7 +26,9 @@
 #include <iostream>
 #include <string_view>
 
+#include "foxy/runtime.hpp"
 #include "foxy/coroutine.hpp"
+#include "foxy/cancellation.hpp"
 #include "foxy/multi_stream.hpp"
 #include "foxy/detail/session.hpp"
 
@@ -59,10 +61,34 @@ public:
   explicit
   client_session(boost::asio::io_context& io, boost::asio::ssl::context& ctx);
 
+  // sessions made against a runtime are bound to the context of the calling
+  // thread when it's one of the runtime's, so that a request made while
+  // serving another stays on the same core
+  //
+  explicit
+  client_session(runtime& rt);
+
+  explicit
+  client_session(runtime& rt, boost::asio::ssl::context& ctx);
+
+  // `enable_http2` has the next `async_connect` offer HTTP/2 during the SSL
+  // handshake, falling back to HTTP/1.1 when the server doesn't pick it
+  // sessions without SSL speak HTTP/2 straight away, so the server has to be
+  // known to support it
+  //
+  auto enable_http2() -> void;
+
+  // `is_http2` is true once a connection has settled on HTTP/2
+  //
+  auto is_http2() const -> bool;
+
   // `async_connect` performs forward name resolution on the specified host
   // and then attempts to form a TCP connection
   // `service` is the same as the original `asio::async_connect` function
   //
+  // cancelling a connect, see `foxy::cancellation_signal`, cancels the lookup
+  // or connection attempt under way and skips any endpoints left to try
+  //
   template <typename ConnectHandler>
   auto async_connect(
     std::string      host,
@@ -75,6 +101,12 @@ public:
   // `async_request` writes a `http::request` to the remotely connected host
   // and then uses the supplied `http::response_parser` to store the response
   //
+  // over HTTP/2, requests each get their own stream and any number may be in
+  // flight at once; bodies are sent and received in full, and responses are
+  // handed to the parser as their HTTP/1.1 equivalent
+  //
+  // only HTTP/1.1 requests can be cancelled, which closes the connection
+  //
   template <
     typename Request,
     typename ResponseParser,
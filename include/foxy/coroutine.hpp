@@ -9,6 +9,13 @@
 #include <boost/asio/experimental/detached.hpp>
 #include <boost/asio/experimental/redirect_error.hpp>
 
+#include "foxy/as_tuple.hpp"
+
+// foxy is written against the coroutine support Boost 1.67 and 1.68 ship
+// under `asio::experimental`, and takes every name it uses from here, so that
+// moving onto the `awaitable` and `use_awaitable` of later releases comes
+// down to this header and to how operations get hold of their token
+//
 namespace foxy {
   namespace this_coro = boost::asio::experimental::this_coro;
 
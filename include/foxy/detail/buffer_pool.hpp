@@ -0,0 +1,139 @@
+#ifndef FOXY_DETAIL_BUFFER_POOL_HPP_
+#define FOXY_DETAIL_BUFFER_POOL_HPP_
+
+#include <boost/asio/buffer.hpp>
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+namespace foxy {
+namespace detail {
+
+// buffer_pool hands out raw blocks of memory in power-of-two size classes
+// ranging from `min_block_size` to `max_block_size`
+//
+// released blocks are cached for reuse up until `max_cached_bytes` have been
+// retained, after which they are returned to the global heap
+//
+// buffer_pool is safe to use concurrently from multiple threads
+//
+struct buffer_pool {
+
+public:
+  static constexpr std::size_t min_block_size   = 2 * 1024;
+  static constexpr std::size_t max_block_size   = 256 * 1024;
+  static constexpr std::size_t num_size_classes = 8;
+
+  struct block {
+    char*       data = nullptr;
+    std::size_t size = 0;
+  };
+
+private:
+  struct size_class {
+    std::mutex         mtx;
+    std::vector<char*> blocks;
+  };
+
+  std::array<size_class, num_size_classes> classes_;
+  std::size_t                              max_cached_bytes_;
+  std::atomic<std::size_t>                 cached_bytes_;
+
+public:
+  buffer_pool()                   = delete;
+  buffer_pool(buffer_pool const&) = delete;
+  buffer_pool(buffer_pool&&)      = delete;
+
+  explicit
+  buffer_pool(std::size_t const max_cached_bytes);
+
+  ~buffer_pool();
+
+  // `acquire` returns a block at least `size` bytes large, rounded up to the
+  // nearest size class and clamped to `max_block_size`
+  //
+  auto acquire(std::size_t const size) -> block;
+
+  // `release` returns a block previously obtained from `acquire` back to the
+  // pool
+  //
+  auto release(block const b) -> void;
+
+  // the number of bytes currently cached by the pool and not in use by anyone
+  //
+  auto cached_bytes() const noexcept -> std::size_t;
+
+  // the process-wide pool shared by all tunnels
+  //
+  static auto global() -> buffer_pool&;
+
+  // `local` is the pool set for the calling thread with `set_local`, falling
+  // back to the global one
+  //
+  static auto local() -> buffer_pool&;
+  static auto set_local(buffer_pool* pool) -> void;
+};
+
+// adaptive_buffer is a scratch buffer for relaying data between two streams
+//
+// the buffer starts at `buffer_pool::min_block_size` and doubles every time a
+// read fills it completely, up to `buffer_pool::max_block_size`
+// after several consecutive reads which use less than a quarter of the
+// buffer, it halves in size again
+//
+// `release` hands the memory back to the pool entirely which should be done
+// whenever the owner is about to wait an indefinite amount of time for more
+// data so that idle connections don't hold onto large blocks
+//
+// unless told otherwise, a buffer draws from the pool local to the thread
+// which created it
+//
+struct adaptive_buffer {
+
+public:
+  static constexpr std::size_t shrink_after = 4;
+
+private:
+  buffer_pool*        pool_;
+  buffer_pool::block  block_;
+  std::size_t         target_size_;
+  std::size_t         underfilled_;
+
+public:
+  adaptive_buffer();
+
+  explicit
+  adaptive_buffer(buffer_pool& pool);
+
+  adaptive_buffer(adaptive_buffer const&) = delete;
+  adaptive_buffer(adaptive_buffer&& other) noexcept;
+
+  ~adaptive_buffer();
+
+  // `prepare` returns the writable region to be used for the next read,
+  // acquiring or resizing the underlying block as the sizing policy dictates
+  //
+  // the contents of the buffer are not preserved across calls to `prepare`
+  //
+  auto prepare() -> boost::asio::mutable_buffer;
+
+  // `commit` informs the buffer how many bytes the last read placed into the
+  // region returned by `prepare`
+  //
+  auto commit(std::size_t const bytes_used) -> void;
+
+  // `release` returns the current block to the pool, if any
+  //
+  auto release() -> void;
+
+  auto data() const noexcept -> char*;
+  auto size() const noexcept -> std::size_t;
+};
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_BUFFER_POOL_HPP_
@@ -0,0 +1,299 @@
+#ifndef FOXY_DETAIL_COLLAPSER_HPP_
+#define FOXY_DETAIL_COLLAPSER_HPP_
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/beast/http/message.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <utility>
+#include <string_view>
+#include <unordered_map>
+
+namespace foxy {
+namespace detail {
+
+// collapsed_response is a response one request fetches from upstream on
+// behalf of every identical request which arrived while it was in flight
+//
+// only the request which went upstream, the leader, writes to it; the body is
+// kept as a chain of chunks which are never modified once linked in so that
+// followers read them, all of them sharing the one copy, without taking any
+// lock
+// followers waiting for more are parked and the leader resumes them after
+// every change
+//
+// the body is only kept for as long as somebody needs it: a leader nobody is
+// following when the body starts doesn't keep it at all, and once the leader
+// has kept more than it was allowed to, the response stops taking on new
+// followers and drops the chunks every follower has moved past
+//
+struct collapsed_response {
+
+public:
+  enum class status : int {
+    // the leader hasn't got the response's header yet
+    //
+    pending,
+
+    // the header is in and the body follows
+    //
+    streaming,
+
+    // the body is complete
+    //
+    done,
+
+    // the response isn't one which may be shared; followers have to go
+    // upstream themselves
+    //
+    unshared,
+
+    // the leader failed partway through
+    //
+    failed
+  };
+
+  struct chunk {
+    std::string         data;
+    std::size_t         index = 0;
+    std::atomic<chunk*> next{nullptr};
+  };
+
+  // follower is the state of a parked request, linked into a list which only
+  // ever grows while the response is alive
+  //
+  // a follower goes back to `idle` every time it wakes up, before it looks for
+  // whatever the leader did
+  //
+  // `position` is the index of the earliest chunk the follower may still
+  // read, which it moves along as it goes and sets to `gone` once it's done
+  // with the response
+  //
+  struct follower {
+    enum : int { idle, parked, notified };
+
+    static constexpr std::size_t gone = static_cast<std::size_t>(-1);
+
+    struct resumer {
+      virtual ~resumer() = default;
+      virtual auto resume() -> void = 0;
+    };
+
+    std::atomic<int>         state{idle};
+    std::atomic<std::size_t> position{0};
+    std::unique_ptr<resumer> handler;
+    follower*                next = nullptr;
+  };
+
+private:
+  std::string                           key_;
+  boost::beast::http::request_header<>  request_;
+  boost::beast::http::response_header<> header_;
+
+  std::atomic<status>    status_;
+  std::atomic<bool>      joinable_;
+  std::atomic<follower*> followers_;
+
+  // `head_` comes before the first chunk of the body; the leader alone owns
+  // the chain and appends to it at `tail_`
+  //
+  chunk                              head_;
+  chunk*                             tail_;
+  std::deque<std::unique_ptr<chunk>> chunks_;
+
+  // the leader's own bookkeeping of how much of the body it has kept
+  //
+  bool        decided_;
+  bool        keeping_;
+  std::size_t kept_;
+  std::size_t retain_limit_;
+
+  auto set_status(status const s) -> void;
+  auto notify() -> void;
+  auto close() -> void;
+  auto release() -> void;
+
+public:
+  collapsed_response()                          = delete;
+  collapsed_response(collapsed_response const&) = delete;
+  collapsed_response(collapsed_response&&)      = delete;
+
+  collapsed_response(
+    std::string                                 key,
+    boost::beast::http::request_header<> const& request);
+
+  ~collapsed_response();
+
+  auto key() const noexcept -> std::string const&;
+
+  // the leader's request, so that followers can tell whether they'd get the
+  // same variant
+  //
+  auto request() const noexcept
+  -> boost::beast::http::request_header<> const&;
+
+  auto get_status() const noexcept -> status;
+
+  // whether the response still takes on new followers, which they have to
+  // check for themselves once they're added
+  //
+  auto joinable() const noexcept -> bool;
+
+  // the response's header, which may only be looked at once the status is no
+  // longer `pending`
+  //
+  auto header() const noexcept
+  -> boost::beast::http::response_header<> const&;
+
+  // `first` is where followers start reading the body from, `next` on from
+  // there, the former only once they've seen that the response is joinable
+  //
+  auto first() const noexcept -> chunk const*;
+  auto next(chunk const* c) const noexcept -> chunk const*;
+
+  // called by the leader, in this order, `publish` only if `shared` was
+  // true
+  //
+  // `retain_limit` is how much of the body is kept for followers which have
+  // yet to join
+  //
+  auto publish_header(
+    boost::beast::http::response_header<> const& header,
+    bool const                                   shared,
+    std::size_t const                            retain_limit) -> void;
+
+  auto publish(void const* data, std::size_t const size) -> void;
+
+  auto finish() -> void;
+  auto fail() -> void;
+
+  // how much of the body the leader is holding onto right now
+  //
+  auto retained() const noexcept -> std::size_t;
+
+  // `add_follower` links in a new follower for the caller to park
+  //
+  auto add_follower() -> follower&;
+
+  // `async_park` suspends `f` until the leader next changes anything, or
+  // completes straight away if it already has since `f` last woke up
+  //
+  template <typename ParkHandler>
+  auto async_park(follower& f, ParkHandler&& park_handler)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    ParkHandler, void(boost::system::error_code));
+};
+
+// collapser keeps track of the responses in flight for requests which may be
+// collapsed into one another, keyed by where they were sent
+//
+struct collapser {
+
+private:
+  static constexpr std::size_t num_shards = 16;
+
+  struct alignas(64) shard {
+    std::mutex mtx;
+
+    std::unordered_map<
+      std::string, std::shared_ptr<collapsed_response>
+    > in_flight;
+  };
+
+  std::unique_ptr<shard[]> shards_;
+
+  auto shard_for(std::string_view const key) -> shard&;
+
+public:
+  collapser();
+  collapser(collapser const&) = delete;
+  collapser(collapser&&)      = delete;
+
+  // `join` returns the response already in flight for `key`, if it's still
+  // worth waiting for; otherwise it starts a new one and makes the caller
+  // its leader, in which case `is_leader` is set
+  //
+  auto join(
+    std::string const&                          key,
+    boost::beast::http::request_header<> const& request,
+    bool&                                       is_leader)
+  -> std::shared_ptr<collapsed_response>;
+
+  // `leave` is for the leader to call once it's done with the response so
+  // that later requests go upstream again
+  //
+  auto leave(collapsed_response const& response) -> void;
+};
+
+template <typename ParkHandler>
+auto collapsed_response::async_park(
+  follower&     f,
+  ParkHandler&& park_handler
+) -> BOOST_ASIO_INITFN_RESULT_TYPE(
+  ParkHandler, void(boost::system::error_code)) {
+
+  namespace asio  = boost::asio;
+  namespace beast = boost::beast;
+
+  asio::async_completion<ParkHandler, void(boost::system::error_code)>
+  init(park_handler);
+
+  using handler_type = typename decltype(init)::completion_handler_type;
+
+  using executor_type =
+    typename asio::associated_executor<handler_type>::type;
+
+  // a parked follower counts as outstanding work, same as any other pending
+  // operation
+  //
+  struct resumer_impl : follower::resumer {
+    handler_type                             handler;
+    asio::executor_work_guard<executor_type> work;
+
+    explicit
+    resumer_impl(handler_type&& h)
+    : handler(std::move(h))
+    , work(asio::get_associated_executor(handler))
+    {
+    }
+
+    auto resume() -> void override {
+      auto executor = work.get_executor();
+      work.reset();
+
+      asio::post(
+        executor,
+        beast::bind_handler(std::move(handler), boost::system::error_code()));
+    }
+  };
+
+  f.handler = std::make_unique<resumer_impl>(
+    std::move(init.completion_handler));
+
+  // the leader may have moved on since the follower last looked, in which
+  // case it has nobody to resume and it's up to us
+  //
+  auto expected = static_cast<int>(follower::idle);
+  if (!f.state.compare_exchange_strong(expected, follower::parked)) {
+    std::exchange(f.handler, nullptr)->resume();
+  }
+
+  return init.result.get();
+}
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_COLLAPSER_HPP_
@@ -0,0 +1,181 @@
+#ifndef FOXY_DETAIL_FORWARD_PROXY_STATE_HPP_
+#define FOXY_DETAIL_FORWARD_PROXY_STATE_HPP_
+
+#include "foxy/runtime.hpp"
+#include "foxy/cancellation.hpp"
+#include "foxy/multi_stream.hpp"
+#include "foxy/socket_options.hpp"
+#include "foxy/response_cache.hpp"
+#include "foxy/circuit_breaker.hpp"
+#include "foxy/admission_control.hpp"
+#include "foxy/detail/collapser.hpp"
+#include "foxy/detail/mpmc_queue.hpp"
+
+#include <boost/asio/strand.hpp>
+#include <boost/asio/executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+
+namespace foxy {
+namespace detail {
+
+struct forward_proxy_state {
+  using acceptor_type = boost::asio::ip::tcp::acceptor;
+  using stream_type   = multi_stream;
+  using endpoint_type = boost::asio::ip::tcp::endpoint;
+  using strand_type   = boost::asio::strand<boost::asio::executor>;
+
+  // how a proxy accepting on a thread of its own picks the thread to serve
+  // each connection on
+  //
+  enum class dispatch_policy {
+    round_robin,
+
+    // the thread with the fewest sessions, counting those on their way to it
+    //
+    least_sessions
+  };
+
+  // a listener accepts connections onto the context of its acceptor, with the
+  // accept loop and anything else which touches the acceptor running on
+  // `strand`
+  //
+  struct listener {
+    strand_type   strand;
+    acceptor_type acceptor;
+    stream_type   socket;
+
+    listener(boost::asio::io_context& io, acceptor_type acceptor_);
+  };
+
+  // a proxy built on a runtime has a listener per thread, all sharing one
+  // port, and otherwise just the one; the first is the one handed off
+  //
+  std::vector<std::unique_ptr<listener>> listeners;
+
+  // a worker is a thread a proxy accepting on a thread of its own dispatches
+  // connections to; they're passed along through its inbox, which the worker
+  // drains once woken up by a post if it isn't already `scheduled` to
+  //
+  struct worker {
+    boost::asio::io_context& io;
+    mpmc_queue<multi_stream> inbox;
+    std::atomic<bool>        scheduled;
+    std::atomic<std::size_t> sessions;
+
+    worker(boost::asio::io_context& io_, std::size_t const capacity);
+  };
+
+  std::vector<std::unique_ptr<worker>> workers;
+  dispatch_policy                      dispatch = dispatch_policy::round_robin;
+  std::atomic<std::size_t>             next_worker;
+
+  admission_control admission;
+  circuit_breaker   upstream;
+  socket_options    sockets;
+  response_cache    cache;
+  collapser         in_flight;
+
+  bool const collapse_requests;
+
+  // the number of client connections being handled, admitted or not
+  //
+  std::atomic<std::size_t> sessions;
+
+  // used to tag log records with the session they belong to
+  //
+  std::atomic<std::uint64_t> next_session_id;
+
+  // once set, connections are closed after the exchange they're currently in
+  //
+  std::atomic<bool> draining;
+
+  // live_session is how draining reaches a session without waiting on it:
+  // every operation the session starts is bound to `signal`, and `idle` is
+  // set while it waits for admission or on its client for the next request
+  //
+  struct live_session {
+    cancellation_signal signal;
+    std::atomic<bool>   idle{false};
+  };
+
+  std::mutex                        live_mtx;
+  std::unordered_set<live_session*> live;
+
+  // `interrupt_sessions` cancels whatever the sessions still alive are doing,
+  // or only those sitting idle if `idle_only` is set
+  //
+  auto interrupt_sessions(bool const idle_only) -> void;
+
+  forward_proxy_state()                           = delete;
+  forward_proxy_state(forward_proxy_state const&) = delete;
+  forward_proxy_state(forward_proxy_state&&)      = delete;
+
+  // the state with no listeners yet
+  //
+  forward_proxy_state(
+    admission_control::options const& admission_opts,
+    circuit_breaker::options const&   upstream_opts,
+    socket_options const&             socket_opts,
+    response_cache::options const&    cache_opts,
+    bool const                        collapse_requests_);
+
+  forward_proxy_state(
+    boost::asio::io_context&          io,
+    endpoint_type const&              local_endpoint,
+    bool const                        reuse_addr,
+    admission_control::options const& admission_opts,
+    circuit_breaker::options const&   upstream_opts,
+    socket_options const&             socket_opts,
+    response_cache::options const&    cache_opts,
+    bool const                        collapse_requests_);
+
+  forward_proxy_state(
+    boost::asio::io_context&          io,
+    acceptor_type                     acceptor_,
+    admission_control::options const& admission_opts,
+    circuit_breaker::options const&   upstream_opts,
+    socket_options const&             socket_opts,
+    response_cache::options const&    cache_opts,
+    bool const                        collapse_requests_);
+
+  // a single listener on `io`, dispatching to every thread of `rt`
+  //
+  forward_proxy_state(
+    boost::asio::io_context&          io,
+    endpoint_type const&              local_endpoint,
+    bool const                        reuse_addr,
+    runtime&                          rt,
+    dispatch_policy const             dispatch_,
+    admission_control::options const& admission_opts,
+    circuit_breaker::options const&   upstream_opts,
+    socket_options const&             socket_opts,
+    response_cache::options const&    cache_opts,
+    bool const                        collapse_requests_);
+
+  // throws if the listeners can't be set up, or if the platform doesn't
+  // support SO_REUSEPORT
+  //
+  forward_proxy_state(
+    runtime&                          rt,
+    endpoint_type const&              local_endpoint,
+    bool const                        reuse_addr,
+    admission_control::options const& admission_opts,
+    circuit_breaker::options const&   upstream_opts,
+    socket_options const&             socket_opts,
+    response_cache::options const&    cache_opts,
+    bool const                        collapse_requests_);
+};
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_FORWARD_PROXY_STATE_HPP_
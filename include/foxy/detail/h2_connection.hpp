@@ -0,0 +1,314 @@
+#ifndef FOXY_DETAIL_H2_CONNECTION_HPP_
+#define FOXY_DETAIL_H2_CONNECTION_HPP_
+
+#include "foxy/coroutine.hpp"
+#include "foxy/detail/hpack.hpp"
+#include "foxy/detail/h2_frame.hpp"
+#include "foxy/detail/session_state.hpp"
+
+#include <boost/asio/ssl/context.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace foxy {
+namespace detail {
+
+// h2_stream is one request/response exchange on an HTTP/2 connection
+//
+// what the peer sends is gathered into `fields` and `body`; `event` is
+// cancelled whenever the stream moves along so that whoever is waiting on
+// it can look again
+//
+struct h2_stream {
+  using timer_type = session_state::timer_type;
+
+  std::uint32_t id;
+
+  // flow control: how much we may still send and how much the peer may
+  //
+  std::int64_t send_window;
+  std::int64_t receive_window;
+
+  std::vector<header_field> fields;
+  std::string               body;
+
+  bool headers_received = false;
+  bool remote_closed    = false;
+
+  // set once the stream has been reset by either side or the connection
+  // failed
+  //
+  boost::system::error_code ec;
+
+  timer_type event;
+
+  h2_stream(
+    std::uint32_t const      id_,
+    std::int64_t const       send_window_,
+    std::int64_t const       receive_window_,
+    boost::asio::io_context& io);
+};
+
+// h2_connection speaks HTTP/2 over a session's stream
+//
+// a single reader runs for the life of the connection, handing what it reads
+// to the streams it belongs to, while frames from every stream are queued
+// and written out together by a single writer; all of it happens on the
+// connection's strand
+//
+// bodies are gathered in full before they're handed on, with our windows
+// being replenished as data arrives so the peer never stalls on them
+//
+// as a server, streams are handed out by `async_accept` once their request
+// has arrived in full and are finished with `async_respond`
+//
+struct h2_connection : std::enable_shared_from_this<h2_connection> {
+public:
+  using strand_type = session_state::strand_type;
+  using timer_type  = session_state::timer_type;
+
+  enum class role { client, server };
+
+  // the stream window we announce, and what the connection's window is
+  // raised to, in bytes
+  //
+  static constexpr std::uint32_t stream_window_size     = 1024 * 1024;
+  static constexpr std::uint32_t connection_window_size = 16 * 1024 * 1024;
+
+  // streams whose body grows past this are reset
+  //
+  static constexpr std::size_t max_body_size = 8 * 1024 * 1024;
+
+  // how many streams a server lets each client have open at once
+  //
+  static constexpr std::uint32_t max_concurrent_streams = 128;
+
+private:
+  std::weak_ptr<session_state> state_;
+  strand_type                  strand_;
+  role const                   role_;
+
+  h2_settings local_;
+  h2_settings remote_;
+
+  hpack_encoder encoder_;
+  hpack_decoder decoder_;
+
+  std::map<std::uint32_t, std::shared_ptr<h2_stream>> streams_;
+
+  // server streams whose request is complete but which haven't been
+  // accepted yet
+  //
+  std::deque<std::shared_ptr<h2_stream>> accepted_;
+
+  std::uint32_t next_stream_id_;
+  std::uint32_t last_peer_stream_id_ = 0;
+
+  std::int64_t send_window_;
+  std::int64_t receive_window_;
+
+  // a header block split across CONTINUATION frames
+  //
+  std::uint32_t continuation_stream_ = 0;
+  bool          continuation_end_    = false;
+  std::string   header_block_;
+
+  boost::beast::flat_buffer output_;
+  boost::beast::flat_buffer writing_;
+  bool                      is_writing_       = false;
+  bool                      shutdown_pending_ = false;
+
+  bool                      open_          = true;
+  bool                      goaway_        = false;
+  bool                      preface_sent_  = false;
+  boost::system::error_code ec_;
+
+  // cancelled as windows open up, streams close and writes drain
+  //
+  timer_type window_event_;
+  timer_type accept_event_;
+  timer_type done_event_;
+  bool       running_ = false;
+
+  auto queue_preface() -> void;
+  auto flush() -> void;
+  auto write_loop() -> awaitable<void, strand_type>;
+
+  auto fill(
+    session_state&             s,
+    std::size_t const          size,
+    boost::system::error_code& ec) -> awaitable<void, strand_type>;
+
+  auto handle_frame(
+    h2_frame_header const&     header,
+    std::string_view           payload,
+    boost::system::error_code& ec) -> void;
+
+  auto handle_data(
+    h2_frame_header const&     header,
+    std::string_view           payload,
+    boost::system::error_code& ec) -> void;
+
+  auto handle_header_block(
+    std::uint32_t const        stream_id,
+    bool const                 end_stream,
+    boost::system::error_code& ec) -> void;
+
+  auto handle_settings(
+    h2_frame_header const&     header,
+    std::string_view           payload,
+    boost::system::error_code& ec) -> void;
+
+  auto handle_window_update(
+    h2_frame_header const&     header,
+    std::string_view           payload,
+    boost::system::error_code& ec) -> void;
+
+  auto open_stream(
+    std::uint32_t const        stream_id,
+    bool const                 end_stream,
+    std::vector<header_field>& fields,
+    boost::system::error_code& ec) -> void;
+
+  auto dispatch(std::shared_ptr<h2_stream> const& stream) -> void;
+
+  auto find_stream(std::uint32_t const id) -> std::shared_ptr<h2_stream>;
+
+  auto reset_stream(
+    h2_stream&                       stream,
+    boost::system::error_code const& ec) -> void;
+
+  auto fail(boost::system::error_code const& ec) -> void;
+
+  auto wait(timer_type& event) -> awaitable<void, strand_type>;
+
+public:
+  h2_connection()                     = delete;
+  h2_connection(h2_connection const&) = delete;
+  h2_connection(h2_connection&&)      = delete;
+
+  h2_connection(std::shared_ptr<session_state> const& state, role const r);
+
+  // servers share the strand of whoever serves the connection so that their
+  // handlers can use it freely
+  //
+  h2_connection(
+    std::shared_ptr<session_state> const& state,
+    role const                            r,
+    strand_type                           strand);
+
+  auto get_strand() const -> strand_type;
+
+  // only to be read on the connection's strand
+  //
+  auto is_open() const noexcept -> bool;
+
+  // `start` runs the connection in the background, which ends when the
+  // connection fails or is closed
+  //
+  auto start() -> void;
+
+  // `run` reads from the connection until it fails or is closed, failing
+  // every stream left open when it does
+  //
+  auto run() -> awaitable<void, strand_type>;
+
+  // `async_send` queues `fields` on `stream` followed by `body`, waiting on
+  // flow control as needed; an empty body ends the stream with the headers
+  //
+  auto async_send(
+    std::shared_ptr<h2_stream> const& stream,
+    std::vector<header_field> const&  fields,
+    std::string_view const            body,
+    boost::system::error_code&        ec) -> awaitable<void, strand_type>;
+
+  // `async_request` opens a stream for `fields` and `body` and waits for the
+  // peer's response to arrive in full, waiting first for room under the
+  // peer's limit on concurrent streams
+  //
+  // requests the peer never looked at, because it's going away, fail with
+  // `http2::error::refused_stream` and are safe to retry elsewhere
+  //
+  auto async_request(
+    std::vector<header_field> const& fields,
+    std::string_view const           body,
+    std::vector<header_field>&       response_fields,
+    std::string&                     response_body,
+    boost::system::error_code&       ec) -> awaitable<void, strand_type>;
+
+  // `async_accept` waits for the next stream whose request has arrived in
+  // full, failing with the error that ended the connection once there are
+  // no more
+  //
+  auto async_accept(
+    std::shared_ptr<h2_stream>& stream,
+    boost::system::error_code&  ec) -> awaitable<void, strand_type>;
+
+  // `async_respond` sends the response to an accepted stream and forgets
+  // about it
+  //
+  auto async_respond(
+    std::shared_ptr<h2_stream> const& stream,
+    std::vector<header_field> const&  fields,
+    std::string_view const            body,
+    boost::system::error_code&        ec) -> awaitable<void, strand_type>;
+
+  // `reset` abandons `stream` with a RST_STREAM carrying `ec`
+  //
+  auto reset(
+    std::shared_ptr<h2_stream> const& stream,
+    boost::system::error_code const&  ec) -> void;
+
+  // `close` tells the peer we're going away and shuts down the sending side
+  // once everything queued has been written
+  //
+  auto close() -> void;
+
+  // `async_close` does the same as `close` but then stops reading and waits
+  // for the connection to stop running, leaving the stream to the caller,
+  // who can then shut TLS down cleanly
+  //
+  auto async_close() -> awaitable<void, strand_type>;
+};
+
+// `offer_h2_alpn` has a client's TLS handshake offer HTTP/2 ahead of
+// HTTP/1.1
+//
+auto offer_h2_alpn(
+  multi_stream&              stream,
+  boost::system::error_code& ec) -> void;
+
+// `select_h2_alpn` has servers using `ctx` pick HTTP/2 during the TLS
+// handshake when the client offers it, and HTTP/1.1 otherwise
+//
+auto select_h2_alpn(boost::asio::ssl::context& ctx) -> void;
+
+// `is_h2_alpn` is true when ALPN settled on HTTP/2 for `stream`
+//
+auto is_h2_alpn(multi_stream& stream) -> bool;
+
+// `async_detect_h2_preface` reads from a plaintext connection until it can
+// tell whether the client opened with the HTTP/2 preface, which clients with
+// prior knowledge of our support do
+//
+// what it reads is left in `s.buffer` for whichever protocol gets to parse it
+//
+auto async_detect_h2_preface(
+  session_state&             s,
+  bool&                      is_h2,
+  boost::system::error_code& ec
+) -> awaitable<void, session_state::strand_type>;
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_H2_CONNECTION_HPP_
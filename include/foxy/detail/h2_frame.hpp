@@ -0,0 +1,146 @@
+#ifndef FOXY_DETAIL_H2_FRAME_HPP_
+#define FOXY_DETAIL_H2_FRAME_HPP_
+
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace foxy {
+namespace detail {
+
+// the framing layer of HTTP/2 (RFC 7540 sections 4 and 6)
+//
+
+enum class h2_frame_type : std::uint8_t {
+  data          = 0x0,
+  headers       = 0x1,
+  priority      = 0x2,
+  rst_stream    = 0x3,
+  settings      = 0x4,
+  push_promise  = 0x5,
+  ping          = 0x6,
+  goaway        = 0x7,
+  window_update = 0x8,
+  continuation  = 0x9
+};
+
+inline constexpr std::uint8_t h2_end_stream  = 0x01;
+inline constexpr std::uint8_t h2_ack         = 0x01;
+inline constexpr std::uint8_t h2_end_headers = 0x04;
+inline constexpr std::uint8_t h2_padded      = 0x08;
+inline constexpr std::uint8_t h2_priority    = 0x20;
+
+enum class h2_setting : std::uint16_t {
+  header_table_size      = 0x1,
+  enable_push            = 0x2,
+  max_concurrent_streams = 0x3,
+  initial_window_size    = 0x4,
+  max_frame_size         = 0x5,
+  max_header_list_size   = 0x6
+};
+
+inline constexpr std::size_t h2_frame_header_size = 9;
+
+inline constexpr std::string_view h2_client_preface =
+  "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+inline constexpr std::uint32_t h2_default_window_size = 65535;
+inline constexpr std::uint32_t h2_max_window_size     = 0x7fffffff;
+inline constexpr std::uint32_t h2_min_frame_size      = 16384;
+inline constexpr std::uint32_t h2_max_frame_size      = 16777215;
+
+struct h2_frame_header {
+  std::uint32_t length    = 0;
+  std::uint8_t  type      = 0;
+  std::uint8_t  flags     = 0;
+  std::uint32_t stream_id = 0;
+
+  auto is(h2_frame_type const t) const noexcept -> bool {
+    return type == static_cast<std::uint8_t>(t);
+  }
+};
+
+// h2_settings are the parameters one end of a connection announces to the
+// other, starting out at the protocol's defaults
+//
+struct h2_settings {
+  std::uint32_t header_table_size      = 4096;
+  bool          enable_push            = true;
+  std::uint32_t max_concurrent_streams = 0xffffffff;
+  std::uint32_t initial_window_size    = h2_default_window_size;
+  std::uint32_t max_frame_size         = h2_min_frame_size;
+  std::uint32_t max_header_list_size   = 0xffffffff;
+};
+
+auto read_u32(char const* p) noexcept -> std::uint32_t;
+
+// `parse_frame_header` reads the 9 octets at `p`
+//
+auto parse_frame_header(char const* p) noexcept -> h2_frame_header;
+
+// `strip_padding` removes the padding and priority fields of DATA and
+// HEADERS frames from `payload`, failing with a protocol error when the
+// padding runs past the end of the frame
+//
+auto strip_padding(
+  h2_frame_header const&     header,
+  std::string_view&          payload,
+  boost::system::error_code& ec) -> void;
+
+// `apply_settings` updates `settings` with the payload of a SETTINGS frame,
+// validating the values as RFC 7540 section 6.5.2 requires
+//
+auto apply_settings(
+  h2_settings&               settings,
+  std::string_view           payload,
+  boost::system::error_code& ec) -> void;
+
+// the `write_` functions append a complete frame to `out`
+//
+
+auto write_frame(
+  boost::beast::flat_buffer& out,
+  h2_frame_type const        type,
+  std::uint8_t const         flags,
+  std::uint32_t const        stream_id,
+  std::string_view const     payload) -> void;
+
+// `write_headers` splits a header block into a HEADERS frame followed by as
+// many CONTINUATION frames as `max_frame_size` calls for
+//
+auto write_headers(
+  boost::beast::flat_buffer& out,
+  std::uint32_t const        stream_id,
+  std::string_view           block,
+  bool const                 end_stream,
+  std::uint32_t const        max_frame_size) -> void;
+
+// `write_settings` announces every value of `settings` which differs from the
+// protocol's defaults
+//
+auto write_settings(
+  boost::beast::flat_buffer& out,
+  h2_settings const&         settings) -> void;
+
+auto write_window_update(
+  boost::beast::flat_buffer& out,
+  std::uint32_t const        stream_id,
+  std::uint32_t const        increment) -> void;
+
+auto write_rst_stream(
+  boost::beast::flat_buffer& out,
+  std::uint32_t const        stream_id,
+  std::uint32_t const        error_code) -> void;
+
+auto write_goaway(
+  boost::beast::flat_buffer& out,
+  std::uint32_t const        last_stream_id,
+  std::uint32_t const        error_code) -> void;
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_H2_FRAME_HPP_
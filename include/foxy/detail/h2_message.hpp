@@ -0,0 +1,407 @@
+#ifndef FOXY_DETAIL_H2_MESSAGE_HPP_
+#define FOXY_DETAIL_H2_MESSAGE_HPP_
+
+#include "foxy/coroutine.hpp"
+#include "foxy/http2_error.hpp"
+#include "foxy/detail/hpack.hpp"
+#include "foxy/detail/h2_connection.hpp"
+
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/field.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <algorithm>
+#include <string_view>
+
+namespace foxy {
+namespace detail {
+
+// translating between HTTP/1.1 messages and the fields and bodies HTTP/2
+// streams carry (RFC 7540 section 8.1)
+//
+
+// `is_h2_field_valid` rejects names and values which would break the
+// HTTP/1.1 framing they're turned back into
+//
+inline
+auto is_h2_field_valid(header_field const& field) -> bool {
+  auto const is_bad = [](char const c) {
+    return c == '\r' || c == '\n' || c == '\0';
+  };
+
+  return
+    !field.name.empty() &&
+    std::none_of(field.name.begin(), field.name.end(), is_bad) &&
+    std::none_of(field.value.begin(), field.value.end(), is_bad) &&
+    field.name.find(':', 1) == std::string::npos;
+}
+
+// `append_h2_fields` adds the fields of `message` to `fields`, lowercasing
+// their names and dropping those which only make sense for a single HTTP/1.1
+// connection
+//
+template <typename Message>
+auto append_h2_fields(
+  Message const&             message,
+  std::vector<header_field>& fields) -> void
+{
+  namespace http = boost::beast::http;
+
+  for (auto const& field : message) {
+    switch (field.name()) {
+      case http::field::connection:
+      case http::field::keep_alive:
+      case http::field::proxy_connection:
+      case http::field::transfer_encoding:
+      case http::field::upgrade:
+      case http::field::host:
+        continue;
+
+      case http::field::te:
+        if (field.value() != "trailers") { continue; }
+        break;
+
+      default:
+        break;
+    }
+
+    auto name = std::string(field.name_string());
+    std::transform(name.begin(), name.end(), name.begin(), [](char const c) {
+      return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+
+    fields.push_back({std::move(name), std::string(field.value())});
+  }
+}
+
+// `make_h2_request_fields` turns the header of `request` into the fields of
+// a HEADERS frame, pseudo-header fields first
+//
+// `authority` is used when the request has no Host field
+//
+template <typename Request>
+auto make_h2_request_fields(
+  Request const&         request,
+  std::string_view const scheme,
+  std::string_view const authority) -> std::vector<header_field>
+{
+  namespace http = boost::beast::http;
+
+  auto fields = std::vector<header_field>();
+
+  auto const host = request[http::field::host];
+
+  fields.push_back({":method", std::string(request.method_string())});
+  fields.push_back({":scheme", std::string(scheme)});
+  fields.push_back({
+    ":authority",
+    host.empty() ? std::string(authority) : std::string(host)});
+  fields.push_back({":path", std::string(request.target())});
+
+  append_h2_fields(request, fields);
+  return fields;
+}
+
+// `make_h2_response_fields` turns the header of `response` into the fields of
+// a HEADERS frame
+//
+template <typename Response>
+auto make_h2_response_fields(
+  Response const& response) -> std::vector<header_field>
+{
+  auto fields = std::vector<header_field>();
+  fields.push_back({":status", std::to_string(response.result_int())});
+
+  append_h2_fields(response, fields);
+  return fields;
+}
+
+// `serialize_h2_body` reads the whole of `message`'s body into `body`
+//
+template <typename Message>
+auto serialize_h2_body(
+  Message&                   message,
+  std::string&               body,
+  boost::system::error_code& ec) -> void
+{
+  namespace asio = boost::asio;
+
+  using body_type = typename Message::body_type;
+
+  ec = {};
+
+  auto writer = typename body_type::writer(message.base(), message.body());
+  writer.init(ec);
+
+  while (!ec) {
+    auto result = writer.get(ec);
+    if (ec || !result) { return; }
+
+    auto const& buffers = result->first;
+    for (auto pos = asio::buffer_sequence_begin(buffers);
+         pos != asio::buffer_sequence_end(buffers);
+         ++pos) {
+      auto const buffer = asio::const_buffer(*pos);
+      body.append(static_cast<char const*>(buffer.data()), buffer.size());
+    }
+
+    if (!result->second) { return; }
+  }
+}
+
+// `put_h2_message` feeds `parser` a complete HTTP/1.1 header followed by
+// `body`
+//
+template <typename Parser>
+auto put_h2_message(
+  Parser&                    parser,
+  std::string_view const     header,
+  std::string_view const     body,
+  boost::system::error_code& ec) -> void
+{
+  namespace asio = boost::asio;
+  namespace http = boost::beast::http;
+
+  parser.eager(true);
+
+  auto const put = [&](std::string_view const data) {
+    auto buffer = asio::const_buffer(data.data(), data.size());
+    while (buffer.size() > 0 && !parser.is_done()) {
+      auto const bytes_parsed = parser.put(buffer, ec);
+      if (ec || bytes_parsed == 0) { return; }
+
+      buffer += bytes_parsed;
+    }
+  };
+
+  put(header);
+  if (!ec) { put(body); }
+
+  if (!ec && !parser.is_done()) { ec = http::error::partial_message; }
+}
+
+// `parse_h2_response` feeds `parser` the HTTP/1.1 equivalent of a response
+// which arrived over HTTP/2
+//
+// the body's length is known up front, so it's always described with a
+// Content-Length; the response to a HEAD request keeps the one it was sent
+//
+template <typename ResponseParser>
+auto parse_h2_response(
+  std::vector<header_field> const& fields,
+  std::string_view const           body,
+  bool const                       is_head,
+  ResponseParser&                  parser,
+  boost::system::error_code&       ec) -> void
+{
+  ec = {};
+
+  auto status = std::string_view();
+  if (!fields.empty() && fields.front().name == ":status") {
+    status = fields.front().value;
+  }
+
+  auto const is_digit = [](char const c) { return c >= '0' && c <= '9'; };
+  if (status.size() != 3 ||
+      !std::all_of(status.begin(), status.end(), is_digit)) {
+    ec = http2::error::protocol_error;
+    return;
+  }
+
+  auto header = std::string("HTTP/1.1 ");
+  header.append(status);
+  header.append(" \r\n");
+
+  for (auto const& field : fields) {
+    if (!is_h2_field_valid(field)) {
+      ec = http2::error::protocol_error;
+      return;
+    }
+
+    auto const is_framing =
+      field.name == "transfer-encoding" ||
+      field.name == "connection" ||
+      (field.name == "content-length" && !is_head);
+
+    if (field.name.front() == ':' || is_framing) { continue; }
+
+    header.append(field.name);
+    header.append(": ");
+    header.append(field.value);
+    header.append("\r\n");
+  }
+
+  auto const has_body = !is_head && status != "204" && status != "304";
+  if (has_body) {
+    header.append("content-length: ");
+    header.append(std::to_string(body.size()));
+    header.append("\r\n");
+  }
+
+  header.append("\r\n");
+
+  if (is_head) { parser.skip(true); }
+  put_h2_message(parser, header, has_body ? body : std::string_view(), ec);
+}
+
+// `parse_h2_request` feeds `parser` the HTTP/1.1 equivalent of a request
+// which arrived over HTTP/2, failing with a protocol error when the request
+// is malformed (RFC 7540 section 8.1.2)
+//
+// `:authority` stands in for a missing Host field and cookies split across
+// several fields are put back together
+//
+template <typename RequestParser>
+auto parse_h2_request(
+  std::vector<header_field> const& fields,
+  std::string_view const           body,
+  RequestParser&                   parser,
+  boost::system::error_code&       ec) -> void
+{
+  ec = {};
+
+  auto method    = std::string_view();
+  auto scheme    = std::string_view();
+  auto authority = std::string_view();
+  auto path      = std::string_view();
+
+  auto has_host     = false;
+  auto seen_regular = false;
+  auto cookie       = std::string();
+  auto regular      = std::string();
+
+  auto const is_malformed = [&](header_field const& field) {
+    auto const is_upper = [](char const c) { return c >= 'A' && c <= 'Z'; };
+
+    if (!is_h2_field_valid(field) ||
+        std::any_of(field.name.begin(), field.name.end(), is_upper)) {
+      return true;
+    }
+
+    if (field.name.front() != ':') {
+      seen_regular = true;
+      return false;
+    }
+
+    // pseudo-header fields come first and only once each
+    //
+    auto const set = [&](std::string_view& value) {
+      if (seen_regular || !value.empty() || field.value.empty()) {
+        return false;
+      }
+
+      value = field.value;
+      return true;
+    };
+
+    if (field.name == ":method")    { return !set(method); }
+    if (field.name == ":scheme")    { return !set(scheme); }
+    if (field.name == ":authority") { return !set(authority); }
+    if (field.name == ":path")      { return !set(path); }
+
+    return true;
+  };
+
+  for (auto const& field : fields) {
+    if (is_malformed(field)) {
+      ec = http2::error::protocol_error;
+      return;
+    }
+
+    auto const is_framing =
+      field.name == "transfer-encoding" ||
+      field.name == "connection" ||
+      field.name == "content-length";
+
+    if (field.name.front() == ':' || is_framing) { continue; }
+
+    if (field.name == "cookie") {
+      if (!cookie.empty()) { cookie.append("; "); }
+      cookie.append(field.value);
+      continue;
+    }
+
+    if (field.name == "host") { has_host = true; }
+
+    regular.append(field.name);
+    regular.append(": ");
+    regular.append(field.value);
+    regular.append("\r\n");
+  }
+
+  auto const has_space = [](std::string_view const s) {
+    return s.find(' ') != std::string_view::npos;
+  };
+
+  if (method.empty() || path.empty() || has_space(method) ||
+      has_space(path) || (scheme.empty() && method != "CONNECT")) {
+    ec = http2::error::protocol_error;
+    return;
+  }
+
+  auto header = std::string(method);
+  header.append(" ");
+  header.append(path);
+  header.append(" HTTP/1.1\r\n");
+
+  if (!has_host && !authority.empty()) {
+    header.append("host: ");
+    header.append(authority);
+    header.append("\r\n");
+  }
+
+  header.append(regular);
+
+  if (!cookie.empty()) {
+    header.append("cookie: ");
+    header.append(cookie);
+    header.append("\r\n");
+  }
+
+  if (!body.empty()) {
+    header.append("content-length: ");
+    header.append(std::to_string(body.size()));
+    header.append("\r\n");
+  }
+
+  header.append("\r\n");
+
+  put_h2_message(parser, header, body, ec);
+}
+
+// `async_send_h2_response` answers an accepted stream with `response`, whose
+// body is left out when it answers a HEAD request
+//
+template <typename Response>
+auto async_send_h2_response(
+  h2_connection&                    h2,
+  std::shared_ptr<h2_stream> const& stream,
+  Response&                         response,
+  bool const                        is_head,
+  boost::system::error_code&        ec
+) -> awaitable<void, h2_connection::strand_type>
+{
+  auto const fields = make_h2_response_fields(response);
+
+  auto body = std::string();
+  if (!is_head) { serialize_h2_body(response, body, ec); }
+
+  if (ec) {
+    h2.reset(stream, http2::error::internal_error);
+    co_return;
+  }
+
+  co_await h2.async_respond(stream, fields, body, ec);
+}
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_H2_MESSAGE_HPP_
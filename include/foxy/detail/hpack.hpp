@@ -0,0 +1,113 @@
+#ifndef FOXY_DETAIL_HPACK_HPP_
+#define FOXY_DETAIL_HPACK_HPP_
+
+#include <boost/system/error_code.hpp>
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace foxy {
+namespace detail {
+
+// HPACK, the header compression of HTTP/2 (RFC 7541)
+//
+
+struct header_field {
+  std::string name;
+  std::string value;
+};
+
+// the default size of the dynamic table, which is also the largest we let
+// peers make ours
+//
+inline constexpr std::size_t default_hpack_table_size = 4096;
+
+// hpack_table is the dynamic table shared by an encoder and the decoder on
+// the other end of the connection
+//
+// entries are indexed from 1, newest first; lookups across both the static
+// and dynamic tables add the 61 static entries in front
+//
+struct hpack_table {
+  std::deque<header_field> entries;
+  std::size_t              size     = 0;
+  std::size_t              max_size = default_hpack_table_size;
+
+  // `insert` adds `field` at the front, evicting from the back to make room
+  // fields larger than the whole table empty it and aren't kept
+  //
+  auto insert(header_field field) -> void;
+
+  auto resize(std::size_t const new_max_size) -> void;
+};
+
+// `field_size` is what a field counts against a table's size
+//
+auto field_size(std::string_view name, std::string_view value) -> std::size_t;
+
+struct hpack_encoder {
+private:
+  hpack_table                table_;
+  std::optional<std::size_t> size_update_;
+
+public:
+  // `set_max_size` follows the peer's SETTINGS_HEADER_TABLE_SIZE, which is
+  // announced at the start of the next header block
+  //
+  auto set_max_size(std::size_t const max_size) -> void;
+
+  // `encode` appends `name: value` to the header block in `out`
+  //
+  // fields found whole in either table go out as an index, everything else
+  // as a literal which is added to the dynamic table; `sensitive` fields,
+  // like credentials, are never added to either side's table
+  //
+  auto encode(
+    std::string_view const name,
+    std::string_view const value,
+    std::string&           out,
+    bool const             sensitive = false) -> void;
+};
+
+struct hpack_decoder {
+private:
+  hpack_table table_;
+  std::size_t max_list_size_;
+
+public:
+  // `max_list_size` bounds the decoded size of a header list, counting each
+  // field as RFC 7540 counts SETTINGS_MAX_HEADER_LIST_SIZE
+  //
+  explicit
+  hpack_decoder(std::size_t const max_list_size = 64 * 1024);
+
+  // `decode` appends the fields of a complete header block to `fields`
+  //
+  // fails with `http2::error::compression_error`, after which the dynamic
+  // table can no longer be trusted and the connection has to be torn down
+  //
+  auto decode(
+    std::string_view const     block,
+    std::vector<header_field>& fields,
+    boost::system::error_code& ec) -> void;
+};
+
+// `huffman_encode` appends the Huffman coding of `s` to `out`
+//
+auto huffman_encode(std::string_view const s, std::string& out) -> void;
+
+auto huffman_encoded_size(std::string_view const s) -> std::size_t;
+
+// `huffman_decode` appends the decoding of `s` to `out`, returning false for
+// invalid codes or padding
+//
+auto huffman_decode(std::string_view const s, std::string& out) -> bool;
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_HPACK_HPP_
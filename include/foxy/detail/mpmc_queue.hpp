@@ -0,0 +1,133 @@
+#ifndef FOXY_DETAIL_MPMC_QUEUE_HPP_
+#define FOXY_DETAIL_MPMC_QUEUE_HPP_
+
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <optional>
+
+namespace foxy {
+namespace detail {
+
+// mpmc_queue is a bounded, lock-free, multi-producer/multi-consumer queue
+// based on Dmitry Vyukov's array-based design
+//
+// every cell carries a sequence number which tells producers and consumers
+// whether it is theirs to write or read so that the only contended state is
+// the pair of enqueue/dequeue cursors
+//
+// `capacity` is rounded up to the next power of two
+//
+template <typename T>
+struct mpmc_queue {
+
+private:
+  struct cell {
+    std::atomic<std::size_t> sequence;
+    std::optional<T>         value;
+  };
+
+  static constexpr std::size_t cache_line = 64;
+
+  std::size_t             mask_;
+  std::unique_ptr<cell[]> cells_;
+
+  alignas(cache_line) std::atomic<std::size_t> enqueue_pos_;
+  alignas(cache_line) std::atomic<std::size_t> dequeue_pos_;
+
+  static auto round_up(std::size_t n) -> std::size_t {
+    auto p = std::size_t{2};
+    while (p < n) { p <<= 1; }
+    return p;
+  }
+
+public:
+  mpmc_queue()                  = delete;
+  mpmc_queue(mpmc_queue const&) = delete;
+  mpmc_queue(mpmc_queue&&)      = delete;
+
+  explicit
+  mpmc_queue(std::size_t const capacity)
+  : mask_(round_up(capacity) - 1)
+  , cells_(new cell[mask_ + 1])
+  , enqueue_pos_(0)
+  , dequeue_pos_(0)
+  {
+    for (auto i = std::size_t{0}; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  auto capacity() const noexcept -> std::size_t {
+    return mask_ + 1;
+  }
+
+  // `try_push` returns false if the queue is full
+  //
+  template <typename U>
+  auto try_push(U&& u) -> bool {
+    auto  pos = enqueue_pos_.load(std::memory_order_relaxed);
+    cell* c   = nullptr;
+
+    while (true) {
+      c = &cells_[pos & mask_];
+
+      auto const seq  = c->sequence.load(std::memory_order_acquire);
+      auto const diff =
+        static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    c->value.emplace(std::forward<U>(u));
+    c->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // `try_pop` returns an empty optional if the queue is empty
+  //
+  auto try_pop() -> std::optional<T> {
+    auto  pos = dequeue_pos_.load(std::memory_order_relaxed);
+    cell* c   = nullptr;
+
+    while (true) {
+      c = &cells_[pos & mask_];
+
+      auto const seq  = c->sequence.load(std::memory_order_acquire);
+      auto const diff =
+        static_cast<std::ptrdiff_t>(seq) -
+        static_cast<std::ptrdiff_t>(pos + 1);
+
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return {};
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    auto value = std::move(c->value);
+    c->value.reset();
+    c->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return value;
+  }
+};
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_MPMC_QUEUE_HPP_
@@ -0,0 +1,156 @@
+#ifndef FOXY_DETAIL_QUEUE_OUTPUT_HPP_
+#define FOXY_DETAIL_QUEUE_OUTPUT_HPP_
+
+#include "foxy/coroutine.hpp"
+#include "foxy/detail/session_state.hpp"
+
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/http/write.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/serializer.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include <boost/core/ignore_unused.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <utility>
+
+namespace foxy {
+namespace detail {
+
+// `queue_output` runs `serializer` to completion, or up to the end of the
+// header when `header_only` is set, appending what it produces to `output`
+//
+// the body is read synchronously, so this is meant for bodies which are
+// already in memory
+// on failure, `output` is left as it was
+//
+template <typename Serializer>
+auto queue_output(
+  boost::beast::flat_buffer& output,
+  Serializer&                serializer,
+  bool const                 header_only,
+  boost::system::error_code& ec) -> void
+{
+  namespace asio = boost::asio;
+
+  auto const prior = output.size();
+
+  ec = {};
+  serializer.split(header_only);
+
+  auto const is_done = [&] {
+    return header_only ? serializer.is_header_done() : serializer.is_done();
+  };
+
+  while (!ec && !is_done()) {
+    serializer.next(
+      ec,
+      [&](boost::system::error_code& next_ec, auto const& buffers) {
+        boost::ignore_unused(next_ec);
+
+        auto const size = asio::buffer_size(buffers);
+        output.commit(asio::buffer_copy(output.prepare(size), buffers));
+        serializer.consume(size);
+      });
+  }
+
+  if (!ec) { return; }
+
+  // a flat_buffer can't drop bytes off its end so we copy back what was
+  // queued before, which only happens when a body fails to serialize
+  //
+  auto restored = boost::beast::flat_buffer();
+  restored.commit(
+    asio::buffer_copy(restored.prepare(prior), output.data(), prior));
+
+  output = std::move(restored);
+}
+
+// `queue_message` appends all of `message` to `output`
+//
+template <bool isRequest, typename Body, typename Fields>
+auto queue_message(
+  boost::beast::flat_buffer&                            output,
+  boost::beast::http::message<isRequest, Body, Fields>& message,
+  boost::system::error_code&                            ec) -> void
+{
+  auto serializer =
+    boost::beast::http::serializer<isRequest, Body, Fields>(message);
+
+  queue_output(output, serializer, false, ec);
+}
+
+// `async_write_message` writes `message` to the session's stream along with
+// anything queued in `s.output`
+//
+// messages with a known body size of at most
+// `session_state::max_coalesced_bytes` are copied in behind the queue and
+// everything leaves in a single write, instead of Beast handing the header and
+// each body buffer over separately; larger messages have the queue sent ahead
+// of them
+//
+template <bool isRequest, typename Body, typename Fields>
+auto async_write_message(
+  session_state&                                        s,
+  boost::beast::http::message<isRequest, Body, Fields>& message,
+  std::size_t&                                          bytes_transferred,
+  boost::system::error_code&                            ec
+) -> foxy::awaitable<void, session_state::strand_type>
+{
+  bytes_transferred = 0;
+
+  auto const payload_size = message.payload_size();
+  auto const coalesce =
+    payload_size && *payload_size <= session_state::max_coalesced_bytes;
+
+  if (coalesce) {
+    queue_message(s.output, message, ec);
+    if (!ec) { co_await async_flush_output(s, bytes_transferred, ec); }
+    co_return;
+  }
+
+  if (s.output.size() > 0) {
+    co_await async_flush_output(s, bytes_transferred, ec);
+    if (ec) { co_return; }
+  }
+
+  auto token       = co_await foxy::this_coro::token();
+  auto error_token = foxy::redirect_error(token, ec);
+
+  bytes_transferred +=
+    co_await boost::beast::http::async_write(s.stream, message, error_token);
+}
+
+// `async_queue_message` is `async_write_message` for messages which can wait
+// on ones still to come: small messages are only queued, being written once
+// `session_state::max_queued_bytes` have built up
+//
+template <bool isRequest, typename Body, typename Fields>
+auto async_queue_message(
+  session_state&                                        s,
+  boost::beast::http::message<isRequest, Body, Fields>& message,
+  std::size_t&                                          bytes_transferred,
+  boost::system::error_code&                            ec
+) -> foxy::awaitable<void, session_state::strand_type>
+{
+  bytes_transferred = 0;
+
+  auto const payload_size = message.payload_size();
+  if (!payload_size || *payload_size > session_state::max_coalesced_bytes) {
+    co_await async_write_message(s, message, bytes_transferred, ec);
+    co_return;
+  }
+
+  queue_message(s.output, message, ec);
+  if (!ec && s.output.size() >= session_state::max_queued_bytes) {
+    co_await async_flush_output(s, bytes_transferred, ec);
+  }
+}
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_QUEUE_OUTPUT_HPP_
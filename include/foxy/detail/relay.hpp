@@ -0,0 +1,42 @@
+#ifndef FOXY_DETAIL_RELAY_HPP_
+#define FOXY_DETAIL_RELAY_HPP_
+
+#include "foxy/coroutine.hpp"
+#include "foxy/detail/session_state.hpp"
+
+#include <boost/system/error_code.hpp>
+
+#include <memory>
+
+namespace foxy {
+namespace detail {
+
+// `async_relay_one_way` copies raw bytes from `from` to `to` until `from` is
+// closed, which is passed on by shutting down the sending side of `to`
+//
+// anything already sitting in `from`'s read buffer goes first
+// while waiting on `from` no memory is held at all, the scratch buffer only
+// being taken from the pool once there's something to read into it
+//
+auto async_relay_one_way(
+  session_state&             from,
+  session_state&             to,
+  boost::system::error_code& ec
+) -> awaitable<void, session_state::strand_type>;
+
+// `async_relay` runs `async_relay_one_way` in both directions at once,
+// finishing when both are done
+//
+// if either direction fails, both connections are shut down so that the
+// other one ends as well
+//
+auto async_relay(
+  std::shared_ptr<session_state> const& a,
+  std::shared_ptr<session_state> const& b,
+  boost::system::error_code&            ec
+) -> awaitable<void, session_state::strand_type>;
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_RELAY_HPP_
@@ -0,0 +1,37 @@
+#ifndef FOXY_DETAIL_SEND_FILE_HPP_
+#define FOXY_DETAIL_SEND_FILE_HPP_
+
+#include "foxy/coroutine.hpp"
+#include "foxy/byte_range.hpp"
+#include "foxy/multi_stream.hpp"
+#include "foxy/detail/session_state.hpp"
+
+#include <boost/beast/core/file.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstdint>
+
+namespace foxy {
+namespace detail {
+
+// `async_send_file` writes the bytes of `file` within `range` to `stream`,
+// storing how many were written in `bytes_transferred`
+//
+// plaintext streams on Linux have the kernel copy straight from the page
+// cache to the socket with `sendfile(2)`
+// everything else, TLS included, writes from a read-only mapping of the file
+// so that the data is at least never copied into a buffer of our own; the
+// file must not be truncated while it's mapped
+//
+auto async_send_file(
+  multi_stream&              stream,
+  boost::beast::file&        file,
+  byte_range const           range,
+  std::uint64_t&             bytes_transferred,
+  boost::system::error_code& ec
+) -> foxy::awaitable<void, session_state::strand_type>;
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_SEND_FILE_HPP_
@@ -0,0 +1,131 @@
+#ifndef FOXY_DETAIL_SERVE_H2_HPP_
+#define FOXY_DETAIL_SERVE_H2_HPP_
+
+#include "foxy/coroutine.hpp"
+#include "foxy/type_traits.hpp"
+#include "foxy/http2_error.hpp"
+#include "foxy/detail/h2_message.hpp"
+#include "foxy/detail/h2_connection.hpp"
+#include "foxy/detail/session_state.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#include <boost/asio/error.hpp>
+
+#include <boost/beast/http/verb.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/parser.hpp>
+#include <boost/beast/http/message.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <memory>
+#include <cstddef>
+#include <type_traits>
+
+namespace foxy {
+namespace detail {
+
+// `async_serve_h2` runs an HTTP/2 connection over `s`, answering every stream
+// with whatever `request_handler` returns for its request
+//
+// each stream gets a coroutine of its own on `strand` so a slow response
+// never holds up the others; this only finishes once the connection has
+// ended and every handler has returned, and the client closing the
+// connection isn't counted as an error
+//
+template <typename RequestBody, typename RequestHandler>
+auto async_serve_h2(
+  std::shared_ptr<session_state> const& s,
+  session_state::strand_type const&     strand,
+  RequestHandler&                       request_handler,
+  boost::system::error_code&            ec
+) -> awaitable<void, session_state::strand_type>
+{
+  using boost::system::error_code;
+
+  namespace asio = boost::asio;
+  namespace http = boost::beast::http;
+
+  using strand_type = session_state::strand_type;
+  using result_type = std::invoke_result_t<
+    RequestHandler&, http::request<RequestBody>&>;
+
+  auto token = co_await this_coro::token();
+
+  auto h2 = std::make_shared<h2_connection>(
+    s, h2_connection::role::server, strand);
+
+  s->h2 = h2;
+  h2->start();
+
+  auto& metrics = session_metrics::get();
+
+  auto active = std::size_t{0};
+  auto idle   = session_state::timer_type(s->stream.get_executor().context());
+  idle.expires_at(session_state::timer_type::time_point::max());
+
+  while (true) {
+    auto stream = std::shared_ptr<h2_stream>();
+    co_await h2->async_accept(stream, ec);
+    if (ec) { break; }
+
+    metrics.h2_streams.add();
+    ++active;
+
+    co_spawn(
+      strand,
+      [&, h2, stream]() -> awaitable<void, strand_type> {
+        auto stream_ec = error_code();
+
+        auto parser = http::request_parser<RequestBody>();
+        parser.body_limit(h2_connection::max_body_size);
+
+        parse_h2_request(stream->fields, stream->body, parser, stream_ec);
+        stream->body.clear();
+
+        if (stream_ec) {
+          h2->reset(stream, http2::error::protocol_error);
+
+        } else {
+          auto&      request = parser.get();
+          auto const is_head = request.method() == http::verb::head;
+
+          if constexpr (foxy::is_awaitable_v<result_type>) {
+            auto response = co_await request_handler(request);
+            co_await async_send_h2_response(
+              *h2, stream, response, is_head, stream_ec);
+          } else {
+            auto response = request_handler(request);
+            co_await async_send_h2_response(
+              *h2, stream, response, is_head, stream_ec);
+          }
+        }
+
+        if (stream_ec) { metrics.errors.add(); }
+
+        --active;
+        idle.cancel();
+      },
+      detached);
+  }
+
+  // the handlers refer to what's on our frame so they have to be done before
+  // it goes away
+  //
+  auto wait_ec = error_code();
+  while (active > 0) {
+    co_await idle.async_wait(redirect_error(token, wait_ec));
+  }
+
+  auto const is_closed =
+    ec == asio::error::eof ||
+    ec == asio::error::operation_aborted ||
+    ec == http::error::end_of_stream;
+
+  if (is_closed) { ec = {}; }
+}
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_SERVE_H2_HPP_
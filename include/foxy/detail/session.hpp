@@ -8,11 +8,16 @@
 #include <boost/beast/http/read.hpp>
 #include <boost/beast/http/write.hpp>
 
+#include <chrono>
 #include <memory>
 
 namespace foxy {
 namespace detail {
 
+// every operation can be cancelled on its own by binding its completion token
+// to a `foxy::cancellation_signal`; cancelling one closes the connection and
+// has the operation complete with `operation_aborted`
+//
 struct session {
 protected:
   std::shared_ptr<session_state> s_;
@@ -45,6 +50,45 @@ public:
   explicit
   session(boost::asio::io_context& io, boost::asio::ssl::context& ctx);
 
+  // `set_socket_options` replaces the options the session's socket is tuned
+  // with, applying them straight away if the socket is already open
+  //
+  // client sessions apply them again on every `async_connect`
+  // options which fail to apply are skipped
+  //
+  auto set_socket_options(socket_options const& opts) -> void;
+
+  // `set_timeout` limits how long any one read or write may take, zero, the
+  // default, meaning there's no limit
+  //
+  // an operation which runs out of time fails with `timed_out` and leaves the
+  // connection shut down; the deadline is re-armed by every operation at next
+  // to no cost, so it's as cheap to set on every session as it is on one
+  //
+  auto set_timeout(std::chrono::steady_clock::duration const timeout) -> void;
+
+  // `queue_write` serializes `message` into the session's output queue
+  // without writing anything, so that several responses can go out in a
+  // single write; the body is read synchronously
+  //
+  // every write the session makes sends what's queued first, or the queue can
+  // be sent on its own with `async_flush`
+  // like all other operations, this must not run concurrently with one
+  //
+  template <
+    typename Message,
+    std::enable_if_t<foxy::is_message_v<Message>, int> = 0
+  >
+  auto
+  queue_write(Message& message, boost::system::error_code& ec) & -> void;
+
+  template <typename FlushHandler>
+  auto
+  async_flush(
+    FlushHandler&& flush_handler
+  ) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    FlushHandler, void(boost::system::error_code));
+
   template <
     typename Serializer,
     typename WriteHeaderHandler
@@ -68,6 +112,11 @@ public:
   ) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
       WriteHandler, void(boost::system::error_code));
 
+  // messages with a known body size of at most
+  // `session_state::max_coalesced_bytes` are written with a single syscall
+  // together with anything queued; larger messages have the queue sent ahead
+  // of them
+  //
   template <
     typename Message,
     typename WriteHandler,
@@ -102,6 +151,22 @@ public:
     ReadHandler&& read_handler
   ) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
     ReadHandler, void(boost::system::error_code));
+
+  // `async_relay` stops treating this session and `other` as HTTP and copies
+  // raw bytes between them in both directions, as is needed once a protocol
+  // upgrade has been agreed to
+  //
+  // one side closing is passed on to the other and the relay completes once
+  // both have closed; neither session should be used for anything else until
+  // then
+  //
+  template <typename RelayHandler>
+  auto
+  async_relay(
+    session&       other,
+    RelayHandler&& relay_handler
+  ) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    RelayHandler, void(boost::system::error_code));
 };
 
 } // detail
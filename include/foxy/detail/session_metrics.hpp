@@ -0,0 +1,60 @@
+#ifndef FOXY_DETAIL_SESSION_METRICS_HPP_
+#define FOXY_DETAIL_SESSION_METRICS_HPP_
+
+#include "foxy/metrics.hpp"
+
+namespace foxy {
+namespace detail {
+
+// session_metrics are the metrics foxy itself records into
+// `metrics_registry::global()`, looked up once so that the hot path only ever
+// touches the metrics themselves
+//
+struct session_metrics {
+  histogram& read_header_time;
+  histogram& read_time;
+  histogram& write_header_time;
+  histogram& write_time;
+
+  counter& bytes_read;
+  counter& bytes_written;
+  counter& errors;
+  counter& timeouts;
+
+  histogram& resolve_time;
+  histogram& tcp_connect_time;
+  histogram& tls_handshake_time;
+  counter&   connect_errors;
+
+  // HTTP/2 hands a response over whole, so it only ever shows up in
+  // `response_time`
+  //
+  histogram& request_write_time;
+  histogram& time_to_first_byte;
+  histogram& response_body_time;
+  histogram& response_time;
+
+  gauge&     proxy_sessions;
+  histogram& proxy_session_time;
+  counter&   proxy_tunnel_bytes;
+  counter&   proxy_upgrades;
+  counter&   proxy_collapsed_requests;
+
+  counter& cache_hits;
+  counter& cache_misses;
+  gauge&   cache_memory_bytes;
+  gauge&   cache_slab_bytes;
+
+  counter& zerocopy_bytes;
+  counter& zerocopy_copied;
+
+  counter& pipelined_requests;
+  counter& h2_streams;
+
+  static auto get() -> session_metrics&;
+};
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_SESSION_METRICS_HPP_
@@ -1,32 +1,100 @@
 #ifndef FOXY_DETAIL_SESSION_STATE_HPP_
 #define FOXY_DETAIL_SESSION_STATE_HPP_
 
+#include "foxy/coroutine.hpp"
+#include "foxy/cancellation.hpp"
 #include "foxy/multi_stream.hpp"
+#include "foxy/socket_options.hpp"
+#include "foxy/detail/uring.hpp"
+#include "foxy/detail/timer_wheel.hpp"
 
 #include <boost/asio/strand.hpp>
 #include <boost/asio/executor.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
 
 #include <boost/asio/ssl/context.hpp>
 
 #include <boost/beast/core/flat_buffer.hpp>
 
+#include <boost/system/error_code.hpp>
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstddef>
+
 namespace foxy {
 namespace detail {
 
+struct h2_connection;
+
 struct session_state {
   using timer_type  = boost::asio::steady_timer;
-  using buffer_type = boost::beast::flat_buffer;
+
+  // read buffers come out of the region registered with io_uring, when it's
+  // in use, so that reads into them can skip pinning pages
+  //
+  using buffer_type =
+    boost::beast::basic_flat_buffer<uring_allocator<char>>;
+
   using stream_type = multi_stream;
   using strand_type = boost::asio::strand<boost::asio::executor>;
 
-  timer_type  timer;
-  buffer_type buffer;
-  stream_type stream;
+  // messages whose body is no larger than this are serialized into `output`
+  // and sent in one write along with anything queued before them
+  // it's also as much as fits in one TLS record
+  //
+  static constexpr std::size_t max_coalesced_bytes = 16 * 1024;
+
+  // once this much is queued, it's written out even if more could follow
+  //
+  static constexpr std::size_t max_queued_bytes = 64 * 1024;
+
+  buffer_type    buffer;
+  stream_type    stream;
+  socket_options options;
+
+  // how long any one read or write may take, zero meaning there's no limit,
+  // see `session::set_timeout`
+  //
+  // every operation re-arms `deadline`, which is kept by the timer wheel of
+  // the session's `io_context` rather than being a timer of its own
+  // once it passes the connection is shut down, which is what aborts the
+  // operation, and `timed_out` is set so the operation can say why
+  //
+  std::chrono::steady_clock::duration timeout;
+  timer_wheel::timer                  deadline;
+  std::atomic<bool>                   timed_out;
+
+  // the deadline fires on whichever thread ticks the wheel rather than on the
+  // operation's strand, so it only touches the socket with `socket_mtx` held,
+  // as does `cancel` when it closes the socket out from under it
+  //
+  std::mutex socket_mtx;
+
+  // serialized messages which have been queued but not yet written
+  //
+  boost::beast::flat_buffer output;
+
+  // set when the session speaks HTTP/2 instead, which then owns all reads
+  // and writes; `offer_http2` has clients ask for it when they connect and
+  // `host` is what they connected to
+  //
+  std::shared_ptr<h2_connection> h2;
+  bool                           offer_http2 = false;
+  std::string                    host;
+
+  // the lookup `async_connect` is waiting on, if it is, so that cancelling the
+  // connect cancels the lookup as well
+  //
+  boost::asio::ip::tcp::resolver* resolver = nullptr;
 
   session_state()                     = delete;
-  session_state(session_state const&) = default;
-  session_state(session_state&&)      = default;
+  session_state(session_state const&) = delete;
+  session_state(session_state&&)      = delete;
 
   explicit
   session_state(boost::asio::io_context& io);
@@ -35,8 +103,75 @@ struct session_state {
   session_state(stream_type stream_);
 
   session_state(boost::asio::io_context& io, boost::asio::ssl::context& ctx);
+
+  // `arm_deadline` starts the clock on an operation, if there's a timeout, and
+  // `disarm_deadline` stops it, replacing `ec` with `timed_out` if the
+  // deadline passed first
+  //
+  auto arm_deadline() -> void;
+  auto disarm_deadline(boost::system::error_code& ec) -> void;
+
+  // `cancel` aborts whatever the session is doing by closing its connection,
+  // and cancelling the lookup under way if there is one
+  //
+  // it must be called from the strand of the operation it's aborting
+  //
+  auto cancel() -> void;
+
+private:
+  auto on_deadline() -> void;
+};
+
+// operation_cancellation hooks one of a session's operations up to the
+// cancellation slot its handler was bound to, if it was, from when it's
+// initiated until `finish` is called
+//
+// emitting the signal has the session cancelled from `strand`, the one the
+// operation runs on, in between its steps, unless it's finished by then; an
+// operation cancelled before it's had a chance to start finds its connection
+// already closed
+//
+struct operation_cancellation {
+
+private:
+  struct state {
+    bool finished  = false;
+    bool cancelled = false;
+  };
+
+  cancellation_slot      slot_;
+  std::shared_ptr<state> state_;
+
+public:
+  operation_cancellation()                              = delete;
+  operation_cancellation(operation_cancellation const&) = delete;
+  operation_cancellation(operation_cancellation&&)      = default;
+
+  operation_cancellation(
+    std::shared_ptr<session_state> const& s,
+    session_state::strand_type const&     strand,
+    cancellation_slot const               slot);
+
+  ~operation_cancellation();
+
+  auto cancelled() const noexcept -> bool;
+
+  // `finish` unhooks the operation, replacing `ec` with `operation_aborted` if
+  // it was cancelled; it has to come before the operation's handler is posted,
+  // which is free to start another operation on the same signal
+  //
+  auto finish(boost::system::error_code& ec) -> void;
 };
 
+// `async_flush_output` writes everything queued in `s.output` in one go and
+// empties it
+//
+auto async_flush_output(
+  session_state&             s,
+  std::size_t&               bytes_transferred,
+  boost::system::error_code& ec
+) -> foxy::awaitable<void, session_state::strand_type>;
+
 } // detail
 } // foxy
 
@@ -0,0 +1,106 @@
+#ifndef FOXY_DETAIL_SPSC_RING_HPP_
+#define FOXY_DETAIL_SPSC_RING_HPP_
+
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace foxy {
+namespace detail {
+
+// spsc_ring is a bounded, lock-free, single-producer/single-consumer ring
+//
+// the producer fills a slot in place through `try_push` so that large records
+// never have to be constructed twice
+// the consumer hands each readable slot to a visitor through `consume_all`
+//
+// `capacity` is rounded up to the next power of two
+//
+template <typename T>
+struct spsc_ring {
+
+  static_assert(
+    std::is_trivially_copyable<T>::value,
+    "spsc_ring slots are reused without being destroyed");
+
+private:
+  static constexpr std::size_t cache_line = 64;
+
+  std::size_t          mask_;
+  std::unique_ptr<T[]> slots_;
+
+  alignas(cache_line) std::atomic<std::size_t> head_;
+  alignas(cache_line) std::atomic<std::size_t> tail_;
+
+  static auto round_up(std::size_t n) -> std::size_t {
+    auto p = std::size_t{2};
+    while (p < n) { p <<= 1; }
+    return p;
+  }
+
+public:
+  spsc_ring()                 = delete;
+  spsc_ring(spsc_ring const&) = delete;
+  spsc_ring(spsc_ring&&)      = delete;
+
+  explicit
+  spsc_ring(std::size_t const capacity)
+  : mask_(round_up(capacity) - 1)
+  , slots_(new T[mask_ + 1])
+  , head_(0)
+  , tail_(0)
+  {
+  }
+
+  auto capacity() const noexcept -> std::size_t {
+    return mask_ + 1;
+  }
+
+  // `try_push` invokes `fill` with a reference to the next free slot and
+  // publishes it
+  // it returns false without invoking `fill` if the ring is full
+  //
+  // must only be called from the producer thread
+  //
+  template <typename Fill>
+  auto try_push(Fill&& fill) -> bool {
+    auto const tail = tail_.load(std::memory_order_relaxed);
+    auto const head = head_.load(std::memory_order_acquire);
+
+    if (tail - head > mask_) { return false; }
+
+    fill(slots_[tail & mask_]);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // `consume_all` invokes `visit` with every slot published so far and returns
+  // how many there were
+  //
+  // must only be called from the consumer thread
+  //
+  template <typename Visit>
+  auto consume_all(Visit&& visit) -> std::size_t {
+    auto const head = head_.load(std::memory_order_relaxed);
+    auto const tail = tail_.load(std::memory_order_acquire);
+
+    for (auto pos = head; pos != tail; ++pos) {
+      visit(static_cast<T const&>(slots_[pos & mask_]));
+    }
+
+    head_.store(tail, std::memory_order_release);
+    return tail - head;
+  }
+
+  auto empty() const noexcept -> bool {
+    return
+      head_.load(std::memory_order_acquire) ==
+      tail_.load(std::memory_order_acquire);
+  }
+};
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_SPSC_RING_HPP_
@@ -0,0 +1,133 @@
+#ifndef FOXY_DETAIL_TIMER_WHEEL_HPP_
+#define FOXY_DETAIL_TIMER_WHEEL_HPP_
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace foxy {
+namespace detail {
+
+// timer_wheel keeps the deadlines of an `io_context`, those of its sessions
+// chiefly, in a hierarchical timing wheel so that arming, re-arming and
+// cancelling one is O(1) however many there are, where a `steady_timer` apiece
+// costs a heap insert and removal every time
+//
+// time is counted in ticks of `resolution` and the clock is read once per tick
+// instead of on every arm, so deadlines fire up to a couple of ticks late, or,
+// when the event loop is running behind, early by as much as it's behind
+// a deadline is only ever moved within the wheel when it's brought forward;
+// pushing one back, or cancelling it, just records the new deadline, which is
+// caught up with once its old slot comes round
+//
+// the wheel only ticks while it has deadlines armed
+//
+struct timer_wheel : public boost::asio::execution_context::service {
+
+public:
+  using clock_type = std::chrono::steady_clock;
+  using duration   = clock_type::duration;
+  using time_point = clock_type::time_point;
+
+  static constexpr auto resolution = std::chrono::milliseconds(10);
+
+  static boost::asio::execution_context::id id;
+
+  // timer is one deadline kept by the wheel of the `io_context` it's created
+  // with, calling `on_expiry` whenever it passes without being cancelled
+  //
+  // `on_expiry` runs on a thread running the context with the wheel locked so
+  // it mustn't touch any timer itself; it's meant to do no more than abort
+  // whatever the deadline was set on
+  //
+  struct timer {
+  private:
+    friend timer_wheel;
+
+    timer_wheel&          wheel_;
+    std::function<void()> on_expiry_;
+
+    // the slot a timer is filed in is gone through at the tick `filed_`,
+    // which is no later than the tick `due_` it's due at
+    //
+    timer**       slot_;
+    timer*        prev_;
+    timer*        next_;
+    std::uint64_t due_;
+    std::uint64_t filed_;
+
+  public:
+    timer()             = delete;
+    timer(timer const&) = delete;
+    timer(timer&&)      = delete;
+
+    timer(boost::asio::io_context& io, std::function<void()> on_expiry);
+
+    ~timer();
+
+    auto expires_after(duration const d) -> void;
+    auto cancel() -> void;
+  };
+
+private:
+  static constexpr std::size_t   slot_bits  = 6;
+  static constexpr std::size_t   num_slots  = std::size_t{1} << slot_bits;
+  static constexpr std::size_t   num_levels = 4;
+  static constexpr std::uint64_t never      = static_cast<std::uint64_t>(-1);
+
+  // deadlines further out than this are filed as far out as the wheel goes
+  // and filed again from there
+  //
+  static constexpr std::uint64_t span =
+    std::uint64_t{1} << (slot_bits * num_levels);
+
+  using level_type = std::array<timer*, num_slots>;
+
+  std::mutex                         mtx_;
+  boost::asio::steady_timer          ticker_;
+  std::array<level_type, num_levels> levels_;
+  time_point const                   epoch_;
+  std::uint64_t                      now_;
+  std::size_t                        armed_;
+  bool                               ticking_;
+
+  auto shutdown() -> void override;
+
+  // everything below must be called with `mtx_` held
+  //
+  auto tick_of(time_point const t) const -> std::uint64_t;
+  auto file(timer& t, std::uint64_t const earliest) -> void;
+  auto unfile(timer& t) -> void;
+  auto cascade(std::size_t const level) -> void;
+  auto advance(std::uint64_t const target) -> void;
+  auto schedule() -> void;
+  auto clear() -> void;
+
+  auto on_tick(boost::system::error_code const ec) -> void;
+
+public:
+  explicit
+  timer_wheel(boost::asio::io_context& io);
+
+  timer_wheel(timer_wheel const&) = delete;
+  timer_wheel(timer_wheel&&)      = delete;
+
+  ~timer_wheel() override;
+
+  // `armed` is the number of deadlines which are set and haven't passed
+  //
+  auto armed() -> std::size_t;
+};
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_TIMER_WHEEL_HPP_
@@ -0,0 +1,416 @@
+#ifndef FOXY_DETAIL_URING_HPP_
+#define FOXY_DETAIL_URING_HPP_
+
+#include "foxy/io_uring.hpp"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <new>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+#if defined(__linux__) && defined(BOOST_ASIO_HAS_POSIX_STREAM_DESCRIPTOR)
+#if __has_include(<linux/io_uring.h>)
+#define FOXY_HAS_IO_URING
+#include <sys/uio.h>
+#include <sys/socket.h>
+#endif
+#endif
+
+namespace foxy {
+namespace detail {
+
+// uring_arena is a single region of memory, carved up into power-of-two
+// blocks, which is registered with every io_uring instance so that reads into
+// it can use the kernel's pre-pinned fixed buffers
+//
+// the region is only mapped by the first call to `init`, which happens once
+// `use_io_uring` succeeds; until then, and whenever the region runs out,
+// allocations are left to the global heap
+// blocks are never handed back to the operating system
+//
+struct uring_arena {
+
+public:
+  static constexpr std::size_t min_block_size   = 4 * 1024;
+  static constexpr std::size_t max_block_size   = 256 * 1024;
+  static constexpr std::size_t num_size_classes = 7;
+
+private:
+  std::atomic<char*> base_;
+  std::size_t        size_;
+
+  std::mutex                                       mtx_;
+  std::size_t                                      used_;
+  std::array<std::vector<char*>, num_size_classes> free_;
+
+public:
+  uring_arena();
+  uring_arena(uring_arena const&) = delete;
+  uring_arena(uring_arena&&)      = delete;
+
+  // `init` maps a region of `size` bytes, returning false if one can't be
+  // mapped
+  // later calls do nothing and report whether the region exists
+  //
+  auto init(std::size_t const size) -> bool;
+
+  // `allocate` returns nullptr when the request is to be served from the heap
+  //
+  auto allocate(std::size_t const size) -> void*;
+
+  // `deallocate` returns false if `p` wasn't allocated from the arena
+  //
+  auto deallocate(void* const p, std::size_t const size) -> bool;
+
+  auto contains(void const* const p, std::size_t const size) const noexcept
+  -> bool {
+    auto const* base = base_.load(std::memory_order_acquire);
+    auto const* ptr  = static_cast<char const*>(p);
+    return base && ptr >= base && ptr + size <= base + size_;
+  }
+
+  auto data() const noexcept -> char*;
+  auto size() const noexcept -> std::size_t;
+
+  static auto global() -> uring_arena&;
+};
+
+// uring_allocator draws from the global `uring_arena` and is what session
+// read buffers are allocated with
+//
+template <typename T>
+struct uring_allocator {
+  using value_type = T;
+
+  uring_allocator() = default;
+
+  template <typename U>
+  uring_allocator(uring_allocator<U> const&) noexcept
+  {
+  }
+
+  auto allocate(std::size_t const n) -> T* {
+    auto const size = n * sizeof(T);
+    if (auto* p = uring_arena::global().allocate(size)) {
+      return static_cast<T*>(p);
+    }
+    return static_cast<T*>(::operator new(size));
+  }
+
+  auto deallocate(T* const p, std::size_t const n) noexcept -> void {
+    if (!uring_arena::global().deallocate(p, n * sizeof(T))) {
+      ::operator delete(p);
+    }
+  }
+
+  template <typename U>
+  friend
+  auto operator==(uring_allocator const&, uring_allocator<U> const&) noexcept
+  -> bool {
+    return true;
+  }
+
+  template <typename U>
+  friend
+  auto operator!=(uring_allocator const&, uring_allocator<U> const&) noexcept
+  -> bool {
+    return false;
+  }
+};
+
+#ifdef FOXY_HAS_IO_URING
+
+// uring_op is the part of an in-flight operation the service deals with
+//
+// the message header and buffers live alongside the operation because the
+// kernel may read them at any point before the operation completes
+//
+struct uring_op {
+  static constexpr std::size_t max_iovs = 16;
+
+  // `complete` destroys the operation and, if `invoke` is set, hands `result`
+  // to its handler
+  //
+  using complete_fn = void (*)(uring_op* op, int result, bool invoke);
+
+  complete_fn complete;
+  uring_op*   prev;
+  uring_op*   next;
+  bool        is_read;
+  std::size_t num_iovs;
+  std::size_t total;
+
+  ::msghdr                      msg;
+  std::array<::iovec, max_iovs> iovs;
+
+  explicit
+  uring_op(complete_fn const complete_)
+  : complete(complete_)
+  , prev(nullptr)
+  , next(nullptr)
+  , is_read(false)
+  , num_iovs(0)
+  , total(0)
+  , msg()
+  , iovs()
+  {
+  }
+};
+
+template <typename Handler>
+struct uring_handler_op : public uring_op {
+
+public:
+  using executor_type = boost::asio::associated_executor_t<
+    Handler, boost::asio::io_context::executor_type>;
+
+  using allocator_type = typename std::allocator_traits<
+    boost::asio::associated_allocator_t<Handler>
+  >::template rebind_alloc<uring_handler_op>;
+
+private:
+  Handler                                         handler_;
+  boost::asio::executor_work_guard<executor_type> work_;
+
+public:
+  uring_handler_op(Handler&& handler, boost::asio::io_context& io)
+  : uring_op(&uring_handler_op::do_complete)
+  , handler_(std::move(handler))
+  , work_(boost::asio::get_associated_executor(handler_, io.get_executor()))
+  {
+  }
+
+  static auto create(Handler&& handler, boost::asio::io_context& io)
+  -> uring_handler_op* {
+    auto alloc = allocator_type(boost::asio::get_associated_allocator(handler));
+    auto* p    = std::allocator_traits<allocator_type>::allocate(alloc, 1);
+
+    try {
+      return ::new (static_cast<void*>(p))
+        uring_handler_op(std::move(handler), io);
+    } catch (...) {
+      std::allocator_traits<allocator_type>::deallocate(alloc, p, 1);
+      throw;
+    }
+  }
+
+  static auto do_complete(uring_op* base, int const result, bool const invoke)
+  -> void {
+    auto* self = static_cast<uring_handler_op*>(base);
+
+    auto alloc   =
+      allocator_type(boost::asio::get_associated_allocator(self->handler_));
+    auto handler = std::move(self->handler_);
+    auto work    = std::move(self->work_);
+
+    auto const is_read = self->is_read;
+    auto const total   = self->total;
+
+    self->~uring_handler_op();
+    std::allocator_traits<allocator_type>::deallocate(alloc, self, 1);
+
+    if (!invoke) { return; }
+
+    auto ec = boost::system::error_code();
+    auto n  = std::size_t{0};
+
+    if (result >= 0) {
+      n = static_cast<std::size_t>(result);
+      if (is_read && n == 0 && total > 0) {
+        ec = boost::asio::error::eof;
+      }
+    } else if (result == -ECANCELED) {
+      ec = boost::asio::error::operation_aborted;
+    } else {
+      ec.assign(-result, boost::asio::error::get_system_category());
+    }
+
+    auto executor = work.get_executor();
+    boost::asio::dispatch(
+      executor,
+      boost::beast::bind_handler(std::move(handler), ec, n));
+  }
+};
+
+// uring_service owns the io_uring instance used by an `io_context`
+//
+// submissions are queued up under a lock and the queue is handed to the
+// kernel by a single handler posted to the `io_context`, so everything started
+// during one turn of the event loop shares one `io_uring_enter`
+// completions are signalled through an eventfd which is watched by the
+// reactor for as long as any operation is in flight
+//
+struct uring_service : public boost::asio::execution_context::service {
+
+public:
+  static boost::asio::execution_context::id id;
+
+private:
+  struct ring;
+
+  struct completion {
+    uring_op* op;
+    int       result;
+  };
+
+  boost::asio::io_context&              io_;
+  std::unique_ptr<ring>                 ring_;
+  boost::asio::posix::stream_descriptor notify_;
+
+  std::mutex  mtx_;
+  uring_op*   ops_;
+  std::size_t in_flight_;
+  std::size_t unsubmitted_;
+  bool        flush_posted_;
+  bool        armed_;
+  bool        fixed_buffers_;
+
+  std::atomic<bool> enabled_;
+
+  std::atomic<std::uint64_t> enters_;
+  std::atomic<std::uint64_t> submitted_;
+  std::atomic<std::uint64_t> completed_;
+  std::atomic<std::uint64_t> fixed_reads_;
+
+  auto shutdown() -> void override;
+
+  auto submit(uring_op* const op, int const fd) -> void;
+  auto enter() -> void;
+  auto flush() -> void;
+  auto arm() -> void;
+  auto reap(std::vector<completion>& done) -> void;
+  auto on_notify(boost::system::error_code const ec) -> void;
+
+  template <typename ConstBufferSequence, typename Handler>
+  auto async_io(
+    bool const                 is_read,
+    int const                  fd,
+    ConstBufferSequence const& buffers,
+    Handler&&                  handler
+  ) -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    Handler, void(boost::system::error_code, std::size_t)) {
+
+    boost::asio::async_completion<
+      Handler, void(boost::system::error_code, std::size_t)
+    >
+    init(handler);
+
+    using handler_type = typename decltype(init)::completion_handler_type;
+
+    auto iovs     = std::array<::iovec, uring_op::max_iovs>();
+    auto num_iovs = std::size_t{0};
+    auto total    = std::size_t{0};
+
+    auto const end = boost::asio::buffer_sequence_end(buffers);
+    for (auto it = boost::asio::buffer_sequence_begin(buffers);
+         it != end && num_iovs < iovs.size();
+         ++it) {
+
+      auto const b = boost::asio::const_buffer(*it);
+      if (b.size() == 0) { continue; }
+
+      iovs[num_iovs].iov_base = const_cast<void*>(b.data());
+      iovs[num_iovs].iov_len  = b.size();
+
+      total += b.size();
+      ++num_iovs;
+    }
+
+    // like the reactor, empty buffers complete right away, even for reads
+    //
+    if (total == 0) {
+      auto executor = boost::asio::get_associated_executor(
+        init.completion_handler, io_.get_executor());
+
+      boost::asio::post(
+        executor,
+        boost::beast::bind_handler(
+          std::move(init.completion_handler),
+          boost::system::error_code(), std::size_t{0}));
+
+      return init.result.get();
+    }
+
+    auto* op = uring_handler_op<handler_type>::create(
+      std::move(init.completion_handler), io_);
+
+    op->is_read  = is_read;
+    op->num_iovs = num_iovs;
+    op->total    = total;
+    op->iovs     = iovs;
+
+    submit(op, fd);
+
+    return init.result.get();
+  }
+
+public:
+  explicit
+  uring_service(boost::asio::io_context& io);
+
+  uring_service(uring_service const&) = delete;
+  uring_service(uring_service&&)      = delete;
+
+  ~uring_service() override;
+
+  // `start` sets up the ring, returning whether it could be
+  //
+  auto start(io_uring_options const& opts) -> bool;
+
+  auto enabled() const noexcept -> bool;
+  auto stats() const -> io_uring_stats;
+
+  // `find` returns the service belonging to `io` if io_uring is in use for it
+  // and nullptr otherwise
+  //
+  static auto find(boost::asio::io_context& io) -> uring_service*;
+
+  template <typename MutableBufferSequence, typename ReadHandler>
+  auto async_read_some(
+    int const                    fd,
+    MutableBufferSequence const& buffers,
+    ReadHandler&&                handler
+  ) -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    ReadHandler, void(boost::system::error_code, std::size_t)) {
+    return async_io(true, fd, buffers, std::forward<ReadHandler>(handler));
+  }
+
+  template <typename ConstBufferSequence, typename WriteHandler>
+  auto async_write_some(
+    int const                  fd,
+    ConstBufferSequence const& buffers,
+    WriteHandler&&             handler
+  ) -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    WriteHandler, void(boost::system::error_code, std::size_t)) {
+    return async_io(false, fd, buffers, std::forward<WriteHandler>(handler));
+  }
+};
+
+#endif // FOXY_HAS_IO_URING
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_URING_HPP_
@@ -0,0 +1,318 @@
+#ifndef FOXY_DETAIL_ZEROCOPY_HPP_
+#define FOXY_DETAIL_ZEROCOPY_HPP_
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/beast/core/buffers_suffix.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#if defined(__linux__) && __has_include(<linux/errqueue.h>)
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define FOXY_HAS_ZEROCOPY
+#endif
+#endif
+
+namespace foxy {
+namespace detail {
+
+// below this many bytes, pinning pages and fielding a completion costs more
+// than the copy it saves
+//
+constexpr std::size_t default_zerocopy_threshold = 32 * 1024;
+
+#ifdef FOXY_HAS_ZEROCOPY
+
+// zerocopy_state tracks the zero-copy sends made on one socket
+//
+// the kernel numbers each `sendmsg` made with `MSG_ZEROCOPY` and reports back,
+// through the socket's error queue, the ranges of those numbers whose pages it
+// no longer needs; `completed` is the first send not yet reported
+//
+struct zerocopy_state {
+  std::size_t   threshold = default_zerocopy_threshold;
+  std::uint32_t next      = 0;
+  std::uint32_t completed = 0;
+
+  // ranges reported ahead of `completed`, which TCP never does in practice
+  //
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> early;
+
+  // `drain` reads every notification queued on `fd`, advancing `completed`
+  //
+  auto drain(int const fd, boost::system::error_code& ec) -> void;
+
+  // `done` returns whether every send before `seq` has completed
+  //
+  auto done(std::uint32_t const seq) const noexcept -> bool {
+    return static_cast<std::int32_t>(seq - completed) <= 0;
+  }
+};
+
+// `zerocopy_send` makes one non-blocking `sendmsg` of `iovs`, with
+// `MSG_ZEROCOPY` if `zerocopy` is set, returning the bytes sent or -1 with
+// `errno` set
+//
+auto zerocopy_send(
+  int const         fd,
+  ::iovec const*    iovs,
+  std::size_t const num_iovs,
+  bool const        zerocopy) -> long;
+
+// zerocopy_write_op sends the whole buffer sequence with `MSG_ZEROCOPY` and
+// then holds on to the handler until the kernel reports that it's done with
+// every page, so that the caller can't reuse its buffers too early
+//
+// for TCP, the kernel is done once the peer has acknowledged the data, which
+// is why sending carries on across `EAGAIN` instead of returning early; that
+// way only the tail end of a large write waits on acknowledgements
+//
+// the socket becoming readable on its error queue is what normally wakes us
+// but the reactor only reports that edge to a wait which is already queued,
+// so a timer re-checks the queue in case the notification raced the wait
+//
+// the wait is made on a duplicate of the socket's descriptor, which sees the
+// same error queue, so that it can be cancelled along with the timer once the
+// operation finishes without cancelling anything else on the socket
+// both complete after the operation does, which is why it's shared and never
+// allocated with the handler's allocator
+//
+template <typename ConstBufferSequence, typename Handler>
+struct zerocopy_write_op
+: public std::enable_shared_from_this<
+    zerocopy_write_op<ConstBufferSequence, Handler>> {
+
+public:
+  using executor_type = boost::asio::associated_executor_t<
+    Handler, boost::asio::ip::tcp::socket::executor_type>;
+
+  static constexpr std::size_t max_iovs = 64;
+
+  static constexpr auto recheck_interval = std::chrono::milliseconds(5);
+
+private:
+  boost::asio::ip::tcp::socket&   socket_;
+  std::shared_ptr<zerocopy_state> state_;
+
+  boost::beast::buffers_suffix<ConstBufferSequence> buffers_;
+
+  Handler                                         handler_;
+  boost::asio::executor_work_guard<executor_type> work_;
+  boost::asio::steady_timer                       timer_;
+  boost::asio::posix::stream_descriptor           errors_;
+
+  std::size_t               sent_;
+  std::uint32_t             last_;
+  bool                      use_zerocopy_;
+  bool                      waiting_on_error_;
+  bool                      finished_;
+  boost::system::error_code ec_;
+
+  auto executor() -> executor_type { return work_.get_executor(); }
+
+  template <typename F>
+  auto wrap(F&& f) {
+    return boost::asio::bind_executor(executor(), std::forward<F>(f));
+  }
+
+  auto finish(boost::system::error_code const ec) -> void {
+    finished_ = true;
+
+    boost::system::error_code ignored;
+    timer_.cancel(ignored);
+    errors_.close(ignored);
+
+    auto executor = work_.get_executor();
+    work_.reset();
+
+    boost::asio::post(
+      executor,
+      boost::beast::bind_handler(std::move(handler_), ec, sent_));
+  }
+
+  auto send() -> void {
+    auto iovs = std::array<::iovec, max_iovs>();
+
+    while (boost::asio::buffer_size(buffers_) > 0) {
+      auto num_iovs = std::size_t{0};
+      for (auto const b : buffers_) {
+        if (num_iovs == iovs.size()) { break; }
+        if (b.size() == 0) { continue; }
+
+        iovs[num_iovs].iov_base = const_cast<void*>(b.data());
+        iovs[num_iovs].iov_len  = b.size();
+        ++num_iovs;
+      }
+
+      auto const n = zerocopy_send(
+        socket_.native_handle(), iovs.data(), num_iovs, use_zerocopy_);
+
+      if (n > 0) {
+        if (use_zerocopy_) { last_ = ++state_->next; }
+
+        sent_ += static_cast<std::size_t>(n);
+        buffers_.consume(static_cast<std::size_t>(n));
+        continue;
+      }
+
+      if (n == 0) { break; }
+
+      if (errno == EINTR) { continue; }
+
+      // the kernel has run out of room to track pending notifications, in
+      // which case the rest of this write is copied as usual
+      //
+      if (errno == ENOBUFS && use_zerocopy_) {
+        use_zerocopy_ = false;
+        continue;
+      }
+
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        socket_.async_wait(
+          boost::asio::ip::tcp::socket::wait_write,
+          wrap(
+            [self = this->shared_from_this()]
+            (boost::system::error_code const ec) {
+              if (ec) {
+                self->ec_ = ec;
+                return self->await_completion();
+              }
+              self->send();
+            }));
+        return;
+      }
+
+      ec_.assign(errno, boost::asio::error::get_system_category());
+      break;
+    }
+
+    await_completion();
+  }
+
+  auto await_completion() -> void {
+    if (finished_) { return; }
+
+    auto ec = boost::system::error_code();
+    state_->drain(socket_.native_handle(), ec);
+
+    if (ec || state_->done(last_)) {
+      return finish(ec_ ? ec_ : ec);
+    }
+
+    if (!errors_.is_open()) {
+      // if the socket can't be duplicated, the timer alone has to do
+      //
+      auto const fd = ::dup(socket_.native_handle());
+      if (fd >= 0) {
+        errors_.assign(fd, ec);
+        if (ec) { ::close(fd); }
+      }
+    }
+
+    if (errors_.is_open() && !waiting_on_error_) {
+      waiting_on_error_ = true;
+      errors_.async_wait(
+        boost::asio::posix::stream_descriptor::wait_error,
+        wrap(
+          [self = this->shared_from_this()]
+          (boost::system::error_code const ec) {
+            self->waiting_on_error_ = false;
+            if (self->finished_) { return; }
+
+            if (ec) { return self->finish(ec); }
+            self->await_completion();
+          }));
+    }
+
+    timer_.expires_after(recheck_interval);
+    timer_.async_wait(
+      wrap(
+        [self = this->shared_from_this()]
+        (boost::system::error_code const ec) {
+          if (ec || self->finished_) { return; }
+          self->await_completion();
+        }));
+  }
+
+public:
+  zerocopy_write_op(
+    boost::asio::ip::tcp::socket&   socket,
+    std::shared_ptr<zerocopy_state> state,
+    ConstBufferSequence const&      buffers,
+    Handler&&                       handler)
+  : socket_(socket)
+  , state_(std::move(state))
+  , buffers_(buffers)
+  , handler_(std::move(handler))
+  , work_(boost::asio::get_associated_executor(
+      handler_, socket.get_executor()))
+  , timer_(socket.get_executor().context())
+  , errors_(socket.get_executor().context())
+  , sent_(0)
+  , last_(state_->next)
+  , use_zerocopy_(true)
+  , waiting_on_error_(false)
+  , finished_(false)
+  , ec_()
+  {
+  }
+
+  auto start() -> void { send(); }
+};
+
+// `async_zerocopy_write_some` is `async_write_some` for a plaintext socket
+// with `SO_ZEROCOPY` set, except that all of `buffers` is written
+//
+template <typename ConstBufferSequence, typename WriteHandler>
+auto async_zerocopy_write_some(
+  boost::asio::ip::tcp::socket&   socket,
+  std::shared_ptr<zerocopy_state> state,
+  ConstBufferSequence const&      buffers,
+  WriteHandler&&                  handler
+) -> BOOST_ASIO_INITFN_RESULT_TYPE(
+  WriteHandler, void(boost::system::error_code, std::size_t)) {
+
+  boost::asio::async_completion<
+    WriteHandler, void(boost::system::error_code, std::size_t)
+  >
+  init(handler);
+
+  using handler_type = typename decltype(init)::completion_handler_type;
+  using op_type      = zerocopy_write_op<ConstBufferSequence, handler_type>;
+
+  std::make_shared<op_type>(
+    socket, std::move(state), buffers,
+    std::move(init.completion_handler))->start();
+
+  return init.result.get();
+}
+
+#endif // FOXY_HAS_ZEROCOPY
+
+} // detail
+} // foxy
+
+#endif // FOXY_DETAIL_ZEROCOPY_HPP_
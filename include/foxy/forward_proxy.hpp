@@ -2,37 +2,64 @@
 #define FOXY_FORWARD_PROXY_HPP_
 
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/async_result.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
 #include <memory>
+#include <string>
+#include <cstddef>
 
+#include "foxy/runtime.hpp"
 #include "foxy/multi_stream.hpp"
+#include "foxy/socket_options.hpp"
+#include "foxy/response_cache.hpp"
+#include "foxy/circuit_breaker.hpp"
+#include "foxy/admission_control.hpp"
+#include "foxy/detail/forward_proxy_state.hpp"
 
 namespace foxy {
 
 struct forward_proxy {
 
 public:
-  using acceptor_type = boost::asio::ip::tcp::acceptor;
-  using stream_type   = multi_stream;
-  using endpoint_type = boost::asio::ip::tcp::endpoint;
+  using acceptor_type = detail::forward_proxy_state::acceptor_type;
+  using stream_type   = detail::forward_proxy_state::stream_type;
+  using endpoint_type = detail::forward_proxy_state::endpoint_type;
+  using strand_type   = detail::forward_proxy_state::strand_type;
+  using clock_type    = std::chrono::steady_clock;
 
-private:
-  struct state {
-    acceptor_type acceptor;
-    stream_type   socket;
-
-    state()             = delete;
-    state(state const&) = delete;
-    state(state&&)      = default;
-
-    state(
-      boost::asio::io_context& io,
-      endpoint_type const&     local_endpoint,
-      bool const               reuse_addr);
+  using dispatch_policy = detail::forward_proxy_state::dispatch_policy;
+
+  // `admission` bounds the amount of work the proxy takes on as a whole while
+  // `upstream` guards against individual remote hosts which are slow or failing
+  //
+  // `sockets` tunes the listening socket, the client connections it accepts
+  // and the connections made to remote hosts alike
+  //
+  // `cache` has GET requests tunneled through the proxy answered from the
+  // responses it's seen before, which is off until it's given some memory
+  //
+  // `collapse_requests` has concurrent GET requests for the same resource sent
+  // upstream only once, everyone else being answered with the response to the
+  // first of them as it arrives, so long as it may be shared
+  //
+  // `dispatch` picks the thread to serve each connection on for a proxy that
+  // accepts on a thread of its own
+  //
+  struct options {
+    admission_control::options admission;
+    circuit_breaker::options   upstream;
+    socket_options             sockets;
+    response_cache::options    cache;
+    bool                       collapse_requests = true;
+    dispatch_policy            dispatch = dispatch_policy::least_sessions;
   };
 
-  std::shared_ptr<state> s_;
+private:
+  std::shared_ptr<detail::forward_proxy_state> s_;
 
 public:
   forward_proxy()                     = delete;
@@ -44,9 +71,92 @@ public:
     endpoint_type const&     local_endpoint,
     bool const               reuse_addr);
 
+  forward_proxy(
+    boost::asio::io_context& io,
+    endpoint_type const&     local_endpoint,
+    bool const               reuse_addr,
+    options const&           opts);
+
+  // construct a proxy which accepts on an already listening socket, typically
+  // one obtained through `foxy::receive_acceptor`
+  //
+  forward_proxy(
+    boost::asio::io_context& io,
+    acceptor_type            acceptor,
+    options const&           opts);
+
+  // construct a proxy which accepts on every thread of `rt`, each with a
+  // listener of its own bound to `local_endpoint` through SO_REUSEPORT, and
+  // which serves every connection on the thread that accepted it
+  //
+  // listeners ask for the connections received on their thread's CPU, see
+  // `foxy::set_incoming_cpu`
+  //
+  forward_proxy(
+    runtime&             rt,
+    endpoint_type const& local_endpoint,
+    bool const           reuse_addr);
+
+  forward_proxy(
+    runtime&             rt,
+    endpoint_type const& local_endpoint,
+    bool const           reuse_addr,
+    options const&       opts);
+
+  // construct a proxy which accepts on `io`, usually run by a thread of its
+  // own, and hands every connection over to one of the threads of `rt` to be
+  // served there, as picked by `opts.dispatch`
+  //
+  // unlike sharding the listener, this spreads connections evenly however
+  // unevenly the kernel would hash them over a SO_REUSEPORT group
+  //
+  forward_proxy(
+    boost::asio::io_context& io,
+    endpoint_type const&     local_endpoint,
+    bool const               reuse_addr,
+    runtime&                 rt,
+    options const&           opts);
+
   auto run() -> void;
+
+  // `async_drain` stops the proxy from accepting any more connections and
+  // waits for the ones it's currently handling to finish
+  //
+  // connections are closed as soon as the request/response exchange they are
+  // in the middle of is over, and those still queued for admission or waiting
+  // on their client for a request are closed straight away
+  //
+  // the handler is invoked with the number of sessions still active, which is
+  // non-zero only if `deadline` passed first, in which case the error is
+  // `boost::asio::error::timed_out` and those sessions have been cut off
+  //
+  template <typename DrainHandler>
+  auto async_drain(
+    clock_type::time_point const deadline,
+    DrainHandler&&               drain_handler
+  ) -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    DrainHandler, void(boost::system::error_code, std::size_t));
+
+  // `handoff` passes a duplicate of the proxy's listening socket to a
+  // replacement process waiting in `foxy::receive_acceptor` on `path`; a proxy
+  // on a runtime hands over its first listener, which shares its port with
+  // the rest
+  //
+  // the proxy keeps accepting until it's drained
+  //
+  auto handoff(std::string const& path, boost::system::error_code& ec) -> void;
+
+  auto active_sessions() const -> std::size_t;
+
+  auto local_endpoint() const -> endpoint_type;
+
+  auto admission_stats() const -> admission_control::stats_type;
+  auto upstream_stats() const  -> circuit_breaker::stats_type;
+  auto cache_stats() const     -> response_cache::stats_type;
 };
 
 } // foxy
 
-#endif // FOXY_FORWARD_PROXY_HPP_
\ No newline at end of file
+#include "foxy/impl/forward_proxy.impl.hpp"
+
+#endif // FOXY_FORWARD_PROXY_HPP_
@@ -0,0 +1,48 @@
+#ifndef FOXY_HANDOFF_HPP_
+#define FOXY_HANDOFF_HPP_
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <string>
+
+namespace foxy {
+
+// these functions allow a listening socket to be passed from one process to
+// another over a Unix domain socket using `SCM_RIGHTS`
+//
+// the typical hot restart looks like:
+// * the replacement process calls `receive_acceptor` which binds `path` and
+//   waits for the old process to connect
+// * the old process calls `forward_proxy::handoff` (or `send_acceptor`) with
+//   the same `path`, after which both processes are accepting connections off
+//   the same listen queue
+// * the old process calls `forward_proxy::async_drain` and exits once its
+//   in-flight sessions are done
+//
+// on platforms without Unix domain sockets both functions fail with
+// `boost::asio::error::operation_not_supported`
+//
+
+// `send_acceptor` connects to `path` and sends a duplicate of the listening
+// socket owned by `acceptor`
+// `acceptor` itself remains open and usable
+//
+auto send_acceptor(
+  boost::asio::ip::tcp::acceptor& acceptor,
+  std::string const&              path,
+  boost::system::error_code&      ec) -> void;
+
+// `receive_acceptor` blocks until a peer connects to `path` and hands over a
+// listening socket, which is then returned as an acceptor bound to `io`
+//
+auto receive_acceptor(
+  boost::asio::io_context&   io,
+  std::string const&         path,
+  boost::system::error_code& ec) -> boost::asio::ip::tcp::acceptor;
+
+} // foxy
+
+#endif // FOXY_HANDOFF_HPP_
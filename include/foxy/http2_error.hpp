@@ -0,0 +1,56 @@
+#ifndef FOXY_HTTP2_ERROR_HPP_
+#define FOXY_HTTP2_ERROR_HPP_
+
+#include <boost/system/error_code.hpp>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace foxy {
+namespace http2 {
+
+// error mirrors the error codes of RFC 7540 section 7, which are what HTTP/2
+// peers send each other in RST_STREAM and GOAWAY frames
+//
+// requests which fail because the peer reset their stream, or because the
+// connection went away underneath them, complete with one of these
+//
+enum class error : std::uint32_t {
+  no_error            = 0x0,
+  protocol_error      = 0x1,
+  internal_error      = 0x2,
+  flow_control_error  = 0x3,
+  settings_timeout    = 0x4,
+  stream_closed       = 0x5,
+  frame_size_error    = 0x6,
+  refused_stream      = 0x7,
+  cancel              = 0x8,
+  compression_error   = 0x9,
+  connect_error       = 0xa,
+  enhance_your_calm   = 0xb,
+  inadequate_security = 0xc,
+  http_1_1_required   = 0xd
+};
+
+auto error_category() -> boost::system::error_category const&;
+
+auto make_error_code(error const e) -> boost::system::error_code;
+
+// `to_wire` is the code to send a peer for `ec`, which is `internal_error`
+// for anything that didn't come from this category
+//
+auto to_wire(boost::system::error_code const& ec) -> std::uint32_t;
+
+} // http2
+} // foxy
+
+namespace boost {
+namespace system {
+
+template <>
+struct is_error_code_enum<foxy::http2::error> : std::true_type {};
+
+} // system
+} // boost
+
+#endif // FOXY_HTTP2_ERROR_HPP_
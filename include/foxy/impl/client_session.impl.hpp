@@ -1,8 +1,14 @@
 #include "foxy/client_session.hpp"
 #include "foxy/type_traits.hpp"
 #include "foxy/detail/get_strand.hpp"
+#include "foxy/detail/h2_message.hpp"
+#include "foxy/detail/queue_output.hpp"
+#include "foxy/detail/h2_connection.hpp"
+#include "foxy/detail/session_metrics.hpp"
 
 #include <chrono>
+#include <string>
+#include <vector>
 
 template <typename ConnectHandler>
 auto foxy::client_session::async_connect(
@@ -31,13 +37,18 @@ auto foxy::client_session::async_connect(
   auto strand = foxy::detail::get_strand(
     init.completion_handler, s_->stream.get_executor());
 
+  auto cancellation = foxy::detail::operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
+
   foxy::co_spawn(
     strand,
     [
-      s       = s_,
-      host    = std::move(host),
-      service = std::move(service),
-      handler = std::move(init.completion_handler)
+      s            = s_,
+      host         = std::move(host),
+      service      = std::move(service),
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
     ]() mutable -> foxy::awaitable<void, strand_type> {
 
       auto executor =
@@ -47,6 +58,9 @@ auto foxy::client_session::async_connect(
       auto ec          = error_code();
       auto error_token = redirect_error(token, ec);
 
+      s->h2.reset();
+      s->host = host;
+
       if (s->stream.is_ssl()) {
         auto const res = SSL_set_tlsext_host_name(
           s->stream.ssl_stream().native_handle(), host.c_str());
@@ -60,40 +74,138 @@ auto foxy::client_session::async_connect(
             executor,
             beast::bind_handler(std::move(handler), ec, tcp::endpoint()));
         }
+
+        if (s->offer_http2) { foxy::detail::offer_h2_alpn(s->stream, ec); }
+        if (ec) {
+          co_return asio::post(
+            executor,
+            beast::bind_handler(std::move(handler), ec, tcp::endpoint()));
+        }
       }
 
-      auto resolver  = tcp::resolver(s->stream.get_executor().context());
+      auto& metrics = foxy::detail::session_metrics::get();
+
+      // a connect cancelled before it got this far doesn't look anything up
+      //
+      if (cancellation.cancelled()) {
+        cancellation.finish(ec);
+        metrics.connect_errors.add();
+        co_return asio::post(
+          executor,
+          beast::bind_handler(std::move(handler), ec, tcp::endpoint()));
+      }
+
+      auto start = std::chrono::steady_clock::now();
+
+      // the lookup is made cancellable along with everything else, though a
+      // lookup the system has already started runs to the end regardless
+      //
+      auto resolver = tcp::resolver(s->stream.get_executor().context());
+      s->resolver   = &resolver;
+
       auto endpoints =
         co_await resolver.async_resolve(host, service, error_token);
 
+      s->resolver = nullptr;
+
+      metrics.resolve_time.record_since(start);
+
       if (ec) {
+        cancellation.finish(ec);
+        metrics.connect_errors.add();
         co_return asio::post(
           executor,
           beast::bind_handler(std::move(handler), ec, tcp::endpoint()));
       }
 
-      auto endpoint = co_await asio::async_connect(
-        s->stream.stream(), endpoints, error_token);
+      start = std::chrono::steady_clock::now();
+
+      // the endpoints are tried in turn by hand, rather than with
+      // `asio::async_connect`, as some options have to be set between a
+      // socket being opened and it connecting
+      //
+      auto& socket   = s->stream.stream();
+      auto endpoint  = tcp::endpoint();
+      auto option_ec = error_code();
+
+      ec = asio::error::not_found;
+      for (auto const& entry : endpoints) {
+        socket.close(option_ec);
+
+        socket.open(entry.endpoint().protocol(), ec);
+        if (ec) { continue; }
+
+        set_connect_options(socket, s->options, option_ec);
+
+        co_await socket.async_connect(entry.endpoint(), error_token);
+        if (!ec) {
+          endpoint = entry.endpoint();
+          break;
+        }
+
+        // the rest of the endpoints aren't tried once the connect has been
+        // cancelled
+        //
+        if (cancellation.cancelled()) { break; }
+      }
+
+      if (!ec) {
+        set_stream_options(s->stream, s->options, option_ec);
+      }
+
+      metrics.tcp_connect_time.record_since(start);
 
       if (ec) {
+        cancellation.finish(ec);
+        metrics.connect_errors.add();
         co_return asio::post(
           executor,
           beast::bind_handler(std::move(handler), ec, tcp::endpoint()));
       }
 
       if (s->stream.is_ssl()) {
+        start = std::chrono::steady_clock::now();
+
         ignore_unused(
           co_await (s->stream)
             .ssl_stream()
             .async_handshake(ssl::stream_base::client, error_token));
 
+        metrics.tls_handshake_time.record_since(start);
+
         if (ec) {
+          cancellation.finish(ec);
+          metrics.connect_errors.add();
           co_return asio::post(
             executor,
             beast::bind_handler(std::move(handler), ec, tcp::endpoint()));
         }
       }
 
+      // once cancelled, a connect which made it through regardless is
+      // reported as cancelled all the same
+      //
+      cancellation.finish(ec);
+      if (ec) {
+        metrics.connect_errors.add();
+        co_return asio::post(
+          executor,
+          beast::bind_handler(std::move(handler), ec, tcp::endpoint()));
+      }
+
+      // without SSL there's nothing to negotiate with, so HTTP/2 is spoken
+      // from the start
+      //
+      auto const is_h2 = s->stream.is_ssl()
+        ? foxy::detail::is_h2_alpn(s->stream)
+        : s->offer_http2;
+
+      if (is_h2) {
+        s->h2 = std::make_shared<foxy::detail::h2_connection>(
+          s, foxy::detail::h2_connection::role::client);
+        s->h2->start();
+      }
+
       co_return asio::post(
         executor,
         beast::bind_handler(std::move(handler), error_code(), endpoint));
@@ -126,14 +238,29 @@ auto foxy::client_session::async_request(
   asio::async_completion<WriteHandler, void(boost::system::error_code)>
   init(write_handler);
 
-  auto strand = foxy::detail::get_strand(
-    init.completion_handler, s_->stream.get_executor());
+  // everything an HTTP/2 connection does happens on its own strand
+  //
+  auto strand = s_->h2
+    ? s_->h2->get_strand()
+    : foxy::detail::get_strand(
+        init.completion_handler, s_->stream.get_executor());
+
+  // cancelling takes the whole connection down, which over HTTP/2 would take
+  // every other stream on it down too, so only HTTP/1 requests can be
+  // cancelled
+  //
+  auto cancellation = foxy::detail::operation_cancellation(
+    s_, strand,
+    s_->h2
+      ? foxy::cancellation_slot()
+      : foxy::get_associated_cancellation_slot(init.completion_handler));
 
   co_spawn(
     strand,
     [
       &request, &parser, s = s_,
-      handler = std::move(init.completion_handler)
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
     ]() mutable -> awaitable<void, strand_type> {
 
       auto token       = co_await this_coro::token();
@@ -143,23 +270,97 @@ auto foxy::client_session::async_request(
       auto executor =
         asio::get_associated_executor(handler, s->stream.get_executor());
 
-      ignore_unused(
-        co_await http::async_write(s->stream, request, error_token));
+      auto& metrics = foxy::detail::session_metrics::get();
+
+      auto start = std::chrono::steady_clock::now();
+
+      if (auto h2 = s->h2) {
+        auto fields = foxy::detail::make_h2_request_fields(
+          request, s->stream.is_ssl() ? "https" : "http", s->host);
+
+        auto body = std::string();
+        foxy::detail::serialize_h2_body(request, body, ec);
+
+        auto response_fields = std::vector<foxy::detail::header_field>();
+        auto response_body   = std::string();
+
+        if (!ec) {
+          co_await h2->async_request(
+            fields, body, response_fields, response_body, ec);
+        }
+
+        metrics.response_time.record_since(start);
+
+        if (!ec) {
+          foxy::detail::parse_h2_response(
+            response_fields,
+            response_body,
+            request.method() == http::verb::head,
+            parser,
+            ec);
+        }
+
+        if (ec) { metrics.errors.add(); }
+
+        co_return asio::post(
+          executor,
+          beast::bind_handler(std::move(handler), ec));
+      }
+
+      s->arm_deadline();
+
+      auto bytes_written = std::size_t{0};
+      co_await foxy::detail::async_write_message(
+        *s, request, bytes_written, ec);
+
+      s->disarm_deadline(ec);
+
+      metrics.request_write_time.record_since(start);
+      metrics.bytes_written.add(bytes_written);
 
       if (ec) {
+        cancellation.finish(ec);
+        metrics.errors.add();
         co_return asio::post(
           executor,
           beast::bind_handler(std::move(handler), ec));
       }
 
-      ignore_unused(
-        co_await http::async_read(
+      // the header is read on its own so that the time to the first byte is
+      // told apart from however long the body then takes to come in
+      //
+      start = std::chrono::steady_clock::now();
+      s->arm_deadline();
+
+      auto bytes_read =
+        co_await http::async_read_header(
           s->stream,
           s->buffer,
           parser,
-          error_token));
+          error_token);
+
+      auto const header_done = std::chrono::steady_clock::now();
+      if (!ec) { metrics.time_to_first_byte.record(header_done - start); }
+
+      if (!ec && !parser.is_done()) {
+        bytes_read +=
+          co_await http::async_read(
+            s->stream,
+            s->buffer,
+            parser,
+            error_token);
+
+        metrics.response_body_time.record_since(header_done);
+      }
+
+      s->disarm_deadline(ec);
+      cancellation.finish(ec);
+
+      metrics.response_time.record_since(start);
+      metrics.bytes_read.add(bytes_read);
 
       if (ec) {
+        metrics.errors.add();
         co_return asio::post(
           executor,
           beast::bind_handler(std::move(handler), ec));
@@ -191,15 +392,25 @@ auto foxy::client_session::async_ssl_shutdown(
   asio::async_completion<ShutdownHandler, void(boost::system::error_code)>
   init(shutdown_handler);
 
-  auto strand = foxy::detail::get_strand(
-    init.completion_handler, s_->stream.get_executor());
+  auto strand = s_->h2
+    ? s_->h2->get_strand()
+    : foxy::detail::get_strand(
+        init.completion_handler, s_->stream.get_executor());
+
+  // a peer which never answers the close_notify would otherwise hold the
+  // connection open until the system gives up on it
+  //
+  auto cancellation = foxy::detail::operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
 
   co_spawn(
     strand,
     [
-      s = s_,
-      handler = std::move(init.completion_handler)
-    ]() mutable -> awaitable<void> {
+      s            = s_,
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
+    ]() mutable -> awaitable<void, strand_type> {
 
       auto& multi_stream = s->stream;
 
@@ -210,9 +421,15 @@ auto foxy::client_session::async_ssl_shutdown(
       auto ec          = error_code();
       auto error_token = redirect_error(token, ec);
 
+      // HTTP/2 says goodbye with a GOAWAY before TLS does
+      //
+      if (auto h2 = s->h2) { co_await h2->async_close(); }
+
       ignore_unused(
         co_await multi_stream.ssl_stream().async_shutdown(error_token));
 
+      cancellation.finish(ec);
+
       asio::post(executor, beast::bind_handler(std::move(handler), ec));
     },
     detached);
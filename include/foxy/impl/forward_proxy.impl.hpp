@@ -0,0 +1,101 @@
+#include "foxy/forward_proxy.hpp"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include "foxy/coroutine.hpp"
+
+#include <algorithm>
+
+template <typename DrainHandler>
+auto foxy::forward_proxy::async_drain(
+  clock_type::time_point const deadline,
+  DrainHandler&&               drain_handler
+) -> BOOST_ASIO_INITFN_RESULT_TYPE(
+  DrainHandler, void(boost::system::error_code, std::size_t)
+) {
+  using boost::system::error_code;
+
+  namespace beast = boost::beast;
+  namespace asio  = boost::asio;
+
+  asio::async_completion<
+    DrainHandler, void(boost::system::error_code, std::size_t)
+  >
+  init(drain_handler);
+
+  // each acceptor is only ever touched from its own listener's strand
+  //
+  auto& first = *s_->listeners.front();
+
+  foxy::co_spawn(
+    first.strand,
+    [
+      s       = s_,
+      &first,
+      deadline,
+      handler = std::move(init.completion_handler)
+    ]() mutable -> foxy::awaitable<void, strand_type> {
+
+      auto executor =
+        asio::get_associated_executor(handler, first.acceptor.get_executor());
+
+      auto token       = co_await this_coro::token();
+      auto ec          = error_code();
+      auto error_token = redirect_error(token, ec);
+
+      s->draining = true;
+
+      for (auto const& l : s->listeners) {
+        asio::post(
+          l->strand,
+          [s, l = l.get()] {
+            auto close_ec = error_code();
+            l->acceptor.close(close_ec);
+          });
+      }
+
+      // sessions don't announce when they finish so we simply check back
+      // periodically, which is plenty for something done once per deploy
+      //
+      // every time round, the sessions sitting idle on their clients are
+      // interrupted, which also catches any which went idle after the last
+      // look
+      //
+      auto const poll_interval = std::chrono::milliseconds(25);
+
+      auto timer = asio::steady_timer(first.acceptor.get_executor().context());
+
+      while (s->sessions.load() > 0) {
+        s->interrupt_sessions(true);
+
+        auto const now = clock_type::now();
+        if (now >= deadline) { break; }
+
+        timer.expires_after(
+          std::min<clock_type::duration>(poll_interval, deadline - now));
+
+        co_await timer.async_wait(error_token);
+      }
+
+      auto const remaining = s->sessions.load();
+
+      // whatever's still going once the deadline has passed is cut off, the
+      // sessions going away as soon as their operations have unwound
+      //
+      if (remaining > 0) { s->interrupt_sessions(false); }
+
+      ec = (remaining > 0) ? error_code(asio::error::timed_out) : error_code();
+
+      co_return asio::post(
+        executor,
+        beast::bind_handler(std::move(handler), ec, remaining));
+    },
+    foxy::detached);
+
+  return init.result.get();
+}
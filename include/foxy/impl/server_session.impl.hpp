@@ -0,0 +1,359 @@
+#include "foxy/server_session.hpp"
+#include "foxy/detail/serve_h2.hpp"
+#include "foxy/detail/send_file.hpp"
+#include "foxy/detail/get_strand.hpp"
+#include "foxy/detail/queue_output.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/serializer.hpp>
+
+#include <chrono>
+#include <type_traits>
+
+template <typename Fields, typename WriteHandler>
+auto foxy::server_session::async_write_file(
+  boost::beast::http::response<boost::beast::http::file_body, Fields>&
+                 response,
+  byte_range     range,
+  WriteHandler&& write_handler
+) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+  WriteHandler, void(boost::system::error_code)
+) {
+  using boost::system::error_code;
+
+  namespace beast = boost::beast;
+  namespace asio  = boost::asio;
+  namespace http  = boost::beast::http;
+
+  asio::async_completion<WriteHandler, void(boost::system::error_code)>
+  init(write_handler);
+
+  auto strand = foxy::detail::get_strand(
+    init.completion_handler, s_->stream.get_executor());
+
+  auto cancellation = detail::operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
+
+  foxy::co_spawn(
+    strand,
+    [
+      &response, range, s = s_,
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
+    ]() mutable -> foxy::awaitable<void, strand_type> {
+
+      auto ec = error_code();
+
+      auto executor =
+        asio::get_associated_executor(handler, s->stream.get_executor());
+
+      auto& metrics = detail::session_metrics::get();
+
+      auto const size = response.body().size();
+      if (range.offset > size || range.length > size - range.offset) {
+        ec = asio::error::invalid_argument;
+        cancellation.finish(ec);
+
+        metrics.errors.add();
+        co_return asio::post(
+          executor,
+          beast::bind_handler(std::move(handler), ec));
+      }
+
+      auto const start = std::chrono::steady_clock::now();
+
+      response.content_length(range.length);
+
+      auto serializer = http::response_serializer<http::file_body, Fields>(
+        response);
+
+      // the header goes out with anything already queued, ahead of the file
+      //
+      auto header_bytes = std::size_t{0};
+      detail::queue_output(s->output, serializer, true, ec);
+      if (!ec) {
+        s->arm_deadline();
+        co_await detail::async_flush_output(*s, header_bytes, ec);
+        s->disarm_deadline(ec);
+      }
+
+      // the file may take any number of sends, each of which gets the full
+      // timeout to make progress in
+      //
+      auto body_bytes = std::uint64_t{0};
+      if (!ec) {
+        s->arm_deadline();
+        co_await detail::async_send_file(
+          s->stream, response.body().file(), range, body_bytes, ec);
+        s->disarm_deadline(ec);
+      }
+
+      cancellation.finish(ec);
+
+      metrics.write_time.record_since(start);
+      metrics.bytes_written.add(header_bytes + body_bytes);
+
+      if (ec) {
+        metrics.errors.add();
+        co_return asio::post(
+          executor,
+          beast::bind_handler(std::move(handler), ec));
+      }
+
+      co_return asio::post(
+        executor,
+        beast::bind_handler(std::move(handler), error_code()));
+    },
+    foxy::detached);
+
+  return init.result.get();
+}
+
+template <typename Fields, typename WriteHandler>
+auto foxy::server_session::async_write_file(
+  boost::beast::http::response<boost::beast::http::file_body, Fields>&
+                 response,
+  WriteHandler&& write_handler
+) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+  WriteHandler, void(boost::system::error_code)
+) {
+  return async_write_file(
+    response,
+    byte_range{0, response.body().size()},
+    std::forward<WriteHandler>(write_handler));
+}
+
+template <
+  typename RequestBody,
+  typename RequestHandler,
+  typename ServeHandler
+>
+auto foxy::server_session::async_serve(
+  RequestHandler&& request_handler,
+  ServeHandler&&   serve_handler
+) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+  ServeHandler, void(boost::system::error_code)
+) {
+  using boost::system::error_code;
+
+  namespace beast = boost::beast;
+  namespace asio  = boost::asio;
+  namespace http  = boost::beast::http;
+
+  using request_handler_type = std::decay_t<RequestHandler>;
+  using result_type          = std::invoke_result_t<
+    request_handler_type&, http::request<RequestBody>&>;
+
+  asio::async_completion<ServeHandler, void(boost::system::error_code)>
+  init(serve_handler);
+
+  auto strand = foxy::detail::get_strand(
+    init.completion_handler, s_->stream.get_executor());
+
+  auto cancellation = detail::operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
+
+  foxy::co_spawn(
+    strand,
+    [
+      request_handler =
+        request_handler_type(std::forward<RequestHandler>(request_handler)),
+      s            = s_,
+      strand       = strand,
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
+    ]() mutable -> foxy::awaitable<void, strand_type> {
+
+      auto token       = co_await this_coro::token();
+      auto ec          = error_code();
+      auto error_token = redirect_error(token, ec);
+
+      auto executor =
+        asio::get_associated_executor(handler, s->stream.get_executor());
+
+      auto& metrics = detail::session_metrics::get();
+
+      // HTTP/2 is spoken when ALPN settled on it or, without SSL, when the
+      // client opens with its preface
+      //
+      auto is_h2 = false;
+      if (s->stream.is_ssl()) {
+        is_h2 = detail::is_h2_alpn(s->stream);
+      } else {
+        s->arm_deadline();
+        co_await detail::async_detect_h2_preface(*s, is_h2, ec);
+        s->disarm_deadline(ec);
+      }
+
+      // an HTTP/2 connection sits idle in between streams for as long as
+      // the client likes, so it isn't held to the timeout
+      //
+      if (is_h2) {
+        co_await detail::async_serve_h2<RequestBody>(
+          s, strand, request_handler, ec);
+
+        cancellation.finish(ec);
+        if (ec) { metrics.errors.add(); }
+
+        co_return asio::post(
+          executor,
+          beast::bind_handler(std::move(handler), ec));
+      }
+
+      if (ec) { cancellation.finish(ec); }
+
+      // a client which hangs up before sending anything is no different from
+      // one which does so after its last request
+      //
+      if (ec == asio::error::eof) {
+        co_return asio::post(
+          executor,
+          beast::bind_handler(std::move(handler), error_code()));
+      }
+
+      if (ec) {
+        metrics.errors.add();
+        co_return asio::post(
+          executor,
+          beast::bind_handler(std::move(handler), ec));
+      }
+
+      auto bytes_written = std::size_t{0};
+
+      // the first request will usually have been read while looking for the
+      // HTTP/2 preface, which doesn't make it pipelined
+      //
+      auto is_first = true;
+
+      while (true) {
+        auto parser = http::request_parser<RequestBody>();
+        parser.eager(true);
+
+        // a pipelining client will have sent further requests along with the
+        // one we just answered
+        //
+        auto bytes_read = std::size_t{0};
+        while (!parser.is_done() && s->buffer.size() > 0) {
+          auto const n = parser.put(s->buffer.data(), ec);
+          s->buffer.consume(n);
+          bytes_read += n;
+
+          if (ec == http::error::need_more) {
+            ec = {};
+            break;
+          }
+
+          if (ec || n == 0) { break; }
+        }
+
+        if (!ec && parser.is_done() && !is_first) {
+          metrics.pipelined_requests.add();
+        }
+
+        is_first = false;
+
+        // the rest of the request has to come off the socket and the client
+        // may well be waiting on the responses we have queued before sending
+        // it
+        //
+        if (!ec && !parser.is_done()) {
+          s->arm_deadline();
+          co_await detail::async_flush_output(*s, bytes_written, ec);
+          s->disarm_deadline(ec);
+
+          metrics.bytes_written.add(bytes_written);
+
+          if (!ec) {
+            s->arm_deadline();
+            bytes_read += co_await http::async_read(
+              s->stream, s->buffer, parser, error_token);
+            s->disarm_deadline(ec);
+          }
+        }
+
+        metrics.bytes_read.add(bytes_read);
+
+        if (ec) { cancellation.finish(ec); }
+
+        if (ec == http::error::end_of_stream) {
+          co_return asio::post(
+            executor,
+            beast::bind_handler(std::move(handler), error_code()));
+        }
+
+        if (ec) {
+          // the requests before this one still get their responses
+          //
+          auto flush_ec = error_code();
+          if (ec != asio::error::operation_aborted) {
+            s->arm_deadline();
+            co_await detail::async_flush_output(*s, bytes_written, flush_ec);
+            s->disarm_deadline(flush_ec);
+
+            metrics.bytes_written.add(bytes_written);
+          }
+
+          metrics.errors.add();
+          co_return asio::post(
+            executor,
+            beast::bind_handler(std::move(handler), ec));
+        }
+
+        auto& request  = parser.get();
+        auto  need_eof = false;
+
+        // the deadline only covers the session's own reads and writes, not
+        // however long the request handler takes
+        //
+        if constexpr (foxy::is_awaitable_v<result_type>) {
+          auto response = co_await request_handler(request);
+          need_eof = response.need_eof();
+
+          s->arm_deadline();
+          co_await detail::async_queue_message(
+            *s, response, bytes_written, ec);
+          s->disarm_deadline(ec);
+        } else {
+          auto response = request_handler(request);
+          need_eof = response.need_eof();
+
+          s->arm_deadline();
+          co_await detail::async_queue_message(
+            *s, response, bytes_written, ec);
+          s->disarm_deadline(ec);
+        }
+
+        metrics.bytes_written.add(bytes_written);
+
+        if (!ec && need_eof) {
+          s->arm_deadline();
+          co_await detail::async_flush_output(*s, bytes_written, ec);
+          s->disarm_deadline(ec);
+
+          metrics.bytes_written.add(bytes_written);
+        }
+
+        if (ec || need_eof) { cancellation.finish(ec); }
+
+        if (ec) {
+          metrics.errors.add();
+          co_return asio::post(
+            executor,
+            beast::bind_handler(std::move(handler), ec));
+        }
+
+        if (need_eof) {
+          co_return asio::post(
+            executor,
+            beast::bind_handler(std::move(handler), error_code()));
+        }
+      }
+    },
+    foxy::detached);
+
+  return init.result.get();
+}
@@ -1,5 +1,10 @@
+#include "foxy/detail/relay.hpp"
 #include "foxy/detail/session.hpp"
 #include "foxy/detail/get_strand.hpp"
+#include "foxy/detail/queue_output.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#include <chrono>
 
 template <
   typename Serializer,
@@ -24,28 +29,44 @@ auto foxy::detail::session::async_write_header(
   auto strand = foxy::detail::get_strand(
     init.completion_handler, s_->stream.get_executor());
 
+  auto cancellation = operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
+
   foxy::co_spawn(
     strand,
     [
       &serializer, s = s_,
-      handler = std::move(init.completion_handler)
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
     ]() mutable -> foxy::awaitable<void, typename session_state::strand_type> {
 
-      auto& stream = s->stream;
-
       auto executor =
-        asio::get_associated_executor(handler, stream.get_executor());
+        asio::get_associated_executor(handler, s->stream.get_executor());
 
-      auto token       = co_await this_coro::token();
-      auto ec          = error_code();
-      auto error_token = redirect_error(token, ec);
+      auto ec = error_code();
 
-      auto const bytes_transferred =
-        co_await http::async_write_header(stream, serializer, error_token);
+      auto const start = std::chrono::steady_clock::now();
 
-      ignore_unused(bytes_transferred);
+      // the header is tacked onto whatever is queued so that both leave in
+      // the one write
+      //
+      auto bytes_transferred = std::size_t{0};
+      queue_output(s->output, serializer, true, ec);
+      if (!ec) {
+        s->arm_deadline();
+        co_await async_flush_output(*s, bytes_transferred, ec);
+        s->disarm_deadline(ec);
+      }
+
+      cancellation.finish(ec);
+
+      auto& metrics = session_metrics::get();
+      metrics.write_header_time.record_since(start);
+      metrics.bytes_written.add(bytes_transferred);
 
       if (ec) {
+        metrics.errors.add();
         co_return asio::post(
           executor,
           beast::bind_handler(std::move(handler), ec));
@@ -85,11 +106,16 @@ auto foxy::detail::session::async_write(
     auto strand = foxy::detail::get_strand(
       init.completion_handler, s_->stream.get_executor());
 
+    auto cancellation = operation_cancellation(
+      s_, strand,
+      foxy::get_associated_cancellation_slot(init.completion_handler));
+
     foxy::co_spawn(
       strand,
       [
         &serializer, s = s_,
-        handler = std::move(init.completion_handler)
+        cancellation = std::move(cancellation),
+        handler      = std::move(init.completion_handler)
       ]() mutable -> foxy::awaitable<void, strand_type> {
 
         auto token       = co_await this_coro::token();
@@ -99,10 +125,29 @@ auto foxy::detail::session::async_write(
         auto executor =
           asio::get_associated_executor(handler, s->stream.get_executor());
 
-        ignore_unused(
-          co_await http::async_write(s->stream, serializer, error_token));
+        auto const start = std::chrono::steady_clock::now();
+
+        s->arm_deadline();
+
+        auto bytes_transferred = std::size_t{0};
+        if (s->output.size() > 0) {
+          co_await async_flush_output(*s, bytes_transferred, ec);
+        }
+
+        if (!ec) {
+          bytes_transferred +=
+            co_await http::async_write(s->stream, serializer, error_token);
+        }
+
+        s->disarm_deadline(ec);
+        cancellation.finish(ec);
+
+        auto& metrics = session_metrics::get();
+        metrics.write_time.record_since(start);
+        metrics.bytes_written.add(bytes_transferred);
 
         if (ec) {
+          metrics.errors.add();
           co_return asio::post(
             executor,
             beast::bind_handler(std::move(handler), ec));
@@ -142,25 +187,115 @@ foxy::detail::session::async_write(
   auto strand = foxy::detail::get_strand(
     init.completion_handler, s_->stream.get_executor());
 
+  auto cancellation = operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
+
   foxy::co_spawn(
     strand,
     [
       &message,
-      s       = s_,
-      handler = std::move(init.completion_handler)
+      s            = s_,
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
     ]() mutable -> foxy::awaitable<void, strand_type> {
 
       auto executor =
         asio::get_associated_executor(handler, s->stream.get_executor());
 
-      auto token       = co_await foxy::this_coro::token();
-      auto ec          = error_code();
-      auto error_token = foxy::redirect_error(token, ec);
+      auto ec = error_code();
+
+      auto const start = std::chrono::steady_clock::now();
+
+      s->arm_deadline();
+
+      auto bytes_transferred = std::size_t{0};
+      co_await async_write_message(*s, message, bytes_transferred, ec);
+
+      s->disarm_deadline(ec);
+      cancellation.finish(ec);
+
+      auto& metrics = session_metrics::get();
+      metrics.write_time.record_since(start);
+      metrics.bytes_written.add(bytes_transferred);
+
+      if (ec) {
+        metrics.errors.add();
+        co_return asio::post(
+          executor, beast::bind_handler(std::move(handler), ec));
+      }
+
+      co_return asio::post(
+        executor, beast::bind_handler(std::move(handler), error_code()));
+    },
+    foxy::detached);
+
+  return init.result.get();
+}
+
+template <
+  typename Message,
+  std::enable_if_t<foxy::is_message_v<Message>, int>
+>
+auto
+foxy::detail::session::queue_write(
+  Message&                   message,
+  boost::system::error_code& ec
+) & -> void {
+  queue_message(s_->output, message, ec);
+}
+
+template <typename FlushHandler>
+auto
+foxy::detail::session::async_flush(
+  FlushHandler&& flush_handler
+) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+  FlushHandler, void(boost::system::error_code)
+) {
+  using boost::system::error_code;
+
+  namespace beast = boost::beast;
+  namespace asio  = boost::asio;
+
+  asio::async_completion<FlushHandler, void(boost::system::error_code)>
+  init(flush_handler);
+
+  auto strand = foxy::detail::get_strand(
+    init.completion_handler, s_->stream.get_executor());
+
+  auto cancellation = operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
+
+  foxy::co_spawn(
+    strand,
+    [
+      s            = s_,
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
+    ]() mutable -> foxy::awaitable<void, strand_type> {
+
+      auto executor =
+        asio::get_associated_executor(handler, s->stream.get_executor());
+
+      auto ec = error_code();
+
+      auto const start = std::chrono::steady_clock::now();
+
+      s->arm_deadline();
+
+      auto bytes_transferred = std::size_t{0};
+      co_await async_flush_output(*s, bytes_transferred, ec);
+
+      s->disarm_deadline(ec);
+      cancellation.finish(ec);
 
-      ignore_unused(
-        co_await http::async_write(s->stream, message, error_token));
+      auto& metrics = session_metrics::get();
+      metrics.write_time.record_since(start);
+      metrics.bytes_written.add(bytes_transferred);
 
       if (ec) {
+        metrics.errors.add();
         co_return asio::post(
           executor, beast::bind_handler(std::move(handler), ec));
       }
@@ -197,12 +332,17 @@ auto foxy::detail::session::async_read_header(
   auto strand = foxy::detail::get_strand(
     init.completion_handler, s_->stream.get_executor());
 
+  auto cancellation = operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
+
   foxy::co_spawn(
     strand,
     [
       &parser,
-      s       = s_,
-      handler = std::move(init.completion_handler)
+      s            = s_,
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
     ]() mutable -> foxy::awaitable<void, strand_type> {
 
       auto executor =
@@ -212,11 +352,23 @@ auto foxy::detail::session::async_read_header(
       auto ec          = error_code();
       auto error_token = redirect_error(token, ec);
 
-      ignore_unused(
+      auto const start = std::chrono::steady_clock::now();
+
+      s->arm_deadline();
+
+      auto const bytes_transferred =
         co_await http::async_read_header(
-          s->stream, s->buffer, parser, error_token));
+          s->stream, s->buffer, parser, error_token);
+
+      s->disarm_deadline(ec);
+      cancellation.finish(ec);
+
+      auto& metrics = session_metrics::get();
+      metrics.read_header_time.record_since(start);
+      metrics.bytes_read.add(bytes_transferred);
 
       if (ec) {
+        metrics.errors.add();
         co_return asio::post(
           executor, beast::bind_handler(std::move(handler), ec));
       }
@@ -254,12 +406,17 @@ foxy::detail::session::async_read(
   auto strand = foxy::detail::get_strand(
     init.completion_handler, s_->stream.get_executor());
 
+  auto cancellation = operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
+
   foxy::co_spawn(
     strand,
     [
       &parser,
-      s       = s_,
-      handler = std::move(init.completion_handler)
+      s            = s_,
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
     ]() mutable -> foxy::awaitable<void, strand_type> {
 
       auto executor =
@@ -269,14 +426,26 @@ foxy::detail::session::async_read(
       auto ec          = error_code();
       auto error_token = foxy::redirect_error(token, ec);
 
-      ignore_unused(
+      auto const start = std::chrono::steady_clock::now();
+
+      s->arm_deadline();
+
+      auto const bytes_transferred =
         co_await http::async_read(
           s->stream,
           s->buffer,
           parser,
-          error_token));
+          error_token);
+
+      s->disarm_deadline(ec);
+      cancellation.finish(ec);
+
+      auto& metrics = session_metrics::get();
+      metrics.read_time.record_since(start);
+      metrics.bytes_read.add(bytes_transferred);
 
       if (ec) {
+        metrics.errors.add();
         co_return asio::post(
           executor, beast::bind_handler(std::move(handler), ec));
       }
@@ -288,4 +457,52 @@ foxy::detail::session::async_read(
     foxy::detached);
 
   return init.result.get();
-}
\ No newline at end of file
+}
+
+template <typename RelayHandler>
+auto foxy::detail::session::async_relay(
+  session&       other,
+  RelayHandler&& relay_handler
+) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+  RelayHandler, void(boost::system::error_code)
+) {
+  namespace beast = boost::beast;
+  namespace asio  = boost::asio;
+
+  using boost::system::error_code;
+
+  asio::async_completion<RelayHandler, void(boost::system::error_code)>
+  init(relay_handler);
+
+  auto strand = foxy::detail::get_strand(
+    init.completion_handler, s_->stream.get_executor());
+
+  auto cancellation = operation_cancellation(
+    s_, strand,
+    foxy::get_associated_cancellation_slot(init.completion_handler));
+
+  foxy::co_spawn(
+    strand,
+    [
+      s = s_, other_s = other.s_,
+      cancellation = std::move(cancellation),
+      handler      = std::move(init.completion_handler)
+    ]() mutable -> foxy::awaitable<void, typename session_state::strand_type> {
+
+      auto executor =
+        asio::get_associated_executor(handler, s->stream.get_executor());
+
+      auto ec = error_code();
+      co_await foxy::detail::async_relay(s, other_s, ec);
+      cancellation.finish(ec);
+
+      if (ec) { session_metrics::get().errors.add(); }
+
+      co_return asio::post(
+        executor,
+        beast::bind_handler(std::move(handler), ec));
+    },
+    foxy::detached);
+
+  return init.result.get();
+}
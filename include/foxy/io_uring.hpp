@@ -0,0 +1,67 @@
+#ifndef FOXY_IO_URING_HPP_
+#define FOXY_IO_URING_HPP_
+
+#include <boost/asio/io_context.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace foxy {
+
+struct io_uring_options {
+  // the number of submission queue entries, rounded up to a power of two by
+  // the kernel
+  // the completion queue is sized to a multiple of this
+  //
+  unsigned queue_depth = 256;
+
+  // the size of the region registered with the kernel for session read
+  // buffers; reads into it skip pinning pages on every operation
+  // only the first successful call to `use_io_uring` decides the size and
+  // zero disables registered buffers entirely
+  //
+  std::size_t registered_buffer_bytes = 16 * 1024 * 1024;
+};
+
+struct io_uring_stats {
+  // the number of `io_uring_enter` calls made to submit operations
+  //
+  std::uint64_t enters = 0;
+
+  std::uint64_t submitted = 0;
+  std::uint64_t completed = 0;
+
+  // reads which landed in registered buffers
+  //
+  std::uint64_t fixed_reads = 0;
+};
+
+// `use_io_uring` makes every plaintext `multi_stream` created on `io` from
+// here on perform its reads and writes through an io_uring instance owned by
+// `io`, instead of through the epoll reactor
+//
+// operations started while the `io_context` runs a batch of handlers are
+// submitted to the kernel together, with a single system call, once the batch
+// is done; completions are reaped all at once as well
+// TLS streams, as well as connects and accepts, still go through the reactor
+//
+// returns false, leaving `io` entirely on the reactor, if io_uring or any of
+// the operations foxy relies on are unavailable, which is always the case on
+// platforms other than Linux
+//
+// must be called before `io` is run
+//
+auto use_io_uring(
+  boost::asio::io_context& io,
+  io_uring_options const&  opts = io_uring_options()) -> bool;
+
+// `uses_io_uring` returns whether a prior call to `use_io_uring` for `io`
+// succeeded
+//
+auto uses_io_uring(boost::asio::io_context& io) -> bool;
+
+auto get_io_uring_stats(boost::asio::io_context& io) -> io_uring_stats;
+
+} // foxy
+
+#endif // FOXY_IO_URING_HPP_
@@ -3,12 +3,89 @@
 
 #include <string_view>
 #include <boost/system/error_code.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+// FOXY_LOG_LEVEL sets the least severe level which is compiled in at all
+// 0 = trace, 1 = debug, 2 = info, 3 = warn, 4 = error, 5 = off
+//
+#ifndef FOXY_LOG_LEVEL
+#define FOXY_LOG_LEVEL 2
+#endif
 
 namespace foxy {
-  auto log_error(
-    boost::system::error_code const ec,
-    std::string_view const what
-  ) -> void;
+
+enum class log_level : int { trace, debug, info, warn, error, off };
+
+constexpr log_level min_log_level = static_cast<log_level>(FOXY_LOG_LEVEL);
+
+// log_fields are the structured parts of a log record, each of which is only
+// written out when set
+//
+struct log_fields {
+  std::uint64_t                  session_id = 0;
+  boost::asio::ip::tcp::endpoint endpoint   = {};
+  boost::system::error_code      ec         = {};
+  std::chrono::nanoseconds       elapsed    = std::chrono::nanoseconds(-1);
+};
+
+struct log_stats_type {
+  std::uint64_t written    = 0;
+  std::uint64_t dropped    = 0;
+  std::uint64_t suppressed = 0;
+};
+
+namespace detail {
+
+auto write_log(
+  log_level const        level,
+  std::string_view const what,
+  log_fields const&      fields) -> void;
+
+} // detail
+
+// log_event hands a record off to a background thread which formats and
+// writes it so that the calling thread never blocks on the log sink
+//
+// every thread has its own bounded ring of records; when a ring is full, new
+// records are dropped rather than waited on
+// records sharing the same `what` and error code are rate limited so that an
+// error storm costs next to nothing
+//
+// `what` is copied and truncated to a fixed length
+//
+template <log_level Level>
+auto log_event(
+  std::string_view const what,
+  log_fields const&      fields = log_fields()) -> void {
+
+  if constexpr (Level >= min_log_level && Level != log_level::off) {
+    detail::write_log(Level, what, fields);
+  }
+}
+
+auto log_error(
+  boost::system::error_code const ec,
+  std::string_view const what
+) -> void;
+
+// `set_log_sink` replaces the destination of formatted log lines, which is
+// `stderr` by default
+// the sink is only ever invoked from the background thread, with as many
+// lines as were ready at once
+//
+auto set_log_sink(std::function<void(std::string_view)> sink) -> void;
+
+// `flush_log` blocks until every record logged before the call has been
+// handed to the sink
+//
+auto flush_log() -> void;
+
+auto log_stats() -> log_stats_type;
+
 } // foxy
 
-#endif // FOXY_LOG_HPP_
\ No newline at end of file
+#endif // FOXY_LOG_HPP_
@@ -0,0 +1,254 @@
+#ifndef FOXY_METRICS_HPP_
+#define FOXY_METRICS_HPP_
+
+#include <array>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace foxy {
+
+namespace detail {
+
+// the shard a thread's counter updates land in
+//
+auto metrics_shard_index() noexcept -> std::size_t;
+
+// the index of the most significant set bit of a non-zero `value`
+//
+inline
+auto highest_bit(std::uint64_t const value) noexcept -> unsigned {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+  auto msb = 0u;
+  for (auto v = value; v >>= 1;) { ++msb; }
+  return msb;
+#endif
+}
+
+} // detail
+
+// counter is a monotonically increasing value which is spread across several
+// cache lines so that threads bumping it concurrently rarely share one
+//
+struct counter {
+
+public:
+  static constexpr std::size_t num_shards = 16;
+
+private:
+  struct alignas(64) shard {
+    std::atomic<std::uint64_t> value{0};
+  };
+
+  std::array<shard, num_shards> shards_;
+
+public:
+  counter()               = default;
+  counter(counter const&) = delete;
+  counter(counter&&)      = delete;
+
+  auto add(std::uint64_t const n = 1) noexcept -> void {
+    shards_[detail::metrics_shard_index()].value.fetch_add(
+      n, std::memory_order_relaxed);
+  }
+
+  auto value() const noexcept -> std::uint64_t;
+};
+
+// gauge is a value which can go up as well as down, like the number of
+// active sessions
+//
+struct gauge {
+
+private:
+  std::atomic<std::int64_t> value_{0};
+
+public:
+  gauge()             = default;
+  gauge(gauge const&) = delete;
+  gauge(gauge&&)      = delete;
+
+  auto add(std::int64_t const n = 1) noexcept -> void {
+    value_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  auto sub(std::int64_t const n = 1) noexcept -> void {
+    value_.fetch_sub(n, std::memory_order_relaxed);
+  }
+
+  auto set(std::int64_t const n) noexcept -> void {
+    value_.store(n, std::memory_order_relaxed);
+  }
+
+  auto value() const noexcept -> std::int64_t {
+    return value_.load(std::memory_order_relaxed);
+  }
+};
+
+struct histogram_snapshot {
+  std::uint64_t              count = 0;
+  std::uint64_t              sum   = 0;
+  std::uint64_t              max   = 0;
+  std::vector<std::uint64_t> buckets;
+
+  // `value_at` returns the upper bound of the bucket holding the value at
+  // quantile `q`, which lies in [0, 1]
+  //
+  auto value_at(double const q) const -> std::uint64_t;
+};
+
+// histogram records unsigned values, typically nanoseconds, into HDR-style
+// log-linear buckets
+//
+// every power of two is split into `sub_buckets` linear buckets so that any
+// recorded value is reported within 1/`sub_buckets` of its true size, across
+// the entire 64-bit range, using a fixed array of atomic counts
+//
+struct histogram {
+
+public:
+  static constexpr unsigned    sub_bucket_bits = 4;
+  static constexpr std::size_t sub_buckets     = 1 << sub_bucket_bits;
+  static constexpr std::size_t num_buckets     =
+    (64 - sub_bucket_bits + 1) * sub_buckets;
+
+private:
+  std::array<std::atomic<std::uint64_t>, num_buckets> buckets_;
+
+  std::atomic<std::uint64_t> count_;
+  std::atomic<std::uint64_t> sum_;
+  std::atomic<std::uint64_t> max_;
+
+public:
+  histogram();
+  histogram(histogram const&) = delete;
+  histogram(histogram&&)      = delete;
+
+  static auto bucket_index(std::uint64_t const value) noexcept
+  -> std::size_t {
+    if (value < sub_buckets) { return static_cast<std::size_t>(value); }
+
+    auto const msb     = detail::highest_bit(value);
+    auto const shift   = msb - sub_bucket_bits;
+    auto const sub_idx = (value >> shift) & (sub_buckets - 1);
+
+    return (shift + 1) * sub_buckets + static_cast<std::size_t>(sub_idx);
+  }
+
+  static auto bucket_upper_bound(std::size_t const idx) noexcept
+  -> std::uint64_t;
+
+  auto record(std::uint64_t const value) noexcept -> void {
+    buckets_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    auto prev = max_.load(std::memory_order_relaxed);
+    while (prev < value &&
+           !max_.compare_exchange_weak(
+             prev, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  auto record(std::chrono::nanoseconds const elapsed) noexcept -> void {
+    record(static_cast<std::uint64_t>(
+      elapsed.count() > 0 ? elapsed.count() : 0));
+  }
+
+  // `record_since` records the time passed since `start`
+  //
+  auto record_since(std::chrono::steady_clock::time_point const start) noexcept
+  -> void {
+    record(std::chrono::steady_clock::now() - start);
+  }
+
+  // concurrent recordings may or may not be part of the snapshot
+  //
+  auto snapshot() const -> histogram_snapshot;
+};
+
+struct metrics_snapshot {
+  template <typename T>
+  struct entry {
+    std::string name;
+    std::string help;
+    T           value;
+  };
+
+  std::vector<entry<std::uint64_t>>      counters;
+  std::vector<entry<std::int64_t>>       gauges;
+  std::vector<entry<histogram_snapshot>> histograms;
+};
+
+// metrics_registry owns every metric by name
+//
+// registration takes a lock and is meant to happen once, up front; the
+// references it hands out stay valid for the lifetime of the registry and
+// updating through them never locks
+// registering an existing name returns the existing metric
+//
+// histograms which record durations are expected to record nanoseconds and
+// are exported in seconds
+//
+struct metrics_registry {
+
+private:
+  template <typename T>
+  struct named {
+    std::string name;
+    std::string help;
+    T           metric;
+
+    named(std::string_view const name_, std::string_view const help_)
+    : name(name_)
+    , help(help_)
+    {
+    }
+  };
+
+  mutable std::mutex           mtx_;
+  std::deque<named<counter>>   counters_;
+  std::deque<named<gauge>>     gauges_;
+  std::deque<named<histogram>> histograms_;
+
+public:
+  metrics_registry()                        = default;
+  metrics_registry(metrics_registry const&) = delete;
+  metrics_registry(metrics_registry&&)      = delete;
+
+  auto make_counter(std::string_view const name, std::string_view const help)
+  -> counter&;
+
+  auto make_gauge(std::string_view const name, std::string_view const help)
+  -> gauge&;
+
+  auto make_histogram(std::string_view const name, std::string_view const help)
+  -> histogram&;
+
+  // `snapshot` is the pull API, copying out the current value of every metric
+  //
+  auto snapshot() const -> metrics_snapshot;
+
+  // the registry every foxy session records into
+  //
+  static auto global() -> metrics_registry&;
+};
+
+// `write_prometheus` renders a snapshot in the Prometheus text exposition
+// format
+// histograms are written as summaries with a handful of quantiles
+//
+auto write_prometheus(metrics_snapshot const& snapshot, std::string& out)
+-> void;
+
+} // foxy
+
+#endif // FOXY_METRICS_HPP_
@@ -12,7 +12,11 @@
 #include <boost/system/error_code.hpp>
 
 #include "foxy/experimental/core/ssl_stream.hpp"
+#include "foxy/detail/uring.hpp"
+#include "foxy/detail/zerocopy.hpp"
 
+#include <memory>
+#include <cstddef>
 #include <utility>
 #include <optional>
 
@@ -23,24 +27,50 @@ namespace foxy {
 //
 // multi_stream meets the requirements of AsyncStream
 //
+// the SSL stream owns its own socket, which lives on the heap, so that moving
+// a multi_stream never leaves the SSL layer referring to a moved-from socket
+//
+// plaintext streams created on an `io_context` set up with `use_io_uring`
+// read and write through its io_uring instance instead of the reactor
+//
+// plaintext streams may also opt into zero-copy sends for large writes with
+// `enable_zerocopy`
+//
 struct multi_stream {
 
 public:
   using stream_type     = boost::asio::ip::tcp::socket;
   using ssl_stream_type =
-    boost::beast::ssl_stream<boost::asio::ip::tcp::socket&>;
+    boost::beast::ssl_stream<boost::asio::ip::tcp::socket>;
   using executor_type   = boost::asio::ip::tcp::socket::executor_type;
 
 private:
+  // `stream_` is only ever used by plaintext streams, the SSL stream having a
+  // socket of its own; anything which could be either goes through `stream()`
+  //
   stream_type                    stream_;
   std::optional<ssl_stream_type> ssl_stream_;
 
+#ifdef FOXY_HAS_IO_URING
+  detail::uring_service* uring_;
+#endif
+
+#ifdef FOXY_HAS_ZEROCOPY
+  std::shared_ptr<detail::zerocopy_state> zerocopy_;
+#endif
+
 public:
   multi_stream()                    = delete;
   multi_stream(multi_stream const&) = delete;
   multi_stream(multi_stream&& other)
   : stream_(std::move(other).stream_)
   , ssl_stream_(std::move(other.ssl_stream_))
+#ifdef FOXY_HAS_IO_URING
+  , uring_(other.uring_)
+#endif
+#ifdef FOXY_HAS_ZEROCOPY
+  , zerocopy_(std::move(other.zerocopy_))
+#endif
   {
   }
 
@@ -63,6 +93,12 @@ public:
       return ssl_stream_.value().async_read_some(
         buffers, std::forward<ReadHandler>(handler));
     }
+#ifdef FOXY_HAS_IO_URING
+    if (uring_) {
+      return uring_->async_read_some(
+        stream_.native_handle(), buffers, std::forward<ReadHandler>(handler));
+    }
+#endif
     return stream_.async_read_some(buffers, std::forward<ReadHandler>(handler));
   }
 
@@ -78,10 +114,40 @@ public:
       return ssl_stream_.value().async_write_some(
         buffers, std::forward<WriteHandler>(handler));
     }
+#ifdef FOXY_HAS_ZEROCOPY
+    if (zerocopy_ &&
+        boost::asio::buffer_size(buffers) >= zerocopy_->threshold) {
+      return detail::async_zerocopy_write_some(
+        stream_, zerocopy_, buffers, std::forward<WriteHandler>(handler));
+    }
+#endif
+#ifdef FOXY_HAS_IO_URING
+    if (uring_) {
+      return uring_->async_write_some(
+        stream_.native_handle(), buffers, std::forward<WriteHandler>(handler));
+    }
+#endif
     return stream_.async_write_some(
       buffers, std::forward<WriteHandler>(handler));
   }
 
+  // `enable_zerocopy` makes plaintext writes of at least `threshold` bytes
+  // send with `MSG_ZEROCOPY`, so that the kernel transmits straight from the
+  // caller's pages instead of copying them into the socket buffer
+  //
+  // such a write only completes once the kernel has released every page,
+  // which for TCP means once the peer has acknowledged all of it, and it is
+  // never partial; in exchange, the CPU time spent copying goes away
+  // over loopback the kernel copies regardless
+  //
+  // the socket must be open, and the call fails with
+  // `operation_not_supported` for TLS streams and on platforms other than
+  // Linux
+  //
+  auto enable_zerocopy(
+    std::size_t const          threshold,
+    boost::system::error_code& ec) -> void;
+
   auto is_ssl() const -> bool;
   auto stream() &     -> stream_type&;
   auto ssl_stream() & -> ssl_stream_type&;
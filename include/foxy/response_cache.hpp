@@ -0,0 +1,218 @@
+#ifndef FOXY_RESPONSE_CACHE_HPP_
+#define FOXY_RESPONSE_CACHE_HPP_
+
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/http/fields.hpp>
+#include <boost/beast/http/message.hpp>
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+namespace foxy {
+
+// response_cache is a shared HTTP cache (RFC 7234) for the responses the proxy
+// relays
+//
+// responses are keyed by their authority and target, with the request fields
+// named by `Vary` telling the variants of a resource apart
+// only responses to GET are stored, HEAD requests being answered from them
+// only responses with an explicit freshness lifetime are stored, as nothing is
+// ever revalidated; once stale they're simply fetched again
+//
+// entries live in a sharded LRU, bodies of up to `max_memory_object_size`
+// bytes included
+// larger bodies, up to `max_object_size`, go to a file of `slab_capacity`
+// bytes mapped into memory when `slab_path` is set; it's written to as a ring
+// so the oldest of them make room for new ones
+// either way, bodies are handed out in place without being copied
+//
+// a cache with a `memory_capacity` of zero stores nothing
+//
+// response_cache is safe to use concurrently from multiple threads
+//
+struct response_cache {
+
+public:
+  using clock_type = std::chrono::system_clock;
+  using time_point = clock_type::time_point;
+
+  struct options {
+    std::size_t memory_capacity        = 0;
+    std::size_t max_memory_object_size = 64 * 1024;
+    std::size_t max_object_size        = 8 * 1024 * 1024;
+    std::string slab_path;
+    std::size_t slab_capacity          = 256 * 1024 * 1024;
+  };
+
+  struct stats_type {
+    std::uint64_t hits         = 0;
+    std::uint64_t misses       = 0;
+    std::uint64_t stores       = 0;
+    std::uint64_t evictions    = 0;
+    std::size_t   memory_bytes = 0;
+    std::size_t   slab_bytes   = 0;
+
+    auto hit_ratio() const noexcept -> double;
+  };
+
+private:
+  struct entry;
+  struct slab;
+
+public:
+  // cached_response is a stored response which stays put for as long as it's
+  // held, so its body can be written straight out of the cache
+  //
+  struct cached_response {
+
+  private:
+    std::shared_ptr<entry> e_;
+
+  public:
+    cached_response() = default;
+    cached_response(cached_response const&) = delete;
+    cached_response(cached_response&&) noexcept;
+
+    explicit
+    cached_response(std::shared_ptr<entry> e);
+
+    ~cached_response();
+
+    auto operator=(cached_response const&) -> cached_response& = delete;
+    auto operator=(cached_response&&) noexcept -> cached_response&;
+
+    explicit operator bool() const noexcept;
+
+    // the response's header, with framing described by a `Content-Length`
+    // and without an `Age`
+    //
+    auto header() const -> boost::beast::http::response_header<> const&;
+
+    auto body() const -> boost::asio::const_buffer;
+
+    // `age` is how old the response is by `now`, which is to be sent along
+    // with it in an `Age` field
+    //
+    auto age(time_point const now = clock_type::now()) const
+    -> std::chrono::seconds;
+  };
+
+private:
+  static constexpr std::size_t num_shards = 16;
+
+  using lru_type = std::list<std::shared_ptr<entry>>;
+
+  struct alignas(64) shard {
+    std::mutex  mtx;
+    lru_type    lru;
+    std::size_t bytes = 0;
+
+    std::unordered_map<std::string, std::vector<lru_type::iterator>> index;
+  };
+
+  options const            opts_;
+  std::unique_ptr<shard[]> shards_;
+  std::unique_ptr<slab>    slab_;
+
+  std::atomic<std::uint64_t> hits_;
+  std::atomic<std::uint64_t> misses_;
+  std::atomic<std::uint64_t> stores_;
+  std::atomic<std::uint64_t> evictions_;
+  std::atomic<std::size_t>   memory_bytes_;
+
+  auto shard_for(std::string_view const key) -> shard&;
+  auto erase(shard& s, lru_type::iterator const pos) -> void;
+
+public:
+  response_cache()                      = delete;
+  response_cache(response_cache const&) = delete;
+  response_cache(response_cache&&)      = delete;
+
+  // failing to set up the slab only leaves the cache without it, which is
+  // logged
+  //
+  explicit
+  response_cache(options const& opts);
+
+  ~response_cache();
+
+  auto enabled() const noexcept -> bool;
+
+  // the largest body worth keeping a copy of while it's relayed
+  //
+  auto max_object_size() const noexcept -> std::size_t;
+
+  // `lookup` finds a fresh response to a GET or HEAD `request` made to
+  // `authority`, returning an empty one when there's none or when `request`
+  // insists on going to the origin
+  //
+  auto lookup(
+    std::string_view const                      authority,
+    boost::beast::http::request_header<> const& request,
+    time_point const                            now = clock_type::now())
+  -> cached_response;
+
+  // `can_share` tells whether `request` may be answered with a response
+  // fetched for someone else
+  //
+  static auto can_share(boost::beast::http::request_header<> const& request)
+  -> bool;
+
+  // `can_share` tells whether `response` to `request` may be handed to anyone
+  // else, be it straight away or out of the cache later on
+  //
+  static auto can_share(
+    boost::beast::http::request_header<> const&  request,
+    boost::beast::http::response_header<> const& response) -> bool;
+
+  // `is_same_variant` tells whether `a` and `b` call for the same variant of
+  // `response`, going by its `Vary`
+  //
+  static auto is_same_variant(
+    boost::beast::http::response_header<> const& response,
+    boost::beast::http::request_header<> const&  a,
+    boost::beast::http::request_header<> const&  b) -> bool;
+
+  // `is_storable` tells whether `response` may be stored at all so that its
+  // body only needs to be kept while it's relayed if so
+  //
+  auto is_storable(
+    boost::beast::http::request_header<> const&  request,
+    boost::beast::http::response_header<> const& response) const -> bool;
+
+  // `store` keeps `response` with the body it came with, replacing the
+  // variant it's for, and reports whether it did
+  //
+  // `now` is when the response was received
+  //
+  auto store(
+    std::string_view const                       authority,
+    boost::beast::http::request_header<> const&  request,
+    boost::beast::http::response_header<> const& response,
+    std::string_view const                       body,
+    time_point const                             now = clock_type::now())
+  -> bool;
+
+  // `invalidate` drops every variant of `target` as an unsafe request to it
+  // went through (RFC 7234 section 4.4)
+  //
+  auto invalidate(
+    std::string_view const authority,
+    std::string_view const target) -> void;
+
+  auto stats() const -> stats_type;
+};
+
+} // foxy
+
+#endif // FOXY_RESPONSE_CACHE_HPP_
@@ -0,0 +1,142 @@
+#ifndef FOXY_RUNTIME_HPP_
+#define FOXY_RUNTIME_HPP_
+
+#include "foxy/multi_stream.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <optional>
+
+namespace foxy {
+
+namespace detail {
+struct buffer_pool;
+} // detail
+
+// runtime runs one `io_context` per thread, each thread pinned to a CPU of its
+// own, so that a connection is handled start to finish on one core and the
+// data it touches stays in that core's caches
+//
+// threads are spread over the CPUs the process is allowed to run on, in
+// order; asking for more threads than there are CPUs wraps around
+// every thread relays through a buffer pool of its own whose blocks are
+// allocated, and so first touched, by that thread once it's pinned, which has
+// the kernel place them on the thread's NUMA node
+//
+// the kernel can be asked to hand connections to whichever thread runs on the
+// CPU that received them, see `forward_proxy` and `adopt`
+//
+// pinning, and finding out where connections arrive, are only supported on
+// Linux; elsewhere the threads float and connections go round-robin
+//
+struct runtime {
+
+public:
+  struct options {
+    // zero means one thread per CPU the process may run on
+    //
+    std::size_t num_threads = 0;
+
+    bool pin_threads = true;
+
+    // the most each thread's buffer pool keeps cached
+    //
+    std::size_t max_cached_bytes = 16 * 1024 * 1024;
+  };
+
+private:
+  // every context is shut down before any of them is destroyed as whatever
+  // was left pending on one may hold onto objects bound to another
+  //
+  struct context_type : boost::asio::io_context {
+    context_type();
+
+    using boost::asio::io_context::shutdown;
+  };
+
+  struct worker {
+    using work_guard_type = boost::asio::executor_work_guard<
+      boost::asio::io_context::executor_type>;
+
+    context_type                   io;
+    std::optional<work_guard_type> work;
+    int const                      cpu;
+    std::atomic<int>               numa_node;
+    std::thread                    thread;
+
+    explicit
+    worker(int const cpu_);
+  };
+
+  options const opts_;
+
+  // the pools outlive the contexts, whose pending work may still be holding
+  // buffers drawn from them
+  //
+  std::vector<std::unique_ptr<detail::buffer_pool>> pools_;
+  std::vector<std::unique_ptr<worker>>              workers_;
+  std::vector<std::size_t>                          by_cpu_;
+  std::atomic<std::size_t>                          next_;
+
+  auto run_worker(std::size_t const idx) -> void;
+
+public:
+  runtime()               = delete;
+  runtime(runtime const&) = delete;
+  runtime(runtime&&)      = delete;
+
+  explicit
+  runtime(options const& opts);
+
+  // stops and joins the threads if that hasn't been done already
+  //
+  ~runtime();
+
+  // `run` starts the threads, which keep going until `stop` is called
+  //
+  auto run() -> void;
+  auto stop() -> void;
+  auto join() -> void;
+
+  auto size() const noexcept -> std::size_t;
+
+  auto context(std::size_t const idx) -> boost::asio::io_context&;
+
+  // the CPU the `idx`th thread is pinned to, or -1 if it isn't
+  //
+  auto cpu(std::size_t const idx) const noexcept -> int;
+
+  // the NUMA node the `idx`th thread runs on, or -1 until it's started or if
+  // that's not known
+  //
+  auto numa_node(std::size_t const idx) const noexcept -> int;
+
+  // `local_context` is the context of the calling thread if it's one of ours
+  // and the next one round-robin otherwise
+  //
+  auto local_context() -> boost::asio::io_context&;
+
+  // `context_for_cpu` is the context of the thread pinned to `cpu`, or the
+  // next one round-robin if there's none
+  //
+  auto context_for_cpu(int const cpu) -> boost::asio::io_context&;
+
+  // `adopt` moves an accepted connection over to the thread on the CPU that
+  // received it, which is where its packets will keep arriving, handing it
+  // back as a plaintext stream bound to that thread's context
+  //
+  // throws `boost::system::system_error` if the connection couldn't be moved
+  //
+  auto adopt(boost::asio::ip::tcp::socket socket) -> multi_stream;
+};
+
+} // foxy
+
+#endif // FOXY_RUNTIME_HPP_
@@ -1,7 +1,9 @@
 #ifndef FOXY_SERVER_SESSION_HPP_
 #define FOXY_SERVER_SESSION_HPP_
 
+#include "foxy/runtime.hpp"
 #include "foxy/coroutine.hpp"
+#include "foxy/byte_range.hpp"
 #include "foxy/multi_stream.hpp"
 #include "foxy/detail/session.hpp"
 
@@ -10,6 +12,7 @@
 #include <boost/asio/async_result.hpp>
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
 #include <boost/asio/steady_timer.hpp>
 
 #include <boost/asio/strand.hpp>
@@ -21,6 +24,10 @@
 
 #include <boost/beast/http/read.hpp>
 #include <boost/beast/http/write.hpp>
+#include <boost/beast/http/parser.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/file_body.hpp>
+#include <boost/beast/http/string_body.hpp>
 
 #include <boost/beast/core/flat_buffer.hpp>
 #include <boost/beast/core/bind_handler.hpp>
@@ -49,9 +56,87 @@ public:
   explicit
   server_session(multi_stream stream);
 
+  // `socket` is moved over to the runtime's thread on the CPU which received
+  // the connection, see `runtime::adopt`
+  //
+  server_session(runtime& rt, boost::asio::ip::tcp::socket socket);
+
   auto shutdown() -> void;
+
+  // `async_write_file` writes `response` with only the bytes of its file that
+  // lie within `range` as the body
+  //
+  // the `Content-Length` is set to the length of the range; the status and
+  // any `Content-Range` header are left to the caller, who will usually
+  // have gotten `range` from `parse_range`
+  // ranges which extend past the end of the file fail with
+  // `asio::error::invalid_argument` before anything is written
+  //
+  // unlike `async_write`, the body never passes through a buffer of ours and
+  // on plaintext connections never enters userspace at all
+  //
+  template <typename Fields, typename WriteHandler>
+  auto async_write_file(
+    boost::beast::http::response<boost::beast::http::file_body, Fields>&
+                   response,
+    byte_range     range,
+    WriteHandler&& write_handler
+  ) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    WriteHandler, void(boost::system::error_code));
+
+  // writes `response` along with the entirety of its file
+  //
+  template <typename Fields, typename WriteHandler>
+  auto async_write_file(
+    boost::beast::http::response<boost::beast::http::file_body, Fields>&
+                   response,
+    WriteHandler&& write_handler
+  ) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    WriteHandler, void(boost::system::error_code));
+
+  // `async_serve` answers every request on the connection with whatever
+  // `request_handler` returns for it, supporting pipelined clients
+  //
+  // `request_handler` is called on the session's strand with a
+  // `http::request<RequestBody>&` and returns a response, or a
+  // `foxy::awaitable` of one on `strand_type`, which is given to the handler
+  // to finish before the next request is looked at so responses are always in
+  // order
+  //
+  // requests which arrived along with earlier ones are parsed straight out of
+  // the session's buffer and small responses are queued rather than written;
+  // the queue is flushed when the next request has to be read off the socket
+  // or enough has built up, so a pipelining client gets its responses back in
+  // large batches
+  //
+  // completes once the client closes the connection or a response which ends
+  // it has been written, at which point the caller will usually `shutdown`
+  //
+  // clients which negotiated HTTP/2 through ALPN (see `enable_http2_alpn`),
+  // or which open a plaintext connection with its preface, are served over
+  // HTTP/2 instead; their requests are handled concurrently, each as soon as
+  // it has arrived in full, and responses go out in whatever order they're
+  // ready in
+  //
+  template <
+    typename RequestBody = boost::beast::http::string_body,
+    typename RequestHandler,
+    typename ServeHandler
+  >
+  auto async_serve(
+    RequestHandler&& request_handler,
+    ServeHandler&&   serve_handler
+  ) & -> BOOST_ASIO_INITFN_RESULT_TYPE(
+    ServeHandler, void(boost::system::error_code));
 };
 
+// `enable_http2_alpn` has TLS handshakes made with `ctx` settle on HTTP/2
+// whenever the client offers it
+//
+auto enable_http2_alpn(boost::asio::ssl::context& ctx) -> void;
+
 } // foxy
 
+#include "foxy/impl/server_session.impl.hpp"
+
 #endif // FOXY_SERVER_SESSION_HPP_
\ No newline at end of file
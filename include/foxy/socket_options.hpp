@@ -0,0 +1,124 @@
+#ifndef FOXY_SOCKET_OPTIONS_HPP_
+#define FOXY_SOCKET_OPTIONS_HPP_
+
+#include "foxy/multi_stream.hpp"
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <optional>
+
+namespace foxy {
+
+// socket_options are the knobs foxy turns on the sockets it listens, connects
+// and accepts with
+//
+// the defaults favor latency: Nagle's algorithm is off, so a small header
+// write followed by the body doesn't sit waiting on a delayed ACK from the
+// peer, and we ACK eagerly ourselves; everything else is left to the kernel
+//
+// options the platform doesn't support are skipped
+//
+struct socket_options {
+  // TCP_NODELAY
+  //
+  bool no_delay = true;
+
+  // TCP_QUICKACK, which the kernel may quietly drop back out of on its own,
+  // so it only really covers the start of a connection
+  //
+  bool quick_ack = true;
+
+  // SO_SNDBUF and SO_RCVBUF in bytes; setting either turns off the kernel's
+  // automatic sizing of that buffer, so zero leaves them alone
+  // the receive buffer is set before connecting or listening as it decides
+  // the window scale offered in the handshake
+  //
+  int send_buffer_size    = 0;
+  int receive_buffer_size = 0;
+
+  // TCP_NOTSENT_LOWAT in bytes, which keeps the amount of unsent data queued
+  // in the kernel small so that writes complete closer to when they're
+  // actually sent; zero leaves it alone
+  //
+  int not_sent_lowat = 0;
+
+  // SO_BUSY_POLL in microseconds, for which raising it above
+  // `net.core.busy_read` requires CAP_NET_ADMIN; zero leaves it alone
+  //
+  int busy_poll = 0;
+
+  // TCP Fast Open, letting a repeat client put its first write in the SYN
+  //
+  // on listeners, `fast_open_queue` is the number of pending fast open
+  // requests allowed and zero turns it off
+  // on outbound connects, `fast_open` uses TCP_FASTOPEN_CONNECT so that the
+  // connect completes at once and the SYN goes out with the first write
+  //
+  // both are off by default since data carried in a SYN can be replayed,
+  // which is only safe when that first write is idempotent, as with a TLS
+  // ClientHello; the `net.ipv4.tcp_fastopen` sysctl must allow it as well
+  //
+  bool fast_open       = false;
+  int  fast_open_queue = 0;
+
+  // plaintext writes of at least this many bytes are sent zero-copy; see
+  // `multi_stream::enable_zerocopy`
+  //
+  std::optional<std::size_t> zerocopy_threshold;
+};
+
+// `set_listen_options` applies the options which carry over from a listening
+// socket to the sockets it accepts, along with the fast open queue
+//
+// every option is attempted; `ec` holds the first failure
+//
+auto set_listen_options(
+  boost::asio::ip::tcp::acceptor& acceptor,
+  socket_options const&           opts,
+  boost::system::error_code&      ec) -> void;
+
+// `set_connect_options` applies the options which must be in place before an
+// open socket connects
+//
+auto set_connect_options(
+  boost::asio::ip::tcp::socket& socket,
+  socket_options const&         opts,
+  boost::system::error_code&    ec) -> void;
+
+// `set_stream_options` applies the options for a connected or accepted
+// stream
+//
+auto set_stream_options(
+  multi_stream&              stream,
+  socket_options const&      opts,
+  boost::system::error_code& ec) -> void;
+
+// `set_reuse_port` lets several listeners bind the same address, the kernel
+// picking one of them for every connection (SO_REUSEPORT); it has to be set
+// before binding
+//
+auto set_reuse_port(
+  boost::asio::ip::tcp::acceptor& acceptor,
+  boost::system::error_code&      ec) -> void;
+
+// `set_incoming_cpu` has connections received on `cpu` go to `acceptor` rather
+// than to the other listeners sharing its port (SO_INCOMING_CPU)
+//
+// this only pays off when the NIC's receive queues, or RPS, are steered to the
+// same CPUs as the threads accepting
+//
+auto set_incoming_cpu(
+  boost::asio::ip::tcp::acceptor& acceptor,
+  int const                       cpu,
+  boost::system::error_code&      ec) -> void;
+
+// `incoming_cpu` is the CPU that received `socket`'s packets last, or -1 if
+// that isn't known
+//
+auto incoming_cpu(boost::asio::ip::tcp::socket& socket) -> int;
+
+} // foxy
+
+#endif // FOXY_SOCKET_OPTIONS_HPP_
@@ -1,6 +1,8 @@
 #ifndef FOXY_TYPE_TRAITS_HPP_
 #define FOXY_TYPE_TRAITS_HPP_
 
+#include "foxy/coroutine.hpp"
+
 #include <boost/asio/strand.hpp>
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/http/serializer.hpp>
@@ -53,6 +55,18 @@ template <typename T>
 inline constexpr
 bool is_serializer_v = is_serializer<T>::value;
 
+// is_awaitable
+//
+template <typename T>
+struct is_awaitable : std::false_type {};
+
+template <typename T, typename Executor>
+struct is_awaitable<foxy::awaitable<T, Executor>> : std::true_type {};
+
+template <typename T>
+inline constexpr
+bool is_awaitable_v = is_awaitable<T>::value;
+
 } // foxy
 
 #endif // FOXY_TYPE_TRAITS_HPP_
\ No newline at end of file
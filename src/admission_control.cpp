@@ -0,0 +1,293 @@
+#include "foxy/admission_control.hpp"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <boost/core/ignore_unused.hpp>
+
+#include <thread>
+
+namespace asio = boost::asio;
+
+using boost::system::error_code;
+using boost::ignore_unused;
+
+// a waiter is shared between the coroutine parked in the queue and whichever
+// thread ends up granting it a slot
+//
+// whoever moves `state` away from `waiting` first decides the outcome: either a
+// releasing connection hands over its slot or the waiter withdraws itself, and
+// either way it's the one that gives up the waiter's place in `pending_`
+//
+// an entry which withdrew stays in the queue until someone pops it, but is
+// skipped over without being counted again
+//
+// the timer is only ever touched on the waiter's own strand, so that a grant
+// from another thread can't cancel it while it's being armed
+//
+struct foxy::admission_control::waiter
+: std::enable_shared_from_this<waiter> {
+
+  enum : int { waiting, granted, withdrawn };
+
+  asio::strand<asio::executor> strand;
+  asio::steady_timer           timer;
+  std::atomic<int>             state;
+  std::atomic<bool>            cancelled;
+
+  explicit
+  waiter(asio::io_context& io)
+  : strand(io.get_executor())
+  , timer(io)
+  , state(waiting)
+  , cancelled(false)
+  {
+  }
+
+  auto transition(int const to) -> bool {
+    auto expected = static_cast<int>(waiting);
+    return state.compare_exchange_strong(expected, to);
+  }
+
+  // async_wait completes once the waiter is granted a slot, is cancelled or
+  // `timeout` has passed, whichever comes first
+  //
+  template <typename WaitHandler>
+  auto async_wait(
+    std::chrono::steady_clock::duration const timeout,
+    WaitHandler&&                             handler)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(WaitHandler, void(error_code)) {
+
+    asio::async_completion<WaitHandler, void(error_code)> init(handler);
+
+    asio::dispatch(
+      strand,
+      [self    = shared_from_this(),
+       timeout,
+       handler = std::move(init.completion_handler)]() mutable {
+        self->timer.expires_after(timeout);
+        self->timer.async_wait(std::move(handler));
+
+        // a grant or cancellation which came in before the wait was armed
+        // had nothing to cancel yet
+        //
+        if (self->state.load() != waiting || self->cancelled) {
+          self->timer.cancel();
+        }
+      });
+
+    return init.result.get();
+  }
+
+  auto wake() -> void {
+    asio::post(strand, [self = shared_from_this()] { self->timer.cancel(); });
+  }
+};
+
+foxy::admission_control::admission_control(options const& opts)
+: opts_(opts)
+, active_(0)
+, pending_(0)
+, upstream_(0)
+, admitted_(0)
+, queued_(0)
+, rejected_(0)
+, timed_out_(0)
+, upstream_rejected_(0)
+, waiters_(opts.max_pending_connections)
+{
+}
+
+auto foxy::admission_control::try_acquire_slot() -> bool {
+  auto n = active_.load();
+  while (n < opts_.max_connections) {
+    if (active_.compare_exchange_weak(n, n + 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto foxy::admission_control::async_admit(
+  asio::io_context&       io,
+  foxy::cancellation_slot slot) -> awaitable<bool> {
+
+  if (try_acquire_slot()) {
+    admitted_.fetch_add(1, std::memory_order_relaxed);
+    co_return true;
+  }
+
+  if (pending_.fetch_add(1) >= opts_.max_pending_connections) {
+    pending_.fetch_sub(1);
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    co_return false;
+  }
+
+  auto w = std::make_shared<waiter>(io);
+
+  auto const queued = enqueue(w);
+
+  // nobody else has seen a waiter which didn't make it into the queue so it
+  // can't have been granted anything; it stops counting as pending before
+  // anyone's woken, as `wake_waiters` keeps at it for as long as there are
+  // waiters pending
+  //
+  if (!queued) {
+    ignore_unused(w->transition(waiter::withdrawn));
+    pending_.fetch_sub(1);
+  }
+
+  // a slot may have been freed between our first attempt and us joining the
+  // queue, or while `enqueue` had other waiters out of it, in which case
+  // nobody else is going to hand it out
+  //
+  wake_waiters();
+
+  if (!queued) {
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    co_return false;
+  }
+
+  queued_.fetch_add(1, std::memory_order_relaxed);
+
+  auto token = co_await this_coro::token();
+  auto ec    = error_code();
+
+  // cancelling cuts the wait short the same way a grant does, leaving the
+  // waiter to withdraw below
+  //
+  slot.assign([w] {
+    w->cancelled = true;
+    w->wake();
+  });
+
+  co_await w->async_wait(opts_.max_pending_time, redirect_error(token, ec));
+
+  slot.clear();
+
+  if (w->transition(waiter::withdrawn)) {
+    pending_.fetch_sub(1);
+    if (!w->cancelled) {
+      timed_out_.fetch_add(1, std::memory_order_relaxed);
+    }
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    co_return false;
+  }
+
+  if (w->state.load() == waiter::withdrawn) {
+    // `enqueue` had to turn us away to make room
+    //
+    rejected_.fetch_add(1, std::memory_order_relaxed);
+    co_return false;
+  }
+
+  admitted_.fetch_add(1, std::memory_order_relaxed);
+  co_return true;
+}
+
+auto foxy::admission_control::enqueue(std::shared_ptr<waiter> const& w)
+-> bool {
+  // the queue holds at most `max_pending_connections` live waiters, so if it's
+  // full then some of its entries withdrew and can be cleared out
+  //
+  // live entries popped along the way go back in at the tail, and one which
+  // can't be put back is turned away
+  //
+  for (auto n = std::size_t{0}; n <= waiters_.capacity(); ++n) {
+    if (waiters_.try_push(w)) { return true; }
+
+    auto head = waiters_.try_pop();
+    if (!head) { continue; }
+
+    auto& p = *head;
+    if (p->state.load() != waiter::waiting || waiters_.try_push(p)) {
+      continue;
+    }
+
+    if (p->transition(waiter::withdrawn)) {
+      pending_.fetch_sub(1);
+      p->wake();
+    }
+  }
+
+  return false;
+}
+
+auto foxy::admission_control::leave() -> void {
+  active_.fetch_sub(1);
+  wake_waiters();
+}
+
+auto foxy::admission_control::wake_waiters() -> void {
+  while (pending_.load() > 0) {
+    if (!try_acquire_slot()) {
+      // whoever beat us to the slot will wake the queue when they leave
+      //
+      return;
+    }
+
+    auto granted = false;
+    while (auto w = waiters_.try_pop()) {
+      auto& p = *w;
+      if (p->transition(waiter::granted)) {
+        pending_.fetch_sub(1);
+        p->wake();
+        granted = true;
+        break;
+      }
+
+      // the waiter already gave up and was counted out of `pending_` when it
+      // did, try the next one
+      //
+    }
+
+    if (granted) { return; }
+
+    // a waiter has reserved its place but not yet pushed itself, or one which
+    // is withdrawing hasn't yet been counted out
+    //
+    // give the slot back and let the other thread get on with it, the waiter
+    // wakes the queue itself once it's pushed
+    //
+    active_.fetch_sub(1);
+    std::this_thread::yield();
+  }
+}
+
+auto foxy::admission_control::try_acquire_upstream() -> bool {
+  auto n = upstream_.load();
+  while (n < opts_.max_upstream_connects) {
+    if (upstream_.compare_exchange_weak(n, n + 1)) {
+      return true;
+    }
+  }
+
+  upstream_rejected_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+auto foxy::admission_control::release_upstream() -> void {
+  upstream_.fetch_sub(1);
+}
+
+auto foxy::admission_control::stats() const -> stats_type {
+  auto s = stats_type();
+
+  s.active_connections       = active_.load(std::memory_order_relaxed);
+  s.pending_connections      = pending_.load(std::memory_order_relaxed);
+  s.active_upstream_connects = upstream_.load(std::memory_order_relaxed);
+  s.admitted                 = admitted_.load(std::memory_order_relaxed);
+  s.queued                   = queued_.load(std::memory_order_relaxed);
+  s.rejected                 = rejected_.load(std::memory_order_relaxed);
+  s.timed_out                = timed_out_.load(std::memory_order_relaxed);
+  s.upstream_rejected        =
+    upstream_rejected_.load(std::memory_order_relaxed);
+
+  return s;
+}
@@ -0,0 +1,172 @@
+#include "foxy/detail/buffer_pool.hpp"
+
+#include <new>
+#include <utility>
+#include <algorithm>
+
+namespace {
+
+auto size_class_index(std::size_t const size) -> std::size_t {
+  using foxy::detail::buffer_pool;
+
+  auto idx        = std::size_t{0};
+  auto block_size = buffer_pool::min_block_size;
+
+  while (block_size < size && idx + 1 < buffer_pool::num_size_classes) {
+    block_size <<= 1;
+    ++idx;
+  }
+
+  return idx;
+}
+
+auto size_class_size(std::size_t const idx) -> std::size_t {
+  return foxy::detail::buffer_pool::min_block_size << idx;
+}
+
+thread_local foxy::detail::buffer_pool* local_pool = nullptr;
+
+} // anonymous
+
+static_assert(
+  (foxy::detail::buffer_pool::min_block_size
+    << (foxy::detail::buffer_pool::num_size_classes - 1)) ==
+  foxy::detail::buffer_pool::max_block_size,
+  "size classes must span exactly [min_block_size, max_block_size]");
+
+foxy::detail::buffer_pool::buffer_pool(std::size_t const max_cached_bytes)
+: max_cached_bytes_(max_cached_bytes)
+, cached_bytes_(0)
+{
+}
+
+foxy::detail::buffer_pool::~buffer_pool() {
+  for (auto& sc : classes_) {
+    for (auto* p : sc.blocks) {
+      ::operator delete(p);
+    }
+  }
+}
+
+auto foxy::detail::buffer_pool::acquire(std::size_t const size) -> block {
+  auto const idx        = size_class_index(size);
+  auto const block_size = size_class_size(idx);
+
+  auto& sc = classes_[idx];
+  {
+    auto lock = std::lock_guard<std::mutex>(sc.mtx);
+    if (!sc.blocks.empty()) {
+      auto* p = sc.blocks.back();
+      sc.blocks.pop_back();
+      cached_bytes_.fetch_sub(block_size, std::memory_order_relaxed);
+      return block{p, block_size};
+    }
+  }
+
+  return block{static_cast<char*>(::operator new(block_size)), block_size};
+}
+
+auto foxy::detail::buffer_pool::release(block const b) -> void {
+  if (!b.data) { return; }
+
+  // reserve room in the cache before taking the lock so that a burst of
+  // releases can't overshoot `max_cached_bytes_`
+  //
+  auto const prev = cached_bytes_.fetch_add(b.size, std::memory_order_relaxed);
+  if (prev + b.size > max_cached_bytes_) {
+    cached_bytes_.fetch_sub(b.size, std::memory_order_relaxed);
+    ::operator delete(b.data);
+    return;
+  }
+
+  auto& sc   = classes_[size_class_index(b.size)];
+  auto  lock = std::lock_guard<std::mutex>(sc.mtx);
+  sc.blocks.push_back(b.data);
+}
+
+auto foxy::detail::buffer_pool::cached_bytes() const noexcept -> std::size_t {
+  return cached_bytes_.load(std::memory_order_relaxed);
+}
+
+auto foxy::detail::buffer_pool::global() -> buffer_pool& {
+  // enough to keep 256 max-sized blocks warm
+  //
+  static buffer_pool pool(64 * 1024 * 1024);
+  return pool;
+}
+
+auto foxy::detail::buffer_pool::local() -> buffer_pool& {
+  return local_pool ? *local_pool : global();
+}
+
+auto foxy::detail::buffer_pool::set_local(buffer_pool* pool) -> void {
+  local_pool = pool;
+}
+
+foxy::detail::adaptive_buffer::adaptive_buffer()
+: adaptive_buffer(buffer_pool::local())
+{
+}
+
+foxy::detail::adaptive_buffer::adaptive_buffer(buffer_pool& pool)
+: pool_(std::addressof(pool))
+, block_()
+, target_size_(buffer_pool::min_block_size)
+, underfilled_(0)
+{
+}
+
+foxy::detail::adaptive_buffer::adaptive_buffer(
+  adaptive_buffer&& other) noexcept
+: pool_(other.pool_)
+, block_(std::exchange(other.block_, buffer_pool::block()))
+, target_size_(other.target_size_)
+, underfilled_(other.underfilled_)
+{
+}
+
+foxy::detail::adaptive_buffer::~adaptive_buffer() {
+  release();
+}
+
+auto foxy::detail::adaptive_buffer::prepare() -> boost::asio::mutable_buffer {
+  if (block_.size != target_size_) {
+    release();
+    block_ = pool_->acquire(target_size_);
+  }
+
+  return boost::asio::mutable_buffer(block_.data, block_.size);
+}
+
+auto foxy::detail::adaptive_buffer::commit(std::size_t const bytes_used)
+-> void {
+  if (bytes_used >= block_.size) {
+    target_size_ = std::min(block_.size * 2, buffer_pool::max_block_size);
+    underfilled_ = 0;
+    return;
+  }
+
+  if (bytes_used > block_.size / 4) {
+    underfilled_ = 0;
+    return;
+  }
+
+  if (++underfilled_ >= shrink_after) {
+    target_size_ = std::max(block_.size / 2, buffer_pool::min_block_size);
+    underfilled_ = 0;
+  }
+}
+
+auto foxy::detail::adaptive_buffer::release() -> void {
+  if (block_.data) {
+    pool_->release(std::exchange(block_, buffer_pool::block()));
+  }
+}
+
+auto foxy::detail::adaptive_buffer::data() const noexcept -> char* {
+  return block_.data;
+}
+
+auto foxy::detail::adaptive_buffer::size() const noexcept -> std::size_t {
+  return block_.size;
+}
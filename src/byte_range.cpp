@@ -0,0 +1,96 @@
+#include "foxy/byte_range.hpp"
+
+#include <limits>
+#include <optional>
+#include <algorithm>
+
+namespace {
+
+auto trim(std::string_view s) -> std::string_view {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+auto parse_uint(std::string_view const s) -> std::optional<std::uint64_t> {
+  if (s.empty()) { return std::nullopt; }
+
+  constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+
+  auto value = std::uint64_t{0};
+  for (auto const c : s) {
+    if (c < '0' || c > '9') { return std::nullopt; }
+
+    auto const digit = static_cast<std::uint64_t>(c - '0');
+    if (value > (max - digit) / 10) { return std::nullopt; }
+
+    value = value * 10 + digit;
+  }
+
+  return value;
+}
+
+} // anonymous
+
+auto foxy::parse_range(
+  std::string_view const value,
+  std::uint64_t const    size,
+  byte_range&            range) -> range_status {
+
+  constexpr auto unit = std::string_view("bytes=");
+
+  auto spec = trim(value);
+  if (spec.substr(0, unit.size()) != unit) { return range_status::ignored; }
+
+  spec = trim(spec.substr(unit.size()));
+  if (spec.find(',') != std::string_view::npos) {
+    return range_status::ignored;
+  }
+
+  auto const dash = spec.find('-');
+  if (dash == std::string_view::npos) { return range_status::ignored; }
+
+  auto const first_str = trim(spec.substr(0, dash));
+  auto const last_str  = trim(spec.substr(dash + 1));
+
+  if (first_str.empty()) {
+    auto const suffix = parse_uint(last_str);
+    if (!suffix) { return range_status::ignored; }
+    if (*suffix == 0 || size == 0) { return range_status::unsatisfiable; }
+
+    auto const length = std::min(*suffix, size);
+    range = byte_range{size - length, length};
+    return range_status::satisfiable;
+  }
+
+  auto const first = parse_uint(first_str);
+  if (!first) { return range_status::ignored; }
+
+  auto last = size > 0 ? size - 1 : 0;
+  if (!last_str.empty()) {
+    auto const parsed = parse_uint(last_str);
+    if (!parsed || *parsed < *first) { return range_status::ignored; }
+    last = std::min(*parsed, last);
+  }
+
+  if (*first >= size) { return range_status::unsatisfiable; }
+
+  range = byte_range{*first, last - *first + 1};
+  return range_status::satisfiable;
+}
+
+auto foxy::content_range(byte_range const range, std::uint64_t const size)
+-> std::string {
+  return
+    "bytes " + std::to_string(range.offset) + "-" +
+    std::to_string(range.offset + range.length - 1) + "/" +
+    std::to_string(size);
+}
+
+auto foxy::unsatisfied_range(std::uint64_t const size) -> std::string {
+  return "bytes */" + std::to_string(size);
+}
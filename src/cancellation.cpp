@@ -0,0 +1,35 @@
+#include "foxy/cancellation.hpp"
+
+// the handler is called with the lock held so that an operation which clears
+// its slot on completing can't have it run any later than that
+//
+auto foxy::cancellation_signal::emit() -> void {
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  if (handler_) { handler_(); }
+}
+
+auto foxy::cancellation_signal::slot() noexcept -> cancellation_slot {
+  return cancellation_slot(*this);
+}
+
+foxy::cancellation_slot::cancellation_slot() noexcept
+: signal_(nullptr)
+{
+}
+
+foxy::cancellation_slot::cancellation_slot(
+  cancellation_signal& signal) noexcept
+: signal_(std::addressof(signal))
+{
+}
+
+auto foxy::cancellation_slot::is_connected() const noexcept -> bool {
+  return signal_ != nullptr;
+}
+
+auto foxy::cancellation_slot::clear() -> void {
+  if (!signal_) { return; }
+
+  auto lock = std::lock_guard<std::mutex>(signal_->mtx_);
+  signal_->handler_ = nullptr;
+}
@@ -0,0 +1,171 @@
+#include "foxy/circuit_breaker.hpp"
+
+#include <functional>
+
+foxy::circuit_breaker::circuit_breaker(options const& opts)
+: opts_(opts)
+, shards_(new shard[num_shards])
+, allowed_(0)
+, rejected_busy_(0)
+, rejected_open_(0)
+, trips_(0)
+{
+}
+
+auto foxy::circuit_breaker::shard_for(std::string_view const host) -> shard& {
+  return shards_[std::hash<std::string_view>()(host) % num_shards];
+}
+
+auto foxy::circuit_breaker::prune(shard& s) -> void {
+  // hosts which are healthy and idle carry no information worth keeping
+  //
+  for (auto it = s.hosts.begin(); it != s.hosts.end();) {
+    auto const& h = it->second;
+    if (h.current == state::closed && h.in_flight == 0) {
+      it = s.hosts.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+auto foxy::circuit_breaker::trip(host_state& h, time_point const now) -> void {
+  h.current    = state::open;
+  h.open_until = now + opts_.open_duration;
+  h.successes  = 0;
+  h.failures   = 0;
+
+  trips_.fetch_add(1, std::memory_order_relaxed);
+}
+
+auto foxy::circuit_breaker::try_acquire(
+  std::string_view const host,
+  time_point const       now) -> verdict {
+
+  auto& s    = shard_for(host);
+  auto  lock = std::lock_guard<std::mutex>(s.mtx);
+
+  auto it = s.hosts.find(std::string(host));
+  if (it == s.hosts.end()) {
+    if (s.hosts.size() >= opts_.max_hosts_per_shard) {
+      prune(s);
+    }
+
+    it = s.hosts.emplace(std::string(host), host_state()).first;
+    it->second.window_start = now;
+  }
+
+  auto& h = it->second;
+
+  if (h.current == state::open) {
+    if (now < h.open_until) {
+      rejected_open_.fetch_add(1, std::memory_order_relaxed);
+      return verdict::open;
+    }
+    h.current = state::half_open;
+  }
+
+  if (h.current == state::half_open) {
+    if (h.in_flight >= opts_.half_open_probes) {
+      rejected_open_.fetch_add(1, std::memory_order_relaxed);
+      return verdict::open;
+    }
+  } else if (h.in_flight >= opts_.max_connects_per_host) {
+    rejected_busy_.fetch_add(1, std::memory_order_relaxed);
+    return verdict::busy;
+  }
+
+  ++h.in_flight;
+  allowed_.fetch_add(1, std::memory_order_relaxed);
+  return verdict::allow;
+}
+
+auto foxy::circuit_breaker::release(
+  std::string_view const host,
+  bool const             success,
+  time_point const       now) -> void {
+
+  auto& s    = shard_for(host);
+  auto  lock = std::lock_guard<std::mutex>(s.mtx);
+
+  auto it = s.hosts.find(std::string(host));
+  if (it == s.hosts.end()) { return; }
+
+  auto& h = it->second;
+  --h.in_flight;
+
+  switch (h.current) {
+    case state::half_open:
+      if (success) {
+        h.current      = state::closed;
+        h.successes    = 0;
+        h.failures     = 0;
+        h.window_start = now;
+      } else {
+        trip(h, now);
+      }
+      return;
+
+    case state::open:
+      // this attempt started before the breaker tripped, its outcome is no
+      // longer interesting
+      //
+      return;
+
+    case state::closed:
+      break;
+  }
+
+  if (now - h.window_start > opts_.failure_window) {
+    h.successes    = 0;
+    h.failures     = 0;
+    h.window_start = now;
+  }
+
+  if (success) {
+    ++h.successes;
+    return;
+  }
+
+  ++h.failures;
+
+  auto const total = h.successes + h.failures;
+  if (
+    total >= opts_.min_requests &&
+    static_cast<double>(h.failures) >= opts_.failure_ratio * total) {
+    trip(h, now);
+  }
+}
+
+auto foxy::circuit_breaker::abandon(std::string_view const host) -> void {
+  auto& s    = shard_for(host);
+  auto  lock = std::lock_guard<std::mutex>(s.mtx);
+
+  auto it = s.hosts.find(std::string(host));
+  if (it == s.hosts.end()) { return; }
+
+  // a half-open breaker simply lets the next probe through in this one's place
+  //
+  --it->second.in_flight;
+}
+
+auto foxy::circuit_breaker::state_of(std::string_view const host) -> state {
+  auto& s    = shard_for(host);
+  auto  lock = std::lock_guard<std::mutex>(s.mtx);
+
+  auto it = s.hosts.find(std::string(host));
+  if (it == s.hosts.end()) { return state::closed; }
+
+  return it->second.current;
+}
+
+auto foxy::circuit_breaker::stats() const -> stats_type {
+  auto s = stats_type();
+
+  s.allowed       = allowed_.load(std::memory_order_relaxed);
+  s.rejected_busy = rejected_busy_.load(std::memory_order_relaxed);
+  s.rejected_open = rejected_open_.load(std::memory_order_relaxed);
+  s.trips         = trips_.load(std::memory_order_relaxed);
+
+  return s;
+}
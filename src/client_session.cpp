@@ -1,4 +1,5 @@
 #include "foxy/client_session.hpp"
+#include "foxy/detail/h2_connection.hpp"
 
 // foxy::client_session::session_state::session_state(boost::asio::io_context& io)
 // : timer(io)
@@ -26,7 +27,36 @@ foxy::client_session::client_session(
 {
 }
 
+foxy::client_session::client_session(runtime& rt)
+: client_session(rt.local_context())
+{
+}
+
+foxy::client_session::client_session(
+  runtime&                   rt,
+  boost::asio::ssl::context& ctx)
+: client_session(rt.local_context(), ctx)
+{
+}
+
+auto foxy::client_session::enable_http2() -> void {
+  s_->offer_http2 = true;
+}
+
+auto foxy::client_session::is_http2() const -> bool {
+  return s_->h2 != nullptr;
+}
+
 auto foxy::client_session::shutdown(boost::system::error_code& ec) -> void {
+  // the GOAWAY has to go out ahead of the shutdown so it's left to the
+  // connection's writer
+  //
+  if (auto h2 = s_->h2) {
+    ec = {};
+    boost::asio::post(h2->get_strand(), [h2] { h2->close(); });
+    return;
+  }
+
   auto& multi_stream = s_->stream;
 
   multi_stream
@@ -0,0 +1,238 @@
+#include "foxy/detail/collapser.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace http = boost::beast::http;
+
+foxy::detail::collapsed_response::collapsed_response(
+  std::string                   key,
+  http::request_header<> const& request)
+: key_(std::move(key))
+, request_(request)
+, status_(status::pending)
+, joinable_(true)
+, followers_(nullptr)
+, tail_(&head_)
+, decided_(false)
+, keeping_(false)
+, kept_(0)
+, retain_limit_(0)
+{
+}
+
+foxy::detail::collapsed_response::~collapsed_response() {
+  auto* f = followers_.load();
+  while (f) {
+    delete std::exchange(f, f->next);
+  }
+}
+
+auto foxy::detail::collapsed_response::key() const noexcept
+-> std::string const& {
+  return key_;
+}
+
+auto foxy::detail::collapsed_response::request() const noexcept
+-> http::request_header<> const& {
+  return request_;
+}
+
+auto foxy::detail::collapsed_response::get_status() const noexcept
+-> status {
+  return status_.load();
+}
+
+auto foxy::detail::collapsed_response::joinable() const noexcept -> bool {
+  return joinable_.load();
+}
+
+auto foxy::detail::collapsed_response::header() const noexcept
+-> http::response_header<> const& {
+  return header_;
+}
+
+auto foxy::detail::collapsed_response::first() const noexcept
+-> chunk const* {
+  return head_.next.load();
+}
+
+auto foxy::detail::collapsed_response::next(chunk const* c) const noexcept
+-> chunk const* {
+  return c->next.load();
+}
+
+// the leader's stores and the followers' loads are all sequentially consistent
+// as a follower going back to idle and then looking for news must not miss a
+// change the leader makes just as it looks for followers to resume
+//
+auto foxy::detail::collapsed_response::set_status(status const s) -> void {
+  status_.store(s);
+  notify();
+}
+
+auto foxy::detail::collapsed_response::notify() -> void {
+  // followers which aren't parked right now find out for themselves, the
+  // next time they try
+  //
+  for (auto* f = followers_.load(); f; f = f->next) {
+    if (f->state.exchange(follower::notified) == follower::parked) {
+      std::exchange(f->handler, nullptr)->resume();
+    }
+  }
+}
+
+auto foxy::detail::collapsed_response::publish_header(
+  http::response_header<> const& header,
+  bool const                     shared,
+  std::size_t const              retain_limit) -> void {
+
+  if (!shared) {
+    set_status(status::unshared);
+    return;
+  }
+
+  header_       = header;
+  retain_limit_ = retain_limit;
+  set_status(status::streaming);
+}
+
+// closing the response and then looking for followers, while followers link
+// themselves in and then check whether it's closed, means that any follower
+// which got in is seen here
+//
+auto foxy::detail::collapsed_response::close() -> void {
+  joinable_.store(false);
+}
+
+auto foxy::detail::collapsed_response::publish(
+  void const*       data,
+  std::size_t const size) -> void {
+
+  if (size == 0) { return; }
+
+  // copying the body on the off chance somebody turns up for it isn't worth
+  // it, so a response nobody is following by now takes on nobody else
+  //
+  if (!decided_) {
+    decided_ = true;
+    keeping_ = followers_.load() != nullptr;
+    if (!keeping_) {
+      close();
+      keeping_ = followers_.load() != nullptr;
+    }
+  }
+
+  if (!keeping_) { return; }
+
+  auto c = std::make_unique<chunk>();
+  c->data.assign(static_cast<char const*>(data), size);
+  c->index = tail_->index + (tail_ == &head_ ? 0 : 1);
+
+  auto* const p = c.get();
+  chunks_.push_back(std::move(c));
+
+  tail_->next.store(p);
+  tail_ = p;
+
+  kept_ += size;
+  if (kept_ > retain_limit_ && joinable_.load()) { close(); }
+  if (!joinable_.load()) { release(); }
+
+  notify();
+}
+
+// release drops the chunks every follower has moved past, which is only safe
+// once nobody new can start reading from the first one
+//
+// the last chunk is always kept as the next one gets linked in after it
+//
+auto foxy::detail::collapsed_response::release() -> void {
+  auto earliest = follower::gone;
+  for (auto* f = followers_.load(); f; f = f->next) {
+    earliest = std::min(earliest, f->position.load());
+  }
+
+  if (earliest == follower::gone) {
+    // everyone who was following is done with the response
+    //
+    keeping_ = false;
+  }
+
+  while (chunks_.size() > 1 && chunks_.front()->index < earliest) {
+    kept_ -= chunks_.front()->data.size();
+    chunks_.pop_front();
+  }
+}
+
+auto foxy::detail::collapsed_response::finish() -> void {
+  set_status(status::done);
+}
+
+auto foxy::detail::collapsed_response::fail() -> void {
+  set_status(status::failed);
+}
+
+auto foxy::detail::collapsed_response::retained() const noexcept
+-> std::size_t {
+  return kept_;
+}
+
+auto foxy::detail::collapsed_response::add_follower() -> follower& {
+  auto* const f = new follower();
+
+  auto* head = followers_.load();
+  do {
+    f->next = head;
+  } while (!followers_.compare_exchange_weak(head, f));
+
+  return *f;
+}
+
+foxy::detail::collapser::collapser()
+: shards_(new shard[num_shards])
+{
+}
+
+auto foxy::detail::collapser::shard_for(std::string_view const key)
+-> shard& {
+  return shards_[std::hash<std::string_view>()(key) % num_shards];
+}
+
+auto foxy::detail::collapser::join(
+  std::string const&            key,
+  http::request_header<> const& request,
+  bool&                         is_leader)
+-> std::shared_ptr<collapsed_response> {
+
+  auto& s    = shard_for(key);
+  auto  lock = std::lock_guard<std::mutex>(s.mtx);
+
+  auto& response = s.in_flight[key];
+
+  // a response which turned out not to be shareable, or whose leader failed,
+  // is of no use to anyone arriving now
+  //
+  auto const is_usable =
+    response && response->joinable() &&
+    (response->get_status() == collapsed_response::status::pending ||
+     response->get_status() == collapsed_response::status::streaming);
+
+  is_leader = !is_usable;
+  if (is_leader) {
+    response = std::make_shared<collapsed_response>(key, request);
+  }
+
+  return response;
+}
+
+auto foxy::detail::collapser::leave(collapsed_response const& response)
+-> void {
+  auto& s    = shard_for(response.key());
+  auto  lock = std::lock_guard<std::mutex>(s.mtx);
+
+  auto const it = s.in_flight.find(response.key());
+  if (it != s.in_flight.end() && it->second.get() == &response) {
+    s.in_flight.erase(it);
+  }
+}
@@ -7,15 +7,30 @@
 #include <boost/spirit/home/x3.hpp>
 #include <boost/fusion/container/vector.hpp>
 
-#include <array>
+#if !defined(BOOST_ASIO_WINDOWS)
+#include <unistd.h>
+#endif
+
+#include <mutex>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <utility>
 #include <iostream>
+#include <string_view>
 
 #include "foxy/log.hpp"
+#include "foxy/handoff.hpp"
 #include "foxy/coroutine.hpp"
 #include "foxy/partition.hpp"
+#include "foxy/cancellation.hpp"
 #include "foxy/server_session.hpp"
 #include "foxy/client_session.hpp"
+#include "foxy/detail/collapser.hpp"
+#include "foxy/detail/buffer_pool.hpp"
+#include "foxy/detail/session_metrics.hpp"
 
 namespace x3     = boost::spirit::x3;
 namespace asio   = boost::asio;
@@ -28,6 +43,8 @@ using boost::ignore_unused;
 
 namespace {
 
+using live_session = foxy::detail::forward_proxy_state::live_session;
+
 // TODO: enforce finite message lengths because we so heavily rely on
 // persistence in the case of our proxy and messages are only considered
 // finite via Content-Length and Transfer-Encoding: chunked otherwise
@@ -35,20 +52,40 @@ namespace {
 //
 
 auto init(
-  foxy::server_session& server_session,
-  foxy::client_session& client_session,
-  error_code&           ec)-> foxy::awaitable<void> {
+  foxy::server_session&              server_session,
+  foxy::client_session&              client_session,
+  foxy::detail::forward_proxy_state& s,
+  live_session&                      live,
+  std::string&                       authority,
+  error_code&                        ec)-> foxy::awaitable<void> {
 
   auto token       = co_await foxy::this_coro::token();
-  auto error_token = foxy::redirect_error(token, ec);
+  auto error_token = foxy::bind_cancellation_slot(
+    live.signal.slot(), foxy::redirect_error(token, ec));
 
   while (true) {
+    // once the proxy starts draining, connections are closed as soon as the
+    // exchange they were in the middle of is over, which covers those which
+    // were only just admitted
+    //
+    // a session waiting on its client's next request, its first included,
+    // counts as idle, which it says before it checks so that draining either
+    // stops it here or finds it waiting and interrupts it
+    //
+    live.idle = true;
+    if (s.draining) {
+      ec = asio::error::operation_aborted;
+      break;
+    }
+
     http::request_parser<http::empty_body>
     parser;
 
     ignore_unused(
       co_await server_session.async_read(parser, error_token));
 
+    live.idle = false;
+
     if (ec) {
       break;
     }
@@ -105,9 +142,62 @@ auto init(
       +(x3::char_ - ":") >> -(":" >> +x3::digit),
       host_and_port);
 
+    // outbound connects to slow or unreachable hosts can pile up quickly so we
+    // turn the client away instead of queueing yet another one
+    //
+    if (!s.admission.try_acquire_upstream()) {
+      auto response = http::response<http::string_body>(
+        http::status::service_unavailable, 11,
+        "Too many outbound connections in progress\n\n");
+
+      response.prepare_payload();
+
+      ignore_unused(
+        co_await server_session.async_write(response, error_token));
+
+      continue;
+    }
+
+    // a single slow or failing remote host shouldn't be able to tie up the
+    // rest of the proxy so every host gets its own limit and circuit breaker
+    //
+    auto const upstream_key = host + ":" + port;
+
+    auto const verdict = s.upstream.try_acquire(upstream_key);
+    if (verdict != foxy::circuit_breaker::verdict::allow) {
+      s.admission.release_upstream();
+
+      auto const is_open = (verdict == foxy::circuit_breaker::verdict::open);
+
+      auto response = http::response<http::string_body>(
+        is_open
+          ? http::status::bad_gateway
+          : http::status::service_unavailable,
+        11,
+        is_open
+          ? "Remote host is failing, try again later\n\n"
+          : "Too many connections in progress to remote host\n\n");
+
+      response.prepare_payload();
+
+      ignore_unused(
+        co_await server_session.async_write(response, error_token));
+
+      continue;
+    }
+
     ignore_unused(
       co_await client_session.async_connect(host, port, error_token));
 
+    // an attempt that was cancelled says nothing about the remote host
+    //
+    if (ec == asio::error::operation_aborted) {
+      s.upstream.abandon(upstream_key);
+    } else {
+      s.upstream.release(upstream_key, !ec);
+    }
+    s.admission.release_upstream();
+
     if (ec) {
       auto response = http::response<http::string_body>(
         http::status::bad_request, 11,
@@ -124,6 +214,8 @@ auto init(
     // we were able to successfully connect to the remote, reply with a 200
     // and thus begin the tunneling
     //
+    authority = upstream_key;
+
     auto response = http::response<http::empty_body>(http::status::ok, 11);
     ignore_unused(
       co_await server_session.async_write(response, error_token));
@@ -132,136 +224,919 @@ auto init(
   }
 }
 
+// body_tap sees a relayed body go by, passing it on to the requests collapsed
+// into this one and keeping a copy of it for the response cache, which it
+// gives up on once it grows past what the cache would store anyway
+//
+struct body_tap {
+  foxy::detail::collapsed_response* followers = nullptr;
+
+  std::string body;
+  std::size_t limit     = 0;
+  bool        capture   = false;
+  bool        truncated = false;
+
+  auto append(void const* data, std::size_t const size) -> void {
+    if (followers) { followers->publish(data, size); }
+
+    if (!capture || truncated) { return; }
+
+    if (body.size() + size > limit) {
+      truncated = true;
+      body      = std::string();
+      return;
+    }
+
+    body.append(static_cast<char const*>(data), size);
+  }
+};
+
+// relay_body writes the header held by `parser` to `output` and then streams
+// the remainder of the message from `input` to `output` through `buf`, showing
+// it to `tap` along the way when there is one
+//
+// this is adapted from the Beast HTTP relay example with the fixed-size
+// scratch array replaced by a pooled buffer that grows while the message keeps
+// filling it so that bulk transfers need fewer reads and writes
+//
+template <typename Parser>
+auto relay_body(
+  foxy::detail::session&         input,
+  foxy::detail::session&         output,
+  Parser&                        parser,
+  foxy::detail::adaptive_buffer& buf,
+  foxy::cancellation_slot const  slot,
+  error_code&                    ec,
+  body_tap*                      tap = nullptr) -> foxy::awaitable<void> {
+
+  auto token       = co_await foxy::this_coro::token();
+  auto error_token =
+    foxy::bind_cancellation_slot(slot, foxy::redirect_error(token, ec));
+
+  http::serializer<
+    Parser::is_request::value, http::buffer_body, http::fields
+  >
+  serializer(parser.get());
+
+  ignore_unused(
+    co_await output.async_write_header(serializer, error_token));
+  if (ec) { co_return; }
+
+  auto& body = parser.get().body();
+
+  do {
+    if (!parser.is_done()) {
+      auto const chunk = buf.prepare();
+
+      body.data = chunk.data();
+      body.size = chunk.size();
+
+      ignore_unused(
+        co_await input.async_read(parser, error_token));
+      if (ec == http::error::need_buffer) {
+        ec = {};
+      }
+      if (ec) { co_return; }
+
+      auto const bytes_read = chunk.size() - body.size;
+
+      buf.commit(bytes_read);
+      if (tap) { tap->append(chunk.data(), bytes_read); }
+
+      foxy::detail::session_metrics::get().proxy_tunnel_bytes.add(bytes_read);
+
+      body.size = bytes_read;
+      body.data = chunk.data();
+      body.more = !parser.is_done();
+
+    } else {
+      body.data = nullptr;
+      body.size = 0;
+    }
+
+    ignore_unused(
+      co_await output.async_write(serializer, error_token));
+    if (ec == http::error::need_buffer) {
+      ec = {};
+    }
+    if (ec) { co_return; }
+
+  } while (!parser.is_done() && !serializer.is_done());
+}
+
+// upgrade_protocol returns what a message asks to upgrade to, given the
+// hop-by-hop fields partitioned out of it, or nothing if it doesn't ask
+//
+auto upgrade_protocol(http::fields const& hop_fields) -> std::string {
+  auto const connection = hop_fields.equal_range(http::field::connection);
+
+  for (auto pos = connection.first; pos != connection.second; ++pos) {
+    if (http::token_list(pos->value()).exists("upgrade")) {
+      return std::string(hop_fields[http::field::upgrade]);
+    }
+  }
+
+  return {};
+}
+
+// an upgrade is the one hop-by-hop option we pass along, as the proxy gets
+// out of the way once it's been agreed to
+//
+auto restore_upgrade(
+  http::fields&      fields,
+  std::string const& protocol) -> void {
+
+  fields.set(http::field::connection, "upgrade");
+  fields.set(http::field::upgrade, protocol);
+}
+
+// write_cached answers a request with a response out of the cache, its body
+// written straight from where the cache keeps it
+//
+auto write_cached(
+  foxy::server_session&                        server_session,
+  foxy::response_cache::cached_response const& cached,
+  bool const                                   is_head,
+  foxy::cancellation_slot const                slot,
+  error_code&                                  ec) -> foxy::awaitable<void> {
+
+  auto token       = co_await foxy::this_coro::token();
+  auto error_token =
+    foxy::bind_cancellation_slot(slot, foxy::redirect_error(token, ec));
+
+  auto const age = std::to_string(cached.age().count());
+
+  if (is_head) {
+    auto response = http::response<http::empty_body>(cached.header());
+    response.set(http::field::age, age);
+
+    ignore_unused(
+      co_await server_session.async_write(response, error_token));
+    co_return;
+  }
+
+  auto response = http::response<http::buffer_body>(cached.header());
+  response.set(http::field::age, age);
+
+  // the serializer only ever reads from the body
+  //
+  auto const body = cached.body();
+  response.body().data = const_cast<void*>(body.data());
+  response.body().size = body.size();
+  response.body().more = false;
+
+  ignore_unused(
+    co_await server_session.async_write(response, error_token));
+}
+
+// collapse_guard has the followers of a response hear about it when its
+// leader gives up on it, and makes sure requests arriving once it's over go
+// upstream again
+//
+struct collapse_guard {
+  foxy::detail::collapser&                           in_flight;
+  std::shared_ptr<foxy::detail::collapsed_response> response;
+
+  ~collapse_guard() {
+    if (!response) { return; }
+
+    using status = foxy::detail::collapsed_response::status;
+
+    auto const st = response->get_status();
+    if (st == status::pending || st == status::streaming) { response->fail(); }
+
+    in_flight.leave(*response);
+  }
+};
+
+// follower_guard lets the leader know a follower is done with the response,
+// however it leaves, so that what it was reading can be released
+//
+struct follower_guard {
+  foxy::detail::collapsed_response::follower& f;
+
+  ~follower_guard() {
+    f.position.store(foxy::detail::collapsed_response::follower::gone);
+  }
+};
+
+// follow answers `request` with the response another tunnel is fetching for
+// the same resource, streaming its body along as it arrives
+//
+// `served` is left unset when the response can't be shared with `request` or
+// its leader failed before there was anything to write, in which case
+// `request` has to go upstream after all
+//
+auto follow(
+  foxy::server_session&             server_session,
+  foxy::detail::collapsed_response& response,
+  http::request_header<> const&     request,
+  bool&                             served,
+  foxy::cancellation_slot const     slot,
+  error_code&                       ec) -> foxy::awaitable<void> {
+
+  using status   = foxy::detail::collapsed_response::status;
+  using chunk    = foxy::detail::collapsed_response::chunk;
+  using follower = foxy::detail::collapsed_response::follower;
+
+  auto token       = co_await foxy::this_coro::token();
+  auto error_token =
+    foxy::bind_cancellation_slot(slot, foxy::redirect_error(token, ec));
+
+  served = false;
+
+  auto& f = response.add_follower();
+
+  auto const left = follower_guard{f};
+
+  // the leader may have stopped keeping the body for anyone who wasn't
+  // already following along
+  //
+  if (!response.joinable()) { co_return; }
+
+  // going back to idle before looking means that anything the leader does
+  // from here on has the next park complete straight away
+  //
+  f.state.exchange(follower::idle);
+  while (response.get_status() == status::pending) {
+    ignore_unused(
+      co_await response.async_park(f, error_token));
+    if (ec) { co_return; }
+
+    f.state.exchange(follower::idle);
+  }
+
+  auto const st = response.get_status();
+  if (st == status::unshared || st == status::failed) { co_return; }
+
+  auto const is_same_variant = foxy::response_cache::is_same_variant(
+    response.header(), response.request(), request);
+
+  if (!is_same_variant) { co_return; }
+
+  served = true;
+
+  auto res = http::response<http::buffer_body>(response.header());
+
+  http::serializer<false, http::buffer_body, http::fields>
+  serializer(res);
+
+  ignore_unused(
+    co_await server_session.async_write_header(serializer, error_token));
+  if (ec) { co_return; }
+
+  auto& body = res.body();
+
+  chunk const* pos = nullptr;
+
+  while (!serializer.is_done()) {
+    f.state.exchange(follower::idle);
+
+    // the status has to be looked at first as every chunk is in by the time
+    // the response is done
+    //
+    auto const st   = response.get_status();
+    auto const next = pos ? response.next(pos) : response.first();
+
+    if (next) {
+      pos = next;
+      f.position.store(pos->index);
+
+      // the serializer only ever reads from the body
+      //
+      body.data = const_cast<char*>(next->data.data());
+      body.size = next->data.size();
+      body.more = true;
+
+    } else if (st == status::done) {
+      body.data = nullptr;
+      body.size = 0;
+      body.more = false;
+
+    } else if (st == status::failed) {
+      // the client already has part of the response so the connection can
+      // only be closed
+      //
+      ec = http::error::partial_message;
+      co_return;
+
+    } else {
+      ignore_unused(
+        co_await response.async_park(f, error_token));
+      if (ec) { co_return; }
+
+      continue;
+    }
+
+    ignore_unused(
+      co_await server_session.async_write(serializer, error_token));
+    if (ec == http::error::need_buffer) {
+      ec = {};
+    }
+    if (ec) { co_return; }
+  }
+}
+
 auto tunnel(
-  foxy::server_session& server_session,
-  foxy::client_session& client_session)-> foxy::awaitable<void> {
+  foxy::server_session&              server_session,
+  foxy::client_session&              client_session,
+  foxy::detail::forward_proxy_state& s,
+  live_session&                      live,
+  std::string const&                 authority)-> foxy::awaitable<void> {
+
+  auto const slot = live.signal.slot();
 
   auto ec          = error_code();
   auto token       = co_await foxy::this_coro::token();
-  auto error_token = foxy::redirect_error(token, ec);
+  auto error_token =
+    foxy::bind_cancellation_slot(slot, foxy::redirect_error(token, ec));
+
+  auto buf = foxy::detail::adaptive_buffer();
 
-  auto buf = std::array<char, 2048>();
+  auto is_first_request = true;
 
   while (true) {
 
+    // the tunnel is idle until the client sends its next request
+    //
+    live.idle = true;
+    if (!std::exchange(is_first_request, false) && s.draining) {
+      break;
+    }
+
+    // the tunnel sits idle until the client sends its next request so we hand
+    // the scratch memory back to the shared pool in the meantime
+    //
+    buf.release();
+
     auto fields = http::fields();
 
     http::request_parser<http::buffer_body>
     parser;
 
-    http::request_serializer<http::buffer_body, http::fields>
-    serializer(parser.get());
-
     ignore_unused(
       co_await server_session.async_read_header(parser, error_token));
+
+    live.idle = false;
     if (ec) { break; }
 
     http::fields& req_fields = parser.get().base();
     foxy::partition_connection_options(req_fields, fields);
 
-    ignore_unused(
-      co_await client_session.async_write_header(serializer, error_token));
-    if (ec) { break; }
+    auto const upgrade = upgrade_protocol(fields);
+    if (!upgrade.empty()) { restore_upgrade(req_fields, upgrade); }
+
+    auto const method  = parser.get().method();
+    auto const is_head = (method == http::verb::head);
 
-    // and then we kind of copy-paste some code from the Beast HTTP relay
-    // example
+    // the cache is keyed by the host the tunnel leads to rather than by what
+    // the client claims in its Host field, so it can't be used to poison
+    // what's cached for anyone else; the same goes for collapsing
     //
-    auto& body = parser.get().body();
-    if (!parser.is_done()) {
+    auto const is_shareable =
+      upgrade.empty() && parser.is_done() &&
+      foxy::response_cache::can_share(parser.get());
 
-      body.data = buf.data();
-      body.size = buf.size();
+    if (is_shareable && s.cache.enabled()) {
+      auto const cached = s.cache.lookup(authority, parser.get());
+      if (cached) {
+        co_await write_cached(server_session, cached, is_head, slot, ec);
+        if (ec) { break; }
 
-      ignore_unused(
-        co_await server_session.async_read(parser, error_token));
-      if (ec == http::error::need_buffer) {
-        ec = {};
+        continue;
       }
-      if (ec) { break; }
+    }
 
-      body.size = buf.size() - body.size;
-      body.data = buf.data();
-      body.more = !parser.is_done();
+    // only one of the GET requests for a resource which arrive at the same
+    // time goes upstream, the rest following along with its response
+    //
+    auto collapsed = collapse_guard{s.in_flight, nullptr};
 
-    } else {
-      body.data = nullptr;
-      body.size = 0;
+    if (is_shareable && !is_head && s.collapse_requests) {
+      auto const target = parser.get().target();
+
+      auto key = authority;
+      key.append(target.data(), target.size());
+
+      auto is_leader = false;
+      auto response  = s.in_flight.join(key, parser.get(), is_leader);
+
+      if (is_leader) {
+        collapsed.response = std::move(response);
+
+      } else {
+        auto served = false;
+        co_await follow(
+          server_session, *response, parser.get(), served, slot, ec);
+        if (ec) { break; }
+
+        if (served) {
+          foxy::detail::session_metrics::get().proxy_collapsed_requests.add();
+          continue;
+        }
+      }
+    }
+
+    co_await relay_body(
+      server_session, client_session, parser, buf, slot, ec);
+    if (ec) { break; }
+
+    http::response_parser<http::buffer_body>
+    res_parser;
+
+    // responses to HEAD requests never carry a body even though their headers
+    // may claim otherwise
+    //
+    res_parser.skip(is_head);
+
+    ignore_unused(
+      co_await client_session.async_read_header(res_parser, error_token));
+    if (ec) { break; }
+
+    auto res_fields = http::fields();
+
+    http::fields& upstream_fields = res_parser.get().base();
+    foxy::partition_connection_options(upstream_fields, res_fields);
+
+    auto const is_switching =
+      !upgrade.empty() &&
+      res_parser.get().result() == http::status::switching_protocols;
+
+    if (is_switching) {
+      auto const accepted = upgrade_protocol(res_fields);
+      restore_upgrade(upstream_fields, accepted.empty() ? upgrade : accepted);
+    }
+
+    auto tap = body_tap();
+
+    if (collapsed.response) {
+      // bodies too big to cache aren't worth holding onto for followers
+      // either
+      //
+      auto const length = res_parser.content_length();
+      auto const shared =
+        foxy::response_cache::can_share(parser.get(), res_parser.get()) &&
+        (!length || *length <= s.cache.max_object_size());
+
+      collapsed.response->publish_header(
+        res_parser.get(), shared, s.cache.max_object_size());
+      if (shared) { tap.followers = collapsed.response.get(); }
     }
 
+    tap.limit   = s.cache.max_object_size();
+    tap.capture =
+      is_shareable && s.cache.is_storable(parser.get(), res_parser.get());
+
+    co_await relay_body(
+      client_session, server_session, res_parser, buf, slot, ec, &tap);
+
+    if (ec) { break; }
+
+    if (tap.followers) { tap.followers->finish(); }
+
+    if (tap.capture && !tap.truncated) {
+      s.cache.store(authority, parser.get(), res_parser.get(), tap.body);
+    }
+
+    // unsafe requests which went through leave whatever's cached for their
+    // target out of date
+    //
+    auto const is_safe =
+      method == http::verb::get || is_head ||
+      method == http::verb::options || method == http::verb::trace;
+
+    if (!is_safe && res_parser.get().result_int() < 400) {
+      auto const target = parser.get().target();
+      s.cache.invalidate(
+        authority, std::string_view(target.data(), target.size()));
+    }
 
+    // whatever the two ends speak now is none of our business, so from here
+    // on bytes are passed along as they come
+    //
+    if (is_switching) {
+      foxy::detail::session_metrics::get().proxy_upgrades.add();
+
+      buf.release();
+      ignore_unused(
+        co_await server_session.async_relay(client_session, error_token));
+      break;
+    }
   }
 }
 
+// admission_guard hands the connection slot back once the session is over, no
+// matter how it ends
+//
+struct admission_guard {
+  foxy::admission_control& admission;
+
+  ~admission_guard() { admission.leave(); }
+};
+
+// session_guard keeps the proxy's count of live sessions up to date so that
+// draining knows when it's done, and lists the session where draining can
+// interrupt it
+//
+struct session_guard {
+  foxy::detail::forward_proxy_state&    s;
+  foxy::detail::session_metrics&        metrics;
+  std::chrono::steady_clock::time_point started;
+  live_session                          entry;
+
+  explicit
+  session_guard(foxy::detail::forward_proxy_state& s_)
+  : s(s_)
+  , metrics(foxy::detail::session_metrics::get())
+  , started(std::chrono::steady_clock::now())
+  {
+    ++s.sessions;
+    metrics.proxy_sessions.add();
+
+    auto lock = std::lock_guard<std::mutex>(s.live_mtx);
+    s.live.insert(&entry);
+  }
+
+  ~session_guard() {
+    {
+      auto lock = std::lock_guard<std::mutex>(s.live_mtx);
+      s.live.erase(&entry);
+    }
+
+    metrics.proxy_session_time.record_since(started);
+    metrics.proxy_sessions.sub();
+    --s.sessions;
+  }
+};
+
 auto handle_request(
-  foxy::multi_stream multi_stream,
-  asio::io_context&  io) -> foxy::awaitable<void> {
+  foxy::multi_stream                                 multi_stream,
+  asio::io_context&                                  io,
+  std::shared_ptr<foxy::detail::forward_proxy_state> s)
+-> foxy::awaitable<void> {
+
+  auto live = session_guard(*s);
 
   auto ec          = error_code();
   auto token       = co_await foxy::this_coro::token();
-  auto error_token = foxy::redirect_error(token, ec);
+  auto error_token = foxy::bind_cancellation_slot(
+    live.entry.signal.slot(), foxy::redirect_error(token, ec));
+
+  auto const session_id = ++s->next_session_id;
+
+  auto remote_ec = error_code();
+  auto const remote_endpoint =
+    multi_stream.stream().remote_endpoint(remote_ec);
 
   auto server_session = foxy::server_session(std::move(multi_stream));
+  server_session.set_socket_options(s->sockets);
+
+  // a connection queued for admission hasn't been served anything yet, making
+  // it as idle as one waiting on its next request
+  //
+  live.entry.idle = true;
+
+  auto const admitted =
+    co_await s->admission.async_admit(io, live.entry.signal.slot());
+
+  live.entry.idle = false;
+
+  if (!admitted) {
+    auto response = http::response<http::string_body>(
+      http::status::service_unavailable, 11,
+      "Proxy is at capacity, try again later\n\n");
+
+    response.keep_alive(false);
+    response.prepare_payload();
+
+    ignore_unused(
+      co_await server_session.async_write(response, error_token));
+
+    server_session.shutdown();
+    co_return;
+  }
+
+  auto const guard = admission_guard{s->admission};
 
   // TODO: add SSL context
   //
   auto client_session = foxy::client_session(io);
+  client_session.set_socket_options(s->sockets);
 
-  co_await init(server_session, client_session, ec);
+  auto authority = std::string();
+
+  co_await init(server_session, client_session, *s, live.entry, authority, ec);
   if (!ec) {
-    co_await tunnel(server_session, client_session);
+    co_await tunnel(server_session, client_session, *s, live.entry, authority);
   }
 
   server_session.shutdown();
+
+  foxy::log_event<foxy::log_level::debug>(
+    "proxy session closed",
+    foxy::log_fields{
+      session_id, remote_endpoint, ec,
+      std::chrono::steady_clock::now() - live.started});
+}
+
+// dispatch_guard keeps a worker's count of sessions up to date from the moment
+// a connection is handed to it
+//
+struct dispatch_guard {
+  std::atomic<std::size_t>& sessions;
+
+  ~dispatch_guard() { --sessions; }
+};
+
+auto pick_worker(foxy::detail::forward_proxy_state& s)
+-> foxy::detail::forward_proxy_state::worker& {
+
+  using dispatch_policy = foxy::detail::forward_proxy_state::dispatch_policy;
+
+  auto& workers = s.workers;
+
+  if (s.dispatch == dispatch_policy::round_robin) {
+    auto const idx = s.next_worker.fetch_add(1, std::memory_order_relaxed);
+    return *workers[idx % workers.size()];
+  }
+
+  // starting the search somewhere new every time keeps ties from all going to
+  // the first worker
+  //
+  auto const start = s.next_worker.fetch_add(1, std::memory_order_relaxed);
+
+  auto* best = workers[start % workers.size()].get();
+  for (auto i = std::size_t{1}; i < workers.size(); ++i) {
+    auto* const w = workers[(start + i) % workers.size()].get();
+    if (w->sessions.load(std::memory_order_relaxed) <
+        best->sessions.load(std::memory_order_relaxed)) {
+      best = w;
+    }
+  }
+
+  return *best;
+}
+
+#if !defined(BOOST_ASIO_WINDOWS)
+// move_stream carries the connection accepted onto `socket` over to `io`. A
+// socket can't change contexts so it goes by way of a duplicate of its
+// descriptor, with `socket` closed either way
+//
+auto move_stream(
+  asio::ip::tcp::socket& socket,
+  asio::io_context&      io,
+  error_code&            ec) -> foxy::multi_stream {
+
+  auto stream = foxy::multi_stream(io);
+
+  auto const endpoint = socket.local_endpoint(ec);
+  if (!ec) {
+    auto const fd = ::dup(socket.native_handle());
+    if (fd < 0) {
+      ec = error_code(errno, asio::error::get_system_category());
+    } else {
+      stream.stream().assign(endpoint.protocol(), fd, ec);
+      if (ec) { ::close(fd); }
+    }
+  }
+
+  auto close_ec = error_code();
+  socket.close(close_ec);
+  return stream;
+}
+#endif
+
+// drain_inbox starts a session for every connection waiting on `w`, running on
+// its thread
+//
+auto drain_inbox(
+  std::shared_ptr<foxy::detail::forward_proxy_state> const& s,
+  foxy::detail::forward_proxy_state::worker&                w) -> void {
+
+  // anything dispatched from here on either gets popped below or finds the
+  // flag cleared and posts again
+  //
+  w.scheduled.exchange(false);
+
+  while (auto stream = w.inbox.try_pop()) {
+    foxy::co_spawn(
+      w.io,
+      [s, &w, multi_stream = std::move(*stream)]() mutable
+      -> foxy::awaitable<void> {
+        auto const guard = dispatch_guard{w.sessions};
+        co_await handle_request(std::move(multi_stream), w.io, s);
+      },
+      foxy::detached);
+  }
+}
+
+// dispatch hands `stream` to `w`, waking it up if it isn't already due to look
+// at its inbox
+//
+auto dispatch(
+  std::shared_ptr<foxy::detail::forward_proxy_state> const& s,
+  foxy::detail::forward_proxy_state::worker&                w,
+  foxy::multi_stream                                        stream) -> void {
+
+  ++w.sessions;
+
+  if (!w.inbox.try_push(std::move(stream))) {
+    --w.sessions;
+
+    // the worker's so far behind that it's in no state to take on more
+    //
+    auto ec = error_code();
+    stream.stream().close(ec);
+
+    foxy::log_error(
+      asio::error::no_buffer_space, "proxy connection dispatch");
+    return;
+  }
+
+  if (!w.scheduled.exchange(true)) {
+    asio::post(w.io, [s, &w] { drain_inbox(s, w); });
+  }
 }
 
 } // anonymous
 
-foxy::forward_proxy::state::state(
+foxy::forward_proxy::forward_proxy(
   boost::asio::io_context& io,
   endpoint_type const&     local_endpoint,
   bool const               reuse_addr)
-: acceptor(io, local_endpoint, reuse_addr)
-, socket(io)
+: forward_proxy(io, local_endpoint, reuse_addr, options())
 {
 }
 
 foxy::forward_proxy::forward_proxy(
   boost::asio::io_context& io,
   endpoint_type const&     local_endpoint,
-  bool const               reuse_addr)
-: s_(std::make_shared<state>(io, local_endpoint, reuse_addr))
+  bool const               reuse_addr,
+  options const&           opts)
+: s_(std::make_shared<detail::forward_proxy_state>(
+    io, local_endpoint, reuse_addr,
+    opts.admission, opts.upstream, opts.sockets, opts.cache,
+    opts.collapse_requests))
 {
 }
 
-auto foxy::forward_proxy::run() -> void {
+foxy::forward_proxy::forward_proxy(
+  boost::asio::io_context& io,
+  acceptor_type            acceptor,
+  options const&           opts)
+: s_(std::make_shared<detail::forward_proxy_state>(
+    io, std::move(acceptor),
+    opts.admission, opts.upstream, opts.sockets, opts.cache,
+    opts.collapse_requests))
+{
+}
+
+foxy::forward_proxy::forward_proxy(
+  runtime&             rt,
+  endpoint_type const& local_endpoint,
+  bool const           reuse_addr)
+: forward_proxy(rt, local_endpoint, reuse_addr, options())
+{
+}
+
+foxy::forward_proxy::forward_proxy(
+  runtime&             rt,
+  endpoint_type const& local_endpoint,
+  bool const           reuse_addr,
+  options const&       opts)
+: s_(std::make_shared<detail::forward_proxy_state>(
+    rt, local_endpoint, reuse_addr,
+    opts.admission, opts.upstream, opts.sockets, opts.cache,
+    opts.collapse_requests))
+{
+}
+
+foxy::forward_proxy::forward_proxy(
+  boost::asio::io_context& io,
+  endpoint_type const&     local_endpoint,
+  bool const               reuse_addr,
+  runtime&                 rt,
+  options const&           opts)
+: s_(std::make_shared<detail::forward_proxy_state>(
+    io, local_endpoint, reuse_addr, rt, opts.dispatch,
+    opts.admission, opts.upstream, opts.sockets, opts.cache,
+    opts.collapse_requests))
+{
+}
 
-  auto& acceptor = s_->acceptor;
-  auto& socket   = s_->socket;
-  auto& io       = socket.get_executor().context();
+auto foxy::forward_proxy::handoff(
+  std::string const&         path,
+  boost::system::error_code& ec) -> void {
 
-  co_spawn(
-    io,
-    [&, s = s_]() mutable -> awaitable<void> {
+  send_acceptor(s_->listeners.front()->acceptor, path, ec);
+}
 
-      auto token       = co_await this_coro::token();
-      auto ec          = error_code();
-      auto error_token = redirect_error(token, ec);
+auto foxy::forward_proxy::active_sessions() const -> std::size_t {
+  return s_->sessions.load();
+}
 
-      while (true) {
-        ignore_unused(
-          co_await acceptor.async_accept(socket.stream(), error_token));
-        if (ec) {
-          log_error(ec, "proxy server connection acceptance");
-          break;
-        }
+auto foxy::forward_proxy::local_endpoint() const -> endpoint_type {
+  return s_->listeners.front()->acceptor.local_endpoint();
+}
 
-        co_spawn(
-          io,
-          [&, multi_stream = std::move(socket)]() mutable {
-            return handle_request(std::move(multi_stream), io); },
-          detached);
-      }
-      co_return;
-    },
-    detached);
-}
\ No newline at end of file
+auto foxy::forward_proxy::admission_stats() const
+-> admission_control::stats_type {
+  return s_->admission.stats();
+}
+
+auto foxy::forward_proxy::upstream_stats() const
+-> circuit_breaker::stats_type {
+  return s_->upstream.stats();
+}
+
+auto foxy::forward_proxy::cache_stats() const
+-> response_cache::stats_type {
+  return s_->cache.stats();
+}
+
+auto foxy::forward_proxy::run() -> void {
+
+  for (auto const& l : s_->listeners) {
+    auto& acceptor = l->acceptor;
+    auto& socket   = l->socket;
+    auto& io       = socket.get_executor().context();
+
+    co_spawn(
+      l->strand,
+      [&, s = s_]() mutable -> awaitable<void> {
+
+        auto token       = co_await this_coro::token();
+        auto ec          = error_code();
+        auto error_token = redirect_error(token, ec);
+
+        while (true) {
+          if (!s->workers.empty()) {
+#if defined(BOOST_ASIO_WINDOWS)
+            // descriptors can't be carried over to another context so the
+            // worker's chosen up front and the connection accepted straight
+            // onto it, a choice which is one connection out of date
+            //
+            auto& w = pick_worker(*s);
+
+            auto stream = multi_stream(w.io);
+            stream.stream() =
+              co_await acceptor.async_accept(w.io, error_token);
+
+            if (!ec) { dispatch(s, w, std::move(stream)); }
+#else
+            // the worker's only chosen once the connection's in hand so that
+            // its load is judged as it stands now rather than as it stood
+            // when the previous connection arrived
+            //
+            ignore_unused(
+              co_await acceptor.async_accept(socket.stream(), error_token));
+
+            if (!ec) {
+              auto& w = pick_worker(*s);
+
+              if (&w.io == &io) {
+                auto stream = multi_stream(w.io);
+                stream.stream() = std::move(socket.stream());
+                dispatch(s, w, std::move(stream));
+              } else {
+                auto move_ec = error_code();
+                auto stream  = move_stream(socket.stream(), w.io, move_ec);
+
+                // only this connection's lost, the listener carries on
+                //
+                if (move_ec) {
+                  log_error(move_ec, "proxy connection dispatch");
+                } else {
+                  dispatch(s, w, std::move(stream));
+                }
+              }
+            }
+#endif
+          } else {
+            ignore_unused(
+              co_await acceptor.async_accept(socket.stream(), error_token));
+
+            if (!ec) {
+              co_spawn(
+                io,
+                [&, s, multi_stream = std::move(socket)]() mutable {
+                  return handle_request(std::move(multi_stream), io, s); },
+                detached);
+            }
+          }
+
+          if (ec) {
+            // a closed acceptor means we're draining, which isn't worth
+            // reporting
+            //
+            if (ec != asio::error::operation_aborted) {
+              log_error(ec, "proxy server connection acceptance");
+            }
+            break;
+          }
+        }
+        co_return;
+      },
+      detached);
+  }
+}
@@ -0,0 +1,184 @@
+#include "foxy/detail/forward_proxy_state.hpp"
+
+#include <boost/asio/socket_base.hpp>
+#include <boost/system/system_error.hpp>
+
+#include <utility>
+
+foxy::detail::forward_proxy_state::listener::listener(
+  boost::asio::io_context& io,
+  acceptor_type            acceptor_)
+: strand(io.get_executor())
+, acceptor(std::move(acceptor_))
+, socket(io)
+{
+}
+
+foxy::detail::forward_proxy_state::worker::worker(
+  boost::asio::io_context& io_,
+  std::size_t const        capacity)
+: io(io_)
+, inbox(capacity)
+, scheduled(false)
+, sessions(0)
+{
+}
+
+foxy::detail::forward_proxy_state::forward_proxy_state(
+  admission_control::options const& admission_opts,
+  circuit_breaker::options const&   upstream_opts,
+  socket_options const&             socket_opts,
+  response_cache::options const&    cache_opts,
+  bool const                        collapse_requests_)
+: listeners()
+, workers()
+, next_worker(0)
+, admission(admission_opts)
+, upstream(upstream_opts)
+, sockets(socket_opts)
+, cache(cache_opts)
+, in_flight()
+, collapse_requests(collapse_requests_)
+, sessions(0)
+, next_session_id(0)
+, draining(false)
+{
+}
+
+foxy::detail::forward_proxy_state::forward_proxy_state(
+  boost::asio::io_context&          io,
+  endpoint_type const&              local_endpoint,
+  bool const                        reuse_addr,
+  admission_control::options const& admission_opts,
+  circuit_breaker::options const&   upstream_opts,
+  socket_options const&             socket_opts,
+  response_cache::options const&    cache_opts,
+  bool const                        collapse_requests_)
+: forward_proxy_state(
+    admission_opts, upstream_opts, socket_opts, cache_opts,
+    collapse_requests_)
+{
+  listeners.push_back(std::make_unique<listener>(
+    io, acceptor_type(io, local_endpoint, reuse_addr)));
+
+  // the acceptor is already listening by now, which doesn't stop what's set
+  // from carrying over to the connections it goes on to accept
+  //
+  auto ec = boost::system::error_code();
+  set_listen_options(listeners.front()->acceptor, sockets, ec);
+}
+
+foxy::detail::forward_proxy_state::forward_proxy_state(
+  boost::asio::io_context&          io,
+  acceptor_type                     acceptor_,
+  admission_control::options const& admission_opts,
+  circuit_breaker::options const&   upstream_opts,
+  socket_options const&             socket_opts,
+  response_cache::options const&    cache_opts,
+  bool const                        collapse_requests_)
+: forward_proxy_state(
+    admission_opts, upstream_opts, socket_opts, cache_opts,
+    collapse_requests_)
+{
+  listeners.push_back(std::make_unique<listener>(io, std::move(acceptor_)));
+
+  // listeners handed over by another process have long since been set up,
+  // which doesn't stop most options from applying to connections accepted
+  // from here on
+  //
+  auto ec = boost::system::error_code();
+  set_listen_options(listeners.front()->acceptor, sockets, ec);
+}
+
+foxy::detail::forward_proxy_state::forward_proxy_state(
+  boost::asio::io_context&          io,
+  endpoint_type const&              local_endpoint,
+  bool const                        reuse_addr,
+  runtime&                          rt,
+  dispatch_policy const             dispatch_,
+  admission_control::options const& admission_opts,
+  circuit_breaker::options const&   upstream_opts,
+  socket_options const&             socket_opts,
+  response_cache::options const&    cache_opts,
+  bool const                        collapse_requests_)
+: forward_proxy_state(
+    io, local_endpoint, reuse_addr,
+    admission_opts, upstream_opts, socket_opts, cache_opts,
+    collapse_requests_)
+{
+  // a worker's inbox only has to absorb a burst of accepts between two of
+  // its turns at draining it
+  //
+  auto const inbox_capacity = std::size_t{1024};
+
+  for (auto idx = std::size_t{0}; idx < rt.size(); ++idx) {
+    workers.push_back(
+      std::make_unique<worker>(rt.context(idx), inbox_capacity));
+  }
+
+  dispatch = dispatch_;
+}
+
+foxy::detail::forward_proxy_state::forward_proxy_state(
+  runtime&                          rt,
+  endpoint_type const&              local_endpoint,
+  bool const                        reuse_addr,
+  admission_control::options const& admission_opts,
+  circuit_breaker::options const&   upstream_opts,
+  socket_options const&             socket_opts,
+  response_cache::options const&    cache_opts,
+  bool const                        collapse_requests_)
+: forward_proxy_state(
+    admission_opts, upstream_opts, socket_opts, cache_opts,
+    collapse_requests_)
+{
+  auto endpoint = local_endpoint;
+
+  for (auto idx = std::size_t{0}; idx < rt.size(); ++idx) {
+    auto& io = rt.context(idx);
+
+    auto acceptor = acceptor_type(io);
+    acceptor.open(endpoint.protocol());
+
+    if (reuse_addr) {
+      acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+    }
+
+    auto ec = boost::system::error_code();
+
+    set_reuse_port(acceptor, ec);
+    if (ec) {
+      throw boost::system::system_error(ec, "foxy::forward_proxy");
+    }
+
+    // steering connections is only ever a preference, so the listener is of
+    // use regardless
+    //
+    if (rt.cpu(idx) >= 0) { set_incoming_cpu(acceptor, rt.cpu(idx), ec); }
+
+    set_listen_options(acceptor, sockets, ec);
+
+    // the rest of the listeners join the first on whatever port it was given
+    //
+    acceptor.bind(endpoint);
+    acceptor.listen();
+
+    endpoint = acceptor.local_endpoint();
+
+    listeners.push_back(std::make_unique<listener>(io, std::move(acceptor)));
+  }
+}
+
+// emitting only ever posts the cancellation to the session's strand, so it's
+// fine to do with the lock held, which is what keeps the session from going
+// away in the meantime
+//
+auto foxy::detail::forward_proxy_state::interrupt_sessions(
+  bool const idle_only) -> void {
+
+  auto lock = std::lock_guard<std::mutex>(live_mtx);
+
+  for (auto* const session : live) {
+    if (!idle_only || session->idle) { session->signal.emit(); }
+  }
+}
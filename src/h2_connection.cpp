@@ -0,0 +1,1064 @@
+#include "foxy/detail/h2_connection.hpp"
+#include "foxy/detail/session_metrics.hpp"
+#include "foxy/http2_error.hpp"
+
+#include <boost/asio/write.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/buffer.hpp>
+
+#include <boost/beast/http/error.hpp>
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <algorithm>
+
+namespace asio  = boost::asio;
+namespace http2 = foxy::http2;
+
+using boost::system::error_code;
+using foxy::detail::h2_stream;
+using foxy::detail::h2_frame_type;
+using foxy::detail::header_field;
+
+namespace {
+
+// frames which build up faster than they can be written hold back streams
+// with more body to send until the writer catches up
+//
+constexpr std::size_t max_queued_frames_size = 256 * 1024;
+
+// what we offer as a client and prefer as a server, in ALPN's wire format
+//
+constexpr unsigned char alpn_protocols[] = {
+  2, 'h', '2',
+  8, 'h', 't', 't', 'p', '/', '1', '.', '1'
+};
+
+auto append(boost::beast::flat_buffer& out, std::string_view const s) -> void {
+  out.commit(asio::buffer_copy(out.prepare(s.size()), asio::buffer(s)));
+}
+
+// credentials are kept out of both ends' tables so they can't be probed for
+// by other streams sharing the connection
+//
+auto is_sensitive(std::string_view const name) -> bool {
+  return
+    name == "authorization" ||
+    name == "proxy-authorization" ||
+    name == "cookie" ||
+    name == "set-cookie";
+}
+
+} // anonymous
+
+foxy::detail::h2_stream::h2_stream(
+  std::uint32_t const      id_,
+  std::int64_t const       send_window_,
+  std::int64_t const       receive_window_,
+  boost::asio::io_context& io)
+: id(id_)
+, send_window(send_window_)
+, receive_window(receive_window_)
+, event(io)
+{
+  event.expires_at(timer_type::time_point::max());
+}
+
+foxy::detail::h2_connection::h2_connection(
+  std::shared_ptr<session_state> const& state,
+  role const                            r)
+: h2_connection(state, r, strand_type(state->stream.get_executor()))
+{
+}
+
+foxy::detail::h2_connection::h2_connection(
+  std::shared_ptr<session_state> const& state,
+  role const                            r,
+  strand_type                           strand)
+: state_(state)
+, strand_(std::move(strand))
+, role_(r)
+, next_stream_id_(r == role::client ? 1 : 2)
+, send_window_(h2_default_window_size)
+, receive_window_(connection_window_size)
+, window_event_(state->stream.get_executor().context())
+, accept_event_(state->stream.get_executor().context())
+, done_event_(state->stream.get_executor().context())
+{
+  if (role_ == role::client) { local_.enable_push = false; }
+  if (role_ == role::server) {
+    local_.max_concurrent_streams = max_concurrent_streams;
+  }
+
+  local_.initial_window_size  = stream_window_size;
+  local_.max_header_list_size = 64 * 1024;
+
+  // the events are only ever cancelled, never expired, so that waiting on
+  // one never disturbs anyone else waiting on it
+  //
+  window_event_.expires_at(timer_type::time_point::max());
+  accept_event_.expires_at(timer_type::time_point::max());
+  done_event_.expires_at(timer_type::time_point::max());
+}
+
+auto foxy::detail::h2_connection::get_strand() const -> strand_type {
+  return strand_;
+}
+
+auto foxy::detail::h2_connection::is_open() const noexcept -> bool {
+  return open_;
+}
+
+auto foxy::detail::h2_connection::queue_preface() -> void {
+  if (preface_sent_) { return; }
+  preface_sent_ = true;
+
+  if (role_ == role::client) { append(output_, h2_client_preface); }
+
+  write_settings(output_, local_);
+  write_window_update(
+    output_, 0, connection_window_size - h2_default_window_size);
+}
+
+auto foxy::detail::h2_connection::flush() -> void {
+  if (is_writing_ || output_.size() == 0) { return; }
+
+  is_writing_ = true;
+
+  co_spawn(
+    strand_,
+    [self = shared_from_this()]() -> awaitable<void, strand_type> {
+      co_await self->write_loop();
+    },
+    detached);
+}
+
+auto foxy::detail::h2_connection::write_loop()
+-> awaitable<void, strand_type> {
+
+  auto token = co_await this_coro::token();
+  auto ec    = error_code();
+
+  auto s = state_.lock();
+
+  // everything queued while a write is in flight goes out in the next one
+  //
+  while (s && output_.size() > 0 && !ec) {
+    std::swap(output_, writing_);
+
+    auto const bytes_transferred = co_await asio::async_write(
+      s->stream, writing_.data(), redirect_error(token, ec));
+
+    session_metrics::get().bytes_written.add(bytes_transferred);
+    writing_.consume(writing_.size());
+  }
+
+  is_writing_ = false;
+
+  if (ec) {
+    fail(ec);
+
+  } else if (s && shutdown_pending_) {
+    shutdown_pending_ = false;
+
+    auto shutdown_ec = error_code();
+    s->stream.stream().shutdown(
+      asio::ip::tcp::socket::shutdown_send, shutdown_ec);
+  }
+
+  window_event_.cancel();
+}
+
+auto foxy::detail::h2_connection::fill(
+  session_state&    s,
+  std::size_t const size,
+  error_code&       ec) -> awaitable<void, strand_type> {
+
+  auto token = co_await this_coro::token();
+
+  while (s.buffer.size() < size) {
+    auto const want = std::max<std::size_t>(size - s.buffer.size(), 16 * 1024);
+
+    auto const bytes_transferred = co_await s.stream.async_read_some(
+      s.buffer.prepare(want), redirect_error(token, ec));
+
+    s.buffer.commit(bytes_transferred);
+    session_metrics::get().bytes_read.add(bytes_transferred);
+
+    if (ec) { co_return; }
+  }
+}
+
+auto foxy::detail::h2_connection::start() -> void {
+  running_ = true;
+
+  co_spawn(
+    strand_,
+    [self = shared_from_this()]() -> awaitable<void, strand_type> {
+      co_await self->run();
+    },
+    detached);
+}
+
+auto foxy::detail::h2_connection::run() -> awaitable<void, strand_type> {
+  auto self = shared_from_this();
+  auto s    = state_.lock();
+  if (!s) { co_return; }
+
+  running_ = true;
+
+  auto ec = error_code();
+
+  queue_preface();
+  flush();
+
+  auto const data = [&] {
+    return static_cast<char const*>(s->buffer.data().data());
+  };
+
+  if (role_ == role::server) {
+    co_await fill(*s, h2_client_preface.size(), ec);
+    if (!ec) {
+      if (std::string_view(data(), h2_client_preface.size()) !=
+          h2_client_preface) {
+        ec = http2::error::protocol_error;
+      }
+      s->buffer.consume(h2_client_preface.size());
+    }
+  }
+
+  while (!ec && open_) {
+    co_await fill(*s, h2_frame_header_size, ec);
+    if (ec) { break; }
+
+    auto const header = parse_frame_header(data());
+    if (header.length > local_.max_frame_size) {
+      ec = http2::error::frame_size_error;
+      break;
+    }
+
+    auto const frame_size = h2_frame_header_size + header.length;
+
+    co_await fill(*s, frame_size, ec);
+    if (ec) { break; }
+
+    handle_frame(
+      header,
+      std::string_view(data() + h2_frame_header_size, header.length),
+      ec);
+
+    s->buffer.consume(frame_size);
+
+    // whatever the frame had us send, like ACKs and window updates, goes out
+    // with the next write
+    //
+    flush();
+  }
+
+  // protocol errors are explained to the peer before we hang up
+  //
+  if (open_ && ec.category() == http2::error_category()) {
+    write_goaway(output_, last_peer_stream_id_, http2::to_wire(ec));
+    shutdown_pending_ = true;
+    flush();
+  }
+
+  fail(ec);
+
+  running_ = false;
+  done_event_.cancel();
+}
+
+auto foxy::detail::h2_connection::find_stream(
+  std::uint32_t const id) -> std::shared_ptr<h2_stream> {
+
+  auto const pos = streams_.find(id);
+  return pos == streams_.end() ? nullptr : pos->second;
+}
+
+auto foxy::detail::h2_connection::reset_stream(
+  h2_stream&        stream,
+  error_code const& ec) -> void {
+
+  write_rst_stream(output_, stream.id, http2::to_wire(ec));
+
+  auto const was_remote_closed = stream.remote_closed;
+
+  stream.ec            = ec;
+  stream.remote_closed = true;
+  stream.event.cancel();
+
+  window_event_.cancel();
+
+  // server streams are only looked after by us until they're accepted
+  //
+  if (role_ == role::server && !was_remote_closed) {
+    streams_.erase(stream.id);
+  }
+}
+
+auto foxy::detail::h2_connection::fail(error_code const& ec) -> void {
+  if (!open_) { return; }
+
+  open_ = false;
+  ec_   = ec ? ec : error_code(asio::error::operation_aborted);
+
+  // streams which already have their response in full keep it
+  //
+  for (auto& [id, stream] : streams_) {
+    if (!stream->ec && !stream->remote_closed) { stream->ec = ec_; }
+    stream->event.cancel();
+  }
+
+  window_event_.cancel();
+  accept_event_.cancel();
+}
+
+auto foxy::detail::h2_connection::wait(
+  timer_type& event) -> awaitable<void, strand_type> {
+
+  auto token = co_await this_coro::token();
+  auto ec    = error_code();
+
+  co_await event.async_wait(redirect_error(token, ec));
+}
+
+auto foxy::detail::h2_connection::handle_frame(
+  h2_frame_header const& header,
+  std::string_view       payload,
+  error_code&            ec) -> void {
+
+  ec = {};
+
+  // nothing may come between the frames of a header block
+  //
+  if (continuation_stream_ != 0 &&
+      (!header.is(h2_frame_type::continuation) ||
+       header.stream_id != continuation_stream_)) {
+    ec = http2::error::protocol_error;
+    return;
+  }
+
+  switch (static_cast<h2_frame_type>(header.type)) {
+    case h2_frame_type::data:
+      return handle_data(header, payload, ec);
+
+    case h2_frame_type::headers: {
+      if (header.stream_id == 0) {
+        ec = http2::error::protocol_error;
+        return;
+      }
+
+      strip_padding(header, payload, ec);
+      if (ec) { return; }
+
+      header_block_.assign(payload);
+
+      auto const end_stream = (header.flags & h2_end_stream) != 0;
+      if ((header.flags & h2_end_headers) != 0) {
+        return handle_header_block(header.stream_id, end_stream, ec);
+      }
+
+      continuation_stream_ = header.stream_id;
+      continuation_end_    = end_stream;
+      return;
+    }
+
+    case h2_frame_type::continuation: {
+      if (continuation_stream_ == 0) {
+        ec = http2::error::protocol_error;
+        return;
+      }
+
+      header_block_.append(payload);
+
+      // an encoded block is never much larger than what it decodes to
+      //
+      if (header_block_.size() > 2 * local_.max_header_list_size) {
+        ec = http2::error::protocol_error;
+        return;
+      }
+
+      if ((header.flags & h2_end_headers) != 0) {
+        auto const stream_id = continuation_stream_;
+        continuation_stream_ = 0;
+        return handle_header_block(stream_id, continuation_end_, ec);
+      }
+      return;
+    }
+
+    case h2_frame_type::priority:
+      if (header.stream_id == 0) { ec = http2::error::protocol_error; }
+      return;
+
+    case h2_frame_type::rst_stream: {
+      if (header.stream_id == 0) {
+        ec = http2::error::protocol_error;
+        return;
+      }
+
+      if (payload.size() != 4) {
+        ec = http2::error::frame_size_error;
+        return;
+      }
+
+      auto stream = find_stream(header.stream_id);
+      if (!stream) { return; }
+
+      // a peer which has said all it has to say may reset the rest of the
+      // stream with NO_ERROR
+      //
+      auto const code              = read_u32(payload.data());
+      auto const was_remote_closed = stream->remote_closed;
+
+      if (code != 0) {
+        stream->ec =
+          error_code(static_cast<int>(code), http2::error_category());
+      } else if (!stream->remote_closed) {
+        stream->ec = http2::error::stream_closed;
+      }
+
+      stream->remote_closed = true;
+      stream->event.cancel();
+      window_event_.cancel();
+
+      if (role_ == role::server && !was_remote_closed) {
+        streams_.erase(stream->id);
+      }
+      return;
+    }
+
+    case h2_frame_type::settings:
+      return handle_settings(header, payload, ec);
+
+    case h2_frame_type::push_promise:
+      // clients turn push off and servers are never sent promises
+      //
+      ec = http2::error::protocol_error;
+      return;
+
+    case h2_frame_type::ping:
+      if (header.stream_id != 0) {
+        ec = http2::error::protocol_error;
+        return;
+      }
+
+      if (payload.size() != 8) {
+        ec = http2::error::frame_size_error;
+        return;
+      }
+
+      if ((header.flags & h2_ack) == 0) {
+        write_frame(output_, h2_frame_type::ping, h2_ack, 0, payload);
+      }
+      return;
+
+    case h2_frame_type::goaway: {
+      if (header.stream_id != 0) {
+        ec = http2::error::protocol_error;
+        return;
+      }
+
+      if (payload.size() < 8) {
+        ec = http2::error::frame_size_error;
+        return;
+      }
+
+      goaway_ = true;
+
+      // streams of ours past the last one the peer will process were never
+      // looked at and can be retried elsewhere
+      //
+      auto const last_stream_id = read_u32(payload.data()) & 0x7fffffff;
+      auto const is_local_id    = [&](std::uint32_t const id) {
+        return (id % 2 == 1) == (role_ == role::client);
+      };
+
+      for (auto& [id, stream] : streams_) {
+        if (is_local_id(id) && id > last_stream_id && !stream->ec) {
+          stream->ec = http2::error::refused_stream;
+          stream->event.cancel();
+        }
+      }
+
+      window_event_.cancel();
+      return;
+    }
+
+    case h2_frame_type::window_update:
+      return handle_window_update(header, payload, ec);
+  }
+
+  // frames of unknown types are ignored
+  //
+}
+
+auto foxy::detail::h2_connection::handle_data(
+  h2_frame_header const& header,
+  std::string_view       payload,
+  error_code&            ec) -> void {
+
+  if (header.stream_id == 0) {
+    ec = http2::error::protocol_error;
+    return;
+  }
+
+  // padding counts against flow control as well
+  //
+  auto const length = static_cast<std::int64_t>(header.length);
+  if (length > receive_window_) {
+    ec = http2::error::flow_control_error;
+    return;
+  }
+
+  receive_window_ -= length;
+  if (receive_window_ < connection_window_size / 2) {
+    write_window_update(
+      output_,
+      0,
+      static_cast<std::uint32_t>(connection_window_size - receive_window_));
+    receive_window_ = connection_window_size;
+  }
+
+  strip_padding(header, payload, ec);
+  if (ec) { return; }
+
+  auto stream = find_stream(header.stream_id);
+  if (!stream || stream->remote_closed) {
+    write_rst_stream(
+      output_,
+      header.stream_id,
+      static_cast<std::uint32_t>(http2::error::stream_closed));
+    return;
+  }
+
+  if (length > stream->receive_window) {
+    return reset_stream(*stream, http2::error::flow_control_error);
+  }
+
+  stream->receive_window -= length;
+
+  if (stream->body.size() + payload.size() > max_body_size) {
+    write_rst_stream(
+      output_, stream->id, static_cast<std::uint32_t>(http2::error::cancel));
+
+    stream->ec            = boost::beast::http::error::body_limit;
+    stream->remote_closed = true;
+    stream->event.cancel();
+
+    if (role_ == role::server) { streams_.erase(stream->id); }
+    return;
+  }
+
+  stream->body.append(payload);
+
+  if ((header.flags & h2_end_stream) != 0) {
+    stream->remote_closed = true;
+    if (role_ == role::server) { dispatch(stream); }
+
+  } else if (stream->receive_window < stream_window_size / 2) {
+    write_window_update(
+      output_,
+      stream->id,
+      static_cast<std::uint32_t>(stream_window_size - stream->receive_window));
+    stream->receive_window = stream_window_size;
+  }
+
+  stream->event.cancel();
+}
+
+auto foxy::detail::h2_connection::handle_header_block(
+  std::uint32_t const stream_id,
+  bool const          end_stream,
+  error_code&         ec) -> void {
+
+  // blocks are decoded even for streams we've let go of, to keep our table
+  // in step with the peer's
+  //
+  auto fields = std::vector<header_field>();
+  decoder_.decode(header_block_, fields, ec);
+  header_block_.clear();
+
+  if (ec) { return; }
+
+  auto stream = find_stream(stream_id);
+  if (!stream) {
+    if (role_ == role::server) {
+      open_stream(stream_id, end_stream, fields, ec);
+    }
+    return;
+  }
+
+  if (stream->remote_closed) { return; }
+
+  if (!stream->headers_received) {
+    // informational responses are skipped over
+    //
+    auto const is_informational =
+      role_ == role::client &&
+      !fields.empty() &&
+      fields.front().name == ":status" &&
+      !fields.front().value.empty() &&
+      fields.front().value.front() == '1';
+
+    if (is_informational) { return; }
+
+    stream->fields           = std::move(fields);
+    stream->headers_received = true;
+
+  } else {
+    // trailers have to end the stream
+    //
+    if (!end_stream) {
+      return reset_stream(*stream, http2::error::protocol_error);
+    }
+
+    for (auto& field : fields) { stream->fields.push_back(std::move(field)); }
+  }
+
+  if (end_stream) {
+    stream->remote_closed = true;
+    if (role_ == role::server) { dispatch(stream); }
+  }
+
+  stream->event.cancel();
+}
+
+auto foxy::detail::h2_connection::open_stream(
+  std::uint32_t const        stream_id,
+  bool const                 end_stream,
+  std::vector<header_field>& fields,
+  error_code&                ec) -> void {
+
+  // clients only ever open odd-numbered streams
+  //
+  if (stream_id % 2 == 0) {
+    ec = http2::error::protocol_error;
+    return;
+  }
+
+  // anything else for a stream we're done with is left to die off
+  //
+  if (stream_id <= last_peer_stream_id_) { return; }
+
+  auto s = state_.lock();
+  if (!s) { return; }
+
+  // once we've said we're going away no new work is taken on
+  //
+  if (goaway_) {
+    write_rst_stream(
+      output_,
+      stream_id,
+      static_cast<std::uint32_t>(http2::error::refused_stream));
+    return;
+  }
+
+  last_peer_stream_id_ = stream_id;
+
+  if (streams_.size() >= local_.max_concurrent_streams) {
+    write_rst_stream(
+      output_,
+      stream_id,
+      static_cast<std::uint32_t>(http2::error::refused_stream));
+    return;
+  }
+
+  auto stream = std::make_shared<h2_stream>(
+    stream_id,
+    remote_.initial_window_size,
+    local_.initial_window_size,
+    s->stream.get_executor().context());
+
+  stream->fields           = std::move(fields);
+  stream->headers_received = true;
+
+  streams_.emplace(stream_id, stream);
+
+  if (end_stream) {
+    stream->remote_closed = true;
+    dispatch(stream);
+  }
+}
+
+auto foxy::detail::h2_connection::dispatch(
+  std::shared_ptr<h2_stream> const& stream) -> void {
+
+  accepted_.push_back(stream);
+  accept_event_.cancel();
+}
+
+auto foxy::detail::h2_connection::handle_settings(
+  h2_frame_header const& header,
+  std::string_view       payload,
+  error_code&            ec) -> void {
+
+  if (header.stream_id != 0) {
+    ec = http2::error::protocol_error;
+    return;
+  }
+
+  if ((header.flags & h2_ack) != 0) {
+    if (!payload.empty()) { ec = http2::error::frame_size_error; }
+    return;
+  }
+
+  auto const previous_window = remote_.initial_window_size;
+
+  apply_settings(remote_, payload, ec);
+  if (ec) { return; }
+
+  encoder_.set_max_size(remote_.header_table_size);
+
+  // a new initial window applies to every open stream after the fact
+  //
+  auto const delta =
+    static_cast<std::int64_t>(remote_.initial_window_size) - previous_window;
+
+  for (auto& [id, stream] : streams_) {
+    stream->send_window += delta;
+    if (stream->send_window > h2_max_window_size) {
+      ec = http2::error::flow_control_error;
+      return;
+    }
+  }
+
+  write_frame(output_, h2_frame_type::settings, h2_ack, 0, {});
+  window_event_.cancel();
+}
+
+auto foxy::detail::h2_connection::handle_window_update(
+  h2_frame_header const& header,
+  std::string_view       payload,
+  error_code&            ec) -> void {
+
+  if (payload.size() != 4) {
+    ec = http2::error::frame_size_error;
+    return;
+  }
+
+  auto const increment = read_u32(payload.data()) & 0x7fffffff;
+
+  if (header.stream_id == 0) {
+    if (increment == 0) {
+      ec = http2::error::protocol_error;
+      return;
+    }
+
+    send_window_ += increment;
+    if (send_window_ > h2_max_window_size) {
+      ec = http2::error::flow_control_error;
+      return;
+    }
+
+  } else {
+    auto stream = find_stream(header.stream_id);
+    if (!stream) { return; }
+
+    if (increment == 0) {
+      return reset_stream(*stream, http2::error::protocol_error);
+    }
+
+    stream->send_window += increment;
+    if (stream->send_window > h2_max_window_size) {
+      return reset_stream(*stream, http2::error::flow_control_error);
+    }
+  }
+
+  window_event_.cancel();
+}
+
+auto foxy::detail::h2_connection::async_send(
+  std::shared_ptr<h2_stream> const& stream,
+  std::vector<header_field> const&  fields,
+  std::string_view const            body,
+  error_code&                       ec) -> awaitable<void, strand_type> {
+
+  ec = {};
+
+  if (!open_) {
+    ec = ec_;
+    co_return;
+  }
+
+  queue_preface();
+
+  auto block = std::string();
+  for (auto const& field : fields) {
+    encoder_.encode(field.name, field.value, block, is_sensitive(field.name));
+  }
+
+  write_headers(
+    output_, stream->id, block, body.empty(), remote_.max_frame_size);
+  flush();
+
+  auto remaining = body;
+  while (!remaining.empty()) {
+    if (!open_) {
+      ec = ec_;
+      co_return;
+    }
+
+    if (stream->ec) {
+      ec = stream->ec;
+      co_return;
+    }
+
+    // once the server has said all it has to say, the rest of our body isn't
+    // wanted
+    //
+    if (role_ == role::client && stream->remote_closed) {
+      write_rst_stream(
+        output_, stream->id, static_cast<std::uint32_t>(http2::error::cancel));
+      flush();
+      co_return;
+    }
+
+    auto const window = std::min(send_window_, stream->send_window);
+    if (window <= 0 || output_.size() >= max_queued_frames_size) {
+      co_await wait(window_event_);
+      continue;
+    }
+
+    auto const size = std::min<std::size_t>({
+      static_cast<std::size_t>(window),
+      remote_.max_frame_size,
+      remaining.size()});
+
+    auto const chunk = remaining.substr(0, size);
+    remaining.remove_prefix(size);
+
+    write_frame(
+      output_,
+      h2_frame_type::data,
+      remaining.empty() ? h2_end_stream : 0,
+      stream->id,
+      chunk);
+
+    send_window_        -= static_cast<std::int64_t>(size);
+    stream->send_window -= static_cast<std::int64_t>(size);
+
+    flush();
+  }
+}
+
+auto foxy::detail::h2_connection::async_request(
+  std::vector<header_field> const& fields,
+  std::string_view const           body,
+  std::vector<header_field>&       response_fields,
+  std::string&                     response_body,
+  error_code&                      ec) -> awaitable<void, strand_type> {
+
+  ec = {};
+
+  auto s = state_.lock();
+
+  while (s && open_ && !goaway_ &&
+         streams_.size() >= remote_.max_concurrent_streams) {
+    co_await wait(window_event_);
+  }
+
+  if (!s || !open_) {
+    ec = s ? ec_ : error_code(asio::error::operation_aborted);
+    co_return;
+  }
+
+  // stream ids are 31 bits and can't be reused
+  //
+  if (goaway_ || next_stream_id_ > 0x7fffffff) {
+    ec = http2::error::refused_stream;
+    co_return;
+  }
+
+  auto stream = std::make_shared<h2_stream>(
+    next_stream_id_,
+    remote_.initial_window_size,
+    local_.initial_window_size,
+    s->stream.get_executor().context());
+
+  next_stream_id_ += 2;
+  streams_.emplace(stream->id, stream);
+
+  co_await async_send(stream, fields, body, ec);
+
+  while (!ec && !stream->ec && !stream->remote_closed) {
+    co_await wait(stream->event);
+  }
+
+  if (!ec) { ec = stream->ec; }
+
+  if (!ec) {
+    response_fields = std::move(stream->fields);
+    response_body   = std::move(stream->body);
+
+  } else if (!stream->remote_closed && open_) {
+    write_rst_stream(
+      output_, stream->id, static_cast<std::uint32_t>(http2::error::cancel));
+    flush();
+  }
+
+  streams_.erase(stream->id);
+  window_event_.cancel();
+}
+
+auto foxy::detail::h2_connection::async_accept(
+  std::shared_ptr<h2_stream>& stream,
+  error_code&                 ec) -> awaitable<void, strand_type> {
+
+  while (accepted_.empty() && open_) { co_await wait(accept_event_); }
+
+  if (accepted_.empty()) {
+    ec = ec_;
+    co_return;
+  }
+
+  ec     = {};
+  stream = std::move(accepted_.front());
+  accepted_.pop_front();
+}
+
+auto foxy::detail::h2_connection::async_respond(
+  std::shared_ptr<h2_stream> const& stream,
+  std::vector<header_field> const&  fields,
+  std::string_view const            body,
+  error_code&                       ec) -> awaitable<void, strand_type> {
+
+  co_await async_send(stream, fields, body, ec);
+
+  streams_.erase(stream->id);
+  window_event_.cancel();
+}
+
+auto foxy::detail::h2_connection::reset(
+  std::shared_ptr<h2_stream> const& stream,
+  error_code const&                 ec) -> void {
+
+  if (open_) {
+    write_rst_stream(output_, stream->id, http2::to_wire(ec));
+    flush();
+  }
+
+  streams_.erase(stream->id);
+  window_event_.cancel();
+}
+
+auto foxy::detail::h2_connection::close() -> void {
+  goaway_ = true;
+
+  write_goaway(output_, last_peer_stream_id_, 0);
+  shutdown_pending_ = true;
+  flush();
+}
+
+auto foxy::detail::h2_connection::async_close()
+-> awaitable<void, strand_type> {
+
+  goaway_ = true;
+
+  write_goaway(output_, last_peer_stream_id_, 0);
+  flush();
+
+  while (is_writing_) { co_await wait(window_event_); }
+
+  // the reader is stopped so that the caller has the stream to itself
+  //
+  if (auto s = state_.lock(); s && running_) {
+    auto ec = error_code();
+    s->stream.stream().cancel(ec);
+  }
+
+  while (running_) { co_await wait(done_event_); }
+}
+
+auto foxy::detail::offer_h2_alpn(
+  multi_stream& stream,
+  error_code&   ec) -> void {
+
+  ec = {};
+
+  // unlike the rest of OpenSSL, this returns 0 on success
+  //
+  auto const res = SSL_set_alpn_protos(
+    stream.ssl_stream().native_handle(),
+    alpn_protocols,
+    sizeof(alpn_protocols));
+
+  if (res != 0) {
+    ec.assign(
+      static_cast<int>(::ERR_get_error()), asio::error::get_ssl_category());
+  }
+}
+
+auto foxy::detail::is_h2_alpn(multi_stream& stream) -> bool {
+  if (!stream.is_ssl()) { return false; }
+
+  auto const* protocol = static_cast<unsigned char const*>(nullptr);
+  auto        size     = 0u;
+
+  SSL_get0_alpn_selected(
+    stream.ssl_stream().native_handle(), &protocol, &size);
+
+  return
+    std::string_view(reinterpret_cast<char const*>(protocol), size) == "h2";
+}
+
+auto foxy::detail::select_h2_alpn(boost::asio::ssl::context& ctx) -> void {
+  auto const select = [](
+    SSL*,
+    unsigned char const** out,
+    unsigned char*        out_size,
+    unsigned char const*  in,
+    unsigned int          in_size,
+    void*) -> int {
+
+    // our list comes first so that our preference wins
+    //
+    auto const res = SSL_select_next_proto(
+      const_cast<unsigned char**>(out),
+      out_size,
+      alpn_protocols,
+      sizeof(alpn_protocols),
+      in,
+      in_size);
+
+    return res == OPENSSL_NPN_NEGOTIATED
+      ? SSL_TLSEXT_ERR_OK
+      : SSL_TLSEXT_ERR_NOACK;
+  };
+
+  SSL_CTX_set_alpn_select_cb(ctx.native_handle(), select, nullptr);
+}
+
+auto foxy::detail::async_detect_h2_preface(
+  session_state& s,
+  bool&          is_h2,
+  error_code&    ec
+) -> awaitable<void, session_state::strand_type> {
+
+  auto token = co_await this_coro::token();
+
+  ec    = {};
+  is_h2 = false;
+
+  auto const matches = [&] {
+    auto const size = std::min(s.buffer.size(), h2_client_preface.size());
+    auto const data = static_cast<char const*>(s.buffer.data().data());
+
+    return std::string_view(data, size) == h2_client_preface.substr(0, size);
+  };
+
+  // an HTTP/1.1 request gives itself away with its first few octets
+  //
+  while (s.buffer.size() < h2_client_preface.size() && matches()) {
+    auto const bytes_transferred = co_await s.stream.async_read_some(
+      s.buffer.prepare(16 * 1024), redirect_error(token, ec));
+
+    s.buffer.commit(bytes_transferred);
+    session_metrics::get().bytes_read.add(bytes_transferred);
+
+    if (ec) { co_return; }
+  }
+
+  is_h2 = matches();
+}
@@ -0,0 +1,294 @@
+#include "foxy/detail/h2_frame.hpp"
+#include "foxy/http2_error.hpp"
+
+#include <boost/asio/buffer.hpp>
+
+#include <array>
+#include <algorithm>
+
+namespace asio = boost::asio;
+
+using boost::system::error_code;
+using foxy::detail::h2_setting;
+using foxy::detail::h2_settings;
+using foxy::detail::h2_frame_type;
+
+namespace {
+
+auto put_u32(char* p, std::uint32_t const value) noexcept -> void {
+  p[0] = static_cast<char>(value >> 24);
+  p[1] = static_cast<char>(value >> 16);
+  p[2] = static_cast<char>(value >> 8);
+  p[3] = static_cast<char>(value);
+}
+
+auto put_setting(
+  std::string&        payload,
+  h2_setting const    id,
+  std::uint32_t const value) -> void {
+
+  auto entry = std::array<char, 6>();
+  entry[0] = static_cast<char>(static_cast<std::uint16_t>(id) >> 8);
+  entry[1] = static_cast<char>(static_cast<std::uint16_t>(id));
+  put_u32(entry.data() + 2, value);
+
+  payload.append(entry.data(), entry.size());
+}
+
+} // anonymous
+
+auto foxy::detail::read_u32(char const* p) noexcept -> std::uint32_t {
+  auto const* u = reinterpret_cast<unsigned char const*>(p);
+  return
+    (std::uint32_t{u[0]} << 24) |
+    (std::uint32_t{u[1]} << 16) |
+    (std::uint32_t{u[2]} << 8)  |
+    std::uint32_t{u[3]};
+}
+
+auto foxy::detail::parse_frame_header(
+  char const* p) noexcept -> h2_frame_header {
+
+  auto const* u = reinterpret_cast<unsigned char const*>(p);
+
+  auto header = h2_frame_header();
+  header.length =
+    (std::uint32_t{u[0]} << 16) | (std::uint32_t{u[1]} << 8) | u[2];
+  header.type      = u[3];
+  header.flags     = u[4];
+  header.stream_id = read_u32(p + 5) & 0x7fffffff;
+  return header;
+}
+
+auto foxy::detail::strip_padding(
+  h2_frame_header const& header,
+  std::string_view&      payload,
+  error_code&            ec) -> void {
+
+  ec = {};
+
+  auto padding = std::size_t{0};
+  if ((header.flags & h2_padded) != 0) {
+    if (payload.empty()) {
+      ec = http2::error::protocol_error;
+      return;
+    }
+
+    padding = static_cast<std::uint8_t>(payload.front());
+    payload.remove_prefix(1);
+  }
+
+  if (header.is(h2_frame_type::headers) && (header.flags & h2_priority) != 0) {
+    if (payload.size() < 5) {
+      ec = http2::error::protocol_error;
+      return;
+    }
+    payload.remove_prefix(5);
+  }
+
+  if (padding > payload.size()) {
+    ec = http2::error::protocol_error;
+    return;
+  }
+
+  payload.remove_suffix(padding);
+}
+
+auto foxy::detail::apply_settings(
+  h2_settings&     settings,
+  std::string_view payload,
+  error_code&      ec) -> void {
+
+  ec = {};
+
+  if (payload.size() % 6 != 0) {
+    ec = http2::error::frame_size_error;
+    return;
+  }
+
+  for (; !payload.empty(); payload.remove_prefix(6)) {
+    auto const* u = reinterpret_cast<unsigned char const*>(payload.data());
+
+    auto const id    = static_cast<std::uint16_t>((u[0] << 8) | u[1]);
+    auto const value = read_u32(payload.data() + 2);
+
+    // unknown settings must be ignored
+    //
+    switch (static_cast<h2_setting>(id)) {
+      case h2_setting::header_table_size:
+        settings.header_table_size = value;
+        break;
+
+      case h2_setting::enable_push:
+        if (value > 1) {
+          ec = http2::error::protocol_error;
+          return;
+        }
+        settings.enable_push = value == 1;
+        break;
+
+      case h2_setting::max_concurrent_streams:
+        settings.max_concurrent_streams = value;
+        break;
+
+      case h2_setting::initial_window_size:
+        if (value > h2_max_window_size) {
+          ec = http2::error::flow_control_error;
+          return;
+        }
+        settings.initial_window_size = value;
+        break;
+
+      case h2_setting::max_frame_size:
+        if (value < h2_min_frame_size || value > h2_max_frame_size) {
+          ec = http2::error::protocol_error;
+          return;
+        }
+        settings.max_frame_size = value;
+        break;
+
+      case h2_setting::max_header_list_size:
+        settings.max_header_list_size = value;
+        break;
+    }
+  }
+}
+
+auto foxy::detail::write_frame(
+  boost::beast::flat_buffer& out,
+  h2_frame_type const        type,
+  std::uint8_t const         flags,
+  std::uint32_t const        stream_id,
+  std::string_view const     payload) -> void {
+
+  auto header = std::array<char, h2_frame_header_size>();
+  header[0] = static_cast<char>(payload.size() >> 16);
+  header[1] = static_cast<char>(payload.size() >> 8);
+  header[2] = static_cast<char>(payload.size());
+  header[3] = static_cast<char>(type);
+  header[4] = static_cast<char>(flags);
+  put_u32(header.data() + 5, stream_id & 0x7fffffff);
+
+  auto const size = header.size() + payload.size();
+  auto       dst  = out.prepare(size);
+
+  asio::buffer_copy(dst, asio::buffer(header));
+  asio::buffer_copy(dst + header.size(), asio::buffer(payload));
+
+  out.commit(size);
+}
+
+auto foxy::detail::write_headers(
+  boost::beast::flat_buffer& out,
+  std::uint32_t const        stream_id,
+  std::string_view           block,
+  bool const                 end_stream,
+  std::uint32_t const        max_frame_size) -> void {
+
+  auto type  = h2_frame_type::headers;
+  auto flags = static_cast<std::uint8_t>(end_stream ? h2_end_stream : 0);
+
+  do {
+    auto const fragment = block.substr(0, max_frame_size);
+    block.remove_prefix(fragment.size());
+
+    if (block.empty()) { flags |= h2_end_headers; }
+
+    write_frame(out, type, flags, stream_id, fragment);
+
+    type  = h2_frame_type::continuation;
+    flags = 0;
+  } while (!block.empty());
+}
+
+auto foxy::detail::write_settings(
+  boost::beast::flat_buffer& out,
+  h2_settings const&         settings) -> void {
+
+  auto const defaults = h2_settings();
+
+  auto payload = std::string();
+
+  if (settings.header_table_size != defaults.header_table_size) {
+    put_setting(
+      payload, h2_setting::header_table_size, settings.header_table_size);
+  }
+
+  if (settings.enable_push != defaults.enable_push) {
+    put_setting(payload, h2_setting::enable_push, settings.enable_push);
+  }
+
+  if (settings.max_concurrent_streams != defaults.max_concurrent_streams) {
+    put_setting(
+      payload,
+      h2_setting::max_concurrent_streams,
+      settings.max_concurrent_streams);
+  }
+
+  if (settings.initial_window_size != defaults.initial_window_size) {
+    put_setting(
+      payload, h2_setting::initial_window_size, settings.initial_window_size);
+  }
+
+  if (settings.max_frame_size != defaults.max_frame_size) {
+    put_setting(payload, h2_setting::max_frame_size, settings.max_frame_size);
+  }
+
+  if (settings.max_header_list_size != defaults.max_header_list_size) {
+    put_setting(
+      payload,
+      h2_setting::max_header_list_size,
+      settings.max_header_list_size);
+  }
+
+  write_frame(out, h2_frame_type::settings, 0, 0, payload);
+}
+
+auto foxy::detail::write_window_update(
+  boost::beast::flat_buffer& out,
+  std::uint32_t const        stream_id,
+  std::uint32_t const        increment) -> void {
+
+  auto payload = std::array<char, 4>();
+  put_u32(payload.data(), increment & 0x7fffffff);
+
+  write_frame(
+    out,
+    h2_frame_type::window_update,
+    0,
+    stream_id,
+    std::string_view(payload.data(), payload.size()));
+}
+
+auto foxy::detail::write_rst_stream(
+  boost::beast::flat_buffer& out,
+  std::uint32_t const        stream_id,
+  std::uint32_t const        error_code) -> void {
+
+  auto payload = std::array<char, 4>();
+  put_u32(payload.data(), error_code);
+
+  write_frame(
+    out,
+    h2_frame_type::rst_stream,
+    0,
+    stream_id,
+    std::string_view(payload.data(), payload.size()));
+}
+
+auto foxy::detail::write_goaway(
+  boost::beast::flat_buffer& out,
+  std::uint32_t const        last_stream_id,
+  std::uint32_t const        error_code) -> void {
+
+  auto payload = std::array<char, 8>();
+  put_u32(payload.data(), last_stream_id & 0x7fffffff);
+  put_u32(payload.data() + 4, error_code);
+
+  write_frame(
+    out,
+    h2_frame_type::goaway,
+    0,
+    0,
+    std::string_view(payload.data(), payload.size()));
+}
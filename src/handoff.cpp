@@ -0,0 +1,250 @@
+#include "foxy/handoff.hpp"
+
+#include <boost/asio/error.hpp>
+#include <boost/core/ignore_unused.hpp>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <sys/un.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+using boost::system::error_code;
+
+namespace asio = boost::asio;
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+namespace {
+
+#if defined(MSG_NOSIGNAL)
+constexpr int send_flags = MSG_NOSIGNAL;
+#else
+constexpr int send_flags = 0;
+#endif
+
+#if defined(MSG_CMSG_CLOEXEC)
+constexpr int recv_flags = MSG_CMSG_CLOEXEC;
+#else
+constexpr int recv_flags = 0;
+#endif
+
+auto last_error() -> error_code {
+  return error_code(errno, boost::system::system_category());
+}
+
+// unique_fd closes the descriptor it owns when it goes out of scope
+//
+struct unique_fd {
+  int fd = -1;
+
+  unique_fd() = default;
+
+  explicit
+  unique_fd(int const fd_)
+  : fd(fd_)
+  {
+  }
+
+  unique_fd(unique_fd const&) = delete;
+
+  ~unique_fd() {
+    if (fd >= 0) { ::close(fd); }
+  }
+
+  auto release() -> int {
+    auto const tmp = fd;
+    fd = -1;
+    return tmp;
+  }
+};
+
+auto make_address(std::string const& path, error_code& ec) -> ::sockaddr_un {
+  auto addr = ::sockaddr_un();
+  addr.sun_family = AF_UNIX;
+
+  if (path.size() >= sizeof(addr.sun_path)) {
+    ec = asio::error::name_too_long;
+    return addr;
+  }
+
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return addr;
+}
+
+} // anonymous
+
+auto foxy::send_acceptor(
+  boost::asio::ip::tcp::acceptor& acceptor,
+  std::string const&              path,
+  boost::system::error_code&      ec) -> void {
+
+  ec = {};
+
+  auto const addr = make_address(path, ec);
+  if (ec) { return; }
+
+  auto const sock = unique_fd(::socket(AF_UNIX, SOCK_STREAM, 0));
+  if (sock.fd < 0) { ec = last_error(); return; }
+
+  if (::connect(
+        sock.fd,
+        reinterpret_cast<::sockaddr const*>(&addr),
+        sizeof(addr)) != 0) {
+    ec = last_error();
+    return;
+  }
+
+  auto const listen_fd = acceptor.native_handle();
+
+  // at least one byte of regular data has to accompany the ancillary data
+  //
+  char payload = 'L';
+
+  auto iov     = ::iovec();
+  iov.iov_base = &payload;
+  iov.iov_len  = sizeof(payload);
+
+  alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+  auto msg           = ::msghdr();
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control;
+  msg.msg_controllen = sizeof(control);
+
+  auto* cmsg       = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type  = SCM_RIGHTS;
+  cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &listen_fd, sizeof(int));
+
+  if (::sendmsg(sock.fd, &msg, send_flags) < 0) {
+    ec = last_error();
+    return;
+  }
+
+  // wait for the receiver to acknowledge so that the caller can safely start
+  // tearing down its own copy of the socket
+  //
+  auto const n = ::recv(sock.fd, &payload, sizeof(payload), 0);
+  if (n < 0) {
+    ec = last_error();
+  } else if (n == 0) {
+    ec = asio::error::eof;
+  }
+}
+
+auto foxy::receive_acceptor(
+  boost::asio::io_context&   io,
+  std::string const&         path,
+  boost::system::error_code& ec) -> boost::asio::ip::tcp::acceptor {
+
+  ec = {};
+
+  auto acceptor = asio::ip::tcp::acceptor(io);
+
+  auto const addr = make_address(path, ec);
+  if (ec) { return acceptor; }
+
+  auto const server = unique_fd(::socket(AF_UNIX, SOCK_STREAM, 0));
+  if (server.fd < 0) { ec = last_error(); return acceptor; }
+
+  ::unlink(path.c_str());
+
+  if (::bind(
+        server.fd,
+        reinterpret_cast<::sockaddr const*>(&addr),
+        sizeof(addr)) != 0) {
+    ec = last_error();
+    return acceptor;
+  }
+
+  if (::listen(server.fd, 1) != 0) {
+    ec = last_error();
+    ::unlink(path.c_str());
+    return acceptor;
+  }
+
+  auto const peer = unique_fd(::accept(server.fd, nullptr, nullptr));
+  ::unlink(path.c_str());
+
+  if (peer.fd < 0) { ec = last_error(); return acceptor; }
+
+  char payload = 0;
+
+  auto iov     = ::iovec();
+  iov.iov_base = &payload;
+  iov.iov_len  = sizeof(payload);
+
+  alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+  auto msg           = ::msghdr();
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control;
+  msg.msg_controllen = sizeof(control);
+
+  auto const n = ::recvmsg(peer.fd, &msg, recv_flags);
+  if (n < 0) { ec = last_error(); return acceptor; }
+  if (n == 0) { ec = asio::error::eof; return acceptor; }
+
+  auto* cmsg = CMSG_FIRSTHDR(&msg);
+  if (
+    !cmsg ||
+    cmsg->cmsg_level != SOL_SOCKET ||
+    cmsg->cmsg_type != SCM_RIGHTS) {
+    ec = asio::error::invalid_argument;
+    return acceptor;
+  }
+
+  auto fd = unique_fd();
+  std::memcpy(&fd.fd, CMSG_DATA(cmsg), sizeof(int));
+
+  auto local = ::sockaddr_storage();
+  auto len   = static_cast<::socklen_t>(sizeof(local));
+  if (::getsockname(fd.fd, reinterpret_cast<::sockaddr*>(&local), &len) != 0) {
+    ec = last_error();
+    return acceptor;
+  }
+
+  auto const protocol =
+    (local.ss_family == AF_INET6)
+      ? asio::ip::tcp::v6()
+      : asio::ip::tcp::v4();
+
+  acceptor.assign(protocol, fd.fd, ec);
+  if (ec) { return acceptor; }
+
+  fd.release();
+
+  payload = 'A';
+  boost::ignore_unused(
+    ::send(peer.fd, &payload, sizeof(payload), send_flags));
+
+  return acceptor;
+}
+
+#else
+
+auto foxy::send_acceptor(
+  boost::asio::ip::tcp::acceptor&,
+  std::string const&,
+  boost::system::error_code& ec) -> void {
+
+  ec = asio::error::operation_not_supported;
+}
+
+auto foxy::receive_acceptor(
+  boost::asio::io_context&   io,
+  std::string const&,
+  boost::system::error_code& ec) -> boost::asio::ip::tcp::acceptor {
+
+  ec = asio::error::operation_not_supported;
+  return asio::ip::tcp::acceptor(io);
+}
+
+#endif
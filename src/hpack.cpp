@@ -0,0 +1,580 @@
+#include "foxy/detail/hpack.hpp"
+#include "foxy/http2_error.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+
+using boost::system::error_code;
+using foxy::detail::hpack_table;
+using foxy::detail::header_field;
+
+namespace {
+
+struct static_entry {
+  std::string_view name;
+  std::string_view value;
+};
+
+// the code and static table are those of RFC 7541 appendices A and B
+//
+constexpr std::uint32_t huffman_codes[256] = {
+  0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5,
+  0xfffffe6, 0xfffffe7, 0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9,
+  0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec, 0xfffffed, 0xfffffee,
+  0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+  0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9,
+  0xffffffa, 0xffffffb, 0x14, 0x3f8, 0x3f9, 0xffa,
+  0x1ff9, 0x15, 0xf8, 0x7fa, 0x3fa, 0x3fb,
+  0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+  0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b,
+  0x1c, 0x1d, 0x1e, 0x1f, 0x5c, 0xfb,
+  0x7ffc, 0x20, 0xffb, 0x3fc, 0x1ffa, 0x21,
+  0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+  0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+  0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e,
+  0x6f, 0x70, 0x71, 0x72, 0xfc, 0x73,
+  0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+  0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5,
+  0x25, 0x26, 0x27, 0x6, 0x74, 0x75,
+  0x28, 0x29, 0x2a, 0x7, 0x2b, 0x76,
+  0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+  0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd,
+  0x1ffd, 0xffffffc, 0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8,
+  0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9, 0x3fffd6, 0x7fffda,
+  0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+  0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1,
+  0x7fffe2, 0x7fffe3, 0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5,
+  0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef, 0x3fffda, 0x1fffdd,
+  0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+  0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf,
+  0x7fffeb, 0x7fffec, 0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2,
+  0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef, 0xfffea, 0x3fffe2,
+  0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+  0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2,
+  0x3fffe8, 0x1ffffec, 0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde,
+  0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed, 0x7fff2, 0x1fffe3,
+  0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+  0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3,
+  0x7ffffe4, 0x7ffffe5, 0xfffec, 0xfffff3, 0xfffed, 0x1fffe6,
+  0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3, 0x3fffea, 0x3fffeb,
+  0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+  0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8,
+  0x7ffffe9, 0x7ffffea, 0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed,
+  0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee
+};
+
+constexpr std::uint8_t huffman_lengths[256] = {
+  13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+  28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+  6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+  5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+  13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+  15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+  6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+  20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+  24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+  22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+  21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+  26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+  19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+  20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+  26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26
+};
+
+constexpr static_entry static_table[] = {
+  {":authority", ""},
+  {":method", "GET"},
+  {":method", "POST"},
+  {":path", "/"},
+  {":path", "/index.html"},
+  {":scheme", "http"},
+  {":scheme", "https"},
+  {":status", "200"},
+  {":status", "204"},
+  {":status", "206"},
+  {":status", "304"},
+  {":status", "400"},
+  {":status", "404"},
+  {":status", "500"},
+  {"accept-charset", ""},
+  {"accept-encoding", "gzip, deflate"},
+  {"accept-language", ""},
+  {"accept-ranges", ""},
+  {"accept", ""},
+  {"access-control-allow-origin", ""},
+  {"age", ""},
+  {"allow", ""},
+  {"authorization", ""},
+  {"cache-control", ""},
+  {"content-disposition", ""},
+  {"content-encoding", ""},
+  {"content-language", ""},
+  {"content-length", ""},
+  {"content-location", ""},
+  {"content-range", ""},
+  {"content-type", ""},
+  {"cookie", ""},
+  {"date", ""},
+  {"etag", ""},
+  {"expect", ""},
+  {"expires", ""},
+  {"from", ""},
+  {"host", ""},
+  {"if-match", ""},
+  {"if-modified-since", ""},
+  {"if-none-match", ""},
+  {"if-range", ""},
+  {"if-unmodified-since", ""},
+  {"last-modified", ""},
+  {"link", ""},
+  {"location", ""},
+  {"max-forwards", ""},
+  {"proxy-authenticate", ""},
+  {"proxy-authorization", ""},
+  {"range", ""},
+  {"referer", ""},
+  {"refresh", ""},
+  {"retry-after", ""},
+  {"server", ""},
+  {"set-cookie", ""},
+  {"strict-transport-security", ""},
+  {"transfer-encoding", ""},
+  {"user-agent", ""},
+  {"vary", ""},
+  {"via", ""},
+  {"www-authenticate", ""}
+};
+
+constexpr std::size_t static_table_size = std::size(static_table);
+
+constexpr std::uint32_t eos_code   = 0x3fffffff;
+constexpr int           eos_length = 30;
+constexpr int           eos_symbol = 256;
+
+// huffman_tree is the Huffman code as a binary tree, walked one bit at a time
+// when decoding
+//
+struct huffman_tree {
+  struct node {
+    std::int16_t children[2] = {-1, -1};
+    std::int16_t symbol      = -1;
+  };
+
+  std::vector<node> nodes;
+
+  huffman_tree() {
+    nodes.reserve(2 * (eos_symbol + 1));
+    nodes.emplace_back();
+
+    for (auto symbol = 0; symbol <= eos_symbol; ++symbol) {
+      auto const code =
+        symbol == eos_symbol ? eos_code : huffman_codes[symbol];
+      auto const length =
+        symbol == eos_symbol ? eos_length : huffman_lengths[symbol];
+
+      auto current = std::size_t{0};
+      for (auto bit = length - 1; bit >= 0; --bit) {
+        auto const b = (code >> bit) & 1;
+        if (nodes[current].children[b] < 0) {
+          nodes[current].children[b] = static_cast<std::int16_t>(nodes.size());
+          nodes.emplace_back();
+        }
+        current = static_cast<std::size_t>(nodes[current].children[b]);
+      }
+
+      nodes[current].symbol = static_cast<std::int16_t>(symbol);
+    }
+  }
+};
+
+auto get_huffman_tree() -> huffman_tree const& {
+  static huffman_tree const tree;
+  return tree;
+}
+
+// integers are packed into the low `prefix_bits` of a byte whose high bits
+// are `flags`, spilling over into a little-endian base-128 continuation
+//
+auto encode_int(
+  std::string&       out,
+  std::uint8_t const flags,
+  int const          prefix_bits,
+  std::size_t        value) -> void {
+
+  auto const max_prefix = (std::size_t{1} << prefix_bits) - 1;
+
+  if (value < max_prefix) {
+    out.push_back(static_cast<char>(flags | value));
+    return;
+  }
+
+  out.push_back(static_cast<char>(flags | max_prefix));
+  value -= max_prefix;
+
+  while (value >= 128) {
+    out.push_back(static_cast<char>(value % 128 + 128));
+    value /= 128;
+  }
+
+  out.push_back(static_cast<char>(value));
+}
+
+auto decode_int(
+  std::string_view& in,
+  int const         prefix_bits,
+  std::size_t&      value) -> bool {
+
+  if (in.empty()) { return false; }
+
+  auto const max_prefix = (std::size_t{1} << prefix_bits) - 1;
+
+  value = static_cast<std::uint8_t>(in.front()) & max_prefix;
+  in.remove_prefix(1);
+
+  if (value < max_prefix) { return true; }
+
+  // anything needing more than 4 continuation bytes is far beyond any limit
+  // of ours and could otherwise overflow
+  //
+  for (auto shift = 0; shift <= 28; shift += 7) {
+    if (in.empty()) { return false; }
+
+    auto const b = static_cast<std::uint8_t>(in.front());
+    in.remove_prefix(1);
+
+    value += static_cast<std::size_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) { return true; }
+  }
+
+  return false;
+}
+
+auto encode_string(std::string& out, std::string_view const s) -> void {
+  auto const encoded_size = foxy::detail::huffman_encoded_size(s);
+
+  if (encoded_size < s.size()) {
+    encode_int(out, 0x80, 7, encoded_size);
+    foxy::detail::huffman_encode(s, out);
+    return;
+  }
+
+  encode_int(out, 0x00, 7, s.size());
+  out.append(s);
+}
+
+auto decode_string(std::string_view& in, std::string& out) -> bool {
+  if (in.empty()) { return false; }
+
+  auto const is_huffman = (static_cast<std::uint8_t>(in.front()) & 0x80) != 0;
+
+  auto length = std::size_t{0};
+  if (!decode_int(in, 7, length) || length > in.size()) { return false; }
+
+  auto const s = in.substr(0, length);
+  in.remove_prefix(length);
+
+  out.clear();
+  if (is_huffman) { return foxy::detail::huffman_decode(s, out); }
+
+  out.assign(s);
+  return true;
+}
+
+auto field_at(
+  hpack_table const& table,
+  std::size_t const  index,
+  header_field&      field) -> bool {
+
+  if (index == 0) { return false; }
+
+  if (index <= static_table_size) {
+    auto const& entry = static_table[index - 1];
+    field.name.assign(entry.name);
+    field.value.assign(entry.value);
+    return true;
+  }
+
+  auto const dynamic_index = index - static_table_size - 1;
+  if (dynamic_index >= table.entries.size()) { return false; }
+
+  field = table.entries[dynamic_index];
+  return true;
+}
+
+struct table_match {
+  std::size_t index = 0;
+  bool        whole = false;
+};
+
+// find_field looks for `name: value` across both tables, settling for the
+// first entry with a matching name
+//
+auto find_field(
+  hpack_table const&     table,
+  std::string_view const name,
+  std::string_view const value) -> table_match {
+
+  auto match = table_match();
+
+  for (auto i = std::size_t{0}; i < static_table_size; ++i) {
+    if (static_table[i].name != name) { continue; }
+    if (static_table[i].value == value) { return table_match{i + 1, true}; }
+    if (match.index == 0) { match.index = i + 1; }
+  }
+
+  for (auto i = std::size_t{0}; i < table.entries.size(); ++i) {
+    auto const& entry = table.entries[i];
+    if (entry.name != name) { continue; }
+
+    auto const index = static_table_size + i + 1;
+    if (entry.value == value) { return table_match{index, true}; }
+    if (match.index == 0) { match.index = index; }
+  }
+
+  return match;
+}
+
+} // anonymous
+
+auto foxy::detail::field_size(
+  std::string_view name,
+  std::string_view value) -> std::size_t {
+  return name.size() + value.size() + 32;
+}
+
+auto foxy::detail::hpack_table::insert(header_field field) -> void {
+  auto const added = field_size(field.name, field.value);
+
+  while (!entries.empty() && size + added > max_size) {
+    size -= field_size(entries.back().name, entries.back().value);
+    entries.pop_back();
+  }
+
+  if (added > max_size) { return; }
+
+  entries.push_front(std::move(field));
+  size += added;
+}
+
+auto foxy::detail::hpack_table::resize(std::size_t const new_max_size) -> void {
+  max_size = new_max_size;
+
+  while (size > max_size) {
+    size -= field_size(entries.back().name, entries.back().value);
+    entries.pop_back();
+  }
+}
+
+auto foxy::detail::hpack_encoder::set_max_size(std::size_t max_size) -> void {
+  // a larger table is the peer's to offer, not ours to use
+  //
+  max_size = std::min(max_size, default_hpack_table_size);
+  if (max_size == table_.max_size) { return; }
+
+  // when the table shrinks and grows again between two header blocks, the
+  // smallest size has to be announced as well so the peer evicts the same
+  // entries we did
+  //
+  size_update_ = size_update_ ? std::min(*size_update_, max_size) : max_size;
+  table_.resize(max_size);
+}
+
+auto foxy::detail::hpack_encoder::encode(
+  std::string_view const name,
+  std::string_view const value,
+  std::string&           out,
+  bool const             sensitive) -> void {
+
+  if (size_update_) {
+    encode_int(out, 0x20, 5, *size_update_);
+    if (*size_update_ != table_.max_size) {
+      encode_int(out, 0x20, 5, table_.max_size);
+    }
+    size_update_.reset();
+  }
+
+  auto const match = find_field(table_, name, value);
+
+  if (sensitive) {
+    encode_int(out, 0x10, 4, match.index);
+    if (match.index == 0) { encode_string(out, name); }
+    encode_string(out, value);
+    return;
+  }
+
+  if (match.whole) {
+    encode_int(out, 0x80, 7, match.index);
+    return;
+  }
+
+  // fields taking up more than half the table would flush out too much of
+  // what's already there to be worth keeping
+  //
+  auto const indexed = field_size(name, value) <= table_.max_size / 2;
+
+  if (indexed) {
+    encode_int(out, 0x40, 6, match.index);
+  } else {
+    encode_int(out, 0x00, 4, match.index);
+  }
+
+  if (match.index == 0) { encode_string(out, name); }
+  encode_string(out, value);
+
+  if (indexed) {
+    table_.insert(header_field{std::string(name), std::string(value)});
+  }
+}
+
+foxy::detail::hpack_decoder::hpack_decoder(std::size_t const max_list_size)
+: max_list_size_(max_list_size)
+{
+}
+
+auto foxy::detail::hpack_decoder::decode(
+  std::string_view const     block,
+  std::vector<header_field>& fields,
+  error_code&                ec) -> void {
+
+  ec = {};
+
+  auto in        = block;
+  auto list_size = std::size_t{0};
+  auto at_start  = true;
+
+  auto const fail = [&] { ec = foxy::http2::error::compression_error; };
+
+  while (!in.empty()) {
+    auto const first = static_cast<std::uint8_t>(in.front());
+    auto       field = header_field();
+    auto       index = std::size_t{0};
+
+    if ((first & 0x80) != 0) {
+      if (!decode_int(in, 7, index) || !field_at(table_, index, field)) {
+        return fail();
+      }
+
+    } else if ((first & 0xe0) == 0x20) {
+      // table size updates may only lead a block and can't exceed what our
+      // SETTINGS allow
+      //
+      auto max_size = std::size_t{0};
+      if (!at_start || !decode_int(in, 5, max_size) ||
+          max_size > default_hpack_table_size) {
+        return fail();
+      }
+
+      table_.resize(max_size);
+      continue;
+
+    } else {
+      auto const incremental = (first & 0x40) != 0;
+
+      if (!decode_int(in, incremental ? 6 : 4, index)) { return fail(); }
+
+      if (index != 0) {
+        if (!field_at(table_, index, field)) { return fail(); }
+      } else if (!decode_string(in, field.name)) {
+        return fail();
+      }
+
+      if (!decode_string(in, field.value)) { return fail(); }
+
+      if (incremental) { table_.insert(field); }
+    }
+
+    at_start = false;
+
+    list_size += field_size(field.name, field.value);
+    if (list_size > max_list_size_) {
+      ec = foxy::http2::error::protocol_error;
+      return;
+    }
+
+    fields.push_back(std::move(field));
+  }
+}
+
+auto foxy::detail::huffman_encoded_size(
+  std::string_view const s) -> std::size_t {
+
+  auto bits = std::size_t{0};
+  for (auto const c : s) {
+    bits += huffman_lengths[static_cast<std::uint8_t>(c)];
+  }
+  return (bits + 7) / 8;
+}
+
+auto foxy::detail::huffman_encode(
+  std::string_view const s,
+  std::string&           out) -> void {
+
+  auto bits  = std::uint64_t{0};
+  auto nbits = 0;
+
+  for (auto const c : s) {
+    auto const symbol = static_cast<std::uint8_t>(c);
+
+    bits   = (bits << huffman_lengths[symbol]) | huffman_codes[symbol];
+    nbits += huffman_lengths[symbol];
+
+    while (nbits >= 8) {
+      nbits -= 8;
+      out.push_back(static_cast<char>(bits >> nbits));
+    }
+
+    bits &= (std::uint64_t{1} << nbits) - 1;
+  }
+
+  // the last byte is padded out with the most significant bits of EOS, which
+  // are all ones
+  //
+  if (nbits > 0) {
+    auto const padding = 8 - nbits;
+    bits = (bits << padding) | ((std::uint64_t{1} << padding) - 1);
+    out.push_back(static_cast<char>(bits));
+  }
+}
+
+auto foxy::detail::huffman_decode(
+  std::string_view const s,
+  std::string&           out) -> bool {
+
+  auto const& tree = get_huffman_tree();
+
+  auto current  = std::size_t{0};
+  auto depth    = 0;
+  auto all_ones = true;
+
+  for (auto const c : s) {
+    auto const byte = static_cast<std::uint8_t>(c);
+
+    for (auto bit = 7; bit >= 0; --bit) {
+      auto const b = (byte >> bit) & 1;
+
+      auto const next = tree.nodes[current].children[b];
+      if (next < 0) { return false; }
+
+      current   = static_cast<std::size_t>(next);
+      depth    += 1;
+      all_ones  = all_ones && b == 1;
+
+      auto const symbol = tree.nodes[current].symbol;
+      if (symbol < 0) { continue; }
+      if (symbol == eos_symbol) { return false; }
+
+      out.push_back(static_cast<char>(symbol));
+      current  = 0;
+      depth    = 0;
+      all_ones = true;
+    }
+  }
+
+  // whatever's left over has to be a prefix of EOS that's shorter than a
+  // byte
+  //
+  return depth < 8 && all_ones;
+}
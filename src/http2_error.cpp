@@ -0,0 +1,53 @@
+#include "foxy/http2_error.hpp"
+
+#include <string>
+
+namespace {
+
+struct http2_category : boost::system::error_category {
+  auto name() const noexcept -> char const* override { return "foxy.http2"; }
+
+  auto message(int const ev) const -> std::string override {
+    using foxy::http2::error;
+
+    switch (static_cast<error>(ev)) {
+      case error::no_error:            return "no error";
+      case error::protocol_error:      return "protocol error";
+      case error::internal_error:      return "internal error";
+      case error::flow_control_error:  return "flow control error";
+      case error::settings_timeout:    return "settings timeout";
+      case error::stream_closed:       return "stream closed";
+      case error::frame_size_error:    return "frame size error";
+      case error::refused_stream:      return "stream refused";
+      case error::cancel:              return "stream cancelled";
+      case error::compression_error:   return "compression error";
+      case error::connect_error:       return "connect error";
+      case error::enhance_your_calm:   return "enhance your calm";
+      case error::inadequate_security: return "inadequate security";
+      case error::http_1_1_required:   return "HTTP/1.1 required";
+    }
+
+    return "unknown HTTP/2 error";
+  }
+};
+
+} // anonymous
+
+auto foxy::http2::error_category() -> boost::system::error_category const& {
+  static http2_category const category;
+  return category;
+}
+
+auto foxy::http2::make_error_code(error const e) -> boost::system::error_code {
+  return boost::system::error_code(static_cast<int>(e), error_category());
+}
+
+auto foxy::http2::to_wire(
+  boost::system::error_code const& ec) -> std::uint32_t {
+
+  if (ec.category() == error_category()) {
+    return static_cast<std::uint32_t>(ec.value());
+  }
+
+  return static_cast<std::uint32_t>(error::internal_error);
+}
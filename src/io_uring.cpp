@@ -0,0 +1,36 @@
+#include "foxy/io_uring.hpp"
+#include "foxy/detail/uring.hpp"
+
+#include <boost/core/ignore_unused.hpp>
+
+auto foxy::use_io_uring(
+  boost::asio::io_context& io,
+  io_uring_options const&  opts) -> bool {
+
+#ifdef FOXY_HAS_IO_URING
+  return boost::asio::use_service<detail::uring_service>(io).start(opts);
+#else
+  boost::ignore_unused(io, opts);
+  return false;
+#endif
+}
+
+auto foxy::uses_io_uring(boost::asio::io_context& io) -> bool {
+#ifdef FOXY_HAS_IO_URING
+  return detail::uring_service::find(io) != nullptr;
+#else
+  boost::ignore_unused(io);
+  return false;
+#endif
+}
+
+auto foxy::get_io_uring_stats(boost::asio::io_context& io) -> io_uring_stats {
+#ifdef FOXY_HAS_IO_URING
+  if (auto* service = detail::uring_service::find(io)) {
+    return service->stats();
+  }
+#else
+  boost::ignore_unused(io);
+#endif
+  return io_uring_stats();
+}
@@ -1,10 +1,363 @@
 #include "foxy/log.hpp"
-#include <iostream>
+#include "foxy/detail/spsc_ring.hpp"
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <ctime>
+#include <algorithm>
+#include <condition_variable>
+
+namespace {
+
+constexpr std::size_t ring_capacity     = 1024;
+constexpr std::size_t max_what_length   = 128;
+constexpr std::size_t rate_limit_slots  = 256;
+constexpr std::size_t rate_limit_burst  = 10;
+constexpr auto        rate_limit_window = std::chrono::seconds(1);
+constexpr auto        flush_interval    = std::chrono::milliseconds(10);
+
+// log_record is what actually travels through the rings
+//
+// it has to be trivially copyable so everything is stored inline and the
+// expensive parts, like formatting the time or looking up the error message,
+// are left for the background thread
+//
+struct log_record {
+  foxy::log_level                     level;
+  std::int64_t                        timestamp_ns;
+  std::uint64_t                       session_id;
+  std::int64_t                        elapsed_ns;
+  int                                 ec_value;
+  boost::system::error_category const* ec_category;
+  std::uint64_t                       suppressed;
+  std::array<unsigned char, 16>       address;
+  unsigned short                      port;
+  bool                                is_v6;
+  std::uint8_t                        what_length;
+  std::array<char, max_what_length>   what;
+};
+
+struct producer {
+  foxy::detail::spsc_ring<log_record> ring{ring_capacity};
+};
+
+// rate_limit_slot tracks how often a given (`what`, error code) pair has been
+// logged within the current window
+// collisions between unrelated call sites merely share a budget
+//
+struct alignas(64) rate_limit_slot {
+  std::atomic<std::int64_t>  window_start{0};
+  std::atomic<std::uint64_t> count{0};
+  std::atomic<std::uint64_t> suppressed{0};
+};
+
+auto level_name(foxy::log_level const level) -> char const* {
+  switch (level) {
+    case foxy::log_level::trace: return "trace";
+    case foxy::log_level::debug: return "debug";
+    case foxy::log_level::info:  return "info";
+    case foxy::log_level::warn:  return "warn";
+    case foxy::log_level::error: return "error";
+    default:                     return "off";
+  }
+}
+
+auto format_record(log_record const& r, std::string& out) -> void {
+  char buf[128];
+
+  auto const secs = static_cast<std::time_t>(r.timestamp_ns / 1000000000);
+  auto const usec = (r.timestamp_ns % 1000000000) / 1000;
+
+  auto tm = std::tm();
+#ifdef _WIN32
+  gmtime_s(&tm, &secs);
+#else
+  gmtime_r(&secs, &tm);
+#endif
+
+  auto n = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+  out.append(buf, n);
+
+  n = std::snprintf(
+    buf, sizeof(buf), ".%06lldZ %s \"",
+    static_cast<long long>(usec), level_name(r.level));
+  out.append(buf, n);
+
+  out.append(r.what.data(), r.what_length);
+  out.push_back('"');
+
+  if (r.session_id != 0) {
+    n = std::snprintf(
+      buf, sizeof(buf), " session=%llu",
+      static_cast<unsigned long long>(r.session_id));
+    out.append(buf, n);
+  }
+
+  if (r.port != 0) {
+    auto endpoint = boost::asio::ip::tcp::endpoint();
+    if (r.is_v6) {
+      endpoint = {boost::asio::ip::address_v6(r.address), r.port};
+    } else {
+      auto v4 = boost::asio::ip::address_v4::bytes_type();
+      std::copy_n(r.address.begin(), v4.size(), v4.begin());
+      endpoint = {boost::asio::ip::address_v4(v4), r.port};
+    }
+
+    out.append(" endpoint=");
+    if (r.is_v6) { out.push_back('['); }
+    out.append(endpoint.address().to_string());
+    if (r.is_v6) { out.push_back(']'); }
+
+    n = std::snprintf(buf, sizeof(buf), ":%u", static_cast<unsigned>(r.port));
+    out.append(buf, n);
+  }
+
+  if (r.ec_value != 0 && r.ec_category) {
+    n = std::snprintf(
+      buf, sizeof(buf), " ec=%s:%d \"", r.ec_category->name(), r.ec_value);
+    out.append(buf, n);
+    out.append(r.ec_category->message(r.ec_value));
+    out.push_back('"');
+  }
+
+  if (r.elapsed_ns >= 0) {
+    n = std::snprintf(
+      buf, sizeof(buf), " elapsed_us=%lld",
+      static_cast<long long>(r.elapsed_ns / 1000));
+    out.append(buf, n);
+  }
+
+  if (r.suppressed > 0) {
+    n = std::snprintf(
+      buf, sizeof(buf), " suppressed=%llu",
+      static_cast<unsigned long long>(r.suppressed));
+    out.append(buf, n);
+  }
+
+  out.push_back('\n');
+}
+
+auto default_sink(std::string_view const lines) -> void {
+  std::fwrite(lines.data(), 1, lines.size(), stderr);
+  std::fflush(stderr);
+}
+
+// logger owns the background thread along with every producer's ring
+//
+// the mutex is only taken by producers the first time a thread logs anything
+// after that, a producer touches nothing but its own ring and the
+// rate-limiting table
+//
+struct logger {
+  std::mutex                             mtx;
+  std::condition_variable                wake;
+  std::condition_variable                flushed;
+  std::vector<std::shared_ptr<producer>> producers;
+  std::function<void(std::string_view)>  sink = default_sink;
+
+  std::uint64_t flush_requested = 0;
+  std::uint64_t flush_completed = 0;
+  bool          stopping        = false;
+
+  std::array<rate_limit_slot, rate_limit_slots> limits;
+
+  std::atomic<std::uint64_t> written{0};
+  std::atomic<std::uint64_t> dropped{0};
+  std::atomic<std::uint64_t> suppressed{0};
+
+  std::string out;
+  std::thread worker;
+
+  logger()
+  : worker([this]() { run(); })
+  {
+  }
+
+  ~logger() {
+    {
+      auto lock = std::lock_guard<std::mutex>(mtx);
+      stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+  }
+
+  // `drain` must be called with `mtx` held
+  //
+  auto drain() -> void {
+    out.clear();
+
+    auto count = std::size_t{0};
+    for (auto& p : producers) {
+      count += p->ring.consume_all(
+        [&](log_record const& r) { format_record(r, out); });
+    }
+
+    if (count > 0) {
+      sink(out);
+      written.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // producers whose threads have exited are only referenced by us
+    //
+    producers.erase(
+      std::remove_if(
+        producers.begin(), producers.end(),
+        [](auto const& p) { return p.use_count() == 1 && p->ring.empty(); }),
+      producers.end());
+  }
+
+  auto run() -> void {
+    auto lock = std::unique_lock<std::mutex>(mtx);
+    while (true) {
+      wake.wait_for(lock, flush_interval, [this]() {
+        return stopping || flush_requested != flush_completed;
+      });
+
+      auto const target = flush_requested;
+      drain();
+
+      if (target != flush_completed) {
+        flush_completed = target;
+        flushed.notify_all();
+      }
+
+      if (stopping) { break; }
+    }
+  }
+
+  auto local_producer() -> producer& {
+    thread_local auto const p = [this]() {
+      auto p    = std::make_shared<producer>();
+      auto lock = std::lock_guard<std::mutex>(mtx);
+      producers.push_back(p);
+      return p;
+    }();
+    return *p;
+  }
+
+  // `admit` applies the rate limit, returning false if the record should be
+  // skipped and otherwise storing how many records were skipped before it
+  //
+  auto admit(
+    std::string_view const           what,
+    boost::system::error_code const& ec,
+    std::int64_t const               now_ns,
+    std::uint64_t&                   skipped) -> bool {
+
+    auto const key =
+      std::hash<std::string_view>()(what) ^
+      (static_cast<std::size_t>(ec.value()) * 0x9e3779b97f4a7c15ull);
+
+    auto& slot = limits[key % rate_limit_slots];
+
+    auto const window =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        rate_limit_window).count();
+
+    auto start = slot.window_start.load(std::memory_order_relaxed);
+    if (now_ns - start >= window &&
+        slot.window_start.compare_exchange_strong(
+          start, now_ns, std::memory_order_relaxed)) {
+      slot.count.store(0, std::memory_order_relaxed);
+    }
+
+    if (slot.count.fetch_add(1, std::memory_order_relaxed) >=
+        rate_limit_burst) {
+      slot.suppressed.fetch_add(1, std::memory_order_relaxed);
+      suppressed.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    skipped = slot.suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+
+  static auto instance() -> logger& {
+    static logger l;
+    return l;
+  }
+};
+
+} // anonymous
+
+auto foxy::detail::write_log(
+  log_level const        level,
+  std::string_view const what,
+  log_fields const&      fields) -> void {
+
+  auto& l = logger::instance();
+
+  auto const now_ns =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+
+  auto skipped = std::uint64_t{0};
+  if (!l.admit(what, fields.ec, now_ns, skipped)) { return; }
+
+  auto const pushed = l.local_producer().ring.try_push([&](log_record& r) {
+    r.level        = level;
+    r.timestamp_ns = now_ns;
+    r.session_id   = fields.session_id;
+    r.elapsed_ns   = fields.elapsed.count();
+    r.ec_value     = fields.ec.value();
+    r.ec_category  = std::addressof(fields.ec.category());
+    r.suppressed   = skipped;
+    r.port         = fields.endpoint.port();
+    r.is_v6        = fields.endpoint.address().is_v6();
+    r.address      = {};
+
+    if (r.is_v6) {
+      r.address = fields.endpoint.address().to_v6().to_bytes();
+    } else {
+      auto const v4 = fields.endpoint.address().to_v4().to_bytes();
+      std::copy(v4.begin(), v4.end(), r.address.begin());
+    }
+
+    r.what_length =
+      static_cast<std::uint8_t>(std::min(what.size(), max_what_length));
+    std::copy_n(what.data(), r.what_length, r.what.data());
+  });
+
+  if (!pushed) {
+    l.dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
 
 auto foxy::log_error(
   boost::system::error_code const ec,
   std::string_view const what
 ) -> void {
 
-  std::cerr << what << " : " << ec << "\n\n";
-}
\ No newline at end of file
+  log_event<log_level::error>(what, log_fields{0, {}, ec});
+}
+
+auto foxy::set_log_sink(std::function<void(std::string_view)> sink) -> void {
+  auto& l    = logger::instance();
+  auto  lock = std::lock_guard<std::mutex>(l.mtx);
+  l.sink = sink ? std::move(sink) : default_sink;
+}
+
+auto foxy::flush_log() -> void {
+  auto& l    = logger::instance();
+  auto  lock = std::unique_lock<std::mutex>(l.mtx);
+
+  auto const target = ++l.flush_requested;
+  l.wake.notify_one();
+  l.flushed.wait(lock, [&]() { return l.flush_completed >= target; });
+}
+
+auto foxy::log_stats() -> log_stats_type {
+  auto& l = logger::instance();
+  return {
+    l.written.load(std::memory_order_relaxed),
+    l.dropped.load(std::memory_order_relaxed),
+    l.suppressed.load(std::memory_order_relaxed)
+  };
+}
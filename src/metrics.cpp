@@ -0,0 +1,197 @@
+#include "foxy/metrics.hpp"
+
+#include <thread>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+template <typename Named>
+auto find_or_make(
+  std::deque<Named>&     metrics,
+  std::string_view const name,
+  std::string_view const help) -> Named& {
+
+  auto pos = std::find_if(
+    metrics.begin(), metrics.end(),
+    [&](auto const& m) { return m.name == name; });
+
+  if (pos != metrics.end()) { return *pos; }
+
+  return metrics.emplace_back(name, help);
+}
+
+auto write_header(
+  std::string&           out,
+  std::string const&     name,
+  std::string const&     help,
+  std::string_view const type) -> void {
+
+  out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+  out.append("# TYPE ").append(name).append(" ");
+  out.append(type).append("\n");
+}
+
+auto format_seconds(std::uint64_t const ns) -> std::string {
+  char buf[32];
+  auto const n = std::snprintf(
+    buf, sizeof(buf), "%.9g", static_cast<double>(ns) / 1e9);
+  return std::string(buf, n);
+}
+
+} // anonymous
+
+auto foxy::detail::metrics_shard_index() noexcept -> std::size_t {
+  thread_local auto const idx =
+    std::hash<std::thread::id>()(std::this_thread::get_id()) %
+    counter::num_shards;
+
+  return idx;
+}
+
+auto foxy::counter::value() const noexcept -> std::uint64_t {
+  auto total = std::uint64_t{0};
+  for (auto const& s : shards_) {
+    total += s.value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+foxy::histogram::histogram()
+: count_(0)
+, sum_(0)
+, max_(0)
+{
+  for (auto& b : buckets_) { b.store(0, std::memory_order_relaxed); }
+}
+
+auto foxy::histogram::bucket_upper_bound(std::size_t const idx) noexcept
+-> std::uint64_t {
+  if (idx < sub_buckets) { return idx; }
+
+  auto const shift   = idx / sub_buckets - 1;
+  auto const sub_idx = idx % sub_buckets;
+  auto const lower   =
+    static_cast<std::uint64_t>(sub_buckets + sub_idx) << shift;
+
+  return lower + ((std::uint64_t{1} << shift) - 1);
+}
+
+auto foxy::histogram::snapshot() const -> histogram_snapshot {
+  auto s = histogram_snapshot();
+
+  s.buckets.resize(num_buckets);
+  for (auto i = std::size_t{0}; i < num_buckets; ++i) {
+    s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    s.count += s.buckets[i];
+  }
+
+  s.sum = sum_.load(std::memory_order_relaxed);
+  s.max = max_.load(std::memory_order_relaxed);
+
+  return s;
+}
+
+auto foxy::histogram_snapshot::value_at(double const q) const
+-> std::uint64_t {
+  if (count == 0) { return 0; }
+
+  auto const clamped = std::min(std::max(q, 0.0), 1.0);
+  auto const target  = std::max<std::uint64_t>(
+    1, static_cast<std::uint64_t>(std::ceil(clamped * count)));
+
+  auto seen = std::uint64_t{0};
+  for (auto i = std::size_t{0}; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= target) {
+      return std::min(histogram::bucket_upper_bound(i), max);
+    }
+  }
+
+  return max;
+}
+
+auto foxy::metrics_registry::make_counter(
+  std::string_view const name,
+  std::string_view const help) -> counter& {
+
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  return find_or_make(counters_, name, help).metric;
+}
+
+auto foxy::metrics_registry::make_gauge(
+  std::string_view const name,
+  std::string_view const help) -> gauge& {
+
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  return find_or_make(gauges_, name, help).metric;
+}
+
+auto foxy::metrics_registry::make_histogram(
+  std::string_view const name,
+  std::string_view const help) -> histogram& {
+
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  return find_or_make(histograms_, name, help).metric;
+}
+
+auto foxy::metrics_registry::snapshot() const -> metrics_snapshot {
+  auto s    = metrics_snapshot();
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  for (auto const& c : counters_) {
+    s.counters.push_back({c.name, c.help, c.metric.value()});
+  }
+
+  for (auto const& g : gauges_) {
+    s.gauges.push_back({g.name, g.help, g.metric.value()});
+  }
+
+  for (auto const& h : histograms_) {
+    s.histograms.push_back({h.name, h.help, h.metric.snapshot()});
+  }
+
+  return s;
+}
+
+auto foxy::metrics_registry::global() -> metrics_registry& {
+  static metrics_registry registry;
+  return registry;
+}
+
+auto foxy::write_prometheus(metrics_snapshot const& snapshot, std::string& out)
+-> void {
+  static constexpr double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+  for (auto const& c : snapshot.counters) {
+    write_header(out, c.name, c.help, "counter");
+    out.append(c.name).append(" ");
+    out.append(std::to_string(c.value)).append("\n");
+  }
+
+  for (auto const& g : snapshot.gauges) {
+    write_header(out, g.name, g.help, "gauge");
+    out.append(g.name).append(" ");
+    out.append(std::to_string(g.value)).append("\n");
+  }
+
+  for (auto const& h : snapshot.histograms) {
+    write_header(out, h.name, h.help, "summary");
+
+    for (auto const q : quantiles) {
+      char buf[32];
+      auto const n = std::snprintf(buf, sizeof(buf), "%g", q);
+
+      out.append(h.name).append("{quantile=\"");
+      out.append(buf, n).append("\"} ");
+      out.append(format_seconds(h.value.value_at(q))).append("\n");
+    }
+
+    out.append(h.name).append("_sum ");
+    out.append(format_seconds(h.value.sum)).append("\n");
+    out.append(h.name).append("_count ");
+    out.append(std::to_string(h.value.count)).append("\n");
+  }
+}
@@ -1,8 +1,14 @@
 #include "foxy/multi_stream.hpp"
 
+#include <boost/asio/error.hpp>
+#include <boost/core/ignore_unused.hpp>
+
 foxy::multi_stream::multi_stream(boost::asio::io_context& io)
 : stream_(io)
 , ssl_stream_()
+#ifdef FOXY_HAS_IO_URING
+, uring_(detail::uring_service::find(io))
+#endif
 {
 }
 
@@ -10,12 +16,15 @@ foxy::multi_stream::multi_stream(
   boost::asio::io_context&   io,
   boost::asio::ssl::context& ctx)
 : stream_(io)
-, ssl_stream_(std::in_place, stream_, ctx)
+, ssl_stream_(std::in_place, io, ctx)
+#ifdef FOXY_HAS_IO_URING
+, uring_(nullptr)
+#endif
 {
 }
 
 auto foxy::multi_stream::get_executor() -> executor_type {
-  return stream_.get_executor();
+  return stream().get_executor();
 }
 
 auto foxy::multi_stream::is_ssl() const -> bool {
@@ -23,9 +32,43 @@ auto foxy::multi_stream::is_ssl() const -> bool {
 }
 
 auto foxy::multi_stream::stream() & -> stream_type& {
+  if (ssl_stream_) {
+    return ssl_stream_->next_layer();
+  }
+
   return stream_;
 }
 
 auto foxy::multi_stream::ssl_stream() & -> ssl_stream_type& {
   return *ssl_stream_;
-}
\ No newline at end of file
+}
+
+auto foxy::multi_stream::enable_zerocopy(
+  std::size_t const          threshold,
+  boost::system::error_code& ec) -> void {
+
+  ec = {};
+
+#ifdef FOXY_HAS_ZEROCOPY
+  if (is_ssl()) {
+    ec = boost::asio::error::operation_not_supported;
+    return;
+  }
+
+  auto const on = 1;
+  if (::setsockopt(
+        stream().native_handle(), SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on))
+      < 0) {
+    ec.assign(errno, boost::asio::error::get_system_category());
+    return;
+  }
+
+  if (!zerocopy_) {
+    zerocopy_ = std::make_shared<detail::zerocopy_state>();
+  }
+  zerocopy_->threshold = threshold;
+#else
+  boost::ignore_unused(threshold);
+  ec = boost::asio::error::operation_not_supported;
+#endif
+}
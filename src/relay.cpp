@@ -0,0 +1,154 @@
+#include "foxy/detail/relay.hpp"
+#include "foxy/detail/buffer_pool.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#include <boost/asio/write.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+namespace asio = boost::asio;
+
+using boost::system::error_code;
+using strand_type = foxy::detail::session_state::strand_type;
+
+namespace {
+
+auto shutdown_both(foxy::detail::session_state& s) -> void {
+  auto ec = error_code();
+  s.stream.stream().shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+}
+
+} // anonymous
+
+auto foxy::detail::async_relay_one_way(
+  session_state& from,
+  session_state& to,
+  error_code&    ec
+) -> awaitable<void, strand_type> {
+
+  auto token       = co_await this_coro::token();
+  auto error_token = redirect_error(token, ec);
+
+  auto& metrics = session_metrics::get();
+
+  ec = {};
+
+  // whatever the HTTP parser read past the end of the last message belongs
+  // to the other side
+  //
+  if (from.buffer.size() > 0) {
+    auto const bytes_transferred =
+      co_await asio::async_write(to.stream, from.buffer.data(), error_token);
+
+    from.buffer.consume(from.buffer.size());
+    metrics.bytes_written.add(bytes_transferred);
+
+    if (ec) { co_return; }
+  }
+
+  auto buf = adaptive_buffer();
+
+  while (true) {
+    // a relayed connection can sit idle for hours so it holds nothing while
+    // it waits; TLS may already have decrypted data in hand so it has to be
+    // read from straight away
+    //
+    buf.release();
+
+    if (!from.stream.is_ssl()) {
+      co_await from.stream.stream().async_wait(
+        asio::ip::tcp::socket::wait_read, error_token);
+
+      if (ec) { co_return; }
+    }
+
+    auto const chunk = buf.prepare();
+
+    auto const bytes_read =
+      co_await from.stream.async_read_some(chunk, error_token);
+
+    buf.commit(bytes_read);
+    metrics.bytes_read.add(bytes_read);
+
+    if (bytes_read > 0) {
+      auto write_ec = error_code();
+
+      auto const bytes_written = co_await asio::async_write(
+        to.stream,
+        asio::buffer(chunk.data(), bytes_read),
+        redirect_error(token, write_ec));
+
+      metrics.bytes_written.add(bytes_written);
+
+      if (write_ec) {
+        ec = write_ec;
+        co_return;
+      }
+    }
+
+    if (ec == asio::error::eof) {
+      ec = {};
+
+      if (!to.stream.is_ssl()) {
+        to.stream.stream().shutdown(
+          asio::ip::tcp::socket::shutdown_send, ec);
+      }
+      co_return;
+    }
+
+    if (ec) { co_return; }
+  }
+}
+
+auto foxy::detail::async_relay(
+  std::shared_ptr<session_state> const& a,
+  std::shared_ptr<session_state> const& b,
+  error_code&                           ec
+) -> awaitable<void, strand_type> {
+
+  auto token    = co_await this_coro::token();
+  auto executor = co_await this_coro::executor();
+
+  ec = {};
+
+  // queued messages go out ahead of anything relayed
+  //
+  auto bytes_written = std::size_t{0};
+  co_await async_flush_output(*a, bytes_written, ec);
+  if (!ec) { co_await async_flush_output(*b, bytes_written, ec); }
+  if (ec) { co_return; }
+
+  auto reverse_ec   = error_code();
+  auto reverse_done = false;
+
+  auto done = session_state::timer_type(a->stream.get_executor().context());
+  done.expires_at(session_state::timer_type::time_point::max());
+
+  co_spawn(
+    executor,
+    [&, a, b]() -> awaitable<void, strand_type> {
+      co_await async_relay_one_way(*b, *a, reverse_ec);
+      if (reverse_ec) {
+        shutdown_both(*a);
+        shutdown_both(*b);
+      }
+
+      reverse_done = true;
+      done.cancel();
+    },
+    detached);
+
+  co_await async_relay_one_way(*a, *b, ec);
+  if (ec) {
+    shutdown_both(*a);
+    shutdown_both(*b);
+  }
+
+  auto wait_ec = error_code();
+  while (!reverse_done) {
+    co_await done.async_wait(redirect_error(token, wait_ec));
+  }
+
+  if (!ec) { ec = reverse_ec; }
+}
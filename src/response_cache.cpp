@@ -0,0 +1,871 @@
+#include "foxy/response_cache.hpp"
+#include "foxy/log.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/core/string.hpp>
+#include <boost/beast/http/rfc7230.hpp>
+
+#include <boost/system/error_code.hpp>
+
+#include <deque>
+#include <limits>
+#include <cstring>
+#include <utility>
+#include <optional>
+#include <algorithm>
+#include <functional>
+
+#if BOOST_BEAST_USE_POSIX_FILE
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace asio  = boost::asio;
+namespace beast = boost::beast;
+namespace http  = beast::http;
+
+using boost::system::error_code;
+using boost::beast::iequals;
+using seconds = std::chrono::seconds;
+
+namespace {
+
+// the directives of a `Cache-Control` field which matter to us, those whose
+// presence would otherwise make a response cacheable being taken to be set
+// whatever their arguments are
+//
+struct cache_control {
+  bool no_store   = false;
+  bool no_cache   = false;
+  bool is_private = false;
+
+  std::optional<seconds> max_age;
+  std::optional<seconds> s_maxage;
+  std::optional<seconds> min_fresh;
+};
+
+// delta-seconds too large to represent are taken to be 2^31 (RFC 7234
+// section 1.2.1)
+//
+auto parse_delta_seconds(beast::string_view const value)
+-> std::optional<seconds> {
+
+  constexpr auto max_delta = std::int64_t{2147483648};
+
+  if (value.empty()) { return {}; }
+
+  auto delta = std::int64_t{0};
+  for (auto const c : value) {
+    if (c < '0' || c > '9') { return {}; }
+
+    delta = std::min(delta * 10 + (c - '0'), max_delta);
+  }
+
+  return seconds(delta);
+}
+
+auto parse_cache_control(http::fields const& fields) -> cache_control {
+  auto cc = cache_control();
+
+  auto const is_space = [](char const c) { return c == ' ' || c == '\t'; };
+
+  auto const apply = [&](
+    beast::string_view const name,
+    beast::string_view const arg) {
+    auto const delta = parse_delta_seconds(arg);
+
+    if (iequals(name, "no-store"))  { cc.no_store   = true; }
+    if (iequals(name, "no-cache"))  { cc.no_cache   = true; }
+    if (iequals(name, "private"))   { cc.is_private = true; }
+    if (iequals(name, "max-age"))   { cc.max_age    = delta; }
+    if (iequals(name, "s-maxage"))  { cc.s_maxage   = delta; }
+    if (iequals(name, "min-fresh")) { cc.min_fresh  = delta; }
+  };
+
+  auto const range = fields.equal_range(http::field::cache_control);
+  for (auto pos = range.first; pos != range.second; ++pos) {
+    auto v = pos->value();
+
+    while (!v.empty()) {
+      if (v.front() == ',' || is_space(v.front())) {
+        v.remove_prefix(1);
+        continue;
+      }
+
+      auto const name_end = v.find_first_of("=, \t");
+      auto const name     = v.substr(0, name_end);
+      v.remove_prefix(name.size());
+
+      auto arg = beast::string_view();
+      if (!v.empty() && v.front() == '=') {
+        v.remove_prefix(1);
+
+        if (!v.empty() && v.front() == '"') {
+          // quoted arguments are only ever lists of field names to us so
+          // escapes don't need undoing, only skipping
+          //
+          auto end = std::size_t{1};
+          while (end < v.size() && v[end] != '"') {
+            end += (v[end] == '\\') ? 2 : 1;
+          }
+
+          arg = v.substr(1, std::min(end, v.size()) - 1);
+          v.remove_prefix(std::min(end + 1, v.size()));
+        } else {
+          arg = v.substr(0, v.find_first_of(", \t"));
+          v.remove_prefix(arg.size());
+        }
+      }
+
+      apply(name, arg);
+    }
+  }
+
+  return cc;
+}
+
+// `parse_http_date` only understands the IMF-fixdate format every current
+// server sends, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+//
+auto parse_http_date(beast::string_view const value)
+-> std::optional<foxy::response_cache::time_point> {
+
+  static constexpr char const* months[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+  };
+
+  if (value.size() != 29 || value.substr(3, 2) != ", " ||
+      value.substr(25) != " GMT") {
+    return {};
+  }
+
+  auto const number = [&](std::size_t const pos, std::size_t const len)
+  -> int {
+    auto n = 0;
+    for (auto i = pos; i < pos + len; ++i) {
+      if (value[i] < '0' || value[i] > '9') { return -1; }
+      n = n * 10 + (value[i] - '0');
+    }
+    return n;
+  };
+
+  auto const day    = number(5, 2);
+  auto const year   = number(12, 4);
+  auto const hour   = number(17, 2);
+  auto const minute = number(20, 2);
+  auto const second = number(23, 2);
+
+  auto month = 0;
+  while (month < 12 && value.substr(8, 3) != months[month]) { ++month; }
+
+  if (day < 1 || day > 31 || month == 12 || year < 0 || hour < 0 ||
+      hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60 ||
+      value[11] != ' ' || value[16] != ' ' || value[19] != ':' ||
+      value[22] != ':') {
+    return {};
+  }
+
+  // days since the epoch of a proleptic Gregorian date, courtesy of Howard
+  // Hinnant's `days_from_civil`
+  //
+  auto const y   = static_cast<std::int64_t>(year) - (month < 2 ? 1 : 0);
+  auto const m   = static_cast<std::int64_t>(month + 1);
+  auto const era = (y >= 0 ? y : y - 399) / 400;
+  auto const yoe = y - era * 400;
+  auto const doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + day - 1;
+  auto const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  auto const days = era * 146097 + doe - 719468;
+
+  return foxy::response_cache::time_point(std::chrono::duration_cast<
+    foxy::response_cache::clock_type::duration>(
+      seconds(days * 86400 + hour * 3600 + minute * 60 + second)));
+}
+
+// `field_value` joins the values of every field called `name`
+//
+auto field_value(http::fields const& fields, beast::string_view const name)
+-> std::string {
+
+  auto value = std::string();
+
+  auto const range = fields.equal_range(name);
+  for (auto pos = range.first; pos != range.second; ++pos) {
+    if (!value.empty()) { value.append(", "); }
+    value.append(pos->value().data(), pos->value().size());
+  }
+
+  return value;
+}
+
+// `make_key` needs no method as only responses to GET are ever stored, with
+// HEAD answered from the same entries
+//
+auto make_key(
+  std::string_view const   authority,
+  beast::string_view const target) -> std::string {
+
+  auto key = std::string(authority);
+  key.append(target.data(), target.size());
+  return key;
+}
+
+// only responses with these status codes are cacheable by default (RFC 7231
+// section 6.1)
+//
+auto is_cacheable_status(unsigned const status) -> bool {
+  switch (status) {
+    case 200: case 203: case 204: case 300: case 301:
+    case 404: case 405: case 410: case 414: case 501:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// `freshness_lifetime` is how long `response` may be served without going
+// back to the origin, if it says so (RFC 7234 section 4.2.1)
+//
+// an `Expires` we can't make sense of means the response is already stale
+//
+auto freshness_lifetime(
+  http::response_header<> const&         response,
+  cache_control const&                   cc,
+  foxy::response_cache::time_point const date) -> std::optional<seconds> {
+
+  if (cc.s_maxage) { return cc.s_maxage; }
+  if (cc.max_age)  { return cc.max_age; }
+
+  auto const expires_pos = response.find(http::field::expires);
+  if (expires_pos == response.end()) { return {}; }
+
+  auto const expires = parse_http_date(expires_pos->value());
+
+  if (!expires || *expires <= date) { return seconds(0); }
+
+  return std::chrono::duration_cast<seconds>(*expires - date);
+}
+
+} // anonymous
+
+struct foxy::response_cache::entry {
+  std::string                                      key;
+  http::response_header<>                          header;
+  std::vector<std::pair<std::string, std::string>> vary;
+
+  // bodies stored in memory live in `memory_body`, `data` pointing into
+  // either it or the slab
+  //
+  std::string memory_body;
+  char const* data   = nullptr;
+  std::size_t size   = 0;
+  std::size_t offset = 0;
+
+  time_point  response_time;
+  seconds     initial_age = seconds(0);
+  seconds     lifetime    = seconds(0);
+  std::size_t charge      = 0;
+
+  // the number of `cached_response`s holding on to the entry, or -1 once its
+  // part of the slab has been handed to another
+  //
+  std::atomic<int> pins{0};
+
+  auto try_pin() noexcept -> bool {
+    auto n = pins.load(std::memory_order_relaxed);
+    while (n >= 0) {
+      if (pins.compare_exchange_weak(n, n + 1, std::memory_order_acquire)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  auto unpin() noexcept -> void {
+    pins.fetch_sub(1, std::memory_order_release);
+  }
+
+  auto try_reclaim() noexcept -> bool {
+    auto n = 0;
+    return pins.compare_exchange_strong(n, -1, std::memory_order_acquire);
+  }
+
+  auto age(time_point const now) const -> seconds {
+    auto const resident = std::chrono::duration_cast<seconds>(
+      now - response_time);
+
+    return initial_age + std::max(resident, seconds(0));
+  }
+
+  auto matches(http::fields const& request) const -> bool {
+    return std::all_of(vary.begin(), vary.end(), [&](auto const& field) {
+      return field_value(request, field.first) == field.second;
+    });
+  }
+};
+
+// slab is the file larger bodies are kept in, written to in order and wrapping
+// around once full
+//
+// `resident` holds every entry with a body in the slab, oldest first, so that
+// room for a new body is made by reclaiming from the front until there's a
+// contiguous gap large enough; a body which is still being sent can't be
+// reclaimed, in which case the new one isn't stored at all
+//
+// entries keep their place here even once the LRU has dropped them, only
+// going away when the ring comes around to them
+//
+struct foxy::response_cache::slab {
+  std::string path;
+  int         fd       = -1;
+  char*       base     = nullptr;
+  std::size_t capacity = 0;
+
+  std::mutex                         mtx;
+  std::deque<std::shared_ptr<entry>> resident;
+  std::size_t                        head = 0;
+  std::atomic<std::size_t>           bytes{0};
+
+  slab() = default;
+  slab(slab const&) = delete;
+
+  ~slab() {
+#if BOOST_BEAST_USE_POSIX_FILE
+    if (base) { ::munmap(base, capacity); }
+    if (fd >= 0) {
+      ::close(fd);
+      ::unlink(path.c_str());
+    }
+#endif
+  }
+
+  auto reclaim_front(std::atomic<std::uint64_t>& evictions) -> bool {
+    auto& e = *resident.front();
+    if (!e.try_reclaim()) { return false; }
+
+    bytes -= e.size;
+    detail::session_metrics::get().cache_slab_bytes.sub(
+      static_cast<std::int64_t>(e.size));
+
+    resident.pop_front();
+    ++evictions;
+    return true;
+  }
+
+  // `allocate` finds room for `e`'s body and takes its place at the back of
+  // the ring
+  //
+  auto allocate(
+    std::shared_ptr<entry> const& e,
+    std::atomic<std::uint64_t>&   evictions) -> bool {
+
+    if (e->size > capacity) { return false; }
+
+    while (!resident.empty()) {
+      auto const tail = resident.front()->offset;
+
+      if (head > tail) {
+        // the free space runs from the head to the end of the file and then
+        // on from the start of it up to the tail
+        //
+        if (capacity - head >= e->size) { break; }
+        head = 0;
+        continue;
+      }
+
+      if (tail - head >= e->size) { break; }
+      if (!reclaim_front(evictions)) { return false; }
+    }
+
+    if (resident.empty()) { head = 0; }
+
+    e->offset = head;
+    e->data   = base + head;
+
+    head += e->size;
+    bytes += e->size;
+    detail::session_metrics::get().cache_slab_bytes.add(
+      static_cast<std::int64_t>(e->size));
+
+    resident.push_back(e);
+    return true;
+  }
+};
+
+auto foxy::response_cache::stats_type::hit_ratio() const noexcept -> double {
+  auto const lookups = hits + misses;
+  return lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+}
+
+foxy::response_cache::cached_response::cached_response(
+  std::shared_ptr<entry> e)
+: e_(std::move(e))
+{
+}
+
+foxy::response_cache::cached_response::cached_response(
+  cached_response&& other) noexcept
+: e_(std::move(other.e_))
+{
+}
+
+foxy::response_cache::cached_response::~cached_response() {
+  if (e_) { e_->unpin(); }
+}
+
+auto foxy::response_cache::cached_response::operator=(
+  cached_response&& other) noexcept -> cached_response& {
+
+  if (this != &other) {
+    if (e_) { e_->unpin(); }
+    e_ = std::move(other.e_);
+  }
+  return *this;
+}
+
+foxy::response_cache::cached_response::operator bool() const noexcept {
+  return static_cast<bool>(e_);
+}
+
+auto foxy::response_cache::cached_response::header() const
+-> http::response_header<> const& {
+  return e_->header;
+}
+
+auto foxy::response_cache::cached_response::body() const
+-> asio::const_buffer {
+  return asio::const_buffer(e_->data, e_->size);
+}
+
+auto foxy::response_cache::cached_response::age(time_point const now) const
+-> seconds {
+  return e_->age(now);
+}
+
+foxy::response_cache::response_cache(options const& opts)
+: opts_(opts)
+, shards_(new shard[num_shards])
+, hits_(0)
+, misses_(0)
+, stores_(0)
+, evictions_(0)
+, memory_bytes_(0)
+{
+  if (!enabled() || opts_.slab_path.empty() || opts_.slab_capacity == 0) {
+    return;
+  }
+
+#if BOOST_BEAST_USE_POSIX_FILE
+  auto s = std::make_unique<slab>();
+  s->path     = opts_.slab_path;
+  s->capacity = opts_.slab_capacity;
+
+  // the slab's contents mean nothing without the index that was in memory so
+  // whatever a previous process left behind is thrown away
+  //
+  s->fd = ::open(
+    s->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+  auto const is_mapped = [&] {
+    if (s->fd < 0) { return false; }
+
+    if (::ftruncate(s->fd, static_cast<off_t>(s->capacity)) != 0) {
+      return false;
+    }
+
+    auto* const addr = ::mmap(
+      nullptr, s->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+
+    if (addr == MAP_FAILED) { return false; }
+
+    s->base = static_cast<char*>(addr);
+    return true;
+  }();
+
+  if (!is_mapped) {
+    log_error(
+      error_code(errno, boost::system::system_category()),
+      "response cache slab");
+    return;
+  }
+
+  slab_ = std::move(s);
+#endif
+}
+
+foxy::response_cache::~response_cache() {
+  auto& metrics = detail::session_metrics::get();
+
+  metrics.cache_memory_bytes.sub(
+    static_cast<std::int64_t>(memory_bytes_.load()));
+
+  if (slab_) {
+    metrics.cache_slab_bytes.sub(
+      static_cast<std::int64_t>(slab_->bytes.load()));
+  }
+}
+
+auto foxy::response_cache::enabled() const noexcept -> bool {
+  return opts_.memory_capacity > 0;
+}
+
+auto foxy::response_cache::max_object_size() const noexcept -> std::size_t {
+  return slab_
+    ? opts_.max_object_size
+    : std::min(opts_.max_object_size, opts_.max_memory_object_size);
+}
+
+auto foxy::response_cache::shard_for(std::string_view const key) -> shard& {
+  return shards_[std::hash<std::string_view>()(key) % num_shards];
+}
+
+auto foxy::response_cache::erase(shard& s, lru_type::iterator const pos)
+-> void {
+  auto const& e = **pos;
+
+  auto const it = s.index.find(e.key);
+  if (it != s.index.end()) {
+    auto& variants = it->second;
+    variants.erase(std::remove(variants.begin(), variants.end(), pos),
+                   variants.end());
+
+    if (variants.empty()) { s.index.erase(it); }
+  }
+
+  s.bytes       -= e.charge;
+  memory_bytes_ -= e.charge;
+  detail::session_metrics::get().cache_memory_bytes.sub(
+    static_cast<std::int64_t>(e.charge));
+
+  s.lru.erase(pos);
+}
+
+auto foxy::response_cache::lookup(
+  std::string_view const        authority,
+  http::request_header<> const& request,
+  time_point const              now) -> cached_response {
+
+  if (!enabled()) { return {}; }
+
+  auto& metrics = detail::session_metrics::get();
+
+  auto const miss = [&] {
+    ++misses_;
+    metrics.cache_misses.add();
+    return cached_response();
+  };
+
+  if (!can_share(request)) { return miss(); }
+
+  auto const cc  = parse_cache_control(request);
+  auto const key = make_key(authority, request.target());
+
+  auto& s = shard_for(key);
+
+  auto found = cached_response();
+  {
+    auto lock = std::lock_guard<std::mutex>(s.mtx);
+
+    auto const it = s.index.find(key);
+    if (it == s.index.end()) { return miss(); }
+
+    for (auto const pos : it->second) {
+      auto const& e = *pos;
+      if (!e->matches(request)) { continue; }
+
+      auto const age = e->age(now);
+
+      // stale entries are of no more use to anyone, nor are those whose body
+      // the slab has reused
+      //
+      if (age >= e->lifetime || !e->try_pin()) {
+        erase(s, pos);
+        break;
+      }
+
+      found = cached_response(e);
+
+      // the client may want something fresher than what would do for others
+      //
+      auto const is_acceptable =
+        (!cc.max_age || age <= *cc.max_age) &&
+        (!cc.min_fresh || age + *cc.min_fresh <= e->lifetime);
+
+      if (!is_acceptable) {
+        found = cached_response();
+        break;
+      }
+
+      s.lru.splice(s.lru.begin(), s.lru, pos);
+      break;
+    }
+  }
+
+  if (!found) { return miss(); }
+
+  ++hits_;
+  metrics.cache_hits.add();
+  return found;
+}
+
+auto foxy::response_cache::can_share(http::request_header<> const& request)
+-> bool {
+
+  auto const cc = parse_cache_control(request);
+
+  // a request asking for an end-to-end reload has to reach the origin
+  //
+  auto const is_reload =
+    cc.no_store || cc.no_cache ||
+    (request.count(http::field::cache_control) == 0 &&
+     http::token_list(request[http::field::pragma]).exists("no-cache"));
+
+  auto const is_method_ok =
+    request.method() == http::verb::get ||
+    request.method() == http::verb::head;
+
+  return
+    is_method_ok && !is_reload &&
+    request.count(http::field::authorization) == 0;
+}
+
+auto foxy::response_cache::can_share(
+  http::request_header<> const&  request,
+  http::response_header<> const& response) -> bool {
+
+  if (request.method() != http::verb::get) { return false; }
+
+  // responses to authenticated requests are only meant for whoever made them
+  // and so are responses setting cookies, as far as a shared cache goes
+  //
+  if (request.count(http::field::authorization) > 0 ||
+      response.count(http::field::set_cookie) > 0) {
+    return false;
+  }
+
+  if (!is_cacheable_status(response.result_int())) { return false; }
+
+  auto const request_cc  = parse_cache_control(request);
+  auto const response_cc = parse_cache_control(response);
+
+  // without revalidation, a response which has to be revalidated before every
+  // use is as good as one which mustn't be stored
+  //
+  if (request_cc.no_store || response_cc.no_store || response_cc.no_cache ||
+      response_cc.is_private) {
+    return false;
+  }
+
+  auto const has_lifetime =
+    response_cc.s_maxage || response_cc.max_age ||
+    response.count(http::field::expires) > 0;
+
+  if (!has_lifetime) { return false; }
+
+  auto const vary = response[http::field::vary];
+  return !http::token_list(vary).exists("*");
+}
+
+auto foxy::response_cache::is_same_variant(
+  http::response_header<> const& response,
+  http::request_header<> const&  a,
+  http::request_header<> const&  b) -> bool {
+
+  auto const names = http::token_list(response[http::field::vary]);
+  return std::all_of(names.begin(), names.end(), [&](auto const name) {
+    return field_value(a, name) == field_value(b, name);
+  });
+}
+
+auto foxy::response_cache::is_storable(
+  http::request_header<> const&  request,
+  http::response_header<> const& response) const -> bool {
+
+  if (!enabled() || !can_share(request, response)) { return false; }
+
+  auto const length = response[http::field::content_length];
+  if (!length.empty()) {
+    auto const size = parse_delta_seconds(length);
+
+    auto const is_too_large =
+      !size || static_cast<std::uint64_t>(size->count()) > max_object_size();
+
+    if (is_too_large) { return false; }
+  }
+
+  return true;
+}
+
+auto foxy::response_cache::store(
+  std::string_view const         authority,
+  http::request_header<> const&  request,
+  http::response_header<> const& response,
+  std::string_view const         body,
+  time_point const               now) -> bool {
+
+  if (!is_storable(request, response)) { return false; }
+
+  if (body.size() > max_object_size()) { return false; }
+
+  auto const is_large = body.size() > opts_.max_memory_object_size;
+
+  auto const cc = parse_cache_control(response);
+
+  auto const date_pos = response.find(http::field::date);
+  auto const date =
+    date_pos == response.end()
+      ? std::nullopt
+      : parse_http_date(date_pos->value());
+
+  auto const date_value = date.value_or(now);
+
+  auto const lifetime = freshness_lifetime(response, cc, date_value);
+  if (!lifetime) { return false; }
+
+  // how old the response already was when it got to us (RFC 7234 section
+  // 4.2.3), leaving out the time it took to arrive
+  //
+  auto const age_field = response[http::field::age];
+  auto const age_value = parse_delta_seconds(age_field);
+
+  auto const apparent_age = std::max(
+    std::chrono::duration_cast<seconds>(now - date_value), seconds(0));
+
+  auto const initial_age = std::max(apparent_age, age_value.value_or(
+    seconds(0)));
+
+  if (initial_age >= *lifetime) { return false; }
+
+  auto e = std::make_shared<entry>();
+
+  e->key = make_key(authority, request.target());
+
+  e->header = response;
+  e->header.erase(http::field::age);
+  e->header.erase(http::field::transfer_encoding);
+
+  if (response.result() == http::status::no_content) {
+    e->header.erase(http::field::content_length);
+  } else {
+    e->header.set(http::field::content_length, std::to_string(body.size()));
+  }
+
+  for (auto const name : http::token_list(response[http::field::vary])) {
+    e->vary.emplace_back(std::string(name), field_value(request, name));
+  }
+
+  e->response_time = now;
+  e->initial_age   = initial_age;
+  e->lifetime      = *lifetime;
+  e->size          = body.size();
+
+  e->charge = sizeof(entry) + 2 * e->key.size();
+  for (auto const& field : e->header) {
+    e->charge += field.name_string().size() + field.value().size();
+  }
+  for (auto const& field : e->vary) {
+    e->charge += field.first.size() + field.second.size();
+  }
+
+  if (!is_large) {
+    e->memory_body = std::string(body);
+    e->data        = e->memory_body.data();
+    e->charge     += e->memory_body.size();
+  }
+
+  auto const budget = opts_.memory_capacity / num_shards;
+  if (e->charge > budget) { return false; }
+
+  if (is_large) {
+    // the body is copied into the slab outside of its lock, pinned so that
+    // nothing reclaims it halfway through
+    //
+    e->pins = 1;
+    {
+      auto lock = std::lock_guard<std::mutex>(slab_->mtx);
+      if (!slab_->allocate(e, evictions_)) { return false; }
+    }
+
+    std::memcpy(slab_->base + e->offset, body.data(), body.size());
+    e->unpin();
+  }
+
+  auto& s = shard_for(e->key);
+  {
+    auto lock = std::lock_guard<std::mutex>(s.mtx);
+
+    // the new response replaces the variant it's for as well as every other
+    // variant if the origin has since changed what it varies on
+    //
+    auto const it = s.index.find(e->key);
+    if (it != s.index.end()) {
+      auto const stale = std::vector<lru_type::iterator>(it->second);
+      for (auto const pos : stale) {
+        auto const& other = **pos;
+
+        auto const same_names = std::equal(
+          other.vary.begin(), other.vary.end(),
+          e->vary.begin(), e->vary.end(),
+          [](auto const& a, auto const& b) {
+            return iequals(a.first, b.first);
+          });
+
+        if (!same_names || other.matches(request)) { erase(s, pos); }
+      }
+    }
+
+    s.lru.push_front(e);
+    s.index[e->key].push_back(s.lru.begin());
+
+    s.bytes       += e->charge;
+    memory_bytes_ += e->charge;
+    detail::session_metrics::get().cache_memory_bytes.add(
+      static_cast<std::int64_t>(e->charge));
+
+    while (s.bytes > budget) {
+      erase(s, std::prev(s.lru.end()));
+      ++evictions_;
+    }
+  }
+
+  ++stores_;
+  return true;
+}
+
+auto foxy::response_cache::invalidate(
+  std::string_view const authority,
+  std::string_view const target) -> void {
+
+  if (!enabled()) { return; }
+
+  auto const key = make_key(
+    authority, beast::string_view(target.data(), target.size()));
+
+  auto& s = shard_for(key);
+
+  auto lock = std::lock_guard<std::mutex>(s.mtx);
+
+  auto const it = s.index.find(key);
+  if (it == s.index.end()) { return; }
+
+  auto const variants = std::vector<lru_type::iterator>(it->second);
+  for (auto const pos : variants) { erase(s, pos); }
+}
+
+auto foxy::response_cache::stats() const -> stats_type {
+  auto s = stats_type();
+
+  s.hits         = hits_.load(std::memory_order_relaxed);
+  s.misses       = misses_.load(std::memory_order_relaxed);
+  s.stores       = stores_.load(std::memory_order_relaxed);
+  s.evictions    = evictions_.load(std::memory_order_relaxed);
+  s.memory_bytes = memory_bytes_.load(std::memory_order_relaxed);
+  s.slab_bytes   = slab_ ? slab_->bytes.load(std::memory_order_relaxed) : 0;
+
+  return s;
+}
@@ -0,0 +1,263 @@
+#include "foxy/runtime.hpp"
+#include "foxy/socket_options.hpp"
+#include "foxy/detail/buffer_pool.hpp"
+
+#include <boost/asio/error.hpp>
+#include <boost/system/system_error.hpp>
+
+#if !defined(BOOST_ASIO_WINDOWS)
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#endif
+
+#include <cerrno>
+#include <utility>
+#include <algorithm>
+
+namespace asio = boost::asio;
+
+using boost::system::error_code;
+
+namespace {
+
+constexpr auto no_worker = static_cast<std::size_t>(-1);
+
+// the runtime the calling thread belongs to, if any, and its place in it
+//
+thread_local foxy::runtime const* current_runtime = nullptr;
+thread_local std::size_t          current_idx     = 0;
+
+// allowed_cpus lists the CPUs the process may be scheduled on, which under
+// taskset or a cpuset cgroup is fewer than the machine has
+//
+auto allowed_cpus() -> std::vector<int> {
+  auto cpus = std::vector<int>();
+
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (auto cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) { cpus.push_back(cpu); }
+    }
+  }
+#endif
+
+  return cpus;
+}
+
+auto pin_to(int const cpu) -> void {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+#endif
+}
+
+auto current_numa_node() -> int {
+#if defined(__linux__) && defined(SYS_getcpu)
+  auto cpu  = 0u;
+  auto node = 0u;
+
+  if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return static_cast<int>(node);
+  }
+#endif
+
+  return -1;
+}
+
+} // anonymous
+
+// a context only ever run by its one thread can do without most of its
+// locking
+//
+foxy::runtime::context_type::context_type()
+: asio::io_context(1)
+{
+}
+
+foxy::runtime::worker::worker(int const cpu_)
+: io()
+, work()
+, cpu(cpu_)
+, numa_node(-1)
+, thread()
+{
+}
+
+foxy::runtime::runtime(options const& opts)
+: opts_(opts)
+, pools_()
+, workers_()
+, by_cpu_()
+, next_(0)
+{
+  auto const cpus = allowed_cpus();
+
+  auto num_threads = opts_.num_threads;
+  if (num_threads == 0) {
+    num_threads = cpus.empty()
+      ? std::max(std::size_t{1},
+                 static_cast<std::size_t>(std::thread::hardware_concurrency()))
+      : cpus.size();
+  }
+
+  pools_.resize(num_threads);
+  workers_.reserve(num_threads);
+
+  for (auto idx = std::size_t{0}; idx < num_threads; ++idx) {
+    auto const cpu =
+      (opts_.pin_threads && !cpus.empty()) ? cpus[idx % cpus.size()] : -1;
+
+    workers_.push_back(std::make_unique<worker>(cpu));
+
+    // with more threads than CPUs, connections arriving on a CPU go to the
+    // first of the threads sharing it
+    //
+    if (cpu >= 0) {
+      auto const pos = static_cast<std::size_t>(cpu);
+      if (by_cpu_.size() <= pos) { by_cpu_.resize(pos + 1, no_worker); }
+      if (by_cpu_[pos] == no_worker) { by_cpu_[pos] = idx; }
+    }
+  }
+}
+
+foxy::runtime::~runtime() {
+  stop();
+  join();
+
+  for (auto& w : workers_) {
+    w->io.shutdown();
+  }
+}
+
+auto foxy::runtime::run_worker(std::size_t const idx) -> void {
+  auto& w = *workers_[idx];
+
+  if (w.cpu >= 0) { pin_to(w.cpu); }
+  w.numa_node = current_numa_node();
+
+  if (!pools_[idx]) {
+    pools_[idx] =
+      std::make_unique<detail::buffer_pool>(opts_.max_cached_bytes);
+  }
+
+  current_runtime = this;
+  current_idx     = idx;
+  detail::buffer_pool::set_local(pools_[idx].get());
+
+  w.io.run();
+
+  detail::buffer_pool::set_local(nullptr);
+  current_runtime = nullptr;
+}
+
+auto foxy::runtime::run() -> void {
+  for (auto idx = std::size_t{0}; idx < workers_.size(); ++idx) {
+    auto& w = *workers_[idx];
+    if (w.thread.joinable()) { continue; }
+
+    w.io.restart();
+    w.work.emplace(w.io.get_executor());
+    w.thread = std::thread([this, idx] { run_worker(idx); });
+  }
+}
+
+auto foxy::runtime::stop() -> void {
+  for (auto& w : workers_) {
+    w->work.reset();
+    w->io.stop();
+  }
+}
+
+auto foxy::runtime::join() -> void {
+  for (auto& w : workers_) {
+    if (w->thread.joinable()) { w->thread.join(); }
+  }
+}
+
+auto foxy::runtime::size() const noexcept -> std::size_t {
+  return workers_.size();
+}
+
+auto foxy::runtime::context(std::size_t const idx) -> asio::io_context& {
+  return workers_[idx]->io;
+}
+
+auto foxy::runtime::cpu(std::size_t const idx) const noexcept -> int {
+  return workers_[idx]->cpu;
+}
+
+auto foxy::runtime::numa_node(std::size_t const idx) const noexcept -> int {
+  return workers_[idx]->numa_node.load(std::memory_order_relaxed);
+}
+
+auto foxy::runtime::local_context() -> asio::io_context& {
+  if (current_runtime == this) { return workers_[current_idx]->io; }
+
+  auto const idx = next_.fetch_add(1, std::memory_order_relaxed);
+  return workers_[idx % workers_.size()]->io;
+}
+
+auto foxy::runtime::context_for_cpu(int const cpu) -> asio::io_context& {
+  auto const pos = static_cast<std::size_t>(cpu);
+  if (cpu >= 0 && pos < by_cpu_.size() && by_cpu_[pos] != no_worker) {
+    return workers_[by_cpu_[pos]]->io;
+  }
+
+  auto const idx = next_.fetch_add(1, std::memory_order_relaxed);
+  return workers_[idx % workers_.size()]->io;
+}
+
+auto foxy::runtime::adopt(asio::ip::tcp::socket socket) -> multi_stream {
+  auto& own = socket.get_executor().context();
+
+#if defined(BOOST_ASIO_WINDOWS)
+  // descriptors can't be carried over to another context so the connection
+  // stays where it is
+  //
+  auto stream = multi_stream(own);
+  stream.stream() = std::move(socket);
+  return stream;
+#else
+  auto& io = context_for_cpu(incoming_cpu(socket));
+
+  auto stream = multi_stream(io);
+  if (&io == &own) {
+    stream.stream() = std::move(socket);
+    return stream;
+  }
+
+  auto ec = error_code();
+
+  auto const endpoint = socket.local_endpoint(ec);
+  if (ec) { throw boost::system::system_error(ec, "foxy::runtime::adopt"); }
+
+  // a socket can't change contexts so the connection goes over by way of a
+  // duplicate of its descriptor
+  //
+  auto const fd = ::dup(socket.native_handle());
+  if (fd < 0) {
+    ec = error_code(errno, asio::error::get_system_category());
+    throw boost::system::system_error(ec, "foxy::runtime::adopt");
+  }
+
+  stream.stream().assign(endpoint.protocol(), fd, ec);
+  if (ec) {
+    ::close(fd);
+    throw boost::system::system_error(ec, "foxy::runtime::adopt");
+  }
+
+  socket.close(ec);
+  return stream;
+#endif
+}
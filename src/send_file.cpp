@@ -0,0 +1,282 @@
+#include "foxy/detail/send_file.hpp"
+
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+
+#include <vector>
+#include <algorithm>
+
+#if BOOST_BEAST_USE_POSIX_FILE
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#if BOOST_BEAST_USE_POSIX_FILE && defined(__linux__)
+#include <sys/sendfile.h>
+#include <csignal>
+#include <ctime>
+#define FOXY_HAS_SENDFILE
+#endif
+
+namespace asio = boost::asio;
+
+using boost::system::error_code;
+using strand_type = foxy::detail::session_state::strand_type;
+
+namespace {
+
+#if BOOST_BEAST_USE_POSIX_FILE
+
+// mapping unmaps the region it owns when it goes out of scope, which may be
+// when the coroutine using it is destroyed mid-write
+//
+struct mapping {
+  void*       addr = MAP_FAILED;
+  std::size_t size = 0;
+
+  mapping() = default;
+  mapping(mapping const&) = delete;
+
+  ~mapping() {
+    if (addr != MAP_FAILED) { ::munmap(addr, size); }
+  }
+};
+
+auto send_mapped(
+  foxy::multi_stream&     stream,
+  int const               fd,
+  foxy::byte_range const  range,
+  std::uint64_t&          bytes_transferred,
+  error_code&             ec) -> foxy::awaitable<void, strand_type> {
+
+  auto token       = co_await foxy::this_coro::token();
+  auto error_token = foxy::redirect_error(token, ec);
+
+  // mappings have to start on a page boundary
+  //
+  auto const page    = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+  auto const aligned = range.offset - range.offset % page;
+  auto const delta   = static_cast<std::size_t>(range.offset - aligned);
+
+  auto m = mapping();
+  m.size = delta + static_cast<std::size_t>(range.length);
+  m.addr = ::mmap(
+    nullptr, m.size, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(aligned));
+
+  if (m.addr == MAP_FAILED) {
+    ec.assign(errno, boost::system::system_category());
+    co_return;
+  }
+
+  ::madvise(m.addr, m.size, MADV_SEQUENTIAL);
+
+  auto const* data = static_cast<char const*>(m.addr) + delta;
+
+  bytes_transferred = co_await asio::async_write(
+    stream,
+    asio::buffer(data, static_cast<std::size_t>(range.length)),
+    error_token);
+}
+
+#endif
+
+#ifdef FOXY_HAS_SENDFILE
+
+// sigpipe_guard keeps a write to a socket the peer has closed from killing
+// the process
+//
+// `sendfile(2)` has no equivalent to `MSG_NOSIGNAL` so SIGPIPE is blocked
+// for the calling thread instead and any instance of it raised while blocked
+// is consumed before the mask is restored
+//
+struct sigpipe_guard {
+  sigset_t old_mask;
+  bool     was_pending;
+
+  sigpipe_guard() {
+    auto block = sigset_t();
+    sigemptyset(&block);
+    sigaddset(&block, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &block, &old_mask);
+
+    auto pending = sigset_t();
+    sigpending(&pending);
+    was_pending = sigismember(&pending, SIGPIPE) == 1;
+  }
+
+  sigpipe_guard(sigpipe_guard const&) = delete;
+
+  ~sigpipe_guard() {
+    auto pending = sigset_t();
+    sigpending(&pending);
+
+    if (!was_pending && sigismember(&pending, SIGPIPE) == 1) {
+      auto set = sigset_t();
+      sigemptyset(&set);
+      sigaddset(&set, SIGPIPE);
+
+      auto const zero = timespec{0, 0};
+      sigtimedwait(&set, nullptr, &zero);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+  }
+};
+
+// `send_some` sends as much of the file as the socket will take without
+// blocking and returns false once it has to wait
+//
+auto send_some(
+  int const      socket,
+  int const      fd,
+  off_t&         offset,
+  std::uint64_t& remaining,
+  error_code&    ec) -> bool {
+
+  // the kernel caps a single call at a little under 2GiB anyway
+  //
+  constexpr auto max_chunk = std::uint64_t{1} << 30;
+
+  auto guard = sigpipe_guard();
+
+  while (remaining > 0) {
+    auto const n = ::sendfile(
+      socket, fd, &offset,
+      static_cast<std::size_t>(std::min(remaining, max_chunk)));
+
+    if (n > 0) {
+      remaining -= static_cast<std::uint64_t>(n);
+      continue;
+    }
+
+    if (n == 0) {
+      // the file is shorter than it was when the response was prepared
+      //
+      ec = asio::error::eof;
+      return true;
+    }
+
+    if (errno == EINTR) { continue; }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) { return false; }
+
+    ec.assign(errno, boost::system::system_category());
+    return true;
+  }
+
+  return true;
+}
+
+auto send_kernel(
+  foxy::multi_stream&     stream,
+  int const               fd,
+  foxy::byte_range const  range,
+  std::uint64_t&          bytes_transferred,
+  error_code&             ec) -> foxy::awaitable<void, strand_type> {
+
+  auto token       = co_await foxy::this_coro::token();
+  auto error_token = foxy::redirect_error(token, ec);
+
+  auto& socket = stream.stream();
+
+  // the socket is only left non-blocking for as long as we need it to be, so
+  // synchronous operations on it behave as they did before
+  //
+  auto const was_non_blocking = socket.non_blocking();
+
+  socket.non_blocking(true, ec);
+  if (ec) { co_return; }
+
+  auto offset    = static_cast<off_t>(range.offset);
+  auto remaining = range.length;
+
+  while (!send_some(socket.native_handle(), fd, offset, remaining, ec)) {
+    co_await socket.async_wait(
+      asio::ip::tcp::socket::wait_write, error_token);
+
+    if (ec) { break; }
+  }
+
+  bytes_transferred = range.length - remaining;
+
+  auto restore_ec = error_code();
+  socket.non_blocking(was_non_blocking, restore_ec);
+}
+
+#endif
+
+#if !BOOST_BEAST_USE_POSIX_FILE
+
+// without a file descriptor to hand to the kernel, the file is read through a
+// buffer of our own
+//
+auto send_buffered(
+  foxy::multi_stream&     stream,
+  boost::beast::file&     file,
+  foxy::byte_range const  range,
+  std::uint64_t&          bytes_transferred,
+  error_code&             ec) -> foxy::awaitable<void, strand_type> {
+
+  auto token       = co_await foxy::this_coro::token();
+  auto error_token = foxy::redirect_error(token, ec);
+
+  auto buffer = std::vector<char>(64 * 1024);
+
+  file.seek(range.offset, ec);
+  if (ec) { co_return; }
+
+  auto remaining = range.length;
+  while (remaining > 0) {
+    auto const want = static_cast<std::size_t>(
+      std::min<std::uint64_t>(remaining, buffer.size()));
+
+    auto const n = file.read(buffer.data(), want, ec);
+    if (ec) { co_return; }
+    if (n == 0) {
+      ec = asio::error::eof;
+      co_return;
+    }
+
+    bytes_transferred += co_await asio::async_write(
+      stream, asio::buffer(buffer.data(), n), error_token);
+
+    if (ec) { co_return; }
+    remaining -= n;
+  }
+}
+
+#endif
+
+} // anonymous
+
+auto foxy::detail::async_send_file(
+  multi_stream&        stream,
+  boost::beast::file&  file,
+  byte_range const     range,
+  std::uint64_t&       bytes_transferred,
+  error_code&          ec
+) -> foxy::awaitable<void, strand_type> {
+
+  bytes_transferred = 0;
+  if (range.length == 0) { co_return; }
+
+#if BOOST_BEAST_USE_POSIX_FILE
+  auto const fd = file.native_handle();
+
+#ifdef FOXY_HAS_SENDFILE
+  // asio's TLS engine encrypts through a memory BIO pair rather than the
+  // socket itself, so kernel TLS never gets a chance to take over and TLS
+  // streams always go through the mapping
+  //
+  if (!stream.is_ssl()) {
+    co_await send_kernel(stream, fd, range, bytes_transferred, ec);
+    co_return;
+  }
+#endif
+
+  co_await send_mapped(stream, fd, range, bytes_transferred, ec);
+#else
+  co_await send_buffered(stream, file, range, bytes_transferred, ec);
+#endif
+}
@@ -1,4 +1,5 @@
 #include "foxy/server_session.hpp"
+#include "foxy/detail/h2_connection.hpp"
 
 #include <boost/asio/post.hpp>
 
@@ -6,13 +7,36 @@ namespace asio = boost::asio;
 
 foxy::server_session::server_session(stream_type stream_)
 : detail::session(std::move(stream_))
+{
+  // the defaults are applied on a best-effort basis, same as for client
+  // sessions once they connect
+  //
+  auto ec = boost::system::error_code();
+  set_stream_options(s_->stream, s_->options, ec);
+}
+
+foxy::server_session::server_session(
+  runtime&                     rt,
+  boost::asio::ip::tcp::socket socket)
+: server_session(rt.adopt(std::move(socket)))
 {
 }
 
 auto foxy::server_session::shutdown() -> void {
+  // the GOAWAY has to go out ahead of the shutdown so it's left to the
+  // connection's writer
+  //
+  if (auto h2 = s_->h2) {
+    asio::post(h2->get_strand(), [h2] { h2->close(); });
+    return;
+  }
+
   auto& multi_stream = s_->stream;
 
   multi_stream
     .stream()
     .shutdown(boost::asio::ip::tcp::socket::shutdown_send);
-}
\ No newline at end of file
+}
+auto foxy::enable_http2_alpn(boost::asio::ssl::context& ctx) -> void {
+  detail::select_h2_alpn(ctx);
+}
@@ -15,4 +15,20 @@ foxy::detail::session::session(
 foxy::detail::session::session(stream_type stream_)
 : s_(std::make_shared<session_state>(std::move(stream_)))
 {
-}
\ No newline at end of file
+}
+
+auto foxy::detail::session::set_socket_options(
+  socket_options const& opts) -> void {
+
+  s_->options = opts;
+
+  if (s_->stream.stream().is_open()) {
+    auto ec = boost::system::error_code();
+    set_stream_options(s_->stream, s_->options, ec);
+  }
+}
+
+auto foxy::detail::session::set_timeout(
+  std::chrono::steady_clock::duration const timeout) -> void {
+  s_->timeout = timeout;
+}
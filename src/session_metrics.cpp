@@ -0,0 +1,105 @@
+#include "foxy/detail/session_metrics.hpp"
+
+auto foxy::detail::session_metrics::get() -> session_metrics& {
+  static session_metrics metrics = [](metrics_registry& r) {
+    return session_metrics{
+      r.make_histogram(
+        "foxy_session_read_header_seconds",
+        "Time spent reading an HTTP message header"),
+      r.make_histogram(
+        "foxy_session_read_seconds",
+        "Time spent reading a complete HTTP message"),
+      r.make_histogram(
+        "foxy_session_write_header_seconds",
+        "Time spent writing an HTTP message header"),
+      r.make_histogram(
+        "foxy_session_write_seconds",
+        "Time spent writing a complete HTTP message"),
+
+      r.make_counter(
+        "foxy_session_read_bytes_total",
+        "Bytes read by sessions"),
+      r.make_counter(
+        "foxy_session_written_bytes_total",
+        "Bytes written by sessions"),
+      r.make_counter(
+        "foxy_session_errors_total",
+        "Session reads and writes which failed"),
+      r.make_counter(
+        "foxy_session_timeouts_total",
+        "Session reads and writes which ran out of time"),
+
+      r.make_histogram(
+        "foxy_client_resolve_seconds",
+        "Time spent resolving the remote host"),
+      r.make_histogram(
+        "foxy_client_tcp_connect_seconds",
+        "Time spent establishing the TCP connection"),
+      r.make_histogram(
+        "foxy_client_tls_handshake_seconds",
+        "Time spent in the TLS handshake"),
+      r.make_counter(
+        "foxy_client_connect_errors_total",
+        "Connection attempts which failed in any phase"),
+
+      r.make_histogram(
+        "foxy_client_request_write_seconds",
+        "Time spent writing a request"),
+      r.make_histogram(
+        "foxy_client_time_to_first_byte_seconds",
+        "Time from a request being written to its response header arriving"),
+      r.make_histogram(
+        "foxy_client_response_body_seconds",
+        "Time spent reading a response body once its header is in"),
+      r.make_histogram(
+        "foxy_client_response_seconds",
+        "Time from a request being written to its response being read"),
+
+      r.make_gauge(
+        "foxy_proxy_active_sessions",
+        "Client connections currently being handled by the proxy"),
+      r.make_histogram(
+        "foxy_proxy_session_seconds",
+        "Lifetime of proxied client connections"),
+      r.make_counter(
+        "foxy_proxy_tunnel_bytes_total",
+        "Message body bytes relayed through proxy tunnels"),
+      r.make_counter(
+        "foxy_proxy_upgrades_total",
+        "Proxied connections switched over to relaying raw bytes"),
+      r.make_counter(
+        "foxy_proxy_collapsed_requests_total",
+        "Proxied requests answered with a response fetched for another"),
+
+      r.make_counter(
+        "foxy_proxy_cache_hits_total",
+        "Proxied requests answered from the response cache"),
+      r.make_counter(
+        "foxy_proxy_cache_misses_total",
+        "Proxied requests the response cache had no fresh answer for"),
+      r.make_gauge(
+        "foxy_proxy_cache_memory_bytes",
+        "Memory held by cached responses"),
+      r.make_gauge(
+        "foxy_proxy_cache_slab_bytes",
+        "Cached response bodies held in the mapped slab file"),
+
+      r.make_counter(
+        "foxy_zerocopy_sent_bytes_total",
+        "Bytes handed to the kernel with MSG_ZEROCOPY"),
+      r.make_counter(
+        "foxy_zerocopy_copied_total",
+        "Zero-copy sends which the kernel ended up copying anyway"),
+
+      r.make_counter(
+        "foxy_server_pipelined_requests_total",
+        "Requests served straight out of the read buffer"),
+
+      r.make_counter(
+        "foxy_server_h2_streams_total",
+        "HTTP/2 streams dispatched to request handlers")
+    };
+  }(metrics_registry::global());
+
+  return metrics;
+}
@@ -1,21 +1,147 @@
 #include "foxy/detail/session_state.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/error.hpp>
 
 foxy::detail::session_state::session_state(boost::asio::io_context& io)
-: timer(io)
-, stream(io)
+: stream(io)
+, timeout(0)
+, deadline(io, [this] { on_deadline(); })
+, timed_out(false)
 {
 }
 
 foxy::detail::session_state::session_state(
   boost::asio::io_context&   io,
   boost::asio::ssl::context& ctx)
-: timer(io)
-, stream(io, ctx)
+: stream(io, ctx)
+, timeout(0)
+, deadline(io, [this] { on_deadline(); })
+, timed_out(false)
 {
 }
 
 foxy::detail::session_state::session_state(stream_type stream_)
-: timer(stream_.get_executor().context())
-, stream(std::move(stream_))
+: stream(std::move(stream_))
+, timeout(0)
+, deadline(stream.get_executor().context(), [this] { on_deadline(); })
+, timed_out(false)
+{
+}
+
+auto foxy::detail::session_state::arm_deadline() -> void {
+  if (timeout == timeout.zero()) { return; }
+
+  timed_out = false;
+  deadline.expires_after(timeout);
+}
+
+auto foxy::detail::session_state::disarm_deadline(
+  boost::system::error_code& ec) -> void {
+
+  if (timeout == timeout.zero()) { return; }
+
+  deadline.cancel();
+  if (timed_out.exchange(false) && ec) {
+    ec = boost::asio::error::timed_out;
+    session_metrics::get().timeouts.add();
+  }
+}
+
+// shutting the socket down, unlike cancelling it, also aborts reads and
+// writes which have been handed to io_uring
+//
+// the lock keeps the strand from closing the socket while we read its
+// descriptor, which could otherwise have been handed to another connection
+// by then
+//
+auto foxy::detail::session_state::on_deadline() -> void {
+  timed_out = true;
+
+  auto lock = std::lock_guard<std::mutex>(socket_mtx);
+
+  auto& socket =
+    stream.is_ssl() ? stream.ssl_stream().next_layer() : stream.stream();
+
+  auto ec = boost::system::error_code();
+  socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+}
+
+auto foxy::detail::session_state::cancel() -> void {
+  if (resolver) { resolver->cancel(); }
+
+  auto& socket =
+    stream.is_ssl() ? stream.ssl_stream().next_layer() : stream.stream();
+
+  // closing alone doesn't abort what's been handed to io_uring, which
+  // shutting down first does
+  //
+  auto lock = std::lock_guard<std::mutex>(socket_mtx);
+
+  auto ec = boost::system::error_code();
+  socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+  socket.close(ec);
+}
+
+foxy::detail::operation_cancellation::operation_cancellation(
+  std::shared_ptr<session_state> const& s,
+  session_state::strand_type const&     strand,
+  cancellation_slot const               slot)
+: slot_(slot)
+, state_()
 {
-}
\ No newline at end of file
+  if (!slot_.is_connected()) { return; }
+
+  state_ = std::make_shared<state>();
+
+  slot_.assign([s, strand, st = state_] {
+    boost::asio::post(strand, [s, st] {
+      if (st->finished) { return; }
+
+      st->cancelled = true;
+      s->cancel();
+    });
+  });
+}
+
+foxy::detail::operation_cancellation::~operation_cancellation() {
+  auto ec = boost::system::error_code();
+  finish(ec);
+}
+
+auto foxy::detail::operation_cancellation::cancelled() const noexcept -> bool {
+  return state_ && state_->cancelled;
+}
+
+auto foxy::detail::operation_cancellation::finish(
+  boost::system::error_code& ec) -> void {
+
+  if (!state_ || state_->finished) { return; }
+
+  slot_.clear();
+  state_->finished = true;
+
+  if (state_->cancelled) { ec = boost::asio::error::operation_aborted; }
+}
+
+auto foxy::detail::async_flush_output(
+  session_state&             s,
+  std::size_t&               bytes_transferred,
+  boost::system::error_code& ec
+) -> foxy::awaitable<void, session_state::strand_type> {
+
+  bytes_transferred = 0;
+  if (s.output.size() == 0) { co_return; }
+
+  auto token       = co_await foxy::this_coro::token();
+  auto error_token = foxy::redirect_error(token, ec);
+
+  bytes_transferred =
+    co_await boost::asio::async_write(s.stream, s.output.data(), error_token);
+
+  // whatever didn't make it out is of no use once the stream has failed
+  //
+  s.output.consume(s.output.size());
+}
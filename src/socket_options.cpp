@@ -0,0 +1,192 @@
+#include "foxy/socket_options.hpp"
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/socket_base.hpp>
+
+#include <boost/core/ignore_unused.hpp>
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+#include <cerrno>
+
+namespace asio = boost::asio;
+
+using boost::system::error_code;
+using boost::ignore_unused;
+
+namespace {
+
+// first_error keeps the first failure among a run of options
+//
+struct first_error {
+  error_code& ec;
+
+  auto operator()(error_code const& e) -> void {
+    if (e && !ec) { ec = e; }
+  }
+};
+
+template <typename Socket>
+auto set_int(
+  Socket&     socket,
+  int const   level,
+  int const   name,
+  int const   value,
+  first_error record) -> void {
+
+  if (::setsockopt(
+        socket.native_handle(), level, name, &value, sizeof(value)) < 0) {
+    record(error_code(errno, asio::error::get_system_category()));
+  }
+}
+
+template <typename Socket>
+auto set_buffer_sizes(
+  Socket&                     socket,
+  foxy::socket_options const& opts,
+  first_error                 record) -> void {
+
+  auto ec = error_code();
+
+  if (opts.send_buffer_size > 0) {
+    socket.set_option(
+      asio::socket_base::send_buffer_size(opts.send_buffer_size), ec);
+    record(ec);
+  }
+
+  if (opts.receive_buffer_size > 0) {
+    socket.set_option(
+      asio::socket_base::receive_buffer_size(opts.receive_buffer_size), ec);
+    record(ec);
+  }
+}
+
+} // anonymous
+
+auto foxy::set_listen_options(
+  asio::ip::tcp::acceptor& acceptor,
+  socket_options const&    opts,
+  error_code&              ec) -> void {
+
+  ec = {};
+  auto record = first_error{ec};
+
+  set_buffer_sizes(acceptor, opts, record);
+
+#if defined(__linux__)
+  if (opts.busy_poll > 0) {
+    set_int(acceptor, SOL_SOCKET, SO_BUSY_POLL, opts.busy_poll, record);
+  }
+
+  if (opts.fast_open_queue > 0) {
+    set_int(acceptor, IPPROTO_TCP, TCP_FASTOPEN, opts.fast_open_queue, record);
+  }
+#endif
+}
+
+auto foxy::set_connect_options(
+  asio::ip::tcp::socket& socket,
+  socket_options const&  opts,
+  error_code&            ec) -> void {
+
+  ec = {};
+  auto record = first_error{ec};
+
+  set_buffer_sizes(socket, opts, record);
+
+#if defined(__linux__) && defined(TCP_FASTOPEN_CONNECT)
+  if (opts.fast_open) {
+    set_int(socket, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1, record);
+  }
+#endif
+}
+
+auto foxy::set_stream_options(
+  multi_stream&         stream,
+  socket_options const& opts,
+  error_code&           ec) -> void {
+
+  ec = {};
+  auto record = first_error{ec};
+
+  auto& socket = stream.stream();
+
+  // sockets accepted by a listener we didn't set up won't have inherited
+  // their buffer sizes
+  //
+  set_buffer_sizes(socket, opts, record);
+
+  auto option_ec = error_code();
+  socket.set_option(asio::ip::tcp::no_delay(opts.no_delay), option_ec);
+  record(option_ec);
+
+#if defined(__linux__)
+  if (opts.quick_ack) {
+    set_int(socket, IPPROTO_TCP, TCP_QUICKACK, 1, record);
+  }
+
+  if (opts.not_sent_lowat > 0) {
+    set_int(
+      socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, opts.not_sent_lowat, record);
+  }
+
+  if (opts.busy_poll > 0) {
+    set_int(socket, SOL_SOCKET, SO_BUSY_POLL, opts.busy_poll, record);
+  }
+#endif
+
+  if (opts.zerocopy_threshold && !stream.is_ssl()) {
+    stream.enable_zerocopy(*opts.zerocopy_threshold, option_ec);
+    record(option_ec);
+  }
+}
+
+auto foxy::set_reuse_port(
+  asio::ip::tcp::acceptor& acceptor,
+  error_code&              ec) -> void {
+
+  ec = {};
+
+#if defined(__linux__) && defined(SO_REUSEPORT)
+  set_int(acceptor, SOL_SOCKET, SO_REUSEPORT, 1, first_error{ec});
+#else
+  ignore_unused(acceptor);
+  ec = asio::error::operation_not_supported;
+#endif
+}
+
+auto foxy::set_incoming_cpu(
+  asio::ip::tcp::acceptor& acceptor,
+  int const                cpu,
+  error_code&              ec) -> void {
+
+  ec = {};
+
+#if defined(__linux__) && defined(SO_INCOMING_CPU)
+  set_int(acceptor, SOL_SOCKET, SO_INCOMING_CPU, cpu, first_error{ec});
+#else
+  ignore_unused(acceptor, cpu);
+  ec = asio::error::operation_not_supported;
+#endif
+}
+
+auto foxy::incoming_cpu(asio::ip::tcp::socket& socket) -> int {
+#if defined(__linux__) && defined(SO_INCOMING_CPU)
+  auto cpu = -1;
+  auto len = static_cast<socklen_t>(sizeof(cpu));
+
+  if (::getsockopt(
+        socket.native_handle(), SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0) {
+    return -1;
+  }
+
+  return cpu;
+#else
+  ignore_unused(socket);
+  return -1;
+#endif
+}
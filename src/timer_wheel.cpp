@@ -0,0 +1,243 @@
+#include "foxy/detail/timer_wheel.hpp"
+
+#include <boost/asio/error.hpp>
+
+#include <utility>
+#include <algorithm>
+
+boost::asio::execution_context::id foxy::detail::timer_wheel::id;
+
+foxy::detail::timer_wheel::timer::timer(
+  boost::asio::io_context& io,
+  std::function<void()>    on_expiry)
+: wheel_(boost::asio::use_service<timer_wheel>(io))
+, on_expiry_(std::move(on_expiry))
+, slot_(nullptr)
+, prev_(nullptr)
+, next_(nullptr)
+, due_(never)
+, filed_(never)
+{
+}
+
+foxy::detail::timer_wheel::timer::~timer() {
+  auto lock = std::lock_guard<std::mutex>(wheel_.mtx_);
+
+  if (due_ != never) { --wheel_.armed_; }
+  if (slot_) { wheel_.unfile(*this); }
+}
+
+auto foxy::detail::timer_wheel::timer::expires_after(
+  duration const d) -> void {
+
+  auto lock = std::lock_guard<std::mutex>(wheel_.mtx_);
+
+  // an idle wheel's idea of the time is stale, so it's brought up to date
+  // before anything is measured against it
+  //
+  if (!wheel_.ticking_) {
+    wheel_.now_     = wheel_.tick_of(clock_type::now());
+    wheel_.ticking_ = true;
+    wheel_.schedule();
+  }
+
+  auto const ticks = static_cast<std::uint64_t>(
+    (std::max(d, duration::zero()) + resolution - duration(1)) / resolution);
+
+  // `now_` may be most of a tick behind the clock, which the extra tick makes
+  // up for so that nothing fires early
+  //
+  if (due_ == never) { ++wheel_.armed_; }
+  due_ = wheel_.now_ + ticks + 1;
+
+  // pushing a deadline back is the common case, every read or write re-arms
+  // its session's, and it's left where it is to be filed again later
+  //
+  if (slot_ && due_ >= filed_) { return; }
+
+  if (slot_) { wheel_.unfile(*this); }
+  wheel_.file(*this, wheel_.now_ + 1);
+}
+
+auto foxy::detail::timer_wheel::timer::cancel() -> void {
+  auto lock = std::lock_guard<std::mutex>(wheel_.mtx_);
+
+  if (due_ == never) { return; }
+
+  --wheel_.armed_;
+  due_ = never;
+}
+
+foxy::detail::timer_wheel::timer_wheel(boost::asio::io_context& io)
+: boost::asio::execution_context::service(io)
+, ticker_(io)
+, levels_()
+, epoch_(clock_type::now())
+, now_(0)
+, armed_(0)
+, ticking_(false)
+{
+}
+
+foxy::detail::timer_wheel::~timer_wheel() {
+  shutdown();
+}
+
+auto foxy::detail::timer_wheel::armed() -> std::size_t {
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  return armed_;
+}
+
+auto foxy::detail::timer_wheel::shutdown() -> void {
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  clear();
+  ticking_ = false;
+
+  auto ec = boost::system::error_code();
+  ticker_.cancel(ec);
+}
+
+auto foxy::detail::timer_wheel::tick_of(
+  time_point const t) const -> std::uint64_t {
+  return static_cast<std::uint64_t>((t - epoch_) / resolution);
+}
+
+// `file` puts `t` in the lowest level whose range reaches its deadline, or
+// `earliest` if that's later
+//
+// a level's slots each cover as many ticks as the whole of the level below,
+// so a timer filed above level 0 is filed again, further down, once its slot
+// comes round
+//
+auto foxy::detail::timer_wheel::file(
+  timer&              t,
+  std::uint64_t const earliest) -> void {
+
+  auto const due   = std::max(t.due_, earliest);
+  auto const delta = due - now_;
+
+  auto level = std::size_t{0};
+  while (level + 1 < num_levels &&
+         delta >= (std::uint64_t{1} << (slot_bits * (level + 1)))) {
+    ++level;
+  }
+
+  auto const at    = (delta < span) ? due : now_ + span - 1;
+  auto const shift = slot_bits * level;
+
+  auto& head = levels_[level][(at >> shift) & (num_slots - 1)];
+
+  t.slot_  = &head;
+  t.filed_ = (at >> shift) << shift;
+  t.prev_  = nullptr;
+  t.next_  = head;
+
+  if (head) { head->prev_ = &t; }
+  head = &t;
+}
+
+auto foxy::detail::timer_wheel::unfile(timer& t) -> void {
+  if (t.prev_) { t.prev_->next_ = t.next_; } else { *t.slot_ = t.next_; }
+  if (t.next_) { t.next_->prev_ = t.prev_; }
+
+  t.slot_  = nullptr;
+  t.prev_  = nullptr;
+  t.next_  = nullptr;
+  t.filed_ = never;
+}
+
+// `cascade` files everything in the slot of `level` which has just come round
+// again further down, dropping whatever was cancelled in the meantime
+//
+auto foxy::detail::timer_wheel::cascade(std::size_t const level) -> void {
+  auto& head = levels_[level][(now_ >> (slot_bits * level)) & (num_slots - 1)];
+
+  auto* t = head;
+  head = nullptr;
+
+  while (t) {
+    auto* const next = t->next_;
+
+    t->slot_  = nullptr;
+    t->filed_ = never;
+    if (t->due_ != never) { file(*t, now_); }
+
+    t = next;
+  }
+}
+
+auto foxy::detail::timer_wheel::advance(std::uint64_t const target) -> void {
+  while (now_ < target) {
+    ++now_;
+
+    // higher levels go first so that what they cascade into a lower one is
+    // there when it cascades in turn
+    //
+    for (auto level = num_levels - 1; level > 0; --level) {
+      auto const mask = (std::uint64_t{1} << (slot_bits * level)) - 1;
+      if ((now_ & mask) == 0) { cascade(level); }
+    }
+
+    auto& head = levels_[0][now_ & (num_slots - 1)];
+
+    auto* t = head;
+    head = nullptr;
+
+    while (t) {
+      auto* const next = t->next_;
+
+      t->slot_  = nullptr;
+      t->filed_ = never;
+
+      if (t->due_ != never && t->due_ <= now_) {
+        t->due_ = never;
+        --armed_;
+        t->on_expiry_();
+      } else if (t->due_ != never) {
+        file(*t, now_ + 1);
+      }
+
+      t = next;
+    }
+  }
+}
+
+auto foxy::detail::timer_wheel::schedule() -> void {
+  ticker_.expires_at(epoch_ + (now_ + 1) * resolution);
+  ticker_.async_wait(
+    [this](boost::system::error_code const ec) { on_tick(ec); });
+}
+
+// `clear` empties every slot, which is all it takes once nothing is armed
+// since whatever's left was cancelled
+//
+auto foxy::detail::timer_wheel::clear() -> void {
+  for (auto& level : levels_) {
+    for (auto& head : level) {
+      while (head) { unfile(*head); }
+    }
+  }
+}
+
+auto foxy::detail::timer_wheel::on_tick(
+  boost::system::error_code const ec) -> void {
+
+  if (ec == boost::asio::error::operation_aborted) { return; }
+
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  if (!ticking_) { return; }
+
+  advance(tick_of(clock_type::now()));
+
+  // an idle wheel stops ticking so that it doesn't keep the `io_context`
+  // running on its own
+  //
+  if (armed_ == 0) {
+    clear();
+    ticking_ = false;
+    return;
+  }
+
+  schedule();
+}
@@ -0,0 +1,644 @@
+#include "foxy/detail/uring.hpp"
+
+#include <boost/core/ignore_unused.hpp>
+
+#include <algorithm>
+
+#ifdef FOXY_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace {
+
+auto size_class_index(std::size_t const size) -> std::size_t {
+  using foxy::detail::uring_arena;
+
+  auto idx        = std::size_t{0};
+  auto block_size = uring_arena::min_block_size;
+
+  while (block_size < size) {
+    block_size <<= 1;
+    ++idx;
+  }
+
+  return idx;
+}
+
+} // anonymous
+
+static_assert(
+  (foxy::detail::uring_arena::min_block_size
+    << (foxy::detail::uring_arena::num_size_classes - 1)) ==
+  foxy::detail::uring_arena::max_block_size,
+  "size classes must span exactly [min_block_size, max_block_size]");
+
+foxy::detail::uring_arena::uring_arena()
+: base_(nullptr)
+, size_(0)
+, used_(0)
+{
+}
+
+auto foxy::detail::uring_arena::init(std::size_t const size) -> bool {
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  if (base_.load(std::memory_order_relaxed)) { return true; }
+
+#ifdef FOXY_HAS_IO_URING
+  auto const rounded =
+    (size + max_block_size - 1) / max_block_size * max_block_size;
+
+  if (rounded == 0) { return false; }
+
+  auto* p = ::mmap(
+    nullptr, rounded, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+  if (p == MAP_FAILED) { return false; }
+
+  size_ = rounded;
+  base_.store(static_cast<char*>(p), std::memory_order_release);
+  return true;
+#else
+  boost::ignore_unused(size);
+  return false;
+#endif
+}
+
+auto foxy::detail::uring_arena::allocate(std::size_t const size) -> void* {
+  auto* base = base_.load(std::memory_order_acquire);
+  if (!base || size > max_block_size) { return nullptr; }
+
+  auto const idx        = size_class_index(size);
+  auto const block_size = min_block_size << idx;
+
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+
+  auto& blocks = free_[idx];
+  if (!blocks.empty()) {
+    auto* p = blocks.back();
+    blocks.pop_back();
+    return p;
+  }
+
+  if (size_ - used_ < block_size) { return nullptr; }
+
+  auto* p = base + used_;
+  used_ += block_size;
+  return p;
+}
+
+auto foxy::detail::uring_arena::deallocate(
+  void* const       p,
+  std::size_t const size) -> bool {
+
+  if (!contains(p, size)) { return false; }
+
+  auto lock = std::lock_guard<std::mutex>(mtx_);
+  free_[size_class_index(size)].push_back(static_cast<char*>(p));
+  return true;
+}
+
+auto foxy::detail::uring_arena::data() const noexcept -> char* {
+  return base_.load(std::memory_order_acquire);
+}
+
+auto foxy::detail::uring_arena::size() const noexcept -> std::size_t {
+  return data() ? size_ : 0;
+}
+
+auto foxy::detail::uring_arena::global() -> uring_arena& {
+  // never destroyed, as buffers may be released during static destruction
+  //
+  static auto* const arena = new uring_arena();
+  return *arena;
+}
+
+#ifdef FOXY_HAS_IO_URING
+
+namespace {
+
+auto sys_io_uring_setup(unsigned const entries, io_uring_params* const p)
+-> int {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+auto sys_io_uring_enter(
+  int const      fd,
+  unsigned const to_submit,
+  unsigned const min_complete,
+  unsigned const flags) -> int {
+
+  return static_cast<int>(::syscall(
+    __NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+auto sys_io_uring_register(
+  int const      fd,
+  unsigned const opcode,
+  void const*    arg,
+  unsigned const nr_args) -> int {
+
+  return static_cast<int>(
+    ::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// the operations we submit, every one of which has to be supported
+//
+constexpr std::uint8_t required_ops[] = {
+  IORING_OP_RECVMSG,
+  IORING_OP_SENDMSG,
+  IORING_OP_READ_FIXED,
+  IORING_OP_ASYNC_CANCEL
+};
+
+auto supports_required_ops(int const fd) -> bool {
+  constexpr auto num_ops = 256u;
+
+  auto storage = std::vector<unsigned char>(
+    sizeof(io_uring_probe) + num_ops * sizeof(io_uring_probe_op));
+
+  auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+
+  if (sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, num_ops) < 0) {
+    return false;
+  }
+
+  return std::all_of(
+    std::begin(required_ops), std::end(required_ops),
+    [&](std::uint8_t const op) {
+      return op <= probe->last_op &&
+        (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    });
+}
+
+template <typename T>
+auto load_acquire(T const* p) -> T {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+auto store_release(T* p, T const v) -> void {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+} // anonymous
+
+// ring holds the memory shared with the kernel
+//
+struct foxy::detail::uring_service::ring {
+  int fd      = -1;
+  int eventfd = -1;
+
+  void*         sq_ptr    = MAP_FAILED;
+  std::size_t   sq_size   = 0;
+  void*         cq_ptr    = MAP_FAILED;
+  std::size_t   cq_size   = 0;
+  io_uring_sqe* sqes      = static_cast<io_uring_sqe*>(MAP_FAILED);
+  std::size_t   sqes_size = 0;
+
+  unsigned* sq_head    = nullptr;
+  unsigned* sq_tail    = nullptr;
+  unsigned* sq_flags   = nullptr;
+  unsigned* sq_array   = nullptr;
+  unsigned  sq_mask    = 0;
+  unsigned  sq_entries = 0;
+
+  unsigned*     cq_head = nullptr;
+  unsigned*     cq_tail = nullptr;
+  unsigned      cq_mask = 0;
+  io_uring_cqe* cqes    = nullptr;
+
+  ring()            = default;
+  ring(ring const&) = delete;
+
+  ~ring() {
+    if (sqes != MAP_FAILED) { ::munmap(sqes, sqes_size); }
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+      ::munmap(cq_ptr, cq_size);
+    }
+    if (sq_ptr != MAP_FAILED) { ::munmap(sq_ptr, sq_size); }
+    if (eventfd >= 0) { ::close(eventfd); }
+    if (fd >= 0) { ::close(fd); }
+  }
+
+  auto setup(unsigned const entries) -> bool {
+    auto params = io_uring_params();
+    std::memset(&params, 0, sizeof(params));
+
+    params.flags      = IORING_SETUP_CLAMP | IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 8;
+
+    fd = sys_io_uring_setup(entries, &params);
+    if (fd < 0) { return false; }
+
+    // without NODROP, completions can be lost whenever the completion queue
+    // overflows
+    //
+    if (!(params.features & IORING_FEAT_NODROP)) { return false; }
+    if (!supports_required_ops(fd)) { return false; }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    auto const single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) { sq_size = cq_size = std::max(sq_size, cq_size); }
+
+    sq_ptr = ::mmap(
+      nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+      fd, IORING_OFF_SQ_RING);
+
+    if (sq_ptr == MAP_FAILED) { return false; }
+
+    cq_ptr = single_mmap
+      ? sq_ptr
+      : ::mmap(
+          nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+          fd, IORING_OFF_CQ_RING);
+
+    if (cq_ptr == MAP_FAILED) { return false; }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes      = static_cast<io_uring_sqe*>(::mmap(
+      nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+      fd, IORING_OFF_SQES));
+
+    if (sqes == MAP_FAILED) { return false; }
+
+    auto* const sq = static_cast<char*>(sq_ptr);
+    auto* const cq = static_cast<char*>(cq_ptr);
+
+    sq_head    = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail    = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_flags   = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+    sq_array   = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_mask    = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes    = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    eventfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventfd < 0) { return false; }
+
+    return
+      sys_io_uring_register(fd, IORING_REGISTER_EVENTFD, &eventfd, 1) == 0;
+  }
+
+  // `next_sqe` must be followed by `publish` and returns nullptr when the
+  // submission queue is full
+  //
+  auto next_sqe() -> io_uring_sqe* {
+    auto const tail = *sq_tail;
+    if (tail - load_acquire(sq_head) >= sq_entries) { return nullptr; }
+
+    auto const idx = tail & sq_mask;
+    sq_array[idx] = idx;
+
+    auto* sqe = &sqes[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+  }
+
+  auto publish() -> void {
+    store_release(sq_tail, *sq_tail + 1);
+  }
+
+  auto cq_ready() const -> unsigned {
+    return load_acquire(cq_tail) - *cq_head;
+  }
+};
+
+boost::asio::execution_context::id foxy::detail::uring_service::id;
+
+foxy::detail::uring_service::uring_service(boost::asio::io_context& io)
+: boost::asio::execution_context::service(io)
+, io_(io)
+, notify_(io)
+, ops_(nullptr)
+, in_flight_(0)
+, unsubmitted_(0)
+, flush_posted_(false)
+, armed_(false)
+, fixed_buffers_(false)
+, enabled_(false)
+, enters_(0)
+, submitted_(0)
+, completed_(0)
+, fixed_reads_(0)
+{
+}
+
+foxy::detail::uring_service::~uring_service() {
+  shutdown();
+}
+
+auto foxy::detail::uring_service::start(io_uring_options const& opts) -> bool {
+  if (ring_) { return enabled(); }
+
+  auto r = std::make_unique<ring>();
+  if (!r->setup(std::max(opts.queue_depth, 1u))) { return false; }
+
+  auto ec = boost::system::error_code();
+  notify_.assign(r->eventfd, ec);
+  if (ec) { return false; }
+
+  // the descriptor now belongs to `notify_`
+  //
+  r->eventfd = -1;
+
+  auto& arena = uring_arena::global();
+  if (opts.registered_buffer_bytes > 0 &&
+      arena.init(opts.registered_buffer_bytes)) {
+
+    auto iov     = ::iovec();
+    iov.iov_base = arena.data();
+    iov.iov_len  = arena.size();
+
+    // registration pins the region and may run into `RLIMIT_MEMLOCK`, in
+    // which case reads simply don't use fixed buffers
+    //
+    fixed_buffers_ =
+      sys_io_uring_register(r->fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+  }
+
+  ring_ = std::move(r);
+  enabled_.store(true, std::memory_order_release);
+  return true;
+}
+
+auto foxy::detail::uring_service::enabled() const noexcept -> bool {
+  return enabled_.load(std::memory_order_acquire);
+}
+
+auto foxy::detail::uring_service::stats() const -> io_uring_stats {
+  return {
+    enters_.load(std::memory_order_relaxed),
+    submitted_.load(std::memory_order_relaxed),
+    completed_.load(std::memory_order_relaxed),
+    fixed_reads_.load(std::memory_order_relaxed)
+  };
+}
+
+auto foxy::detail::uring_service::find(boost::asio::io_context& io)
+-> uring_service* {
+  if (!boost::asio::has_service<uring_service>(io)) { return nullptr; }
+
+  auto& service = boost::asio::use_service<uring_service>(io);
+  return service.enabled() ? &service : nullptr;
+}
+
+auto foxy::detail::uring_service::submit(uring_op* const op, int const fd)
+-> void {
+  auto& r = *ring_;
+
+  auto post_flush = false;
+  auto arm_now    = false;
+  auto rejected   = false;
+
+  {
+    auto lock = std::lock_guard<std::mutex>(mtx_);
+
+    auto* sqe = r.next_sqe();
+    if (!sqe) {
+      enter();
+      sqe = r.next_sqe();
+    }
+
+    if (!sqe) {
+      rejected = true;
+    } else {
+      auto const& iov = op->iovs[0];
+
+      if (op->is_read && op->num_iovs == 1 && fixed_buffers_ &&
+          uring_arena::global().contains(iov.iov_base, iov.iov_len)) {
+
+        sqe->opcode    = IORING_OP_READ_FIXED;
+        sqe->addr      = reinterpret_cast<std::uint64_t>(iov.iov_base);
+        sqe->len       = static_cast<std::uint32_t>(iov.iov_len);
+        sqe->buf_index = 0;
+
+        fixed_reads_.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        op->msg.msg_iov    = op->iovs.data();
+        op->msg.msg_iovlen = op->num_iovs;
+
+        sqe->opcode    = op->is_read ? IORING_OP_RECVMSG : IORING_OP_SENDMSG;
+        sqe->addr      = reinterpret_cast<std::uint64_t>(&op->msg);
+        sqe->len       = 1;
+        sqe->msg_flags = op->is_read ? 0 : MSG_NOSIGNAL;
+      }
+
+      sqe->fd        = fd;
+      sqe->user_data = reinterpret_cast<std::uint64_t>(op);
+      r.publish();
+
+      op->prev = nullptr;
+      op->next = ops_;
+      if (ops_) { ops_->prev = op; }
+      ops_ = op;
+
+      ++in_flight_;
+      ++unsubmitted_;
+
+      post_flush = !std::exchange(flush_posted_, true);
+      arm_now    = !std::exchange(armed_, true);
+    }
+  }
+
+  submitted_.fetch_add(1, std::memory_order_relaxed);
+
+  // the submission queue can only stay full while the kernel can't take any
+  // more work, which we report the same way a full socket buffer would be
+  //
+  if (rejected) {
+    boost::asio::post(io_, [op]() { op->complete(op, -ENOBUFS, true); });
+    return;
+  }
+
+  if (post_flush) {
+    boost::asio::post(io_, [this]() { flush(); });
+  }
+
+  if (arm_now) { arm(); }
+}
+
+// `enter` must be called with `mtx_` held
+//
+auto foxy::detail::uring_service::enter() -> void {
+  while (unsubmitted_ > 0) {
+    auto const n = sys_io_uring_enter(
+      ring_->fd, static_cast<unsigned>(unsubmitted_), 0, 0);
+
+    enters_.fetch_add(1, std::memory_order_relaxed);
+
+    if (n < 0 && errno == EINTR) { continue; }
+    if (n <= 0) { break; }
+
+    unsubmitted_ -= static_cast<std::size_t>(n);
+  }
+}
+
+auto foxy::detail::uring_service::flush() -> void {
+  auto repost = false;
+  {
+    auto lock = std::lock_guard<std::mutex>(mtx_);
+    flush_posted_ = false;
+    enter();
+
+    // anything the kernel turned away is retried on the next turn, by which
+    // point completions will have been reaped
+    //
+    if (unsubmitted_ > 0) { repost = flush_posted_ = true; }
+  }
+
+  if (repost) {
+    boost::asio::post(io_, [this]() { flush(); });
+  }
+}
+
+// `arm` is only ever called by whoever flipped `armed_` to true so there's
+// never more than one wait outstanding
+//
+auto foxy::detail::uring_service::arm() -> void {
+  notify_.async_wait(
+    boost::asio::posix::stream_descriptor::wait_read,
+    [this](boost::system::error_code const ec) { on_notify(ec); });
+
+  // the reactor is edge-triggered, so completions which arrived while nobody
+  // was waiting need a fresh edge
+  //
+  if (ring_->cq_ready() > 0) {
+    auto const one = std::uint64_t{1};
+    auto const n   = ::write(notify_.native_handle(), &one, sizeof(one));
+    boost::ignore_unused(n);
+  }
+}
+
+// `reap` must be called with `mtx_` held
+//
+auto foxy::detail::uring_service::reap(std::vector<completion>& done) -> void {
+  auto& r = *ring_;
+
+  while (true) {
+    auto       head = *r.cq_head;
+    auto const tail = load_acquire(r.cq_tail);
+
+    for (; head != tail; ++head) {
+      auto const& cqe = r.cqes[head & r.cq_mask];
+      auto* op = reinterpret_cast<uring_op*>(cqe.user_data);
+
+      // cancellations are submitted without an operation of their own
+      //
+      if (!op) { continue; }
+
+      if (op->prev) { op->prev->next = op->next; } else { ops_ = op->next; }
+      if (op->next) { op->next->prev = op->prev; }
+
+      --in_flight_;
+      done.push_back({op, cqe.res});
+    }
+
+    store_release(r.cq_head, head);
+
+    // completions which didn't fit are held back by the kernel until asked
+    // for
+    //
+    if (!(load_acquire(r.sq_flags) & IORING_SQ_CQ_OVERFLOW)) { break; }
+    sys_io_uring_enter(r.fd, 0, 0, IORING_ENTER_GETEVENTS);
+  }
+
+  completed_.fetch_add(done.size(), std::memory_order_relaxed);
+}
+
+auto foxy::detail::uring_service::on_notify(
+  boost::system::error_code const ec) -> void {
+
+  if (ec == boost::asio::error::operation_aborted) { return; }
+
+  auto count = std::uint64_t{0};
+  auto const n = ::read(notify_.native_handle(), &count, sizeof(count));
+  boost::ignore_unused(n);
+
+  auto done  = std::vector<completion>();
+  auto rearm = false;
+
+  {
+    auto lock = std::lock_guard<std::mutex>(mtx_);
+
+    armed_ = false;
+    reap(done);
+
+    if (in_flight_ > 0) { rearm = armed_ = true; }
+  }
+
+  if (rearm) { arm(); }
+
+  for (auto const& c : done) {
+    c.op->complete(c.op, c.result, true);
+  }
+}
+
+auto foxy::detail::uring_service::shutdown() -> void {
+  if (!ring_) { return; }
+
+  auto ec = boost::system::error_code();
+  notify_.close(ec);
+
+  auto done = std::vector<completion>();
+  {
+    auto lock = std::lock_guard<std::mutex>(mtx_);
+    auto& r   = *ring_;
+
+    // the kernel may still be writing into the buffers of operations in
+    // flight, so they're cancelled and waited on before anything is freed
+    //
+    for (auto* op = ops_; op; op = op->next) {
+      auto* sqe = r.next_sqe();
+      if (!sqe) {
+        enter();
+        sqe = r.next_sqe();
+      }
+      if (!sqe) { break; }
+
+      sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+      sqe->addr      = reinterpret_cast<std::uint64_t>(op);
+      sqe->user_data = 0;
+      r.publish();
+
+      ++unsubmitted_;
+    }
+
+    enter();
+
+    while (in_flight_ > 0) {
+      reap(done);
+      if (in_flight_ == 0) { break; }
+
+      auto const n = sys_io_uring_enter(r.fd, 0, 1, IORING_ENTER_GETEVENTS);
+      if (n < 0 && errno != EINTR) { break; }
+    }
+
+    for (auto* op = ops_; op; op = op->next) {
+      done.push_back({op, -ECANCELED});
+    }
+
+    ops_       = nullptr;
+    in_flight_ = 0;
+  }
+
+  enabled_.store(false, std::memory_order_release);
+  ring_.reset();
+
+  for (auto const& c : done) {
+    c.op->complete(c.op, c.result, false);
+  }
+}
+
+#endif // FOXY_HAS_IO_URING
@@ -0,0 +1,106 @@
+#include "foxy/detail/zerocopy.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#ifdef FOXY_HAS_ZEROCOPY
+
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+
+namespace {
+
+auto is_recverr(::cmsghdr const* cm) -> bool {
+  return
+    (cm->cmsg_level == SOL_IP   && cm->cmsg_type == IP_RECVERR) ||
+    (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+}
+
+} // anonymous
+
+auto foxy::detail::zerocopy_state::drain(
+  int const                  fd,
+  boost::system::error_code& ec) -> void {
+
+  auto& metrics = session_metrics::get();
+
+  while (true) {
+    alignas(::cmsghdr) char control[128];
+
+    auto msg = ::msghdr();
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno == EINTR) { continue; }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        ec.assign(errno, boost::asio::error::get_system_category());
+      }
+      break;
+    }
+
+    for (auto* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!is_recverr(cm)) { continue; }
+
+      auto const* err =
+        reinterpret_cast<::sock_extended_err const*>(CMSG_DATA(cm));
+
+      if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) { continue; }
+
+      if (err->ee_errno != 0) {
+        ec.assign(
+          static_cast<int>(err->ee_errno),
+          boost::asio::error::get_system_category());
+        return;
+      }
+
+      // the kernel fell back to copying, which is always the case over
+      // loopback
+      //
+      if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        metrics.zerocopy_copied.add(err->ee_data - err->ee_info + 1);
+      }
+
+      early.emplace_back(err->ee_info, err->ee_data);
+    }
+
+    // fold every range which now touches `completed` into it
+    //
+    auto merged = true;
+    while (merged) {
+      merged = false;
+      for (auto it = early.begin(); it != early.end(); ++it) {
+        if (static_cast<std::int32_t>(it->first - completed) > 0) { continue; }
+
+        if (static_cast<std::int32_t>(it->second + 1 - completed) > 0) {
+          completed = it->second + 1;
+        }
+
+        early.erase(it);
+        merged = true;
+        break;
+      }
+    }
+  }
+}
+
+auto foxy::detail::zerocopy_send(
+  int const         fd,
+  ::iovec const*    iovs,
+  std::size_t const num_iovs,
+  bool const        zerocopy) -> long {
+
+  auto msg = ::msghdr();
+  msg.msg_iov    = const_cast<::iovec*>(iovs);
+  msg.msg_iovlen = num_iovs;
+
+  auto const flags =
+    MSG_DONTWAIT | MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0);
+
+  auto const n = ::sendmsg(fd, &msg, flags);
+  if (n > 0 && zerocopy) {
+    session_metrics::get().zerocopy_bytes.add(static_cast<std::uint64_t>(n));
+  }
+
+  return n;
+}
+
+#endif // FOXY_HAS_ZEROCOPY
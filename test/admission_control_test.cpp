@@ -0,0 +1,202 @@
+#include "foxy/coroutine.hpp"
+#include "foxy/cancellation.hpp"
+#include "foxy/admission_control.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+
+TEST_CASE("Our admission control") {
+  SECTION("should queue, admit and reject connections at capacity") {
+
+    asio::io_context io;
+
+    auto opts = foxy::admission_control::options();
+
+    opts.max_connections         = 1;
+    opts.max_pending_connections = 1;
+    opts.max_pending_time        = std::chrono::seconds(5);
+
+    auto admission = foxy::admission_control(opts);
+
+    auto first  = false;
+    auto second = false;
+    auto third  = true;
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        first = co_await admission.async_admit(io);
+      },
+      foxy::detached);
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        second = co_await admission.async_admit(io);
+      },
+      foxy::detached);
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        third = co_await admission.async_admit(io);
+
+        // by now the second connection is parked in the queue, freeing up the
+        // first slot should hand it over
+        //
+        admission.leave();
+      },
+      foxy::detached);
+
+    io.run();
+
+    CHECK(first);
+    CHECK(second);
+    CHECK(!third);
+
+    auto const stats = admission.stats();
+
+    CHECK(stats.active_connections == 1);
+    CHECK(stats.pending_connections == 0);
+    CHECK(stats.admitted == 2);
+    CHECK(stats.queued == 1);
+    CHECK(stats.rejected == 1);
+    CHECK(stats.timed_out == 0);
+  }
+
+  SECTION("should time out connections which wait too long") {
+
+    asio::io_context io;
+
+    auto opts = foxy::admission_control::options();
+
+    opts.max_connections         = 1;
+    opts.max_pending_connections = 4;
+    opts.max_pending_time        = std::chrono::milliseconds(10);
+
+    auto admission = foxy::admission_control(opts);
+
+    auto first  = false;
+    auto second = true;
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        first  = co_await admission.async_admit(io);
+        second = co_await admission.async_admit(io);
+      },
+      foxy::detached);
+
+    io.run();
+
+    CHECK(first);
+    CHECK(!second);
+    CHECK(admission.stats().timed_out == 1);
+  }
+
+  SECTION("should turn away a waiter whose wait is cancelled") {
+
+    asio::io_context io;
+
+    auto opts = foxy::admission_control::options();
+
+    opts.max_connections         = 1;
+    opts.max_pending_connections = 4;
+    opts.max_pending_time        = std::chrono::seconds(5);
+
+    auto admission = foxy::admission_control(opts);
+    auto signal    = foxy::cancellation_signal();
+    auto timer     = asio::steady_timer(io);
+
+    auto first  = false;
+    auto second = true;
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        first  = co_await admission.async_admit(io);
+        second = co_await admission.async_admit(io, signal.slot());
+      },
+      foxy::detached);
+
+    timer.expires_after(std::chrono::milliseconds(10));
+    timer.async_wait([&](boost::system::error_code) { signal.emit(); });
+
+    auto const started = std::chrono::steady_clock::now();
+    io.run();
+
+    CHECK(first);
+    CHECK(!second);
+    CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(1));
+
+    auto const stats = admission.stats();
+
+    CHECK(stats.pending_connections == 0);
+    CHECK(stats.rejected == 1);
+    CHECK(stats.timed_out == 0);
+  }
+
+  SECTION("should not count waiters which timed out against the queue") {
+
+    asio::io_context io;
+
+    auto opts = foxy::admission_control::options();
+
+    opts.max_connections         = 1;
+    opts.max_pending_connections = 2;
+    opts.max_pending_time        = std::chrono::milliseconds(10);
+
+    auto admission = foxy::admission_control(opts);
+
+    auto first    = false;
+    auto admitted = 0;
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        first = co_await admission.async_admit(io);
+
+        // every one of these waits out `max_pending_time`, leaving its entry
+        // behind in the queue, which fills up after the second
+        //
+        for (auto i = 0; i < 4; ++i) {
+          if (co_await admission.async_admit(io)) { ++admitted; }
+        }
+      },
+      foxy::detached);
+
+    io.run();
+
+    CHECK(first);
+    CHECK(admitted == 0);
+
+    auto const stats = admission.stats();
+
+    CHECK(stats.pending_connections == 0);
+    CHECK(stats.queued == 4);
+    CHECK(stats.timed_out == 4);
+    CHECK(stats.rejected == 4);
+  }
+
+  SECTION("should cap outbound connects") {
+
+    auto opts = foxy::admission_control::options();
+    opts.max_upstream_connects = 1;
+
+    auto admission = foxy::admission_control(opts);
+
+    CHECK(admission.try_acquire_upstream());
+    CHECK(!admission.try_acquire_upstream());
+
+    admission.release_upstream();
+
+    CHECK(admission.try_acquire_upstream());
+    CHECK(admission.stats().upstream_rejected == 1);
+  }
+}
@@ -0,0 +1,144 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/write.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include "foxy/as_tuple.hpp"
+#include "foxy/coroutine.hpp"
+#include "foxy/cancellation.hpp"
+#include "foxy/multi_stream.hpp"
+#include "foxy/server_session.hpp"
+
+#include <tuple>
+#include <chrono>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+namespace http = boost::beast::http;
+
+using ip::tcp;
+using boost::system::error_code;
+using std::chrono::milliseconds;
+
+namespace {
+
+auto const request = std::string(
+  "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+} // anonymous
+
+TEST_CASE("Our as_tuple completion token") {
+  SECTION("should hand a coroutine its error code and result together") {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto read_ec = error_code();
+    auto target  = std::string();
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        auto token = co_await foxy::this_coro::token();
+
+        auto [accept_ec, socket] =
+          co_await acceptor.async_accept(foxy::as_tuple(token));
+
+        if (accept_ec) { co_return; }
+
+        auto stream     = foxy::multi_stream(io);
+        stream.stream() = std::move(socket);
+
+        auto session = foxy::server_session(std::move(stream));
+
+        http::request_parser<http::empty_body> parser;
+
+        std::tie(read_ec) =
+          co_await session.async_read(parser, foxy::as_tuple(token));
+
+        target = std::string(parser.get().target());
+      },
+      foxy::detached);
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client = tcp::socket(io);
+      client.async_connect(acceptor.local_endpoint(), yield);
+      asio::async_write(client, asio::buffer(request), yield);
+    });
+
+    io.run();
+
+    CHECK(!read_ec);
+    CHECK(target == "/");
+  }
+
+  SECTION("should hand plain callbacks a tuple as well") {
+    asio::io_context io;
+
+    auto wait_ec = error_code();
+    auto called  = false;
+
+    auto timer = asio::steady_timer(io);
+    timer.expires_after(std::chrono::hours(1));
+    timer.async_wait(foxy::as_tuple(
+      [&](std::tuple<error_code> result) {
+        wait_ec = std::get<0>(result);
+        called  = true;
+      }));
+
+    timer.cancel();
+    io.run();
+
+    CHECK(called);
+    CHECK(wait_ec == asio::error::operation_aborted);
+  }
+
+  SECTION("should keep a bound cancellation slot reaching the operation") {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto signal  = foxy::cancellation_signal();
+    auto read_ec = error_code();
+
+    auto client = tcp::socket(io);
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io);
+      acceptor.async_accept(stream.stream(), yield);
+
+      auto session = foxy::server_session(std::move(stream));
+
+      http::request_parser<http::empty_body> parser;
+      std::tie(read_ec) = session.async_read_header(
+        parser,
+        foxy::as_tuple(foxy::bind_cancellation_slot(signal.slot(), yield)));
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      client.async_connect(acceptor.local_endpoint(), yield);
+
+      auto timer = asio::steady_timer(io);
+      timer.expires_after(milliseconds(20));
+      timer.async_wait(yield);
+
+      signal.emit();
+    });
+
+    io.run();
+
+    CHECK(read_ec == asio::error::operation_aborted);
+  }
+}
@@ -0,0 +1,80 @@
+#include "foxy/detail/buffer_pool.hpp"
+
+#include <catch2/catch.hpp>
+
+using foxy::detail::buffer_pool;
+using foxy::detail::adaptive_buffer;
+
+TEST_CASE("Our buffer pool") {
+  SECTION("should round requests up to a size class and recycle blocks") {
+
+    auto pool = buffer_pool(1024 * 1024);
+
+    auto b = pool.acquire(3000);
+    CHECK(b.size == 4096);
+
+    auto* const p = b.data;
+    pool.release(b);
+    CHECK(pool.cached_bytes() == 4096);
+
+    auto c = pool.acquire(4096);
+    CHECK(c.data == p);
+    CHECK(pool.cached_bytes() == 0);
+
+    pool.release(c);
+  }
+
+  SECTION("should never cache more than it was told to") {
+
+    auto pool = buffer_pool(buffer_pool::min_block_size);
+
+    auto a = pool.acquire(0);
+    auto b = pool.acquire(0);
+
+    pool.release(a);
+    pool.release(b);
+
+    CHECK(pool.cached_bytes() == buffer_pool::min_block_size);
+  }
+}
+
+TEST_CASE("Our adaptive buffer") {
+  SECTION("should grow while full and shrink while mostly empty") {
+
+    auto pool = buffer_pool(16 * 1024 * 1024);
+    auto buf  = adaptive_buffer(pool);
+
+    CHECK(buf.prepare().size() == buffer_pool::min_block_size);
+
+    for (auto i = 0; i < 16; ++i) {
+      auto const chunk = buf.prepare();
+      buf.commit(chunk.size());
+    }
+
+    CHECK(buf.prepare().size() == buffer_pool::max_block_size);
+
+    for (auto i = std::size_t{0}; i < adaptive_buffer::shrink_after; ++i) {
+      buf.prepare();
+      buf.commit(1);
+    }
+
+    CHECK(buf.prepare().size() == buffer_pool::max_block_size / 2);
+  }
+
+  SECTION("should hand its memory back to the pool when released") {
+
+    auto pool = buffer_pool(16 * 1024 * 1024);
+    auto buf  = adaptive_buffer(pool);
+
+    auto const chunk = buf.prepare();
+    buf.commit(chunk.size());
+    buf.release();
+
+    CHECK(buf.data() == nullptr);
+    CHECK(pool.cached_bytes() == buffer_pool::min_block_size);
+
+    // the buffer remembers how large it had grown
+    //
+    CHECK(buf.prepare().size() == 2 * buffer_pool::min_block_size);
+  }
+}
@@ -0,0 +1,164 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ssl/context.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include "foxy/cancellation.hpp"
+#include "foxy/multi_stream.hpp"
+#include "foxy/client_session.hpp"
+#include "foxy/server_session.hpp"
+
+#include <array>
+#include <chrono>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+namespace ssl  = asio::ssl;
+namespace http = boost::beast::http;
+
+using ip::tcp;
+using boost::system::error_code;
+using std::chrono::milliseconds;
+
+TEST_CASE("Our cancellation support") {
+  SECTION("should cancel a read the peer never answers") {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto signal  = foxy::cancellation_signal();
+    auto read_ec = error_code();
+    auto peer_ec = error_code();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io);
+      acceptor.async_accept(stream.stream(), yield);
+
+      auto session = foxy::server_session(std::move(stream));
+
+      http::request_parser<http::empty_body> parser;
+      session.async_read_header(
+        parser, foxy::bind_cancellation_slot(signal.slot(), yield[read_ec]));
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client = tcp::socket(io);
+      client.async_connect(acceptor.local_endpoint(), yield);
+
+      auto timer = asio::steady_timer(io);
+      timer.expires_after(milliseconds(20));
+      timer.async_wait(yield);
+
+      signal.emit();
+
+      // the cancelled session doesn't hang onto the connection
+      //
+      auto buf = std::array<char, 1>();
+      asio::async_read(client, asio::buffer(buf), yield[peer_ec]);
+    });
+
+    io.run();
+
+    CHECK(read_ec == asio::error::operation_aborted);
+    CHECK(peer_ec == asio::error::eof);
+  }
+
+  SECTION("should cancel a connect stuck in its handshake") {
+    asio::io_context io;
+
+    auto ctx = ssl::context(ssl::context::tlsv12_client);
+    ctx.set_verify_mode(ssl::verify_none);
+
+    // a server which accepts connections but never says anything
+    //
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto server = tcp::socket(io);
+    acceptor.async_accept(server, [](error_code) {});
+
+    auto signal     = foxy::cancellation_signal();
+    auto connect_ec = error_code();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto session = foxy::client_session(io, ctx);
+
+      session.async_connect(
+        "127.0.0.1",
+        std::to_string(acceptor.local_endpoint().port()),
+        foxy::bind_cancellation_slot(signal.slot(), yield[connect_ec]));
+    });
+
+    auto timer = asio::steady_timer(io);
+    timer.expires_after(milliseconds(50));
+    timer.async_wait([&](error_code) { signal.emit(); });
+
+    io.run();
+
+    CHECK(connect_ec == asio::error::operation_aborted);
+  }
+
+  SECTION("should leave operations which have finished alone") {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto signal = foxy::cancellation_signal();
+    auto ec     = error_code();
+    auto count  = 0;
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io);
+      acceptor.async_accept(stream.stream(), yield);
+
+      auto session = foxy::server_session(std::move(stream));
+
+      for (auto i = 0; i < 2; ++i) {
+        http::request_parser<http::empty_body> parser;
+        session.async_read(
+          parser, foxy::bind_cancellation_slot(signal.slot(), yield[ec]));
+
+        if (ec) { break; }
+        ++count;
+
+        // nothing is in flight to be cancelled
+        //
+        signal.emit();
+      }
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto client = tcp::socket(io);
+      client.async_connect(acceptor.local_endpoint(), yield);
+
+      auto const requests = std::string(
+        "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+      asio::async_write(client, asio::buffer(requests), yield);
+
+      auto buf = std::array<char, 1>();
+      auto read_ec = error_code();
+      asio::async_read(client, asio::buffer(buf), yield[read_ec]);
+    });
+
+    io.run();
+
+    CHECK(!ec);
+    CHECK(count == 2);
+  }
+}
@@ -0,0 +1,133 @@
+#include "foxy/circuit_breaker.hpp"
+
+#include <chrono>
+
+#include <catch2/catch.hpp>
+
+using foxy::circuit_breaker;
+using verdict = foxy::circuit_breaker::verdict;
+using namespace std::chrono_literals;
+
+TEST_CASE("Our circuit breaker") {
+
+  auto opts = circuit_breaker::options();
+
+  opts.max_connects_per_host = 2;
+  opts.min_requests          = 4;
+  opts.failure_ratio         = 0.5;
+  opts.failure_window        = 10s;
+  opts.open_duration         = 5s;
+  opts.half_open_probes      = 1;
+
+  auto const host = std::string_view("www.example.com:443");
+  auto const t0   = circuit_breaker::clock_type::now();
+
+  SECTION("should limit connects in flight per host") {
+
+    auto breaker = circuit_breaker(opts);
+
+    CHECK(breaker.try_acquire(host, t0) == verdict::allow);
+    CHECK(breaker.try_acquire(host, t0) == verdict::allow);
+    CHECK(breaker.try_acquire(host, t0) == verdict::busy);
+
+    // other hosts are unaffected
+    //
+    CHECK(
+      breaker.try_acquire("www.example.org:80", t0) ==
+      verdict::allow);
+
+    breaker.release(host, true, t0);
+    CHECK(breaker.try_acquire(host, t0) == verdict::allow);
+
+    CHECK(breaker.stats().rejected_busy == 1);
+  }
+
+  SECTION("should open, probe and then close again") {
+
+    auto breaker = circuit_breaker(opts);
+
+    for (auto i = 0; i < 2; ++i) {
+      REQUIRE(breaker.try_acquire(host, t0) == verdict::allow);
+      breaker.release(host, true, t0);
+    }
+
+    for (auto i = 0; i < 2; ++i) {
+      REQUIRE(breaker.try_acquire(host, t0) == verdict::allow);
+      breaker.release(host, false, t0);
+    }
+
+    CHECK(breaker.state_of(host) == circuit_breaker::state::open);
+    CHECK(breaker.try_acquire(host, t0 + 1s) == verdict::open);
+
+    // once the open duration has passed, exactly one probe is let through
+    //
+    CHECK(breaker.try_acquire(host, t0 + 6s) == verdict::allow);
+    CHECK(breaker.state_of(host) == circuit_breaker::state::half_open);
+    CHECK(breaker.try_acquire(host, t0 + 6s) == verdict::open);
+
+    breaker.release(host, true, t0 + 6s);
+
+    CHECK(breaker.state_of(host) == circuit_breaker::state::closed);
+    CHECK(breaker.try_acquire(host, t0 + 6s) == verdict::allow);
+    CHECK(breaker.stats().trips == 1);
+  }
+
+  SECTION("should re-open when a probe fails") {
+
+    auto breaker = circuit_breaker(opts);
+
+    for (auto i = 0; i < 4; ++i) {
+      REQUIRE(breaker.try_acquire(host, t0) == verdict::allow);
+      breaker.release(host, false, t0);
+    }
+
+    CHECK(breaker.try_acquire(host, t0 + 6s) == verdict::allow);
+    breaker.release(host, false, t0 + 6s);
+
+    CHECK(breaker.state_of(host) == circuit_breaker::state::open);
+    CHECK(breaker.try_acquire(host, t0 + 7s) == verdict::open);
+    CHECK(breaker.stats().trips == 2);
+  }
+
+  SECTION("should not count abandoned attempts") {
+
+    auto breaker = circuit_breaker(opts);
+
+    for (auto i = 0; i < 4; ++i) {
+      REQUIRE(breaker.try_acquire(host, t0) == verdict::allow);
+      breaker.abandon(host);
+    }
+
+    CHECK(breaker.state_of(host) == circuit_breaker::state::closed);
+
+    for (auto i = 0; i < 4; ++i) {
+      REQUIRE(breaker.try_acquire(host, t0) == verdict::allow);
+      breaker.release(host, false, t0);
+    }
+
+    // an abandoned probe neither closes the breaker nor keeps the next one out
+    //
+    CHECK(breaker.try_acquire(host, t0 + 6s) == verdict::allow);
+    breaker.abandon(host);
+
+    CHECK(breaker.state_of(host) == circuit_breaker::state::half_open);
+    CHECK(breaker.try_acquire(host, t0 + 6s) == verdict::allow);
+    CHECK(breaker.stats().trips == 1);
+  }
+
+  SECTION("should forget failures outside of the window") {
+
+    auto breaker = circuit_breaker(opts);
+
+    for (auto i = 0; i < 3; ++i) {
+      REQUIRE(breaker.try_acquire(host, t0) == verdict::allow);
+      breaker.release(host, false, t0);
+    }
+
+    REQUIRE(
+      breaker.try_acquire(host, t0 + 11s) == verdict::allow);
+    breaker.release(host, false, t0 + 11s);
+
+    CHECK(breaker.state_of(host) == circuit_breaker::state::closed);
+  }
+}
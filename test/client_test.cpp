@@ -8,6 +8,9 @@
 #include "foxy/coroutine.hpp"
 #include "foxy/client_session.hpp"
 
+#include "foxy/test/origin.hpp"
+#include "foxy/test/certificate_authority.hpp"
+
 #include <catch2/catch.hpp>
 
 namespace asio = boost::asio;
@@ -22,16 +25,19 @@ TEST_CASE("Our HTTP client session") {
   // HTTP/1.1
   auto const http_version_11 = 11;
 
-  SECTION("should be able to callout to google") {
+  SECTION("should be able to callout to a remote host") {
 
     asio::io_context io;
 
+    auto origin = foxy::test::origin(io);
+    origin.run();
+
     auto was_valid_request = false;
     auto s                 = foxy::client_session(io);
 
     s.async_connect(
-      "www.google.com", "80",
-      [=, &was_valid_request]
+      "127.0.0.1", origin.port(),
+      [=, &was_valid_request, &origin]
       (error_code const ec, tcp::endpoint const) mutable -> void {
 
         auto message = std::make_shared<
@@ -47,10 +53,11 @@ TEST_CASE("Our HTTP client session") {
 
         s.async_request(
           m, p,
-          [s, message, parser, &was_valid_request]
+          [s, message, parser, &was_valid_request, &origin]
           (error_code ec) mutable -> void {
 
           s.shutdown(ec);
+          origin.stop();
 
           auto msg = parser->release();
 
@@ -72,6 +79,9 @@ TEST_CASE("Our HTTP client session") {
 
     asio::io_context io;
 
+    auto origin = foxy::test::origin(io);
+    origin.run();
+
     auto was_valid_request = false;
 
     asio::spawn(
@@ -89,9 +99,10 @@ TEST_CASE("Our HTTP client session") {
 
         auto ec = error_code();
 
-        s.async_connect("www.google.com", "80", yield_ctx);
+        s.async_connect("127.0.0.1", origin.port(), yield_ctx);
         s.async_request(message, parser, yield_ctx);
         s.shutdown(ec);
+        origin.stop();
 
         auto msg = parser.release();
 
@@ -114,6 +125,12 @@ TEST_CASE("Our HTTP client session") {
 
     asio::io_context io;
 
+    auto const ca         = foxy::test::certificate_authority();
+    auto       server_ctx = ca.server_context();
+
+    auto origin = foxy::test::origin(io, {}, &server_ctx);
+    origin.run();
+
     auto was_valid_request = false;
 
     foxy::co_spawn(
@@ -125,7 +142,9 @@ TEST_CASE("Our HTTP client session") {
         auto error_token = foxy::redirect_error(token, ec);
 
         auto ctx = ssl::context(ssl::context::tlsv12_client);
-        auto s   = foxy::client_session(io, ctx);
+        ca.trust(ctx);
+
+        auto s = foxy::client_session(io, ctx);
 
         auto message =
           http::request<http::empty_body>(
@@ -134,10 +153,12 @@ TEST_CASE("Our HTTP client session") {
         http::response_parser<http::string_body>
         parser;
 
-        (void ) co_await s.async_connect("www.google.com", "443", token);
+        (void ) co_await s.async_connect("localhost", origin.port(), token);
         (void ) co_await s.async_request(message, parser, token);
         (void ) co_await s.async_ssl_shutdown(error_token);
 
+        origin.stop();
+
         auto msg = parser.release();
 
         auto is_correct_status = (msg.result_int() == 200);
@@ -161,13 +182,21 @@ TEST_CASE("Our HTTP client session") {
 
     asio::io_context io;
 
+    auto const ca         = foxy::test::certificate_authority();
+    auto       server_ctx = ca.server_context();
+
+    auto origin = foxy::test::origin(io, {}, &server_ctx);
+    origin.run();
+
     auto was_valid_request = false;
 
     asio::spawn(
       io,
       [&, http_version_11](asio::yield_context yield_ctx) mutable -> void {
         auto ctx = ssl::context(ssl::context::sslv23_client);
-        auto s   = foxy::client_session(io, ctx);
+        ca.trust(ctx);
+
+        auto s = foxy::client_session(io, ctx);
 
         auto message =
           http::request<http::empty_body>(
@@ -177,7 +206,7 @@ TEST_CASE("Our HTTP client session") {
         parser;
 
         auto connect_token
-          = s.async_connect("www.google.com", "443", asio::use_future);
+          = s.async_connect("localhost", origin.port(), asio::use_future);
 
         connect_token.get();
 
@@ -191,6 +220,8 @@ TEST_CASE("Our HTTP client session") {
 
         }
 
+        origin.stop();
+
         auto msg = parser.release();
 
         auto is_correct_status = (msg.result_int() == 200);
@@ -0,0 +1,257 @@
+#include "foxy/coroutine.hpp"
+#include "foxy/detail/collapser.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace http = boost::beast::http;
+
+using foxy::detail::collapser;
+using foxy::detail::collapsed_response;
+
+namespace {
+
+auto make_request() -> http::request_header<> {
+  auto request = http::request_header<>();
+  request.method(http::verb::get);
+  request.target("/");
+  request.version(11);
+  return request;
+}
+
+// follow_body reads the body of `response` as its leader publishes it, parking
+// whenever it's caught up
+//
+auto follow_body(collapsed_response& response, std::string& body)
+-> foxy::awaitable<void> {
+
+  using status   = collapsed_response::status;
+  using follower = collapsed_response::follower;
+
+  auto token = co_await foxy::this_coro::token();
+
+  auto& f = response.add_follower();
+  if (!response.joinable()) { co_return; }
+
+  collapsed_response::chunk const* pos = nullptr;
+
+  while (true) {
+    f.state.exchange(follower::idle);
+
+    auto const st   = response.get_status();
+    auto const next = pos ? response.next(pos) : response.first();
+
+    if (next) {
+      body += next->data;
+      pos   = next;
+      f.position.store(pos->index);
+      continue;
+    }
+
+    if (st != status::pending && st != status::streaming) { break; }
+
+    co_await response.async_park(f, token);
+  }
+}
+
+} // anonymous
+
+TEST_CASE("Our request collapser") {
+  SECTION("should make the first of concurrent requests their leader") {
+    auto in_flight = collapser();
+
+    auto is_leader = false;
+
+    auto const leader = in_flight.join("example.com:80/", make_request(),
+                                       is_leader);
+    CHECK(is_leader);
+
+    auto const follower = in_flight.join("example.com:80/", make_request(),
+                                         is_leader);
+    CHECK(!is_leader);
+    CHECK(follower == leader);
+
+    auto const other = in_flight.join("example.com:80/other", make_request(),
+                                      is_leader);
+    CHECK(is_leader);
+    CHECK(other != leader);
+
+    // a response which may not be shared is no use to anyone arriving later
+    //
+    leader->publish_header(http::response_header<>(), false, 1024);
+    CHECK(in_flight.join("example.com:80/", make_request(), is_leader) !=
+          leader);
+    CHECK(is_leader);
+
+    // nor is one its leader is done with
+    //
+    in_flight.leave(*other);
+    CHECK(in_flight.join("example.com:80/other", make_request(), is_leader) !=
+          other);
+    CHECK(is_leader);
+  }
+
+  SECTION("should stream the leader's response to its followers") {
+    asio::io_context io;
+
+    auto const response = std::make_shared<collapsed_response>(
+      "example.com:80/", make_request());
+
+    auto early = std::string();
+    auto late  = std::string();
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await follow_body(*response, early);
+      },
+      foxy::detached);
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        auto token = co_await foxy::this_coro::token();
+
+        auto timer = asio::steady_timer(io);
+
+        timer.expires_after(std::chrono::milliseconds(10));
+        co_await timer.async_wait(token);
+
+        auto header = http::response_header<>();
+        header.result(http::status::ok);
+        response->publish_header(header, true, 1024);
+        response->publish("hello, ", 7);
+
+        // a follower joining partway through still starts from the top
+        //
+        foxy::co_spawn(
+          io,
+          [&]() -> foxy::awaitable<void> {
+            co_await follow_body(*response, late);
+          },
+          foxy::detached);
+
+        timer.expires_after(std::chrono::milliseconds(10));
+        co_await timer.async_wait(token);
+
+        response->publish("world!", 6);
+        response->finish();
+      },
+      foxy::detached);
+
+    io.run();
+
+    CHECK(response->get_status() == collapsed_response::status::done);
+    CHECK(response->header().result() == http::status::ok);
+    CHECK(early == "hello, world!");
+    CHECK(late == "hello, world!");
+  }
+
+  SECTION("should wake its followers when the leader fails") {
+    asio::io_context io;
+
+    auto const response = std::make_shared<collapsed_response>(
+      "example.com:80/", make_request());
+
+    auto body = std::string();
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        co_await follow_body(*response, body);
+      },
+      foxy::detached);
+
+    foxy::co_spawn(
+      io,
+      [&]() -> foxy::awaitable<void> {
+        auto token = co_await foxy::this_coro::token();
+
+        auto timer = asio::steady_timer(io);
+
+        timer.expires_after(std::chrono::milliseconds(10));
+        co_await timer.async_wait(token);
+
+        response->fail();
+      },
+      foxy::detached);
+
+    io.run();
+
+    CHECK(response->get_status() == collapsed_response::status::failed);
+    CHECK(body.empty());
+  }
+
+  SECTION("should keep nothing for a response nobody is following") {
+    auto in_flight = collapser();
+
+    auto is_leader = false;
+    auto const leader = in_flight.join("example.com:80/", make_request(),
+                                       is_leader);
+
+    leader->publish_header(http::response_header<>(), true, 1024);
+    leader->publish("hello, world!", 13);
+
+    CHECK(!leader->joinable());
+    CHECK(leader->first() == nullptr);
+    CHECK(leader->retained() == 0);
+
+    // requests arriving now would have missed the start of the body
+    //
+    CHECK(in_flight.join("example.com:80/", make_request(), is_leader) !=
+          leader);
+    CHECK(is_leader);
+  }
+
+  SECTION("should release what its followers have read once past its limit") {
+    using follower = collapsed_response::follower;
+
+    auto const response = std::make_shared<collapsed_response>(
+      "example.com:80/", make_request());
+
+    auto& f = response->add_follower();
+
+    response->publish_header(http::response_header<>(), true, 8);
+    response->publish("hello, ", 7);
+
+    CHECK(response->joinable());
+    CHECK(response->retained() == 7);
+
+    // past the limit the response takes on nobody new, but everything the
+    // follower has yet to read is still there
+    //
+    response->publish("world", 5);
+
+    CHECK(!response->joinable());
+    CHECK(response->retained() == 12);
+
+    auto const* first = response->first();
+    REQUIRE(first);
+    REQUIRE(response->next(first));
+
+    f.position.store(response->next(first)->index);
+    response->publish("!", 1);
+
+    CHECK(response->retained() == 6);
+
+    // once the last follower is gone only the chunk the next one would be
+    // linked after is kept
+    //
+    f.position.store(follower::gone);
+    response->publish("?", 1);
+
+    CHECK(response->retained() == 1);
+
+    response->publish("?", 1);
+    CHECK(response->retained() == 1);
+  }
+}
@@ -1,13 +1,25 @@
 #include <boost/system/error_code.hpp>
 
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/ip/address_v4.hpp>
 
 #include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/buffers_to_string.hpp>
 
+#include "foxy/runtime.hpp"
 #include "foxy/coroutine.hpp"
 #include "foxy/forward_proxy.hpp"
 #include "foxy/client_session.hpp"
 
+#include "foxy/test/origin.hpp"
+
+#include <chrono>
+#include <string>
+
 #include <catch2/catch.hpp>
 
 namespace asio = boost::asio;
@@ -129,4 +141,647 @@ TEST_CASE("Our forward proxy") {
 
     REQUIRE(was_valid_request);
   }
-}
\ No newline at end of file
+
+  SECTION("should tunnel requests to the remote host") {
+
+    asio::io_context io;
+
+    auto opts       = foxy::test::origin_options();
+    opts.body_size  = 256 * 1024;
+    opts.chunk_size = 4096;
+
+    auto origin = foxy::test::origin(io, opts);
+    origin.run();
+
+    auto proxy = foxy::forward_proxy(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true);
+
+    proxy.run();
+
+    auto was_valid_tunnel = false;
+
+    foxy::co_spawn(
+      io,
+      [&]() mutable -> foxy::awaitable<void> {
+
+        auto token       = co_await foxy::this_coro::token();
+        auto ec          = boost::system::error_code();
+        auto error_token = foxy::redirect_error(token, ec);
+
+        auto session = foxy::client_session(io);
+
+        (void ) co_await session.async_connect(
+          "127.0.0.1", std::to_string(proxy.local_endpoint().port()), token);
+
+        auto connect = http::request<http::empty_body>(
+          http::verb::connect, "127.0.0.1:" + origin.port(), 11);
+
+        // nothing in a 200 response to a CONNECT says it has no body
+        //
+        http::response_parser<http::empty_body> connect_parser;
+        connect_parser.skip(true);
+
+        (void ) co_await session.async_request(
+          connect, connect_parser, token);
+
+        auto const is_tunnel_open =
+          connect_parser.get().result() == http::status::ok;
+
+        CHECK(is_tunnel_open);
+
+        auto was_valid_response = true;
+        for (auto i = 0; i < 3; ++i) {
+          auto req = http::request<http::empty_body>(http::verb::get, "/", 11);
+
+          http::response_parser<http::string_body> res_parser;
+          res_parser.body_limit(opts.body_size);
+
+          (void ) co_await session.async_request(req, res_parser, token);
+
+          auto res = res_parser.release();
+
+          was_valid_response =
+            was_valid_response &&
+            res.result() == http::status::ok &&
+            res.body() == std::string(opts.body_size, 'x');
+        }
+
+        CHECK(was_valid_response);
+        CHECK(origin.stats().connections == 1);
+        CHECK(origin.stats().requests == 3);
+
+        was_valid_tunnel = is_tunnel_open && was_valid_response;
+
+        session.shutdown(ec);
+
+        io.stop();
+        co_return;
+      },
+      foxy::detached);
+
+    io.run();
+
+    REQUIRE(was_valid_tunnel);
+  }
+
+  SECTION("should close idle tunnels as soon as it's drained") {
+
+    asio::io_context io;
+
+    auto origin = foxy::test::origin(io, foxy::test::origin_options());
+    origin.run();
+
+    auto proxy = foxy::forward_proxy(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true);
+
+    proxy.run();
+
+    auto drain_ec  = boost::system::error_code();
+    auto remaining = std::size_t{1};
+    auto elapsed   = std::chrono::steady_clock::duration();
+
+    foxy::co_spawn(
+      io,
+      [&]() mutable -> foxy::awaitable<void> {
+
+        auto token = co_await foxy::this_coro::token();
+        auto ec    = boost::system::error_code();
+
+        auto session = foxy::client_session(io);
+
+        (void ) co_await session.async_connect(
+          "127.0.0.1", std::to_string(proxy.local_endpoint().port()), token);
+
+        auto connect = http::request<http::empty_body>(
+          http::verb::connect, "127.0.0.1:" + origin.port(), 11);
+
+        http::response_parser<http::empty_body> connect_parser;
+        connect_parser.skip(true);
+
+        (void ) co_await session.async_request(
+          connect, connect_parser, token);
+
+        auto req = http::request<http::empty_body>(http::verb::get, "/", 11);
+        http::response_parser<http::string_body> res_parser;
+
+        (void ) co_await session.async_request(req, res_parser, token);
+
+        // the tunnel now sits waiting on our next request, which never comes
+        //
+        auto const start = std::chrono::steady_clock::now();
+
+        remaining = co_await proxy.async_drain(
+          std::chrono::steady_clock::now() + std::chrono::seconds(5),
+          foxy::redirect_error(token, drain_ec));
+
+        elapsed = std::chrono::steady_clock::now() - start;
+
+        session.shutdown(ec);
+
+        io.stop();
+        co_return;
+      },
+      foxy::detached);
+
+    io.run();
+
+    CHECK(!drain_ec);
+    CHECK(remaining == 0);
+    CHECK(elapsed < std::chrono::seconds(1));
+  }
+
+  SECTION("should close connections yet to send a request when drained") {
+
+    asio::io_context io;
+
+    auto proxy = foxy::forward_proxy(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true);
+
+    proxy.run();
+
+    auto drain_ec  = boost::system::error_code();
+    auto remaining = std::size_t{1};
+    auto elapsed   = std::chrono::steady_clock::duration();
+
+    foxy::co_spawn(
+      io,
+      [&]() mutable -> foxy::awaitable<void> {
+
+        auto token = co_await foxy::this_coro::token();
+        auto ec    = boost::system::error_code();
+
+        auto session = foxy::client_session(io);
+
+        (void ) co_await session.async_connect(
+          "127.0.0.1", std::to_string(proxy.local_endpoint().port()), token);
+
+        // give the proxy the chance to pick the connection up, after which it
+        // waits on a CONNECT that never comes
+        //
+        auto timer = asio::steady_timer(io);
+        timer.expires_after(std::chrono::milliseconds(50));
+        co_await timer.async_wait(token);
+
+        auto const start = std::chrono::steady_clock::now();
+
+        remaining = co_await proxy.async_drain(
+          std::chrono::steady_clock::now() + std::chrono::seconds(5),
+          foxy::redirect_error(token, drain_ec));
+
+        elapsed = std::chrono::steady_clock::now() - start;
+
+        session.shutdown(ec);
+
+        io.stop();
+        co_return;
+      },
+      foxy::detached);
+
+    io.run();
+
+    CHECK(!drain_ec);
+    CHECK(remaining == 0);
+    CHECK(elapsed < std::chrono::seconds(1));
+  }
+
+  SECTION("should accept on every thread of a runtime") {
+
+    asio::io_context io;
+
+    auto origin = foxy::test::origin(io, foxy::test::origin_options());
+    origin.run();
+
+    auto rt_opts = foxy::runtime::options();
+    rt_opts.num_threads = 2;
+
+    auto rt = foxy::runtime(rt_opts);
+    rt.run();
+
+    auto proxy = foxy::forward_proxy(
+      rt, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true);
+
+    proxy.run();
+
+    auto constexpr num_clients = 4;
+
+    auto num_valid = 0;
+    auto num_done  = 0;
+
+    for (auto i = 0; i < num_clients; ++i) {
+      foxy::co_spawn(
+        io,
+        [&]() mutable -> foxy::awaitable<void> {
+
+          auto token = co_await foxy::this_coro::token();
+          auto ec    = boost::system::error_code();
+
+          auto session = foxy::client_session(io);
+
+          (void ) co_await session.async_connect(
+            "127.0.0.1", std::to_string(proxy.local_endpoint().port()), token);
+
+          auto connect = http::request<http::empty_body>(
+            http::verb::connect, "127.0.0.1:" + origin.port(), 11);
+
+          http::response_parser<http::empty_body> connect_parser;
+          connect_parser.skip(true);
+
+          (void ) co_await session.async_request(
+            connect, connect_parser, token);
+
+          auto req = http::request<http::empty_body>(http::verb::get, "/", 11);
+
+          http::response_parser<http::string_body> res_parser;
+
+          (void ) co_await session.async_request(req, res_parser, token);
+
+          auto const is_valid =
+            connect_parser.get().result() == http::status::ok &&
+            res_parser.get().result() == http::status::ok;
+
+          if (is_valid) { ++num_valid; }
+
+          session.shutdown(ec);
+
+          if (++num_done == num_clients) { io.stop(); }
+          co_return;
+        },
+        foxy::detached);
+    }
+
+    io.run();
+
+    CHECK(num_valid == num_clients);
+    CHECK(origin.stats().requests == num_clients);
+  }
+
+  SECTION("should hand connections off to the threads of a runtime") {
+
+    asio::io_context io;
+
+    auto origin = foxy::test::origin(io, foxy::test::origin_options());
+    origin.run();
+
+    auto rt_opts = foxy::runtime::options();
+    rt_opts.num_threads = 2;
+
+    auto rt = foxy::runtime(rt_opts);
+    rt.run();
+
+    // the test's own thread does the accepting
+    //
+    auto proxy_opts     = foxy::forward_proxy::options();
+    proxy_opts.dispatch = foxy::forward_proxy::dispatch_policy::round_robin;
+
+    auto proxy = foxy::forward_proxy(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true, rt,
+      proxy_opts);
+
+    proxy.run();
+
+    auto constexpr num_clients = 4;
+
+    auto num_valid = 0;
+    auto num_done  = 0;
+
+    for (auto i = 0; i < num_clients; ++i) {
+      foxy::co_spawn(
+        io,
+        [&]() mutable -> foxy::awaitable<void> {
+
+          auto token = co_await foxy::this_coro::token();
+          auto ec    = boost::system::error_code();
+
+          auto session = foxy::client_session(io);
+
+          (void ) co_await session.async_connect(
+            "127.0.0.1", std::to_string(proxy.local_endpoint().port()), token);
+
+          auto connect = http::request<http::empty_body>(
+            http::verb::connect, "127.0.0.1:" + origin.port(), 11);
+
+          http::response_parser<http::empty_body> connect_parser;
+          connect_parser.skip(true);
+
+          (void ) co_await session.async_request(
+            connect, connect_parser, token);
+
+          auto req = http::request<http::empty_body>(http::verb::get, "/", 11);
+
+          http::response_parser<http::string_body> res_parser;
+
+          (void ) co_await session.async_request(req, res_parser, token);
+
+          auto const is_valid =
+            connect_parser.get().result() == http::status::ok &&
+            res_parser.get().result() == http::status::ok;
+
+          if (is_valid) { ++num_valid; }
+
+          session.shutdown(ec);
+
+          if (++num_done == num_clients) { io.stop(); }
+          co_return;
+        },
+        foxy::detached);
+    }
+
+    io.run();
+
+    CHECK(num_valid == num_clients);
+    CHECK(origin.stats().requests == num_clients);
+  }
+
+  SECTION("should answer repeated requests from its cache") {
+
+    asio::io_context io;
+
+    auto opts          = foxy::test::origin_options();
+    opts.body_size     = 16 * 1024;
+    opts.chunk_size    = 4096;
+    opts.cache_control = "max-age=60";
+
+    auto origin = foxy::test::origin(io, opts);
+    origin.run();
+
+    auto proxy_opts = foxy::forward_proxy::options();
+    proxy_opts.cache.memory_capacity = 1024 * 1024;
+
+    auto proxy = foxy::forward_proxy(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true,
+      proxy_opts);
+
+    proxy.run();
+
+    auto was_valid_response = true;
+    auto ages               = std::string();
+
+    foxy::co_spawn(
+      io,
+      [&]() mutable -> foxy::awaitable<void> {
+
+        auto token = co_await foxy::this_coro::token();
+        auto ec    = boost::system::error_code();
+
+        auto session = foxy::client_session(io);
+
+        (void ) co_await session.async_connect(
+          "127.0.0.1", std::to_string(proxy.local_endpoint().port()), token);
+
+        auto connect = http::request<http::empty_body>(
+          http::verb::connect, "127.0.0.1:" + origin.port(), 11);
+
+        http::response_parser<http::empty_body> connect_parser;
+        connect_parser.skip(true);
+
+        (void ) co_await session.async_request(
+          connect, connect_parser, token);
+
+        REQUIRE(connect_parser.get().result() == http::status::ok);
+
+        for (auto i = 0; i < 3; ++i) {
+          auto req = http::request<http::empty_body>(http::verb::get, "/", 11);
+
+          http::response_parser<http::string_body> res_parser;
+          res_parser.body_limit(opts.body_size);
+
+          (void ) co_await session.async_request(req, res_parser, token);
+
+          auto res = res_parser.release();
+
+          was_valid_response =
+            was_valid_response &&
+            res.result() == http::status::ok &&
+            res.body() == std::string(opts.body_size, 'x');
+
+          ages += std::string(res[http::field::age]) + "|";
+        }
+
+        session.shutdown(ec);
+
+        io.stop();
+        co_return;
+      },
+      foxy::detached);
+
+    io.run();
+
+    CHECK(was_valid_response);
+    CHECK(ages == "|0|0|");
+    CHECK(origin.stats().requests == 1);
+
+    auto const stats = proxy.cache_stats();
+    CHECK(stats.hits == 2);
+    CHECK(stats.misses == 1);
+    CHECK(stats.stores == 1);
+  }
+
+  SECTION("should collapse concurrent requests for the same resource") {
+
+    asio::io_context io;
+
+    auto opts          = foxy::test::origin_options();
+    opts.body_size     = 16 * 1024;
+    opts.chunk_size    = 4096;
+    opts.latency       = std::chrono::milliseconds(100);
+    opts.cache_control = "max-age=60";
+
+    auto origin = foxy::test::origin(io, opts);
+    origin.run();
+
+    // the cache is left off so that only collapsing can spare the origin
+    //
+    auto proxy = foxy::forward_proxy(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true);
+
+    proxy.run();
+
+    auto constexpr num_clients = 3;
+
+    auto was_valid_response = true;
+    auto num_done           = 0;
+
+    for (auto i = 0; i < num_clients; ++i) {
+      foxy::co_spawn(
+        io,
+        [&]() mutable -> foxy::awaitable<void> {
+
+          auto token = co_await foxy::this_coro::token();
+          auto ec    = boost::system::error_code();
+
+          auto session = foxy::client_session(io);
+
+          (void ) co_await session.async_connect(
+            "127.0.0.1", std::to_string(proxy.local_endpoint().port()), token);
+
+          auto connect = http::request<http::empty_body>(
+            http::verb::connect, "127.0.0.1:" + origin.port(), 11);
+
+          http::response_parser<http::empty_body> connect_parser;
+          connect_parser.skip(true);
+
+          (void ) co_await session.async_request(
+            connect, connect_parser, token);
+
+          REQUIRE(connect_parser.get().result() == http::status::ok);
+
+          auto req = http::request<http::empty_body>(http::verb::get, "/", 11);
+
+          http::response_parser<http::string_body> res_parser;
+          res_parser.body_limit(opts.body_size);
+
+          (void ) co_await session.async_request(req, res_parser, token);
+
+          auto res = res_parser.release();
+
+          was_valid_response =
+            was_valid_response &&
+            res.result() == http::status::ok &&
+            res.body() == std::string(opts.body_size, 'x');
+
+          session.shutdown(ec);
+
+          if (++num_done == num_clients) { io.stop(); }
+          co_return;
+        },
+        foxy::detached);
+    }
+
+    io.run();
+
+    CHECK(num_done == num_clients);
+    CHECK(was_valid_response);
+    CHECK(origin.stats().requests == 1);
+  }
+
+  SECTION("should relay upgraded connections as raw bytes") {
+
+    asio::io_context io;
+
+    auto proxy = foxy::forward_proxy(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0), true);
+
+    proxy.run();
+
+    auto upstream = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto upgrade_fields = std::string();
+    auto echoed         = std::string();
+    auto saw_close      = false;
+
+    // the upstream agrees to the upgrade and then echoes everything back
+    // until the client is done
+    //
+    foxy::co_spawn(
+      io,
+      [&]() mutable -> foxy::awaitable<void> {
+
+        auto token = co_await foxy::this_coro::token();
+        auto ec    = boost::system::error_code();
+
+        auto socket = tcp::socket(io);
+        co_await upstream.async_accept(socket, token);
+
+        auto buffer  = boost::beast::flat_buffer();
+        auto request = http::request<http::empty_body>();
+        co_await http::async_read(socket, buffer, request, token);
+
+        upgrade_fields =
+          std::string(request[http::field::connection]) + "|" +
+          std::string(request[http::field::upgrade]);
+
+        auto const response = std::string(
+          "HTTP/1.1 101 Switching Protocols\r\n"
+          "Connection: Upgrade\r\n"
+          "Upgrade: websocket\r\n\r\n");
+
+        co_await asio::async_write(socket, asio::buffer(response), token);
+
+        while (true) {
+          if (buffer.size() > 0) {
+            co_await asio::async_write(socket, buffer.data(), token);
+            buffer.consume(buffer.size());
+          }
+
+          auto const n = co_await socket.async_read_some(
+            buffer.prepare(4096), foxy::redirect_error(token, ec));
+
+          buffer.commit(n);
+          if (ec) { break; }
+        }
+
+        socket.shutdown(tcp::socket::shutdown_send, ec);
+      },
+      foxy::detached);
+
+    foxy::co_spawn(
+      io,
+      [&]() mutable -> foxy::awaitable<void> {
+
+        auto token = co_await foxy::this_coro::token();
+        auto ec    = boost::system::error_code();
+
+        auto socket = tcp::socket(io);
+        co_await socket.async_connect(proxy.local_endpoint(), token);
+
+        auto const port = std::to_string(upstream.local_endpoint().port());
+
+        auto const connect = std::string(
+          "CONNECT 127.0.0.1:" + port + " HTTP/1.1\r\n\r\n");
+
+        co_await asio::async_write(socket, asio::buffer(connect), token);
+
+        auto buffer = boost::beast::flat_buffer();
+
+        http::response_parser<http::empty_body> connect_parser;
+        connect_parser.skip(true);
+        co_await http::async_read(socket, buffer, connect_parser, token);
+
+        // the first message of the new protocol follows the request without
+        // waiting for the 101
+        //
+        auto const upgrade = std::string(
+          "GET /chat HTTP/1.1\r\n"
+          "Host: 127.0.0.1\r\n"
+          "Connection: keep-alive, Upgrade\r\n"
+          "Upgrade: websocket\r\n\r\n"
+          "hello");
+
+        co_await asio::async_write(socket, asio::buffer(upgrade), token);
+
+        http::response_parser<http::empty_body> upgrade_parser;
+        co_await http::async_read(socket, buffer, upgrade_parser, token);
+
+        CHECK(
+          upgrade_parser.get().result() == http::status::switching_protocols);
+
+        co_await asio::async_write(
+          socket, asio::buffer(std::string(" world")), token);
+
+        socket.shutdown(tcp::socket::shutdown_send, ec);
+
+        // the upstream only closes once our close has made it through
+        //
+        while (true) {
+          auto const n = co_await socket.async_read_some(
+            buffer.prepare(4096), foxy::redirect_error(token, ec));
+
+          buffer.commit(n);
+          if (ec) { break; }
+        }
+
+        saw_close = (ec == asio::error::eof);
+        echoed    = boost::beast::buffers_to_string(buffer.data());
+
+        io.stop();
+      },
+      foxy::detached);
+
+    io.run();
+
+    CHECK(upgrade_fields == "upgrade|websocket");
+    CHECK(echoed == "hello world");
+    CHECK(saw_close);
+  }
+}
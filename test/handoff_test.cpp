@@ -0,0 +1,75 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include "foxy/handoff.hpp"
+
+#include <thread>
+#include <chrono>
+#include <string>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+using ip::tcp;
+using boost::system::error_code;
+
+TEST_CASE("Our listening socket handoff") {
+  SECTION("should let a second acceptor accept off the same listen queue") {
+
+    asio::io_context io;
+
+    auto const addr = ip::make_address_v4("127.0.0.1");
+    auto const path = std::string("foxy_handoff_test.sock");
+
+    auto old_acceptor = tcp::acceptor(io, tcp::endpoint(addr, 0));
+    auto const port   = old_acceptor.local_endpoint().port();
+
+    auto receive_ec = error_code();
+    auto new_port   = static_cast<unsigned short>(0);
+    auto accepted   = false;
+
+    auto receiver = std::thread([&]() {
+      asio::io_context new_io;
+
+      auto new_acceptor = foxy::receive_acceptor(new_io, path, receive_ec);
+      if (receive_ec) { return; }
+
+      new_port = new_acceptor.local_endpoint().port();
+
+      auto socket = tcp::socket(new_io);
+      auto ec     = error_code();
+      new_acceptor.accept(socket, ec);
+      accepted = !ec;
+    });
+
+    // give the receiver a chance to bind `path`
+    //
+    auto send_ec = error_code();
+    for (auto attempts = 0; attempts < 50; ++attempts) {
+      foxy::send_acceptor(old_acceptor, path, send_ec);
+      if (!send_ec) { break; }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // once the old acceptor is closed, only the new one can pick up the
+    // connection
+    //
+    old_acceptor.close();
+
+    auto client = tcp::socket(io);
+    auto ec     = error_code();
+    client.connect(tcp::endpoint(addr, port), ec);
+
+    receiver.join();
+
+    CHECK(!send_ec);
+    CHECK(!receive_ec);
+    CHECK(!ec);
+    CHECK(new_port == port);
+    CHECK(accepted);
+  }
+}
@@ -0,0 +1,169 @@
+#include <boost/system/error_code.hpp>
+
+#include "foxy/http2_error.hpp"
+#include "foxy/detail/hpack.hpp"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <catch2/catch.hpp>
+
+using boost::system::error_code;
+using foxy::detail::header_field;
+
+namespace {
+
+auto from_hex(std::string const& hex) -> std::string {
+  auto bytes = std::string();
+  for (auto i = std::size_t{0}; i + 1 < hex.size(); i += 2) {
+    auto const byte = std::stoi(hex.substr(i, 2), nullptr, 16);
+    bytes.push_back(static_cast<char>(byte));
+  }
+  return bytes;
+}
+
+auto encode(
+  foxy::detail::hpack_encoder&     encoder,
+  std::vector<header_field> const& fields) -> std::string {
+
+  auto block = std::string();
+  for (auto const& field : fields) {
+    encoder.encode(field.name, field.value, block);
+  }
+  return block;
+}
+
+auto same(
+  std::vector<header_field> const& lhs,
+  std::vector<header_field> const& rhs) -> bool {
+
+  if (lhs.size() != rhs.size()) { return false; }
+  for (auto i = std::size_t{0}; i < lhs.size(); ++i) {
+    if (lhs[i].name != rhs[i].name || lhs[i].value != rhs[i].value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // anonymous
+
+TEST_CASE("Our HPACK implementation") {
+  // the requests of RFC 7541 appendix C.4
+  //
+  auto const requests = std::vector<std::vector<header_field>>{
+    {
+      {":method", "GET"},
+      {":scheme", "http"},
+      {":path", "/"},
+      {":authority", "www.example.com"}
+    },
+    {
+      {":method", "GET"},
+      {":scheme", "http"},
+      {":path", "/"},
+      {":authority", "www.example.com"},
+      {"cache-control", "no-cache"}
+    },
+    {
+      {":method", "GET"},
+      {":scheme", "https"},
+      {":path", "/index.html"},
+      {":authority", "www.example.com"},
+      {"custom-key", "custom-value"}
+    }
+  };
+
+  auto const blocks = std::vector<std::string>{
+    from_hex("828684418cf1e3c2e5f23a6ba0ab90f4ff"),
+    from_hex("828684be5886a8eb10649cbf"),
+    from_hex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf")
+  };
+
+  SECTION("should encode the RFC's example requests") {
+    auto encoder = foxy::detail::hpack_encoder();
+    for (auto i = std::size_t{0}; i < requests.size(); ++i) {
+      CHECK(encode(encoder, requests[i]) == blocks[i]);
+    }
+  }
+
+  SECTION("should decode the RFC's example requests") {
+    auto decoder = foxy::detail::hpack_decoder();
+    for (auto i = std::size_t{0}; i < blocks.size(); ++i) {
+      auto fields = std::vector<header_field>();
+      auto ec     = error_code();
+
+      decoder.decode(blocks[i], fields, ec);
+      REQUIRE(!ec);
+      CHECK(same(fields, requests[i]));
+    }
+  }
+
+  SECTION("should keep both tables in step as entries are evicted") {
+    auto encoder = foxy::detail::hpack_encoder();
+    auto decoder = foxy::detail::hpack_decoder();
+
+    encoder.set_max_size(256);
+
+    auto block = std::string();
+    encoder.encode("x-small-table", "ok", block);
+
+    auto ec     = error_code();
+    auto fields = std::vector<header_field>();
+
+    // the encoder announces the smaller table before anything else
+    //
+    decoder.decode(block, fields, ec);
+    REQUIRE(!ec);
+
+    for (auto i = 0; i < 50; ++i) {
+      auto const value = "value-" + std::to_string(i % 7);
+
+      block.clear();
+      encoder.encode("x-request-id", value, block);
+      encoder.encode("set-cookie", "secret", block, true);
+
+      fields.clear();
+      decoder.decode(block, fields, ec);
+      REQUIRE(!ec);
+      REQUIRE(fields.size() == 2);
+      CHECK(fields[0].value == value);
+      CHECK(fields[1].value == "secret");
+    }
+  }
+
+  SECTION("should round-trip every octet through the Huffman code") {
+    auto s = std::string();
+    for (auto c = 0; c < 256; ++c) { s.push_back(static_cast<char>(c)); }
+
+    auto encoded = std::string();
+    foxy::detail::huffman_encode(s, encoded);
+    CHECK(encoded.size() == foxy::detail::huffman_encoded_size(s));
+
+    auto decoded = std::string();
+    REQUIRE(foxy::detail::huffman_decode(encoded, decoded));
+    CHECK(decoded == s);
+  }
+
+  SECTION("should reject malformed blocks") {
+    auto decoder = foxy::detail::hpack_decoder();
+    auto fields  = std::vector<header_field>();
+    auto ec      = error_code();
+
+    // an index past the end of both tables
+    //
+    decoder.decode(from_hex("ff00"), fields, ec);
+    CHECK(ec == foxy::http2::error::compression_error);
+
+    // a Huffman string padded with zeros
+    //
+    decoder.decode(from_hex("0081" "00"), fields, ec);
+    CHECK(ec == foxy::http2::error::compression_error);
+
+    // a table larger than our SETTINGS allow
+    //
+    decoder.decode(from_hex("3fe21f"), fields, ec);
+    CHECK(ec == foxy::http2::error::compression_error);
+  }
+}
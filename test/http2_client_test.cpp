@@ -0,0 +1,256 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include "foxy/http2_error.hpp"
+#include "foxy/client_session.hpp"
+#include "foxy/detail/hpack.hpp"
+#include "foxy/detail/h2_frame.hpp"
+#include "foxy/detail/h2_message.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+namespace http = boost::beast::http;
+
+using ip::tcp;
+using boost::system::error_code;
+using foxy::detail::header_field;
+using foxy::detail::h2_frame_type;
+
+namespace {
+
+auto find_field(
+  std::vector<header_field> const& fields,
+  std::string_view const           name) -> std::string {
+
+  for (auto const& field : fields) {
+    if (field.name == name) { return field.value; }
+  }
+  return {};
+}
+
+auto write_buffer(
+  tcp::socket&               socket,
+  boost::beast::flat_buffer& out,
+  asio::yield_context        yield) -> void {
+
+  asio::async_write(socket, out.data(), yield);
+  out.consume(out.size());
+}
+
+// serve_h2 is just enough of an HTTP/2 server to answer each request with
+// its path followed by its body
+//
+auto serve_h2(tcp::socket& socket, asio::yield_context yield) -> void {
+  auto preface = std::string(foxy::detail::h2_client_preface.size(), '\0');
+  asio::async_read(socket, asio::buffer(preface), yield);
+  REQUIRE(preface == foxy::detail::h2_client_preface);
+
+  auto out = boost::beast::flat_buffer();
+  foxy::detail::write_settings(out, foxy::detail::h2_settings());
+  write_buffer(socket, out, yield);
+
+  auto encoder = foxy::detail::hpack_encoder();
+  auto decoder = foxy::detail::hpack_decoder();
+
+  auto requests = std::map<std::uint32_t, std::vector<header_field>>();
+  auto bodies   = std::map<std::uint32_t, std::string>();
+
+  while (true) {
+    char raw[foxy::detail::h2_frame_header_size];
+
+    auto ec = error_code();
+    asio::async_read(socket, asio::buffer(raw), yield[ec]);
+    if (ec) { return; }
+
+    auto const header = foxy::detail::parse_frame_header(raw);
+
+    auto payload = std::string(header.length, '\0');
+    asio::async_read(socket, asio::buffer(payload), yield);
+
+    if (header.is(h2_frame_type::goaway)) { return; }
+
+    if (header.is(h2_frame_type::settings) &&
+        (header.flags & foxy::detail::h2_ack) == 0) {
+      foxy::detail::write_frame(
+        out, h2_frame_type::settings, foxy::detail::h2_ack, 0, {});
+    }
+
+    if (header.is(h2_frame_type::headers)) {
+      REQUIRE((header.flags & foxy::detail::h2_end_headers) != 0);
+
+      decoder.decode(payload, requests[header.stream_id], ec);
+      REQUIRE(!ec);
+    }
+
+    if (header.is(h2_frame_type::data) && header.length > 0) {
+      bodies[header.stream_id] += payload;
+
+      // the data is consumed as soon as it arrives
+      //
+      foxy::detail::write_window_update(out, 0, header.length);
+      foxy::detail::write_window_update(out, header.stream_id, header.length);
+    }
+
+    auto const is_request_done =
+      (header.is(h2_frame_type::headers) || header.is(h2_frame_type::data)) &&
+      (header.flags & foxy::detail::h2_end_stream) != 0;
+
+    if (is_request_done) {
+      auto const& fields = requests[header.stream_id];
+      auto const  body   =
+        find_field(fields, ":path") + bodies[header.stream_id];
+
+      auto block = std::string();
+      encoder.encode(":status", "200", block);
+      encoder.encode("content-type", "text/plain", block);
+      encoder.encode("x-method", find_field(fields, ":method"), block);
+
+      foxy::detail::write_headers(
+        out, header.stream_id, block, false, foxy::detail::h2_min_frame_size);
+
+      foxy::detail::write_frame(
+        out,
+        h2_frame_type::data,
+        foxy::detail::h2_end_stream,
+        header.stream_id,
+        body);
+    }
+
+    if (out.size() > 0) { write_buffer(socket, out, yield); }
+  }
+}
+
+} // anonymous
+
+TEST_CASE("Our HTTP/2 message translation") {
+  SECTION("should turn requests into pseudo-header fields") {
+    auto request =
+      http::request<http::string_body>(http::verb::post, "/x", 11);
+    request.set(http::field::host, "example.com");
+    request.set(http::field::connection, "keep-alive");
+    request.set("X-Custom", "Value");
+
+    auto const fields = foxy::detail::make_h2_request_fields(
+      request, "https", "ignored.com");
+
+    REQUIRE(fields.size() == 5);
+    CHECK(fields[0].value == "POST");
+    CHECK(fields[1].value == "https");
+    CHECK(fields[2].value == "example.com");
+    CHECK(fields[3].value == "/x");
+    CHECK(fields[4].name == "x-custom");
+    CHECK(fields[4].value == "Value");
+  }
+
+  SECTION("should hand responses to a parser as HTTP/1.1") {
+    auto const fields = std::vector<header_field>{
+      {":status", "404"},
+      {"content-length", "1000"},
+      {"x-header", "value"}
+    };
+
+    auto parser = http::response_parser<http::string_body>();
+    auto ec     = error_code();
+
+    foxy::detail::parse_h2_response(fields, "not found", false, parser, ec);
+    REQUIRE(!ec);
+    REQUIRE(parser.is_done());
+
+    auto const& response = parser.get();
+    CHECK(response.result() == http::status::not_found);
+    CHECK(response["x-header"] == "value");
+    CHECK(response[http::field::content_length] == "9");
+    CHECK(response.body() == "not found");
+  }
+
+  SECTION("should reject fields which would split the header") {
+    auto const fields = std::vector<header_field>{
+      {":status", "200"},
+      {"x-header", "value\r\nx-injected: true"}
+    };
+
+    auto parser = http::response_parser<http::string_body>();
+    auto ec     = error_code();
+
+    foxy::detail::parse_h2_response(fields, "", false, parser, ec);
+    CHECK(ec == foxy::http2::error::protocol_error);
+  }
+}
+
+TEST_CASE("Our HTTP/2 client session") {
+  SECTION("should multiplex requests over one connection") {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+      acceptor.async_accept(socket, yield);
+
+      serve_h2(socket, yield);
+    });
+
+    auto client    = foxy::client_session(io);
+    auto responses = std::vector<http::response<http::string_body>>(2);
+    auto remaining = 2;
+
+    client.enable_http2();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      client.async_connect("127.0.0.1", port, yield);
+      REQUIRE(client.is_http2());
+
+      for (auto i = 0; i < 2; ++i) {
+        asio::spawn(yield, [&, i](asio::yield_context yield) {
+          auto request = http::request<http::string_body>(
+            i == 0 ? http::verb::get : http::verb::post,
+            i == 0 ? "/get" : "/post",
+            11);
+
+          if (i == 1) {
+            request.body() = std::string(100 * 1024, 'x');
+            request.prepare_payload();
+          }
+
+          auto parser = http::response_parser<http::string_body>();
+          client.async_request(request, parser, yield);
+
+          responses[i] = parser.release();
+
+          if (--remaining == 0) {
+            auto ec = error_code();
+            client.shutdown(ec);
+          }
+        });
+      }
+    });
+
+    io.run();
+
+    CHECK(responses[0].result() == http::status::ok);
+    CHECK(responses[0]["x-method"] == "GET");
+    CHECK(responses[0].body() == "/get");
+
+    CHECK(responses[1]["x-method"] == "POST");
+    CHECK(responses[1].body() == "/post" + std::string(100 * 1024, 'x'));
+  }
+}
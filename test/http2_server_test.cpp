@@ -0,0 +1,187 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include "foxy/coroutine.hpp"
+#include "foxy/multi_stream.hpp"
+#include "foxy/client_session.hpp"
+#include "foxy/server_session.hpp"
+#include "foxy/http2_error.hpp"
+#include "foxy/detail/h2_message.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+namespace http = boost::beast::http;
+
+using ip::tcp;
+using boost::system::error_code;
+using foxy::detail::header_field;
+
+TEST_CASE("Our HTTP/2 request translation") {
+  SECTION("should hand requests to a parser as HTTP/1.1") {
+    auto const fields = std::vector<header_field>{
+      {":method", "POST"},
+      {":scheme", "https"},
+      {":authority", "example.com"},
+      {":path", "/upload"},
+      {"cookie", "a=1"},
+      {"cookie", "b=2"},
+      {"content-length", "1000"}
+    };
+
+    auto parser = http::request_parser<http::string_body>();
+    auto ec     = error_code();
+
+    foxy::detail::parse_h2_request(fields, "body", parser, ec);
+    REQUIRE(!ec);
+    REQUIRE(parser.is_done());
+
+    auto const& request = parser.get();
+    CHECK(request.method() == http::verb::post);
+    CHECK(request.target() == "/upload");
+    CHECK(request[http::field::host] == "example.com");
+    CHECK(request[http::field::cookie] == "a=1; b=2");
+    CHECK(request[http::field::content_length] == "4");
+    CHECK(request.body() == "body");
+  }
+
+  SECTION("should reject malformed requests") {
+    auto const malformed = std::vector<std::vector<header_field>>{
+      // no :path
+      {{":method", "GET"}, {":scheme", "https"}},
+
+      // a pseudo-header field after a regular one
+      {{":method", "GET"}, {"accept", "*/*"}, {":path", "/"}},
+
+      // uppercase names
+      {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {"Foo", "x"}},
+
+      // a path which would split the request line
+      {{":method", "GET"}, {":scheme", "http"}, {":path", "/ HTTP/1.0"}}
+    };
+
+    for (auto const& fields : malformed) {
+      auto parser = http::request_parser<http::string_body>();
+      auto ec     = error_code();
+
+      foxy::detail::parse_h2_request(fields, "", parser, ec);
+      CHECK(ec == foxy::http2::error::protocol_error);
+    }
+  }
+}
+
+TEST_CASE("Our HTTP/2 server session") {
+  SECTION("should answer concurrent streams as they become ready") {
+    using strand_type = foxy::server_session::strand_type;
+
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto const port = std::to_string(acceptor.local_endpoint().port());
+
+    auto& streams    = foxy::detail::session_metrics::get().h2_streams;
+    auto const prior = streams.value();
+
+    auto serve_ec = error_code(asio::error::would_block);
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io);
+      acceptor.async_accept(stream.stream(), yield);
+
+      auto session = foxy::server_session(std::move(stream));
+
+      // "/slow" takes its time so that "/fast", sent after it, is answered
+      // first
+      //
+      session.async_serve(
+        [&io](http::request<http::string_body>& request)
+        -> foxy::awaitable<http::response<http::string_body>, strand_type> {
+
+          auto token = co_await foxy::this_coro::token();
+
+          if (request.target() == "/slow") {
+            auto timer = asio::steady_timer(io);
+            timer.expires_after(std::chrono::milliseconds(100));
+            co_await timer.async_wait(token);
+          }
+
+          auto response =
+            http::response<http::string_body>(http::status::ok, 11);
+
+          response.set("x-target", request.target());
+          response.body() = std::string(request.target()) + request.body();
+          response.prepare_payload();
+
+          co_return response;
+        },
+        yield[serve_ec]);
+    });
+
+    auto client  = foxy::client_session(io);
+    auto order   = std::vector<std::string>();
+    auto bodies  = std::vector<std::string>(3);
+    auto pending = 3;
+
+    client.enable_http2();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      client.async_connect("127.0.0.1", port, yield);
+      REQUIRE(client.is_http2());
+
+      auto const targets = std::vector<std::string>{"/slow", "/fast", "/post"};
+
+      for (auto i = std::size_t{0}; i < targets.size(); ++i) {
+        asio::spawn(yield, [&, i](asio::yield_context yield) {
+          auto request = http::request<http::string_body>(
+            i == 2 ? http::verb::post : http::verb::get, targets[i], 11);
+
+          if (i == 2) {
+            request.body() = std::string(256 * 1024, 'x');
+            request.prepare_payload();
+          }
+
+          auto parser = http::response_parser<http::string_body>();
+          parser.body_limit(1024 * 1024);
+
+          client.async_request(request, parser, yield);
+
+          auto response = parser.release();
+          order.push_back(std::string(response["x-target"]));
+          bodies[i] = response.body();
+
+          if (--pending == 0) {
+            auto ec = error_code();
+            client.shutdown(ec);
+          }
+        });
+      }
+    });
+
+    io.run();
+
+    CHECK(!serve_ec);
+    CHECK(streams.value() - prior == 3);
+
+    REQUIRE(order.size() == 3);
+    CHECK(order.back() == "/slow");
+
+    CHECK(bodies[0] == "/slow");
+    CHECK(bodies[1] == "/fast");
+    CHECK(bodies[2] == "/post" + std::string(256 * 1024, 'x'));
+  }
+}
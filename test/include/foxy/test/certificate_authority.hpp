@@ -0,0 +1,151 @@
+#ifndef FOXY_TEST_CERTIFICATE_AUTHORITY_HPP_
+#define FOXY_TEST_CERTIFICATE_AUTHORITY_HPP_
+
+#include <boost/asio/ssl/context.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include <memory>
+#include <stdexcept>
+
+namespace foxy {
+namespace test {
+
+// certificate_authority is a throwaway CA generated in memory along with a
+// single server certificate it has signed for "localhost" and 127.0.0.1
+//
+// `server_context` serves that certificate while `trust` makes a client
+// context accept it, so tests and benchmarks can run TLS over loopback with
+// full peer verification and without touching the filesystem
+//
+struct certificate_authority {
+
+private:
+  using key_type  = std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>;
+  using cert_type = std::unique_ptr<X509, decltype(&X509_free)>;
+
+  key_type  ca_key_;
+  cert_type ca_cert_;
+  key_type  server_key_;
+  cert_type server_cert_;
+
+  static auto make_key() -> key_type {
+    auto ctx = std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)>(
+      EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr), &EVP_PKEY_CTX_free);
+
+    EVP_PKEY* key = nullptr;
+    if (!ctx ||
+        EVP_PKEY_keygen_init(ctx.get()) != 1 ||
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(
+          ctx.get(), NID_X9_62_prime256v1) != 1 ||
+        EVP_PKEY_keygen(ctx.get(), &key) != 1) {
+      throw std::runtime_error("unable to generate a test key");
+    }
+
+    return key_type(key, &EVP_PKEY_free);
+  }
+
+  static auto add_extension(X509* cert, X509* issuer, int nid, char const* v)
+  -> void {
+    auto ctx = X509V3_CTX();
+    X509V3_set_ctx_nodb(&ctx);
+    X509V3_set_ctx(&ctx, issuer, cert, nullptr, nullptr, 0);
+
+    auto* ext = X509V3_EXT_conf_nid(nullptr, &ctx, nid, v);
+    if (!ext) {
+      throw std::runtime_error("unable to create a test certificate extension");
+    }
+
+    X509_add_ext(cert, ext, -1);
+    X509_EXTENSION_free(ext);
+  }
+
+  static auto make_cert(
+    EVP_PKEY*   key,
+    char const* common_name,
+    long const  serial,
+    X509*       issuer,
+    EVP_PKEY*   issuer_key) -> cert_type {
+
+    auto cert = cert_type(X509_new(), &X509_free);
+
+    X509_set_version(cert.get(), 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), serial);
+    X509_gmtime_adj(X509_getm_notBefore(cert.get()), -60 * 60);
+    X509_gmtime_adj(X509_getm_notAfter(cert.get()), 60 * 60 * 24);
+    X509_set_pubkey(cert.get(), key);
+
+    auto* name = X509_get_subject_name(cert.get());
+    X509_NAME_add_entry_by_txt(
+      name, "CN", MBSTRING_ASC,
+      reinterpret_cast<unsigned char const*>(common_name), -1, -1, 0);
+
+    auto* signer = issuer ? issuer : cert.get();
+    X509_set_issuer_name(cert.get(), X509_get_subject_name(signer));
+
+    if (issuer) {
+      add_extension(cert.get(), signer, NID_basic_constraints, "CA:FALSE");
+      add_extension(
+        cert.get(), signer, NID_subject_alt_name,
+        "DNS:localhost,IP:127.0.0.1");
+    } else {
+      add_extension(
+        cert.get(), signer, NID_basic_constraints, "critical,CA:TRUE");
+      add_extension(
+        cert.get(), signer, NID_key_usage, "critical,keyCertSign,cRLSign");
+    }
+
+    if (X509_sign(cert.get(), issuer_key, EVP_sha256()) == 0) {
+      throw std::runtime_error("unable to sign a test certificate");
+    }
+
+    return cert;
+  }
+
+public:
+  certificate_authority()
+  : ca_key_(make_key())
+  , ca_cert_(
+      make_cert(ca_key_.get(), "foxy test CA", 1, nullptr, ca_key_.get()))
+  , server_key_(make_key())
+  , server_cert_(
+      make_cert(
+        server_key_.get(), "localhost", 2, ca_cert_.get(), ca_key_.get()))
+  {
+  }
+
+  certificate_authority(certificate_authority const&) = delete;
+  certificate_authority(certificate_authority&&)      = default;
+
+  auto server_context() const -> boost::asio::ssl::context {
+    namespace ssl = boost::asio::ssl;
+
+    auto ctx = ssl::context(ssl::context::tls_server);
+    SSL_CTX_use_certificate(ctx.native_handle(), server_cert_.get());
+    SSL_CTX_use_PrivateKey(ctx.native_handle(), server_key_.get());
+    return ctx;
+  }
+
+  // `trust` adds the CA to `ctx`'s trust store and turns on peer
+  // verification
+  //
+  auto trust(boost::asio::ssl::context& ctx) const -> void {
+    X509_STORE_add_cert(
+      SSL_CTX_get_cert_store(ctx.native_handle()), ca_cert_.get());
+
+    ctx.set_verify_mode(boost::asio::ssl::verify_peer);
+  }
+
+  auto client_context() const -> boost::asio::ssl::context {
+    auto ctx = boost::asio::ssl::context(boost::asio::ssl::context::tls_client);
+    trust(ctx);
+    return ctx;
+  }
+};
+
+} // test
+} // foxy
+
+#endif // FOXY_TEST_CERTIFICATE_AUTHORITY_HPP_
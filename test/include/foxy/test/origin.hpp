@@ -0,0 +1,265 @@
+#ifndef FOXY_TEST_ORIGIN_HPP_
+#define FOXY_TEST_ORIGIN_HPP_
+
+#include "foxy/coroutine.hpp"
+#include "foxy/multi_stream.hpp"
+#include "foxy/server_session.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <algorithm>
+
+namespace foxy {
+namespace test {
+
+struct origin_options {
+  // every response carries a body of this many bytes
+  //
+  std::size_t body_size = 1024;
+
+  // when non-zero, bodies are sent with chunked transfer coding in chunks of
+  // this size
+  //
+  std::size_t chunk_size = 0;
+
+  // how long to wait before responding to each request
+  //
+  std::chrono::milliseconds latency = std::chrono::milliseconds(0);
+
+  // when false, every connection is closed after its first response no
+  // matter what the client asked for
+  //
+  bool keep_alive = true;
+
+  // when non-zero, a connection is closed after serving this many requests
+  //
+  std::size_t max_requests_per_connection = 0;
+
+  // when set, every response carries it in a `Cache-Control` field
+  //
+  std::string cache_control;
+};
+
+// origin is an in-process HTTP/1.1 server built on `foxy::server_session`,
+// listening on an ephemeral loopback port
+//
+// it answers every request, regardless of method or target, with a 200 and a
+// body shaped by `origin_options`
+// when given an SSL context, every connection is TLS
+//
+// the origin keeps accepting until `stop` is called and may be driven by any
+// number of threads running its `io_context`
+//
+struct origin {
+
+public:
+  struct stats_type {
+    std::size_t connections = 0;
+    std::size_t requests    = 0;
+  };
+
+private:
+  struct state {
+    boost::asio::io_context&       io;
+    boost::asio::ip::tcp::acceptor acceptor;
+    boost::asio::ssl::context*     ctx;
+    origin_options const           opts;
+    std::string const              body;
+
+    std::atomic<std::size_t> connections;
+    std::atomic<std::size_t> requests;
+
+    state(
+      boost::asio::io_context&   io_,
+      origin_options const&      opts_,
+      boost::asio::ssl::context* ctx_)
+    : io(io_)
+    , acceptor(
+        io_,
+        boost::asio::ip::tcp::endpoint(
+          boost::asio::ip::make_address_v4("127.0.0.1"), 0))
+    , ctx(ctx_)
+    , opts(opts_)
+    , body(opts_.body_size, 'x')
+    , connections(0)
+    , requests(0)
+    {
+    }
+  };
+
+  std::shared_ptr<state> s_;
+
+  static auto write_response(
+    foxy::server_session&      session,
+    state const&               s,
+    bool const                 keep_alive,
+    boost::system::error_code& ec) -> foxy::awaitable<void> {
+
+    namespace http = boost::beast::http;
+
+    auto token       = co_await foxy::this_coro::token();
+    auto error_token = foxy::redirect_error(token, ec);
+
+    auto response = http::response<http::buffer_body>(http::status::ok, 11);
+    response.keep_alive(keep_alive);
+
+    if (!s.opts.cache_control.empty()) {
+      response.set(http::field::cache_control, s.opts.cache_control);
+    }
+
+    if (s.opts.chunk_size == 0) {
+      response.content_length(s.body.size());
+    } else {
+      response.chunked(true);
+    }
+
+    auto serializer = http::response_serializer<http::buffer_body>(response);
+
+    auto& body = response.body();
+    auto  sent = std::size_t{0};
+
+    // every buffer handed to the serializer becomes one chunk when the
+    // response is chunked
+    //
+    auto const piece_size =
+      s.opts.chunk_size == 0 ? s.body.size() : s.opts.chunk_size;
+
+    while (true) {
+      auto const n = std::min(piece_size, s.body.size() - sent);
+
+      body.data = n > 0 ? const_cast<char*>(s.body.data() + sent) : nullptr;
+      body.size = n;
+      body.more = n > 0;
+
+      sent += n;
+
+      co_await session.async_write(serializer, error_token);
+      if (ec == http::error::need_buffer) { ec = {}; }
+      if (ec || serializer.is_done()) { co_return; }
+    }
+  }
+
+  static auto serve(foxy::multi_stream stream, std::shared_ptr<state> s)
+  -> foxy::awaitable<void> {
+
+    namespace http = boost::beast::http;
+    namespace ssl  = boost::asio::ssl;
+
+    auto token       = co_await foxy::this_coro::token();
+    auto ec          = boost::system::error_code();
+    auto error_token = foxy::redirect_error(token, ec);
+
+    if (stream.is_ssl()) {
+      co_await stream.ssl_stream().async_handshake(
+        ssl::stream_base::server, error_token);
+
+      if (ec) { co_return; }
+    }
+
+    auto session = foxy::server_session(std::move(stream));
+    auto timer   = boost::asio::steady_timer(s->io);
+
+    for (auto served = std::size_t{1}; true; ++served) {
+      http::request_parser<http::string_body> parser;
+      parser.body_limit(64 * 1024 * 1024);
+
+      co_await session.async_read(parser, error_token);
+      if (ec) { break; }
+
+      ++s->requests;
+
+      if (s->opts.latency.count() > 0) {
+        timer.expires_after(s->opts.latency);
+        co_await timer.async_wait(error_token);
+        ec = {};
+      }
+
+      auto const keep_alive =
+        parser.get().keep_alive() &&
+        s->opts.keep_alive &&
+        (s->opts.max_requests_per_connection == 0 ||
+         served < s->opts.max_requests_per_connection);
+
+      co_await write_response(session, *s, keep_alive, ec);
+      if (ec || !keep_alive) { break; }
+    }
+
+    session.shutdown();
+  }
+
+public:
+  origin()              = delete;
+  origin(origin const&) = delete;
+  origin(origin&&)      = default;
+
+  origin(
+    boost::asio::io_context&   io,
+    origin_options const&      opts = origin_options(),
+    boost::asio::ssl::context* ctx  = nullptr)
+  : s_(std::make_shared<state>(io, opts, ctx))
+  {
+  }
+
+  auto port() const -> std::string {
+    return std::to_string(s_->acceptor.local_endpoint().port());
+  }
+
+  auto endpoint() const -> boost::asio::ip::tcp::endpoint {
+    return s_->acceptor.local_endpoint();
+  }
+
+  auto stats() const -> stats_type {
+    return {s_->connections.load(), s_->requests.load()};
+  }
+
+  auto run() -> void {
+    foxy::co_spawn(
+      s_->io,
+      [s = s_]() -> foxy::awaitable<void> {
+        auto token       = co_await foxy::this_coro::token();
+        auto ec          = boost::system::error_code();
+        auto error_token = foxy::redirect_error(token, ec);
+
+        while (true) {
+          auto stream = s->ctx
+            ? foxy::multi_stream(s->io, *s->ctx)
+            : foxy::multi_stream(s->io);
+
+          co_await s->acceptor.async_accept(stream.stream(), error_token);
+          if (ec) { break; }
+
+          ++s->connections;
+
+          foxy::co_spawn(
+            s->io,
+            [s, stream = std::move(stream)]() mutable {
+              return serve(std::move(stream), s); },
+            foxy::detached);
+        }
+      },
+      foxy::detached);
+  }
+
+  // `stop` closes the listening socket; connections already accepted are
+  // served until their clients hang up
+  //
+  auto stop() -> void {
+    auto ec = boost::system::error_code();
+    s_->acceptor.close(ec);
+  }
+};
+
+} // test
+} // foxy
+
+#endif // FOXY_TEST_ORIGIN_HPP_
@@ -0,0 +1,192 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include "foxy/io_uring.hpp"
+#include "foxy/multi_stream.hpp"
+#include "foxy/detail/uring.hpp"
+
+#include <array>
+#include <string>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+using ip::tcp;
+using boost::system::error_code;
+
+namespace {
+
+// connected_pair hands back a client and a server stream connected over
+// loopback, both created on `io`
+//
+auto connected_pair(asio::io_context& io)
+-> std::pair<foxy::multi_stream, foxy::multi_stream> {
+  auto acceptor = tcp::acceptor(
+    io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+  auto client = foxy::multi_stream(io);
+  auto server = foxy::multi_stream(io);
+
+  client.stream().connect(acceptor.local_endpoint());
+  acceptor.accept(server.stream());
+
+  return {std::move(client), std::move(server)};
+}
+
+} // anonymous
+
+TEST_CASE("Our io_uring engine") {
+  SECTION("should relay data between plaintext streams") {
+    asio::io_context io;
+    if (!foxy::use_io_uring(io)) {
+      WARN("io_uring is unavailable, nothing to test");
+      return;
+    }
+
+    REQUIRE(foxy::uses_io_uring(io));
+
+    auto streams = connected_pair(io);
+    auto& client = streams.first;
+    auto& server = streams.second;
+
+    auto const payload = std::string(1024 * 1024, 'x');
+
+    auto buffer = boost::beast::basic_flat_buffer<
+      foxy::detail::uring_allocator<char>>();
+
+    auto write_ec = error_code();
+    auto read_ec  = error_code();
+    auto written  = std::size_t{0};
+    auto read     = std::size_t{0};
+
+    asio::async_write(
+      client, asio::buffer(payload),
+      [&](error_code ec, std::size_t n) {
+        write_ec = ec;
+        written  = n;
+        client.stream().shutdown(tcp::socket::shutdown_send, ec);
+      });
+
+    // the buffer is read into directly, just as a session's would be
+    //
+    std::function<void(error_code, std::size_t)> on_read =
+      [&](error_code ec, std::size_t n) {
+        buffer.commit(n);
+        read += n;
+
+        if (ec) {
+          read_ec = ec;
+          return;
+        }
+
+        server.async_read_some(buffer.prepare(64 * 1024), on_read);
+      };
+
+    server.async_read_some(buffer.prepare(64 * 1024), on_read);
+
+    io.run();
+
+    REQUIRE(!write_ec);
+    REQUIRE(read_ec == asio::error::eof);
+    REQUIRE(written == payload.size());
+    REQUIRE(read == payload.size());
+    REQUIRE(buffer.size() == payload.size());
+
+    auto const stats = foxy::get_io_uring_stats(io);
+    CHECK(stats.submitted > 0);
+    CHECK(stats.completed == stats.submitted);
+    CHECK(stats.enters > 0);
+  }
+
+  SECTION("should batch submissions made in the same turn") {
+    asio::io_context io;
+    if (!foxy::use_io_uring(io)) {
+      WARN("io_uring is unavailable, nothing to test");
+      return;
+    }
+
+    constexpr auto num_pairs = 16;
+
+    auto pairs =
+      std::vector<std::pair<foxy::multi_stream, foxy::multi_stream>>();
+    for (auto i = 0; i < num_pairs; ++i) {
+      pairs.push_back(connected_pair(io));
+    }
+
+    auto buffers   = std::vector<std::array<char, 4>>(num_pairs);
+    auto completed = 0;
+
+    for (auto i = 0; i < num_pairs; ++i) {
+      asio::async_read(
+        pairs[i].second, asio::buffer(buffers[i]),
+        [&](error_code ec, std::size_t) {
+          if (!ec) { ++completed; }
+        });
+
+      asio::async_write(
+        pairs[i].first, asio::buffer("ping", 4),
+        [](error_code, std::size_t) {});
+    }
+
+    io.run();
+
+    REQUIRE(completed == num_pairs);
+
+    // every read and write was started before the loop ran, so they all went
+    // to the kernel together
+    //
+    auto const stats = foxy::get_io_uring_stats(io);
+    CHECK(stats.submitted == 2 * num_pairs);
+    CHECK(stats.enters < stats.submitted);
+  }
+
+  SECTION("should cancel operations still in flight on destruction") {
+    auto invoked = false;
+    auto buffer  = std::array<char, 16>();
+
+    {
+      asio::io_context io;
+      if (!foxy::use_io_uring(io)) {
+        WARN("io_uring is unavailable, nothing to test");
+        return;
+      }
+
+      auto streams = std::make_unique<
+        std::pair<foxy::multi_stream, foxy::multi_stream>>(connected_pair(io));
+
+      streams->second.async_read_some(
+        asio::buffer(buffer),
+        [&](error_code, std::size_t) { invoked = true; });
+
+      io.run_for(std::chrono::milliseconds(10));
+    }
+
+    REQUIRE(!invoked);
+  }
+
+  SECTION("should leave other io_contexts on the reactor") {
+    asio::io_context io;
+    asio::io_context other;
+
+    auto const enabled = foxy::use_io_uring(io);
+
+    REQUIRE(foxy::uses_io_uring(io) == enabled);
+    REQUIRE(!foxy::uses_io_uring(other));
+
+    auto const stats = foxy::get_io_uring_stats(other);
+    REQUIRE(stats.submitted == 0);
+  }
+}
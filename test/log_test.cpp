@@ -0,0 +1,114 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include "foxy/log.hpp"
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+using ip::tcp;
+using boost::system::error_code;
+
+namespace {
+
+// capture installs a sink which collects everything written to it for the
+// lifetime of the object
+//
+struct capture {
+  std::mutex  mtx;
+  std::string lines;
+
+  capture() {
+    foxy::set_log_sink([this](std::string_view const s) {
+      auto lock = std::lock_guard<std::mutex>(mtx);
+      lines.append(s);
+    });
+  }
+
+  ~capture() {
+    foxy::flush_log();
+    foxy::set_log_sink(nullptr);
+  }
+
+  auto text() -> std::string {
+    foxy::flush_log();
+    auto lock = std::lock_guard<std::mutex>(mtx);
+    return lines;
+  }
+};
+
+} // anonymous
+
+TEST_CASE("Our logger") {
+  SECTION("should write out structured fields") {
+    auto sink = capture();
+
+    auto const endpoint =
+      tcp::endpoint(ip::make_address_v4("127.0.0.1"), 8080);
+
+    foxy::log_event<foxy::log_level::warn>(
+      "upstream connect",
+      foxy::log_fields{
+        42, endpoint, asio::error::connection_refused,
+        std::chrono::microseconds(1500)});
+
+    auto const text = sink.text();
+
+    CHECK(text.find(" warn \"upstream connect\"") != std::string::npos);
+    CHECK(text.find(" session=42") != std::string::npos);
+    CHECK(text.find(" endpoint=127.0.0.1:8080") != std::string::npos);
+    CHECK(text.find(" ec=system:") != std::string::npos);
+    CHECK(text.find(" elapsed_us=1500") != std::string::npos);
+  }
+
+  SECTION("should compile out levels below FOXY_LOG_LEVEL") {
+    auto sink = capture();
+
+    foxy::log_event<foxy::log_level::trace>("compiled out");
+    foxy::log_error(asio::error::eof, "still compiled in");
+
+    auto const text = sink.text();
+
+    CHECK(text.find("compiled out") == std::string::npos);
+    CHECK(text.find(" error \"still compiled in\"") != std::string::npos);
+  }
+
+  SECTION("should rate limit repeated records") {
+    auto sink = capture();
+
+    auto const before = foxy::log_stats();
+
+    auto threads = std::vector<std::thread>();
+    for (auto i = 0; i < 4; ++i) {
+      threads.emplace_back([]() {
+        for (auto j = 0; j < 1000; ++j) {
+          foxy::log_error(asio::error::connection_reset, "accept storm");
+        }
+      });
+    }
+
+    for (auto& t : threads) { t.join(); }
+
+    auto const text  = sink.text();
+    auto const after = foxy::log_stats();
+
+    auto const lines = std::count(text.begin(), text.end(), '\n');
+
+    CHECK(lines > 0);
+    CHECK(lines < 4000);
+    CHECK(
+      lines + (after.suppressed - before.suppressed) +
+      (after.dropped - before.dropped) == 4000);
+  }
+}
@@ -0,0 +1,87 @@
+#include "foxy/metrics.hpp"
+
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("Our metrics") {
+  SECTION("histogram buckets should bound every value within their precision") {
+    auto const values = std::vector<std::uint64_t>{
+      0, 1, 15, 16, 17, 31, 32, 1000, 123456, 999999999, UINT64_MAX};
+
+    for (auto const v : values) {
+      auto const idx   = foxy::histogram::bucket_index(v);
+      auto const upper = foxy::histogram::bucket_upper_bound(idx);
+
+      CHECK(idx < foxy::histogram::num_buckets);
+      CHECK(upper >= v);
+      CHECK(upper - v <= v / foxy::histogram::sub_buckets);
+    }
+  }
+
+  SECTION("histograms should report quantiles") {
+    auto h = foxy::histogram();
+
+    for (auto i = std::uint64_t{1}; i <= 1000; ++i) {
+      h.record(i * 1000);
+    }
+
+    auto const s = h.snapshot();
+
+    CHECK(s.count == 1000);
+    CHECK(s.max == 1000 * 1000);
+    CHECK(s.sum == 500500 * 1000);
+
+    auto const p50 = s.value_at(0.5);
+    auto const p99 = s.value_at(0.99);
+
+    CHECK(p50 >= 500 * 1000);
+    CHECK(p50 <= 500 * 1000 + 500 * 1000 / foxy::histogram::sub_buckets);
+    CHECK(p99 >= 990 * 1000);
+    CHECK(s.value_at(1.0) == s.max);
+  }
+
+  SECTION("counters should add up across threads") {
+    auto c = foxy::counter();
+
+    auto threads = std::vector<std::thread>();
+    for (auto i = 0; i < 8; ++i) {
+      threads.emplace_back([&]() {
+        for (auto j = 0; j < 10000; ++j) { c.add(); }
+      });
+    }
+    for (auto& t : threads) { t.join(); }
+
+    CHECK(c.value() == 80000);
+  }
+
+  SECTION("the registry should export in the Prometheus text format") {
+    auto registry = foxy::metrics_registry();
+
+    auto& requests = registry.make_counter("requests_total", "Requests");
+    auto& active   = registry.make_gauge("active", "Active things");
+    auto& latency  = registry.make_histogram("latency_seconds", "Latency");
+
+    requests.add(3);
+    active.add(2);
+    active.sub();
+    latency.record(std::uint64_t{2000000});
+
+    CHECK(&registry.make_counter("requests_total", "Requests") == &requests);
+
+    auto text = std::string();
+    foxy::write_prometheus(registry.snapshot(), text);
+
+    CHECK(text.find("# TYPE requests_total counter\n") != std::string::npos);
+    CHECK(text.find("requests_total 3\n") != std::string::npos);
+    CHECK(text.find("active 1\n") != std::string::npos);
+    CHECK(text.find("# TYPE latency_seconds summary\n") != std::string::npos);
+    CHECK(
+      text.find("latency_seconds{quantile=\"0.5\"} 0.002\n") !=
+      std::string::npos);
+    CHECK(text.find("latency_seconds_count 1\n") != std::string::npos);
+  }
+}
@@ -0,0 +1,136 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include "foxy/coroutine.hpp"
+#include "foxy/multi_stream.hpp"
+#include "foxy/server_session.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+namespace http = boost::beast::http;
+
+using ip::tcp;
+using boost::system::error_code;
+
+namespace {
+
+auto echo_target(http::request<http::string_body> const& request)
+-> http::response<http::string_body> {
+  auto response = http::response<http::string_body>(http::status::ok, 11);
+  response.body() = std::string(request.target());
+  response.keep_alive(request.keep_alive());
+  response.prepare_payload();
+  return response;
+}
+
+// pipeline writes every request in one go and reads back as many responses
+// as it can
+//
+template <typename Serve>
+auto pipeline(std::vector<std::string> const& targets, Serve serve)
+-> std::vector<std::string> {
+  asio::io_context io;
+
+  auto acceptor = tcp::acceptor(
+    io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+  auto received = std::vector<std::string>();
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    auto stream = foxy::multi_stream(io);
+    acceptor.async_accept(stream.stream(), yield);
+
+    auto session = foxy::server_session(std::move(stream));
+
+    auto ec = error_code();
+    serve(session, yield[ec]);
+    REQUIRE(!ec);
+
+    session.shutdown();
+  });
+
+  asio::spawn(io, [&](asio::yield_context yield) {
+    auto socket = tcp::socket(io);
+    socket.async_connect(acceptor.local_endpoint(), yield);
+
+    auto requests = std::string();
+    for (auto const& target : targets) {
+      requests += "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n";
+      if (&target == &targets.back()) {
+        requests += "Connection: close\r\n";
+      }
+      requests += "\r\n";
+    }
+
+    asio::async_write(socket, asio::buffer(requests), yield);
+
+    auto buffer = boost::beast::flat_buffer();
+    while (true) {
+      auto response = http::response<http::string_body>();
+      auto ec       = error_code();
+      http::async_read(socket, buffer, response, yield[ec]);
+      if (ec) { break; }
+
+      received.push_back(response.body());
+    }
+  });
+
+  io.run();
+
+  return received;
+}
+
+} // anonymous
+
+TEST_CASE("Our server session's pipelining") {
+  auto const targets = std::vector<std::string>{"/a", "/b", "/c", "/d"};
+
+  SECTION("should answer buffered requests in order") {
+    auto& pipelined  = foxy::detail::session_metrics::get().pipelined_requests;
+    auto const prior = pipelined.value();
+
+    auto const received = pipeline(
+      targets,
+      [](foxy::server_session& session, auto&& handler) {
+        session.async_serve(echo_target, handler);
+      });
+
+    CHECK(received == targets);
+
+    // everything after the first request arrived in the same segment
+    //
+    CHECK(pipelined.value() - prior >= 1);
+  }
+
+  SECTION("should wait on awaitable responses") {
+    using strand_type = foxy::server_session::strand_type;
+
+    auto const received = pipeline(
+      targets,
+      [](foxy::server_session& session, auto&& handler) {
+        session.async_serve(
+          [](http::request<http::string_body>& request)
+          -> foxy::awaitable<http::response<http::string_body>, strand_type> {
+            co_return echo_target(request);
+          },
+          handler);
+      });
+
+    CHECK(received == targets);
+  }
+}
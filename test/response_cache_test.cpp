@@ -0,0 +1,249 @@
+#include "foxy/response_cache.hpp"
+
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include <catch2/catch.hpp>
+
+namespace http = boost::beast::http;
+
+using foxy::response_cache;
+using namespace std::chrono_literals;
+
+namespace {
+
+auto make_request(std::string const& target) -> http::request_header<> {
+  auto request = http::request_header<>();
+  request.method(http::verb::get);
+  request.target(target);
+  request.version(11);
+  return request;
+}
+
+auto make_response(std::string const& cache_control)
+-> http::response_header<> {
+  auto response = http::response_header<>();
+  response.result(http::status::ok);
+  response.version(11);
+  response.set(http::field::cache_control, cache_control);
+  return response;
+}
+
+auto body_of(response_cache::cached_response const& cached) -> std::string {
+  auto const body = cached.body();
+  return std::string(static_cast<char const*>(body.data()), body.size());
+}
+
+} // anonymous
+
+TEST_CASE("Our response cache") {
+
+  auto opts = response_cache::options();
+  opts.memory_capacity = 1024 * 1024;
+
+  auto const authority = std::string_view("www.example.com:80");
+  auto const t0        = response_cache::clock_type::now();
+
+  SECTION("should serve fresh responses until they go stale") {
+    auto cache = response_cache(opts);
+
+    auto const request  = make_request("/index.html");
+    auto const response = make_response("public, max-age=60");
+
+    REQUIRE(cache.store(authority, request, response, "hello", t0));
+
+    auto cached = cache.lookup(authority, request, t0 + 10s);
+    REQUIRE(cached);
+    CHECK(body_of(cached) == "hello");
+    CHECK(cached.header()[http::field::content_length] == "5");
+    CHECK(cached.age(t0 + 10s) == 10s);
+
+    // HEAD requests are answered from the same entry
+    //
+    auto head = make_request("/index.html");
+    head.method(http::verb::head);
+    CHECK(cache.lookup(authority, head, t0 + 10s));
+
+    CHECK(!cache.lookup(authority, request, t0 + 60s));
+    CHECK(!cache.lookup("www.example.org:80", request, t0));
+
+    auto const stats = cache.stats();
+    CHECK(stats.hits == 2);
+    CHECK(stats.misses == 2);
+    CHECK(stats.hit_ratio() == Approx(0.5));
+  }
+
+  SECTION("should count the age the response arrived with") {
+    auto cache = response_cache(opts);
+
+    auto const request = make_request("/");
+
+    auto response = make_response("max-age=60");
+    response.set(http::field::age, "50");
+
+    REQUIRE(cache.store(authority, request, response, "", t0));
+    CHECK(cache.lookup(authority, request, t0 + 5s).age(t0 + 5s) == 55s);
+    CHECK(!cache.lookup(authority, request, t0 + 10s));
+
+    auto expired = make_response("public");
+    expired.set(http::field::date, "Sun, 06 Nov 1994 08:49:37 GMT");
+    expired.set(http::field::expires, "Sun, 06 Nov 1994 08:50:37 GMT");
+    CHECK(!cache.store(authority, request, expired, "", t0));
+  }
+
+  SECTION("should only store what a shared cache may") {
+    auto cache = response_cache(opts);
+
+    auto const request = make_request("/");
+
+    CHECK(!cache.store(authority, request, make_response("no-store"), "", t0));
+    CHECK(!cache.store(authority, request, make_response("private"), "", t0));
+    CHECK(!cache.store(authority, request, make_response("no-cache"), "", t0));
+    CHECK(!cache.store(authority, request, make_response("public"), "", t0));
+
+    auto cookie = make_response("max-age=60");
+    cookie.set(http::field::set_cookie, "id=1");
+    CHECK(!cache.store(authority, request, cookie, "", t0));
+
+    auto partial = make_response("max-age=60");
+    partial.result(http::status::partial_content);
+    CHECK(!cache.store(authority, request, partial, "", t0));
+
+    auto authorized = make_request("/");
+    authorized.set(http::field::authorization, "Basic Zm94eQ==");
+    CHECK(!cache.store(
+      authority, authorized, make_response("max-age=60"), "", t0));
+
+    CHECK(cache.stats().stores == 0);
+  }
+
+  SECTION("should let clients insist on going to the origin") {
+    auto cache = response_cache(opts);
+
+    auto request = make_request("/");
+    REQUIRE(cache.store(authority, request, make_response("max-age=60"), "",
+                        t0));
+
+    request.set(http::field::cache_control, "no-cache");
+    CHECK(!cache.lookup(authority, request, t0));
+
+    request.set(http::field::cache_control, "max-age=5");
+    CHECK(!cache.lookup(authority, request, t0 + 10s));
+    CHECK(cache.lookup(authority, request, t0 + 1s));
+
+    request.erase(http::field::cache_control);
+    request.set(http::field::pragma, "no-cache");
+    CHECK(!cache.lookup(authority, request, t0));
+  }
+
+  SECTION("should tell variants apart by the fields named in Vary") {
+    auto cache = response_cache(opts);
+
+    auto response = make_response("max-age=60");
+    response.set(http::field::vary, "Accept-Encoding");
+
+    auto gzip = make_request("/");
+    gzip.set(http::field::accept_encoding, "gzip");
+
+    auto identity = make_request("/");
+
+    REQUIRE(cache.store(authority, gzip, response, "compressed", t0));
+    CHECK(!cache.lookup(authority, identity, t0));
+
+    REQUIRE(cache.store(authority, identity, response, "plain", t0));
+    CHECK(body_of(cache.lookup(authority, gzip, t0)) == "compressed");
+    CHECK(body_of(cache.lookup(authority, identity, t0)) == "plain");
+
+    response.set(http::field::vary, "*");
+    CHECK(!cache.store(authority, identity, response, "", t0));
+  }
+
+  SECTION("should drop what unsafe requests invalidate") {
+    auto cache = response_cache(opts);
+
+    auto const request = make_request("/items");
+    REQUIRE(cache.store(authority, request, make_response("max-age=60"), "",
+                        t0));
+
+    cache.invalidate(authority, "/items");
+    CHECK(!cache.lookup(authority, request, t0));
+    CHECK(cache.stats().memory_bytes == 0);
+  }
+
+  SECTION("should evict the least recently used entries") {
+    opts.memory_capacity = 16 * 8 * 1024;
+    auto cache = response_cache(opts);
+
+    auto const body     = std::string(4 * 1024, 'x');
+    auto const response = make_response("max-age=60");
+
+    for (auto i = 0; i < 256; ++i) {
+      auto const request = make_request("/" + std::to_string(i));
+      REQUIRE(cache.store(authority, request, response, body, t0));
+    }
+
+    auto const stats = cache.stats();
+    CHECK(stats.evictions > 0);
+    CHECK(stats.memory_bytes <= opts.memory_capacity);
+    CHECK(cache.lookup(authority, make_request("/255"), t0));
+  }
+
+  SECTION("should keep large bodies in the slab") {
+    opts.max_memory_object_size = 1024;
+    opts.slab_path              = "foxy_response_cache_test.slab";
+    opts.slab_capacity          = 64 * 1024;
+
+    auto cache = response_cache(opts);
+
+    auto const response = make_response("max-age=60");
+    auto const large    = std::string(24 * 1024, 'a');
+
+    REQUIRE(cache.store(authority, make_request("/a"), response, large, t0));
+    CHECK(cache.stats().slab_bytes == large.size());
+
+    {
+      // a body that's being sent can't be overwritten so there's no room for
+      // the third
+      //
+      auto const pinned = cache.lookup(authority, make_request("/a"), t0);
+      REQUIRE(pinned);
+
+      REQUIRE(cache.store(
+        authority, make_request("/b"), response, std::string(24 * 1024, 'b'),
+        t0));
+
+      CHECK(!cache.store(
+        authority, make_request("/c"), response, std::string(24 * 1024, 'c'),
+        t0));
+
+      CHECK(body_of(pinned) == large);
+    }
+
+    // once it's no longer held, the ring wraps around over it
+    //
+    REQUIRE(cache.store(
+      authority, make_request("/c"), response, std::string(24 * 1024, 'c'),
+      t0));
+
+    CHECK(!cache.lookup(authority, make_request("/a"), t0));
+    CHECK(
+      body_of(cache.lookup(authority, make_request("/c"), t0)) ==
+      std::string(24 * 1024, 'c'));
+
+    CHECK(cache.stats().slab_bytes == 48 * 1024);
+  }
+
+  SECTION("should store nothing when disabled") {
+    opts.memory_capacity = 0;
+    auto cache = response_cache(opts);
+
+    auto const request = make_request("/");
+    CHECK(!cache.store(authority, request, make_response("max-age=60"), "",
+                       t0));
+    CHECK(!cache.lookup(authority, request, t0));
+    CHECK(cache.stats().misses == 0);
+  }
+}
@@ -0,0 +1,96 @@
+#include "foxy/runtime.hpp"
+#include "foxy/detail/buffer_pool.hpp"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <future>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+
+using ip::tcp;
+using foxy::detail::buffer_pool;
+
+TEST_CASE("Our runtime") {
+  SECTION("should run every context on a pinned thread of its own") {
+
+    auto opts = foxy::runtime::options();
+    opts.num_threads = 2;
+
+    auto rt = foxy::runtime(opts);
+    REQUIRE(rt.size() == 2);
+
+    rt.run();
+
+    auto pools = std::vector<buffer_pool*>();
+
+    for (auto idx = std::size_t{0}; idx < rt.size(); ++idx) {
+      auto on_thread = std::promise<bool>();
+      auto pool      = std::promise<buffer_pool*>();
+
+      asio::post(
+        rt.context(idx),
+        [&] {
+          auto is_pinned = true;
+#if defined(__linux__)
+          is_pinned = rt.cpu(idx) < 0 || ::sched_getcpu() == rt.cpu(idx);
+#endif
+          on_thread.set_value(
+            is_pinned && &rt.local_context() == &rt.context(idx));
+
+          pool.set_value(&buffer_pool::local());
+        });
+
+      CHECK(on_thread.get_future().get());
+      pools.push_back(pool.get_future().get());
+    }
+
+    CHECK(pools[0] != pools[1]);
+    CHECK(pools[0] != &buffer_pool::global());
+    CHECK(&buffer_pool::local() == &buffer_pool::global());
+
+    rt.stop();
+    rt.join();
+  }
+
+  SECTION("should adopt connections onto one of its contexts") {
+
+    asio::io_context io;
+
+    auto opts = foxy::runtime::options();
+    opts.num_threads = 2;
+
+    auto rt = foxy::runtime(opts);
+
+    auto acceptor =
+      tcp::acceptor(io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto client = tcp::socket(io);
+    client.connect(acceptor.local_endpoint());
+
+    auto accepted = tcp::socket(io);
+    acceptor.accept(accepted);
+
+    auto stream = rt.adopt(std::move(accepted));
+
+    auto is_ours = false;
+    for (auto idx = std::size_t{0}; idx < rt.size(); ++idx) {
+      is_ours = is_ours || &stream.get_executor().context() == &rt.context(idx);
+    }
+
+    CHECK(is_ours);
+    CHECK(!accepted.is_open());
+    CHECK(stream.stream().remote_endpoint() == client.local_endpoint());
+  }
+}
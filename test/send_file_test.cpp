@@ -0,0 +1,228 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+
+#include "foxy/byte_range.hpp"
+#include "foxy/multi_stream.hpp"
+#include "foxy/server_session.hpp"
+
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <fstream>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+namespace http = boost::beast::http;
+
+using ip::tcp;
+using boost::system::error_code;
+
+TEST_CASE("Our Range header parser") {
+  auto range = foxy::byte_range();
+
+  SECTION("should honor the three forms of a single range") {
+    REQUIRE(
+      foxy::parse_range("bytes=0-499", 10000, range) ==
+      foxy::range_status::satisfiable);
+    CHECK(range.offset == 0);
+    CHECK(range.length == 500);
+
+    REQUIRE(
+      foxy::parse_range("bytes=9500-", 10000, range) ==
+      foxy::range_status::satisfiable);
+    CHECK(range.offset == 9500);
+    CHECK(range.length == 500);
+
+    REQUIRE(
+      foxy::parse_range("bytes=-500", 10000, range) ==
+      foxy::range_status::satisfiable);
+    CHECK(range.offset == 9500);
+    CHECK(range.length == 500);
+  }
+
+  SECTION("should clamp ranges running past the end") {
+    REQUIRE(
+      foxy::parse_range("bytes=100-99999", 1000, range) ==
+      foxy::range_status::satisfiable);
+    CHECK(range.offset == 100);
+    CHECK(range.length == 900);
+
+    REQUIRE(
+      foxy::parse_range("bytes=-5000", 1000, range) ==
+      foxy::range_status::satisfiable);
+    CHECK(range.offset == 0);
+    CHECK(range.length == 1000);
+  }
+
+  SECTION("should ignore what it can't or won't serve") {
+    CHECK(
+      foxy::parse_range("bytes=0-1,5-6", 100, range) ==
+      foxy::range_status::ignored);
+    CHECK(
+      foxy::parse_range("items=0-1", 100, range) ==
+      foxy::range_status::ignored);
+    CHECK(
+      foxy::parse_range("bytes=5-1", 100, range) ==
+      foxy::range_status::ignored);
+    CHECK(
+      foxy::parse_range("bytes=a-b", 100, range) ==
+      foxy::range_status::ignored);
+    CHECK(
+      foxy::parse_range("bytes=99999999999999999999-", 100, range) ==
+      foxy::range_status::ignored);
+  }
+
+  SECTION("should reject ranges beyond the end of the resource") {
+    CHECK(
+      foxy::parse_range("bytes=100-", 100, range) ==
+      foxy::range_status::unsatisfiable);
+    CHECK(
+      foxy::parse_range("bytes=-0", 100, range) ==
+      foxy::range_status::unsatisfiable);
+
+    CHECK(foxy::unsatisfied_range(100) == "bytes */100");
+  }
+
+  SECTION("should format a Content-Range") {
+    CHECK(
+      foxy::content_range(foxy::byte_range{10, 20}, 100) == "bytes 10-29/100");
+  }
+}
+
+TEST_CASE("Our server session's file writes") {
+  // make_file writes `size` bytes of a repeating pattern to a temporary file
+  // and returns its contents
+  //
+  auto const make_file = [](std::string const& path, std::size_t const size) {
+    auto contents = std::string(size, '\0');
+    for (auto i = std::size_t{0}; i < size; ++i) {
+      contents[i] = static_cast<char>('a' + i % 26);
+    }
+
+    auto out = std::ofstream(path, std::ios::binary);
+    out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+
+    return contents;
+  };
+
+  // serve_range opens `path` on a server session and writes `range` of it to
+  // a client reading with plain beast
+  //
+  auto const serve_range = [](
+    std::string const&                 path,
+    foxy::byte_range const             range,
+    error_code&                        write_ec,
+    http::response<http::string_body>& received) {
+
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io);
+      acceptor.async_accept(stream.stream(), yield);
+
+      auto session = foxy::server_session(std::move(stream));
+
+      auto response = http::response<http::file_body>(http::status::ok, 11);
+
+      auto ec = error_code();
+      response.body().open(path.c_str(), boost::beast::file_mode::scan, ec);
+      REQUIRE(!ec);
+
+      session.async_write_file(response, range, yield[write_ec]);
+      session.shutdown();
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+      socket.async_connect(acceptor.local_endpoint(), yield);
+
+      auto buffer = boost::beast::flat_buffer();
+      auto ec     = error_code();
+      http::async_read(socket, buffer, received, yield[ec]);
+    });
+
+    io.run();
+  };
+
+  auto const path = std::string("foxy_send_file_test.bin");
+
+  SECTION("should send the requested range of a large file") {
+    auto const contents = make_file(path, 4 * 1024 * 1024 + 123);
+
+    auto const range    = foxy::byte_range{4097, 3 * 1024 * 1024};
+    auto       ec       = error_code();
+    auto       received = http::response<http::string_body>();
+
+    serve_range(path, range, ec, received);
+    std::remove(path.c_str());
+
+    REQUIRE(!ec);
+    REQUIRE(received.body().size() == range.length);
+    CHECK(received.body() == contents.substr(range.offset, range.length));
+  }
+
+  SECTION("should refuse ranges past the end of the file") {
+    make_file(path, 100);
+
+    auto ec       = error_code();
+    auto received = http::response<http::string_body>();
+
+    serve_range(path, foxy::byte_range{50, 51}, ec, received);
+    std::remove(path.c_str());
+
+    CHECK(ec == asio::error::invalid_argument);
+  }
+
+  SECTION("should give up on a client which stops reading") {
+    make_file(path, 64 * 1024 * 1024);
+
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto write_ec = error_code();
+
+    // the client connects and then never reads a thing, leaving the socket
+    // buffers to fill up
+    //
+    auto client = tcp::socket(io);
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io);
+      acceptor.async_accept(stream.stream(), yield);
+
+      auto session = foxy::server_session(std::move(stream));
+      session.set_timeout(std::chrono::milliseconds(100));
+
+      auto response = http::response<http::file_body>(http::status::ok, 11);
+
+      auto ec = error_code();
+      response.body().open(path.c_str(), boost::beast::file_mode::scan, ec);
+      REQUIRE(!ec);
+
+      session.async_write_file(response, yield[write_ec]);
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      client.async_connect(acceptor.local_endpoint(), yield);
+    });
+
+    io.run();
+    std::remove(path.c_str());
+
+    CHECK(write_ec == asio::error::timed_out);
+  }
+}
@@ -0,0 +1,132 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include "foxy/multi_stream.hpp"
+#include "foxy/socket_options.hpp"
+
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+using ip::tcp;
+using boost::system::error_code;
+
+namespace {
+
+#if defined(__linux__)
+
+template <typename Socket>
+auto get_int(Socket& socket, int const level, int const name) -> int {
+  auto value = 0;
+  auto size  = static_cast<socklen_t>(sizeof(value));
+  ::getsockopt(socket.native_handle(), level, name, &value, &size);
+  return value;
+}
+
+#endif
+
+} // anonymous
+
+TEST_CASE("Our socket options") {
+  asio::io_context io;
+
+  auto acceptor = tcp::acceptor(
+    io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+  SECTION("should default to disabling Nagle's algorithm") {
+    auto client = foxy::multi_stream(io);
+    client.stream().connect(acceptor.local_endpoint());
+
+    auto ec = error_code();
+    foxy::set_stream_options(client, foxy::socket_options(), ec);
+    REQUIRE(!ec);
+
+    auto no_delay = tcp::no_delay();
+    client.stream().get_option(no_delay);
+    CHECK(no_delay.value());
+  }
+
+  SECTION("should apply buffer sizes before connecting") {
+    auto opts                = foxy::socket_options();
+    opts.send_buffer_size    = 64 * 1024;
+    opts.receive_buffer_size = 64 * 1024;
+
+    auto socket = tcp::socket(io);
+    socket.open(tcp::v4());
+
+    auto ec = error_code();
+    foxy::set_connect_options(socket, opts, ec);
+    REQUIRE(!ec);
+
+    auto send_size = asio::socket_base::send_buffer_size();
+    auto recv_size = asio::socket_base::receive_buffer_size();
+    socket.get_option(send_size);
+    socket.get_option(recv_size);
+
+    // Linux doubles what it's asked for to make room for bookkeeping
+    //
+    CHECK(send_size.value() >= opts.send_buffer_size);
+    CHECK(recv_size.value() >= opts.receive_buffer_size);
+
+    socket.connect(acceptor.local_endpoint());
+  }
+
+#if defined(__linux__)
+  SECTION("should set the Linux specific options") {
+    auto opts           = foxy::socket_options();
+    opts.not_sent_lowat = 16 * 1024;
+
+    auto client = foxy::multi_stream(io);
+    client.stream().connect(acceptor.local_endpoint());
+
+    auto ec = error_code();
+    foxy::set_stream_options(client, opts, ec);
+    REQUIRE(!ec);
+
+    CHECK(
+      get_int(client.stream(), IPPROTO_TCP, TCP_NOTSENT_LOWAT) ==
+      opts.not_sent_lowat);
+  }
+
+  SECTION("should turn on fast open for listeners") {
+    auto opts            = foxy::socket_options();
+    opts.fast_open_queue = 16;
+
+    auto ec = error_code();
+    foxy::set_listen_options(acceptor, opts, ec);
+    REQUIRE(!ec);
+
+    CHECK(get_int(acceptor, IPPROTO_TCP, TCP_FASTOPEN) == 16);
+  }
+
+  SECTION("should report failures and carry on with the rest") {
+    auto opts      = foxy::socket_options();
+    opts.busy_poll = 1000 * 1000 * 1000;
+
+    auto client = foxy::multi_stream(io);
+    client.stream().connect(acceptor.local_endpoint());
+
+    client.stream().set_option(tcp::no_delay(false));
+
+    // without CAP_NET_ADMIN, raising the busy poll time fails but Nagle's
+    // algorithm is still turned off
+    //
+    auto ec = error_code();
+    foxy::set_stream_options(client, opts, ec);
+
+    auto no_delay = tcp::no_delay();
+    client.stream().get_option(no_delay);
+    CHECK(no_delay.value());
+  }
+#endif
+}
@@ -0,0 +1,182 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+
+#include "foxy/multi_stream.hpp"
+#include "foxy/server_session.hpp"
+#include "foxy/detail/timer_wheel.hpp"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+namespace http = boost::beast::http;
+
+using ip::tcp;
+using boost::system::error_code;
+using foxy::detail::timer_wheel;
+
+using clock_type = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+TEST_CASE("Our timer wheel") {
+  SECTION("should fire deadlines in order once they've passed") {
+    asio::io_context io;
+
+    auto const start = clock_type::now();
+
+    auto fired   = std::vector<int>();
+    auto elapsed = std::vector<clock_type::duration>();
+    auto timers  = std::vector<std::unique_ptr<timer_wheel::timer>>();
+
+    auto const delays = std::vector<int>{30, 0, 120, 60};
+
+    for (auto idx = 0; idx < static_cast<int>(delays.size()); ++idx) {
+      timers.push_back(std::make_unique<timer_wheel::timer>(
+        io,
+        [&, idx] {
+          fired.push_back(idx);
+          elapsed.push_back(clock_type::now() - start);
+        }));
+
+      timers.back()->expires_after(milliseconds(delays[idx]));
+    }
+
+    CHECK(asio::use_service<timer_wheel>(io).armed() == 4);
+
+    // the wheel stops ticking, and so lets `run` return, once the last
+    // deadline is gone
+    //
+    io.run();
+
+    REQUIRE(fired == std::vector<int>{1, 0, 3, 2});
+    for (auto idx = std::size_t{0}; idx < fired.size(); ++idx) {
+      CHECK(elapsed[idx] >= milliseconds(delays[fired[idx]]));
+    }
+
+    CHECK(asio::use_service<timer_wheel>(io).armed() == 0);
+  }
+
+  SECTION("should push deadlines back and cancel them") {
+    asio::io_context io;
+
+    auto const start = clock_type::now();
+
+    auto pushed_back = clock_type::duration();
+    auto cancelled   = false;
+
+    auto a = timer_wheel::timer(
+      io, [&] { pushed_back = clock_type::now() - start; });
+
+    auto b = timer_wheel::timer(io, [&] { cancelled = true; });
+
+    a.expires_after(milliseconds(20));
+    b.expires_after(milliseconds(20));
+
+    auto step = asio::steady_timer(io);
+    step.expires_after(milliseconds(10));
+    step.async_wait([&](error_code) {
+      a.expires_after(milliseconds(100));
+      b.cancel();
+    });
+
+    io.run();
+
+    CHECK(pushed_back >= milliseconds(110));
+    CHECK(!cancelled);
+  }
+
+  SECTION("should bring deadlines forward") {
+    asio::io_context io;
+
+    auto const start = clock_type::now();
+
+    auto elapsed = clock_type::duration();
+
+    auto t = timer_wheel::timer(
+      io, [&] { elapsed = clock_type::now() - start; });
+
+    t.expires_after(std::chrono::hours(72));
+    t.expires_after(milliseconds(20));
+
+    io.run();
+
+    CHECK(elapsed >= milliseconds(20));
+    CHECK(elapsed < std::chrono::seconds(10));
+  }
+
+  SECTION("should cascade deadlines from the levels above") {
+    asio::io_context io;
+
+    auto const start = clock_type::now();
+
+    auto elapsed = clock_type::duration();
+
+    // more than fits in the lowest level
+    //
+    auto const delay = 70 * timer_wheel::resolution;
+
+    auto t = timer_wheel::timer(
+      io, [&] { elapsed = clock_type::now() - start; });
+
+    t.expires_after(delay);
+
+    io.run();
+
+    CHECK(elapsed >= delay);
+    CHECK(elapsed < delay + 20 * timer_wheel::resolution);
+  }
+
+  SECTION("should time out a session whose peer has gone quiet") {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto read_ec = error_code();
+    auto elapsed = clock_type::duration();
+
+    auto client = tcp::socket(io);
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io);
+      acceptor.async_accept(stream.stream(), yield);
+
+      auto session = foxy::server_session(std::move(stream));
+      session.set_timeout(milliseconds(50));
+
+      auto const start = clock_type::now();
+
+      http::request_parser<http::empty_body> parser;
+      session.async_read_header(parser, yield[read_ec]);
+
+      elapsed = clock_type::now() - start;
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      client.async_connect(acceptor.local_endpoint(), yield);
+
+      // half a request, and then nothing
+      //
+      auto const partial = std::string("GET / HTTP/1.1\r\n");
+      asio::async_write(client, asio::buffer(partial), yield);
+    });
+
+    io.run();
+
+    CHECK(read_ec == asio::error::timed_out);
+    CHECK(elapsed >= milliseconds(50));
+  }
+}
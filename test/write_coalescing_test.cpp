@@ -0,0 +1,112 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/spawn.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+
+#include <boost/beast/http.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/buffers_to_string.hpp>
+
+#include "foxy/multi_stream.hpp"
+#include "foxy/server_session.hpp"
+#include "foxy/detail/queue_output.hpp"
+
+#include <string>
+#include <vector>
+#include <sstream>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+namespace http = boost::beast::http;
+
+using ip::tcp;
+using boost::system::error_code;
+
+namespace {
+
+auto make_response(int const id) -> http::response<http::string_body> {
+  auto response = http::response<http::string_body>(http::status::ok, 11);
+  response.body() = "response number " + std::to_string(id);
+  response.prepare_payload();
+  return response;
+}
+
+} // anonymous
+
+TEST_CASE("Our output queue") {
+  SECTION("should serialize messages the same as Beast does") {
+    auto response = make_response(1);
+
+    auto expected = std::ostringstream();
+    expected << response;
+
+    auto output = boost::beast::flat_buffer();
+    auto ec     = error_code();
+
+    foxy::detail::queue_message(output, response, ec);
+    foxy::detail::queue_message(output, response, ec);
+    REQUIRE(!ec);
+
+    CHECK(
+      boost::beast::buffers_to_string(output.data()) ==
+      expected.str() + expected.str());
+  }
+
+  SECTION("should send back-to-back responses together") {
+    asio::io_context io;
+
+    auto acceptor = tcp::acceptor(
+      io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+    auto write_ec = error_code();
+    auto received = std::vector<std::string>();
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto stream = foxy::multi_stream(io);
+      acceptor.async_accept(stream.stream(), yield);
+
+      auto session = foxy::server_session(std::move(stream));
+
+      for (auto id = 0; id < 3; ++id) {
+        auto response = make_response(id);
+        session.queue_write(response, write_ec);
+        REQUIRE(!write_ec);
+      }
+
+      // the last one picks up the three queued ahead of it
+      //
+      auto response = make_response(3);
+      session.async_write(response, yield[write_ec]);
+
+      session.async_flush(yield[write_ec]);
+      session.shutdown();
+    });
+
+    asio::spawn(io, [&](asio::yield_context yield) {
+      auto socket = tcp::socket(io);
+      socket.async_connect(acceptor.local_endpoint(), yield);
+
+      auto buffer = boost::beast::flat_buffer();
+      for (auto i = 0; i < 4; ++i) {
+        auto response = http::response<http::string_body>();
+        auto ec       = error_code();
+        http::async_read(socket, buffer, response, yield[ec]);
+        if (ec) { break; }
+
+        received.push_back(response.body());
+      }
+    });
+
+    io.run();
+
+    REQUIRE(!write_ec);
+    REQUIRE(received.size() == 4);
+    for (auto id = 0; id < 4; ++id) {
+      CHECK(received[id] == "response number " + std::to_string(id));
+    }
+  }
+}
@@ -0,0 +1,145 @@
+#include <boost/system/error_code.hpp>
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ssl/context.hpp>
+
+#include "foxy/multi_stream.hpp"
+#include "foxy/detail/session_metrics.hpp"
+
+#include <string>
+#include <cstddef>
+
+#include <catch2/catch.hpp>
+
+namespace asio = boost::asio;
+namespace ip   = asio::ip;
+namespace ssl  = asio::ssl;
+using ip::tcp;
+using boost::system::error_code;
+
+namespace {
+
+auto connected_pair(asio::io_context& io)
+-> std::pair<foxy::multi_stream, foxy::multi_stream> {
+  auto acceptor = tcp::acceptor(
+    io, tcp::endpoint(ip::make_address_v4("127.0.0.1"), 0));
+
+  auto client = foxy::multi_stream(io);
+  auto server = foxy::multi_stream(io);
+
+  client.stream().connect(acceptor.local_endpoint());
+  acceptor.accept(server.stream());
+
+  return {std::move(client), std::move(server)};
+}
+
+// send_and_receive writes `payload` from `client` to `server` and hands back
+// whatever `server` read before the client shut down its side
+//
+auto send_and_receive(
+  asio::io_context&   io,
+  foxy::multi_stream& client,
+  foxy::multi_stream& server,
+  std::string const&  payload,
+  error_code&         write_ec) -> std::string {
+
+  auto received = std::string(payload.size(), '\0');
+
+  asio::async_write(
+    client, asio::buffer(payload),
+    [&](error_code ec, std::size_t) {
+      write_ec = ec;
+      client.stream().shutdown(tcp::socket::shutdown_send, ec);
+    });
+
+  asio::async_read(
+    server, asio::buffer(received),
+    [&](error_code ec, std::size_t n) {
+      received.resize(n);
+    });
+
+  io.run();
+  return received;
+}
+
+} // anonymous
+
+TEST_CASE("Our zero-copy send mode") {
+  auto& metrics = foxy::detail::session_metrics::get();
+
+  SECTION("should deliver large writes intact") {
+    asio::io_context io;
+
+    auto streams = connected_pair(io);
+    auto& client = streams.first;
+    auto& server = streams.second;
+
+    auto ec = error_code();
+    client.enable_zerocopy(64 * 1024, ec);
+    if (ec) {
+      WARN("SO_ZEROCOPY is unavailable: " << ec.message());
+      return;
+    }
+
+    auto payload = std::string(8 * 1024 * 1024, '\0');
+    for (auto i = std::size_t{0}; i < payload.size(); ++i) {
+      payload[i] = static_cast<char>(i * 31 % 251);
+    }
+
+    auto const before = metrics.zerocopy_bytes.value();
+
+    auto write_ec = error_code();
+    auto const received =
+      send_and_receive(io, client, server, payload, write_ec);
+
+    REQUIRE(!write_ec);
+    REQUIRE(received.size() == payload.size());
+    REQUIRE(received == payload);
+
+    CHECK(metrics.zerocopy_bytes.value() - before == payload.size());
+  }
+
+  SECTION("should leave writes under the threshold alone") {
+    asio::io_context io;
+
+    auto streams = connected_pair(io);
+    auto& client = streams.first;
+    auto& server = streams.second;
+
+    auto ec = error_code();
+    client.enable_zerocopy(64 * 1024, ec);
+    if (ec) {
+      WARN("SO_ZEROCOPY is unavailable: " << ec.message());
+      return;
+    }
+
+    auto const payload = std::string(4 * 1024, 'x');
+    auto const before  = metrics.zerocopy_bytes.value();
+
+    auto write_ec = error_code();
+    auto const received =
+      send_and_receive(io, client, server, payload, write_ec);
+
+    REQUIRE(!write_ec);
+    REQUIRE(received == payload);
+
+    CHECK(metrics.zerocopy_bytes.value() == before);
+  }
+
+  SECTION("should refuse TLS streams") {
+    asio::io_context io;
+    auto ctx = ssl::context(ssl::context::tlsv12_client);
+
+    auto stream = foxy::multi_stream(io, ctx);
+
+    auto ec = error_code();
+    stream.enable_zerocopy(64 * 1024, ec);
+
+    REQUIRE(ec == asio::error::operation_not_supported);
+  }
+}